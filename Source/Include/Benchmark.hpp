@@ -0,0 +1,91 @@
+#ifndef Header_Benchmark
+#define Header_Benchmark
+
+
+#include "mostQtHeaders.h"
+
+#include <QJsonDocument>
+#include <functional>
+
+
+class LatexDocument;
+class LatexDocuments;
+class LatexCompleterConfig;
+class QLanguageDefinition;
+class QEditor;
+
+
+/*!
+ *	@brief Headless timing of the editing and parsing pipeline
+ *
+ *	Generates synthetic projects of increasing size and times
+ *	loading, structure updates, syntax checking, reference checks,
+ *	line wrapping, BibTeX parsing, completion filtering, search,
+ *	saving and log parsing on them.
+ *	The results are written as JSON so that runs can be compared.
+ */
+
+class Benchmark {
+
+	public:
+
+		struct Corpus {
+
+			QString name;
+			QString dir;
+
+			QStringList texFiles; // root document first
+
+			QString bibFile;
+			QString logFile;
+
+			int lines = 0;
+		};
+
+		struct Result {
+
+			QString corpus;
+			QString stage;
+
+			int lines;
+			int files;
+
+			QVector<double> samples; // milliseconds
+		};
+
+	private:
+
+		QList<Result> results;
+
+		QList<LatexDocument *> docs;
+		QList<QEditor *> editors;
+
+		LatexDocuments * documents = nullptr;
+		QLanguageDefinition * language = nullptr;
+		LatexCompleterConfig * completerConfig = nullptr;
+
+		int runs;
+
+	private:
+
+		void measure(const Corpus &,const QString & stage,const std::function<void()> & prepare,const std::function<void()> & body);
+		void measure(const Corpus &,const QString & stage,const std::function<void()> & body);
+
+		void benchmark(const Corpus &);
+		void loadDocuments(const Corpus &);
+		void closeDocuments();
+
+		QJsonDocument report() const;
+
+	public:
+
+		explicit Benchmark(int runs = 3);
+
+		static Corpus generate(const QString & dir,int lines);
+
+		bool run(const QString & outputFile = QString());
+
+};
+
+
+#endif
@@ -1,7 +1,10 @@
 
 #include "configmanager.h"
+#include "Benchmark.hpp"
 #include "Debug/Logger.hpp"
 
+#include <optional>
+
 
 /*!
  *  @brief Extract info / Format arguments
@@ -34,6 +37,18 @@ std::tuple<QStringList,bool> parseArguments(){
                 continue;
             }
 
+            // the output file is optional
+
+            if(argument == "--benchmark"){
+
+                commandLine << "--benchmark";
+
+                if(hasNext && !arguments[i + 1].startsWith('-'))
+                    commandLine << QFileInfo(arguments[++i]).absoluteFilePath();
+
+                continue;
+            }
+
             if(hasNext){
 
                 const auto value = arguments[++i];
@@ -156,7 +171,10 @@ inline void printHelp(){
             "Show the specified page in the PDF Viewer." )
         << formatArgument(
             "texpath","<Path>",
-            "Uses the given path as first search directory when force resetting." );
+            "Uses the given path as first search directory when force resetting." )
+        << formatArgument(
+            "benchmark","[File]",
+            "Time loading, parsing, search and saving of generated projects and write the results as JSON." );
 }
 
 
@@ -176,21 +194,33 @@ inline void printVersion(){
 
 /*!
  *  @brief Handle commands that don't run MexStudio
- *  @return If the MexStudio doesn't need to be started
+ *  @return The exit code if MexStudio doesn't need to be started
  *  @note Windows GUI does not support stdout
  */
 
-inline bool handleCommandLine(const QStringList & commandLine){
+inline std::optional<int> handleCommandLine(const QStringList & commandLine){
     
     if(commandLine.contains("--help")){
         printHelp();
-        return true;
+        return 0;
     }
 
     if(commandLine.contains("--version")){
         printVersion();
-        return true;
+        return 0;
+    }
+
+    const int benchmark = commandLine.indexOf("--benchmark");
+
+    if(benchmark >= 0){
+
+        auto outputFile = commandLine.value(benchmark + 1);
+
+        if(outputFile.startsWith('-'))
+            outputFile.clear();
+
+        return Benchmark().run(outputFile) ? 0 : 1;
     }
 
-    return false;
+    return std::nullopt;
 }
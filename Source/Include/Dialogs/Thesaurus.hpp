@@ -2,8 +2,49 @@
 #define Header_Thesaurus_Dialog
 
 #include "mostQtHeaders.h"
+#include <QSharedPointer>
+#include <QStringView>
 
-class ThesaurusDatabaseType;
+struct ThesaurusImageHeader;
+struct ThesaurusImageKey;
+struct ThesaurusImageEntry;
+struct ThesaurusImageSuffix;
+
+
+class ThesaurusDatabaseType {
+
+	public:
+
+		QString fileName, userFileName;
+		QMap<QString, QStringList> userWords; //maps category => Category/words
+		QMultiMap<QString, QString> userCategories; //maps word => Category
+		void clear();
+		void load(QFile & file, const QString & imageFileName);
+		void saveUser();
+		QStringList lookup(const QString & key) const;
+		QStringList keysStartingWith(const QString & prefix) const;
+		QStringList keysContaining(const QString & part) const;
+		ThesaurusDatabaseType();
+		~ThesaurusDatabaseType();
+
+	private:
+
+		QSharedPointer<QFile> imageFile; //keeps the mapping alive
+		QByteArray image;
+		const ThesaurusImageHeader * header;
+		const ThesaurusImageKey * keys;
+		const ThesaurusImageEntry * entries;
+		const ThesaurusImageSuffix * suffixes;
+		const QChar * pool;
+
+		bool setImage(const QByteArray & data, const QFileInfo & source);
+		bool mapImage(const QString & imageFileName, const QFileInfo & source);
+		static QByteArray buildImage(QFile & file, const QFileInfo & source);
+		QStringView keyAt(int i) const;
+		QStringView suffixAt(int i) const;
+		int lowerBoundKey(const QString & key) const;
+
+};
 
 
 class ThesaurusDialog: public QDialog {
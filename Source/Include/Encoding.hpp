@@ -3,6 +3,7 @@
 
 
 #include <QTextCodec>
+#include <QVector>
 
 
 namespace Encoding {
@@ -21,7 +22,7 @@ namespace Encoding {
     Codec * QTextCodecForLatexName(QString);
     QStringList latexNamesForTextCodec(const Codec *);
 
-    Codec * guessEncodingBasic(const Bytes & data,int * outSure);
+    Codec * guessEncodingBasic(const Bytes & data,int * outSure,QVector<int> * lineBreaks = nullptr);
     void guessEncoding(const Bytes & data,Codec * & guess, int & sure);
 
 
@@ -45,6 +45,7 @@ HEADERS +=                              \
     $$PWD/Search/ResultWidget.hpp
 
 HEADERS +=                              \
+    $$PWD/Benchmark.hpp                 \
     $$PWD/PackageScanner.hpp           \
     $$PWD/KpathSeaParser.hpp           \
     $$PWD/MiktexPackageScanner.hpp           \
@@ -96,6 +97,7 @@ HEADERS +=                              \
     $$PWD/Latex/EditorView.hpp          \
     $$PWD/Latex/Repository.hpp          \
     $$PWD/Latex/Structure.hpp           \
+    $$PWD/Latex/StructureItems.hpp      \
     $$PWD/Latex/Completer.hpp           \
     $$PWD/Latex/Reference.hpp           \
     $$PWD/Latex/CompletionListModel.hpp           \
@@ -101,6 +101,7 @@ class LatexDocument: public QDocument {
         friend class LatexEditorViewTest;
         friend class ScriptEngineTest;
         friend class SyntaxCheckTest;
+        friend class Benchmark;
 
     private:
 
@@ -166,6 +166,7 @@ class LatexEditorView : public QWidget {
 
 		void setLineMarkToolTip(const QString & tooltip);
 		void updateSettings();
+		void updateLineWrapping();
 
 		QPoint getHoverPosistion(){
 			return m_point;
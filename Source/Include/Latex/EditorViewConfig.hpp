@@ -52,6 +52,8 @@ class LatexEditorViewConfig {
 		bool monitorFilesForExternalChanges;
 		bool silentReload;
 		bool useQSaveFile;
+		int undoHistoryLimitMB; // 0: unlimited
+		bool undoHistorySpill;
 
 		bool autoInsertLRM, visualColumnMode, switchLanguagesDirection, switchLanguagesMath;
 
@@ -14,6 +14,7 @@ class LatexLogModel: public QAbstractTableModel {
 	private:
 
 		QList<LatexLogEntry> log;
+		QVector<int> byLogLine; // entry numbers, stably sorted by log line
 		bool foundType[4];
 		int markIDs[4];
 
@@ -0,0 +1,28 @@
+#ifndef Header_Latex_StructureItems
+#define Header_Latex_StructureItems
+
+
+#include "mostQtHeaders.h"
+
+
+struct StructureEntry;
+
+
+/*!
+ * Keep the items of the structure tree in step with the structure of a document.
+ * The items hold their entry as Qt::UserRole, the groups their key as Qt::UserRole+1.
+ */
+
+void expandStructureItems(QTreeWidgetItem *);
+void indexStructureItems(QTreeWidgetItem *,QHash<StructureEntry *,QTreeWidgetItem *> *);
+void unindexStructureItems(QTreeWidgetItem *,QHash<StructureEntry *,QTreeWidgetItem *> *);
+void copyStructureItemLook(QTreeWidgetItem * current,QTreeWidgetItem * item);
+void syncStructureItems(QTreeWidgetItem * live,QTreeWidgetItem * built,QHash<StructureEntry *,QTreeWidgetItem *> * index = nullptr);
+
+bool structureItemIsCurrent(QTreeWidgetItem *);
+bool structureItemsArePlaced(StructureEntry *,QTreeWidgetItem * built,bool includesIndented);
+
+void forgetStructureEntries(StructureEntry *,QSet<StructureEntry *> *);
+
+
+#endif
@@ -15,8 +15,16 @@
 
 #include "loghighlighter.h"
 
+#include <QPlainTextEdit>
 
-class LogEditor : public QTextEdit {
+
+/*!
+ *	Read-only view of a log or of build messages. Lines are
+ *	colored lazily when they scroll into view, so loading a
+ *	large log costs no more than the plain text layout.
+ */
+
+class LogEditor : public QPlainTextEdit {
 
 	Q_OBJECT
 
@@ -43,7 +51,9 @@ class LogEditor : public QTextEdit {
 
 	private:
 
-		LogHighlighter *highlighter;
+		LogHighlighter highlighter;
+
+		void highlightVisibleBlocks();
 
 };
 
@@ -273,14 +273,28 @@ class Texstudio : public QMainWindow {
 		QEditor *previewEditorPending; bool previewIsAutoCompiling;
 
 		void updateUserToolMenu();
+		void finishLoad(LatexEditorView *edit, LatexDocument *doc, const QString &f_real, bool asProject, bool hidden, bool recheck, bool bibTeXmodified);
 		void linkToEditorSlot(QAction *act, const char *slot, const QList<QVariant> &args);
 
 		bool parseStruct(StructureEntry* se, QVector<QTreeWidgetItem *> &rootVector, QSet<LatexDocument*> *visited=nullptr, QList<QTreeWidgetItem *> *todoList=nullptr, int currentColor=0);
 		void parseStructLocally(StructureEntry* se, QVector<QTreeWidgetItem *> &rootVector, QList<QTreeWidgetItem *> *todoList=nullptr, QList<QTreeWidgetItem *> *labelList=nullptr, QList<QTreeWidgetItem *> *magicList=nullptr, QList<QTreeWidgetItem *> *biblioList=nullptr);
+		QTreeWidgetItem *createStructureItem(StructureEntry *entry);
+		bool patchStructureItems(QTreeWidgetItem *root, LatexDocument *doc);
+
+		// structure tree of the current document, entries which changed since it was last updated
+		// removed entries are dropped from the sets when the document reports them
+		QPointer<LatexDocument> structureTreeDocument;
+		QHash<StructureEntry *, QTreeWidgetItem *> structureTreeItems;
+		QSet<StructureEntry *> structureTreeChanged, structureTreeUpdated;
+		bool structureTreeGroupsChanged;
 
 	private slots:
 
 		void updateTOCs();
+		void patchTOCs();
+		void structureElementAdded(StructureEntry *parent, int row);
+		void structureElementRemoved(StructureEntry *entry, int row);
+		void structureElementUpdated(StructureEntry *entry);
 
 		void updateTOC();
 		void updateCurrentPosInTOC(QTreeWidgetItem *root=nullptr,StructureEntry *old=nullptr,StructureEntry *selected=nullptr);
@@ -304,7 +318,7 @@ class Texstudio : public QMainWindow {
 		void collapseSubitems();
 		StructureEntry *labelForStructureEntry(const StructureEntry *entry);
 
-		void updateStructureLocally();
+		void updateStructureLocally(bool patch=false);
 		void customMenuStructure(const QPoint &pos);
 		void createLabelFromAction();
 
@@ -364,6 +378,10 @@ class Texstudio : public QMainWindow {
 
 		void restoreSession(const Session &s, bool showProgress = true, bool warnMissing = true);
 		Session getCurrentSession();
+		void restoreFileState(LatexEditorView *edView, const FileInSession &f);
+		void restoreDeferredFileState(LatexEditorView *edView);
+		void loadPendingFile(LatexEditorView *edView);
+		void loadNextPendingFile();
 
 	protected slots:
 
@@ -754,6 +772,9 @@ class Texstudio : public QMainWindow {
 		QPixmapCache previewCache;
 
 		bool recheckLabels;
+		bool deferEditorLoad; ///< load() only creates a placeholder editor, see loadPendingFile()
+		QList<LatexEditorView *> pendingFileLoads; ///< placeholder editors of a restored session whose file has not been read yet
+		QHash<LatexEditorView *, FileInSession> deferredFileStates; ///< session state of editors which have not been shown since the session was restored
 
 		bool rememberFollowFromScroll,enlargedViewer;
 
@@ -0,0 +1,610 @@
+#include "Benchmark.hpp"
+#include "buildmanager.h"
+#include "configmanager.h"
+#include "qdocumentsearch.h"
+#include "qeditor.h"
+#include "qformatfactory.h"
+#include "qlanguagefactory.h"
+#include "smallUsefulFunctions.h"
+#include "utilsVersion.h"
+
+#include "BibTex/Parser.hpp"
+#include "Latex/CompletionListModel.hpp"
+#include "Latex/Document.hpp"
+#include "Latex/Log.hpp"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <algorithm>
+
+
+namespace {
+
+const QStringList Vocabulary {
+	"lorem" , "ipsum" , "dolor" , "sit" , "amet" , "consectetur" , "adipiscing" , "elit" ,
+	"sed" , "do" , "eiusmod" , "tempor" , "incididunt" , "ut" , "labore" , "et" , "dolore" ,
+	"magna" , "aliqua" , "enim" , "ad" , "minim" , "veniam" , "quis" , "nostrud" , "the" ,
+	"exercitation" , "ullamco" , "laboris" , "nisi" , "aliquip" , "ex" , "ea" , "commodo" ,
+	"consequat" , "duis" , "aute" , "irure" , "in" , "reprehenderit" , "voluptate" , "of" ,
+	"velit" , "esse" , "cillum" , "fugiat" , "nulla" , "pariatur" , "excepteur" , "sint"
+};
+
+const int CorpusSizes[] = { 10000 , 50000 , 200000 };
+
+const int LinesPerChapter = 1000;
+const int LinesPerBibEntry = 10;
+
+const int WrapWidth = 800; // pixels, an editor on half of a full HD screen
+
+
+/*!
+ *	@brief Deterministic writer of synthetic LaTeX projects
+ */
+
+class Generator {
+
+	private:
+
+		QRandomGenerator rng;
+
+		QStringList labels;
+		int bibEntries;
+
+	public:
+
+		explicit Generator(int lines)
+			: rng(lines)
+			, bibEntries(qMax(1,lines / LinesPerBibEntry)) {}
+
+	private:
+
+		QString word(){
+			return Vocabulary[rng.bounded(Vocabulary.size())];
+		}
+
+		QString text(int words){
+
+			QStringList result;
+
+			for(int i = 0;i < words;i++)
+				result << word();
+
+			return result.join(' ');
+		}
+
+		QString label(const QString & kind,int chapter,int number){
+
+			const auto name = QString("%1:%2:%3").arg(kind).arg(chapter).arg(number);
+
+			labels << name;
+
+			return "\\label{" + name + "}";
+		}
+
+		QString cite(){
+			return QString("\\cite{key%1}").arg(rng.bounded(bibEntries));
+		}
+
+		QString ref(){
+
+			// a few references are dangling, like in a document that is being written
+
+			if(labels.isEmpty() || rng.bounded(20) == 0)
+				return "\\ref{" + text(1) + "}";
+
+			return "\\ref{" + labels[rng.bounded(labels.size())] + "}";
+		}
+
+		QString line(){
+
+			QString result = text(4 + rng.bounded(6));
+
+			switch(rng.bounded(8)){
+			case 0: result += " \\emph{" + text(2) + "}"; break;
+			case 1: result += QString(" $x_{%1}^{2} + \\vect{v}$").arg(rng.bounded(10)); break;
+			case 2: result += " see " + ref(); break;
+			case 3: result += " " + cite(); break;
+			case 4: result += " \\textbf{" + word() + "}"; break;
+			default: break;
+			}
+
+			return result + " " + text(3 + rng.bounded(5)) + ".";
+		}
+
+		QStringList chapter(int number,int lines){
+
+			QStringList out;
+
+			out << QString("\\chapter{%1}").arg(text(3)) << label("chap",number,0) << "";
+
+			int sections = 0 , items = 0;
+
+			while(out.size() < lines){
+
+				if(out.size() / 60 >= sections){
+					sections++;
+					out << QString("\\section{%1}").arg(text(4)) << label("sec",number,sections) << "";
+				}
+
+				items++;
+
+				switch(rng.bounded(7)){
+				case 0:
+					out << "\\begin{equation}" << label("eq",number,items)
+					    << QString("  a_{%1} + \\frac{b}{c} = \\sum_{i=1}^{n} x_i^2").arg(items)
+					    << "\\end{equation}";
+					break;
+				case 1:
+					out << "\\begin{itemize}";
+					for(int i = 0;i < 3;i++)
+						out << "  \\item " + line();
+					out << "\\end{itemize}";
+					break;
+				case 2:
+					out << "\\begin{table}[ht]" << "  \\centering" << "  \\begin{tabular}{lll}" << "    \\hline";
+					for(int i = 0;i < 3;i++)
+						out << QString("    %1 & %2 & %3 \\\\").arg(word(),word()).arg(rng.bounded(100));
+					out << "    \\hline" << "  \\end{tabular}" << "  \\caption{" + text(5) + "}"
+					    << "  " + label("tab",number,items) << "\\end{table}";
+					break;
+				case 3:
+					out << "\\begin{figure}[ht]" << "  \\centering"
+					    << "  \\includegraphics[width=0.8\\linewidth]{figures/figure}"
+					    << "  \\caption{" + text(6) + "}" << "  " + label("fig",number,items) << "\\end{figure}";
+					break;
+				default:
+					for(int i = 4 + rng.bounded(5);i > 0;i--)
+						out << line();
+					if(rng.bounded(10) == 0)
+						out << "% TODO: " + text(4);
+					break;
+				}
+
+				out << "";
+			}
+
+			return out;
+		}
+
+		QStringList bibliography(){
+
+			QStringList out;
+
+			for(int i = 0;i < bibEntries;i++)
+				out << QString("@article{key%1,").arg(i)
+				    << QString("  author = {%1, %2 and %3, %4},").arg(word(),word(),word(),word())
+				    << "  title = {" + text(6) + "},"
+				    << "  journal = {Journal of " + text(2) + "},"
+				    << QString("  year = {%1},").arg(1950 + rng.bounded(75))
+				    << QString("  volume = {%1},").arg(1 + rng.bounded(60))
+				    << QString("  pages = {%1--%2},").arg(i % 300).arg(i % 300 + 12)
+				    << "}" << "";
+
+			return out;
+		}
+
+		QStringList log(int chapters){
+
+			QStringList out;
+
+			out << "This is pdfTeX, Version 3.141592653-2.6-1.40.25 (TeX Live 2023) (preloaded format=pdflatex)"
+			    << "entering extended mode"
+			    << "(./main.tex"
+			    << "LaTeX2e <2023-06-01>"
+			    << "(/usr/share/texlive/texmf-dist/tex/latex/base/book.cls"
+			    << "Document Class: book 2023/05/17 v1.4n Standard LaTeX document class"
+			    << ")";
+
+			int page = 1;
+
+			for(int chapter = 1;chapter <= chapters;chapter++){
+
+				out << QString("(./chapters/chapter%1.tex [%2]").arg(chapter).arg(page++);
+
+				for(int i = LinesPerChapter / 20;i > 0;i--){
+
+					const int line = 1 + rng.bounded(LinesPerChapter);
+
+					switch(rng.bounded(6)){
+					case 0:
+						out << QString("LaTeX Warning: Reference `%1' on page %2 undefined on input line %3.").arg(word()).arg(page).arg(line) << "";
+						break;
+					case 1:
+						out << QString("LaTeX Warning: Citation `key%1' on page %2 undefined on input line %3.").arg(rng.bounded(bibEntries)).arg(page).arg(line) << "";
+						break;
+					case 2:
+						out << QString("Overfull \\hbox (%1.2pt too wide) in paragraph at lines %2--%3").arg(rng.bounded(40)).arg(line).arg(line + 3)
+						    << "[]\\T1/cmr/m/n/10.95 " + text(8) << "";
+						break;
+					case 3:
+						out << QString("Underfull \\hbox (badness 10000) in paragraph at lines %1--%2").arg(line).arg(line + 1) << "";
+						break;
+					case 4:
+						out << "! Undefined control sequence." << QString("l.%1 \\%2").arg(line).arg(word()) << "";
+						break;
+					default:
+						out << QString("[%1]").arg(page++);
+						break;
+					}
+				}
+
+				out << ")";
+			}
+
+			out << QString("Output written on main.pdf (%1 pages, %2 bytes).").arg(page).arg(page * 4096)
+			    << "Transcript written on main.log.";
+
+			return out;
+		}
+
+	public:
+
+		Benchmark::Corpus write(const QString & dir,int lines){
+
+			Benchmark::Corpus corpus;
+
+			corpus.name = QString("%1k").arg(lines / 1000);
+			corpus.dir = dir;
+
+			QDir().mkpath(dir + "/chapters");
+
+			const auto save = [ & ](const QString & name,const QStringList & content){
+
+				QFile file(dir + "/" + name);
+
+				if(file.open(QFile::WriteOnly | QFile::Truncate))
+					file.write((content.join('\n') + '\n').toUtf8());
+
+				return file.fileName();
+			};
+
+			const int chapters = qMax(1,lines / LinesPerChapter);
+
+			QStringList main;
+
+			main << "\\documentclass[11pt]{book}"
+			     << "\\usepackage[utf8]{inputenc}"
+			     << "\\usepackage{amsmath,amssymb}"
+			     << "\\usepackage{graphicx}"
+			     << "\\usepackage{hyperref}"
+			     << "\\newcommand{\\vect}[1]{\\mathbf{#1}}"
+			     << "\\newcommand{\\R}{\\mathbb{R}}"
+			     << "\\begin{document}"
+			     << "\\tableofcontents";
+
+			for(int chapter = 1;chapter <= chapters;chapter++)
+				main << QString("\\input{chapters/chapter%1}").arg(chapter);
+
+			main << "\\bibliographystyle{plain}" << "\\bibliography{references}" << "\\end{document}";
+
+			corpus.texFiles << save("main.tex",main);
+			corpus.lines += main.size();
+
+			for(int chapter = 1;chapter <= chapters;chapter++){
+
+				const auto content = this -> chapter(chapter,LinesPerChapter);
+
+				corpus.texFiles << save(QString("chapters/chapter%1.tex").arg(chapter),content);
+				corpus.lines += content.size();
+			}
+
+			corpus.bibFile = save("references.bib",bibliography());
+			corpus.logFile = save("main.log",log(chapters));
+
+			return corpus;
+		}
+
+};
+
+
+double median(QVector<double> samples){
+
+	if(samples.isEmpty())
+		return 0;
+
+	std::sort(samples.begin(),samples.end());
+
+	return samples[samples.size() / 2];
+}
+
+}
+
+
+Benchmark::Benchmark(int runs)
+	: runs(qMax(1,runs)) {}
+
+
+/*!
+ *	@brief Write a synthetic project of about \a lines lines of LaTeX to \a dir
+ *
+ *	The project consists of a root document which \\input s one file per
+ *	chapter, a BibTeX file with one entry per ten lines and a pdflatex log.
+ *	The content only depends on \a lines, so runs are comparable.
+ */
+
+Benchmark::Corpus Benchmark::generate(const QString & dir,int lines){
+	return Generator(lines).write(dir,lines);
+}
+
+
+void Benchmark::measure(
+	const Corpus & corpus,
+	const QString & stage,
+	const std::function<void()> & prepare,
+	const std::function<void()> & body
+){
+
+	Result result { corpus.name , stage , corpus.lines , corpus.texFiles.size() , {} };
+
+	for(int run = 0;run < runs;run++){
+
+		if(prepare)
+			prepare();
+
+		QElapsedTimer timer;
+		timer.start();
+
+		body();
+
+		result.samples << timer.nsecsElapsed() / 1e6;
+	}
+
+	QTextStream(stderr)
+		<< QString("%1 %2: %3 ms\n").arg(corpus.name,-5).arg(stage,-10).arg(median(result.samples),0,'f',1);
+
+	results << result;
+}
+
+
+void Benchmark::measure(const Corpus & corpus,const QString & stage,const std::function<void()> & body){
+	measure(corpus,stage,nullptr,body);
+}
+
+
+void Benchmark::loadDocuments(const Corpus & corpus){
+
+	const auto codec = QTextCodec::codecForName("UTF-8");
+
+	for(const auto & fileName : corpus.texFiles){
+
+		auto document = new LatexDocument();
+		document -> setLanguageDefinition(language);
+		document -> load(fileName,codec);
+		document -> setFileName(fileName);
+
+		// like documents loaded for \input, all but the root are hidden
+		documents -> addDocument(document,!docs.isEmpty());
+
+		docs << document;
+	}
+}
+
+
+void Benchmark::closeDocuments(){
+
+	qDeleteAll(editors);
+	editors.clear();
+
+	documents -> documents.clear();
+	documents -> hiddenDocuments.clear();
+
+	qDeleteAll(docs);
+	docs.clear();
+}
+
+
+void Benchmark::benchmark(const Corpus & corpus){
+
+	measure(corpus,"load",[ & ]{ closeDocuments(); },[ & ]{ loadDocuments(corpus); });
+
+	measure(corpus,"structure",[ & ]{
+		for(auto document : docs)
+			document -> updateStructure();
+	});
+
+	measure(corpus,"syntax",[ & ]{
+		for(auto document : docs)
+			document -> reCheckSyntax();
+		for(auto document : docs)
+			document -> SynChecker.waitForQueueProcess();
+	});
+
+	// restoring a session skips these two for tabs which are not shown yet
+
+	measure(corpus,"refs",[ & ]{
+		for(auto document : docs)
+			document -> recheckRefsLabels();
+	});
+
+	measure(corpus,"wrap",[ & ]{
+		for(auto document : docs)
+			document -> clearWidthConstraint();
+	},[ & ]{
+		for(auto document : docs)
+			document -> setWidthConstraint(WrapWidth);
+	});
+
+	measure(corpus,"bibtex",[ & ]{
+		BibTex::FileInfo bibTex;
+		bibTex.codec = QTextCodec::codecForName("UTF-8");
+		bibTex.loadIfModified(QFileInfo(corpus.bibFile));
+	});
+
+	measure(corpus,"completion",[ & ]{
+
+		CodeSnippetList userCommands;
+		QSet<QString> labels;
+
+		for(auto document : docs){
+			userCommands.unite(document -> userCommandList());
+			labels.unite(convertStringListtoSet(document -> labelItems()));
+		}
+
+		CompletionListModel commands , references;
+		commands.setBaseWords(completerConfig -> words,userCommands,CT_COMMANDS);
+		references.setBaseWords(labels,CT_LABELS);
+
+		const QStringList prefixes { "\\" , "\\s" , "\\se" , "\\sec" , "\\te" , "\\textb" , "\\beg" , "\\vec" , "\\lab" };
+
+		for(const int mode : { 0 , 3 , 2 }) // typical, all, fuzzy
+			for(const auto & prefix : prefixes)
+				commands.filterList(prefix,mode);
+
+		for(const auto & prefix : { "s" , "sec:" , "sec:1" , "eq:" , "fig:2" })
+			references.filterList(prefix,0);
+	});
+
+	for(auto document : docs)
+		editors << new QEditor(false,nullptr,document);
+
+	measure(corpus,"search",[ & ]{
+
+		const QList<QPair<QString,QDocumentSearch::Options>> queries {
+			{ "section" , QDocumentSearch::Options() } ,
+			{ "the" , QDocumentSearch::WholeWords } ,
+			{ "\\label" , QDocumentSearch::CaseSensitive } ,
+			{ "\\\\(ref|cite)\\{[^}]*\\}" , QDocumentSearch::RegExp }
+		};
+
+		for(auto editor : editors)
+			for(const auto & [ text , options ] : queries){
+				QDocumentSearch search(editor,text,options | QDocumentSearch::Silent);
+				search.next(false,true,false,false);
+			}
+	});
+
+	const QString savedDir = corpus.dir + "/saved";
+
+	measure(corpus,"save",[ & ]{
+		QDir().mkpath(savedDir + "/chapters");
+		for(int i = 0;i < editors.size();i++)
+			editors[i] -> saveCopy(savedDir + "/" + QDir(corpus.dir).relativeFilePath(docs[i] -> getFileName()));
+	});
+
+	measure(corpus,"log",[ & ]{
+
+		QFile file(corpus.logFile);
+
+		if(!file.open(QFile::ReadOnly))
+			return;
+
+		QTextDocument log;
+		log.setPlainText(QString::fromUtf8(file.readAll()));
+
+		LatexLogModel model;
+		model.parseLogDocument(& log,QFileInfo(corpus.texFiles.first()).completeBaseName());
+	});
+
+	closeDocuments();
+}
+
+
+QJsonDocument Benchmark::report() const {
+
+	QJsonArray entries;
+
+	for(const auto & result : results){
+
+		QJsonArray samples;
+
+		for(const auto sample : result.samples)
+			samples << sample;
+
+		entries << QJsonObject {
+			{ "corpus" , result.corpus } ,
+			{ "stage" , result.stage } ,
+			{ "lines" , result.lines } ,
+			{ "files" , result.files } ,
+			{ "min_ms" , * std::min_element(result.samples.begin(),result.samples.end()) } ,
+			{ "median_ms" , median(result.samples) } ,
+			{ "samples_ms" , samples }
+		};
+	}
+
+	return QJsonDocument(QJsonObject {
+		{ "version" , TXSVERSION } ,
+		{ "revision" , TEXSTUDIO_GIT_REVISION } ,
+		{ "qt" , qVersion() } ,
+		{ "runs" , runs } ,
+		{ "results" , entries }
+	});
+}
+
+
+/*!
+ *	@brief Benchmark all corpus sizes and write the results to \a outputFile or stdout
+ *
+ *	Settings are read from a temporary directory unless --config was given,
+ *	so that the user's configuration does not influence the timings.
+ */
+
+bool Benchmark::run(const QString & outputFile){
+
+	QTemporaryDir settingsDir , workDir;
+
+	if(!settingsDir.isValid() || !workDir.isValid()){
+		QTextStream(stderr) << "Could not create a temporary directory\n";
+		return false;
+	}
+
+	if(ConfigManager::configDirOverride.isEmpty())
+		ConfigManager::configDirOverride = settingsDir.path();
+
+	LatexParser latexParser;
+	ConfigManager configManager;
+	BuildManager buildManager;
+
+	configManager.buildManager = & buildManager;
+	configManager.readSettings();
+
+	completerConfig = configManager.completerConfig;
+
+	QFormatFactory formats(":/qxs/defaultFormats.qxf");
+	const auto defaultFormats = QDocument::defaultFormatScheme();
+	QDocument::setDefaultFormatScheme(& formats);
+
+	QLanguageFactory languages(& formats);
+	languages.addDefinitionPath(QFileInfo(findResourceFile("qxs/tex.qnfa")).path());
+	language = languages.languageData("(La)TeX").d;
+
+	LatexDocuments documents;
+	this -> documents = & documents;
+
+	for(const int lines : CorpusSizes){
+
+		const auto corpus = generate(workDir.path() + QString("/%1").arg(lines),lines);
+
+		QTextStream(stderr) << QString("%1: %2 lines in %3 files\n").arg(corpus.name).arg(corpus.lines).arg(corpus.texFiles.size());
+
+		benchmark(corpus);
+	}
+
+	this -> documents = nullptr;
+	this -> completerConfig = nullptr;
+
+	QDocument::setDefaultFormatScheme(defaultFormats);
+
+	const auto json = report().toJson();
+
+	if(outputFile.isEmpty()){
+		QTextStream(stdout) << json;
+		return true;
+	}
+
+	QFile file(outputFile);
+
+	if(!file.open(QFile::WriteOnly | QFile::Truncate)){
+		QTextStream(stderr) << "Could not write " << outputFile << "\n";
+		return false;
+	}
+
+	if(file.write(json) != json.size()){
+		QTextStream(stderr) << "Could not write " << outputFile << "\n";
+		return false;
+	}
+
+	return true;
+}
@@ -1,6 +1,7 @@
 #include "Include/Encoding.hpp"
 #include "latexparser/latexparser.h"
 
+#include <cstring>
 #include <vector>
 
 namespace Encoding {
@@ -313,7 +314,29 @@ QStringList latexNamesForTextCodec(const QTextCodec * codec){
 }
 
 
-QTextCodec * guessEncodingBasic(const QByteArray & data,int * outSure){
+/// true if the 8 bytes contain neither line breaks, nor zeros, nor non-ASCII characters
+
+static bool isPlainAscii(quint64 word){
+
+	const quint64 ones = 0x0101010101010101ULL;
+	const quint64 highs = 0x8080808080808080ULL;
+
+	const auto hasZero = [ & ](quint64 x){
+		return (x - ones) & ~x & highs;
+	};
+
+	return
+		! (word & highs) &&
+		! hasZero(word) &&
+		! hasZero(word ^ (ones * '\n')) &&
+		! hasZero(word ^ (ones * '\r'));
+}
+
+
+/// \param lineBreaks if given, receives the indices of all '\n' and '\r' bytes,
+/// which are line breaks in all ASCII compatible encodings
+
+QTextCodec * guessEncodingBasic(const QByteArray & data,int * outSure,QVector<int> * lineBreaks){
 	
 	const char * str = data.data();
 	int size = data.size();
@@ -331,35 +354,72 @@ QTextCodec * guessEncodingBasic(const QByteArray & data,int * outSure){
 		
 		if(prev >= 0x80 && prev <= 0x9F)
 			badIso1++;
+
+		if(lineBreaks && (prev == '\n' || prev == '\r'))
+			lineBreaks -> append(0);
 		
-		for(int i = 1;i < size;i++){
+		int i = 1;
 
-			unsigned char cur = str[i];
+		while(i < size){
 
-			if(cur >= 0x80 && cur <= 0x9F)
-				badIso1++;
-			
-			if((cur & 0xC0) == 0x80){
-				
-				if((prev & 0xC0) == 0xC0)
-					goodUtf8++;
-				else 
-				if((prev & 0x80) == 0x00)
-					badUtf8++;
-			} else {
-				
-				if((prev & 0xC0) == 0xC0)
-					badUtf8++;
-				
-				if(prev == 0) {
-					if((i & 1) == 1)
-						utf16be++;
-					else
-						utf16le++;
+			// Plain ASCII text only affects the statistics through its
+			// first byte, so it is skipped 8 bytes at a time
+
+			if(i + 8 <= size){
+
+				quint64 word;
+				memcpy(& word,str + i,8);
+
+				if(isPlainAscii(word)){
+
+					if((prev & 0xC0) == 0xC0)
+						badUtf8++;
+
+					if(prev == 0) {
+						if((i & 1) == 1)
+							utf16be++;
+						else
+							utf16le++;
+					}
+
+					prev = str[i + 7];
+					i += 8;
+					continue;
 				}
 			}
 
-			prev = cur;
+			for(const int end = qMin(i + 8,size);i < end;i++){
+
+				unsigned char cur = str[i];
+
+				if(cur >= 0x80 && cur <= 0x9F)
+					badIso1++;
+				
+				if((cur & 0xC0) == 0x80){
+					
+					if((prev & 0xC0) == 0xC0)
+						goodUtf8++;
+					else 
+					if((prev & 0x80) == 0x00)
+						badUtf8++;
+				} else {
+					
+					if((prev & 0xC0) == 0xC0)
+						badUtf8++;
+					
+					if(prev == 0) {
+						if((i & 1) == 1)
+							utf16be++;
+						else
+							utf16le++;
+					}
+
+					if(lineBreaks && (cur == '\n' || cur == '\r'))
+						lineBreaks -> append(i);
+				}
+
+				prev = cur;
+			}
 		}
 
 		// less than 0.1% of the characters can be wrong for utf-16 if at least 1% are valid (for English text)
@@ -2,6 +2,83 @@
 #include "utilsSystem.h"
 
 
+/*
+ *	Directory listings shared by all searches, so that
+ *	lookups and especially misses are answered without
+ *	a filesystem round trip per searched directory.
+ *	A listing is dropped as soon as the watcher reports
+ *	a change of its directory.
+ *	Only used from the GUI thread, which owns the watcher.
+ */
+
+namespace {
+
+	enum Presence { Absent , Listed , Unknown };
+
+	const int maxListings = 64;
+
+	QHash<QString,QSet<QString>> listings;
+	QFileSystemWatcher * watcher = nullptr;
+
+
+	inline QString listingKey(const QString & fileName){
+		#if defined(Q_OS_WIN32) || defined(Q_OS_MAC)
+			return fileName.toLower();
+		#else
+			return fileName;
+		#endif
+	}
+
+	const QSet<QString> * listingOf(const QString & directory){
+
+		const auto app = QCoreApplication::instance();
+
+		if(!app || QThread::currentThread() != app -> thread())
+			return nullptr;
+
+		const auto cached = listings.constFind(directory);
+
+		if(cached != listings.constEnd())
+			return & cached.value();
+
+		if(!watcher){
+			watcher = new QFileSystemWatcher(app);
+			QObject::connect(watcher,& QFileSystemWatcher::directoryChanged,[](const QString & changed){
+				listings.remove(changed);
+				watcher -> removePath(changed);
+			});
+		}
+
+		// Directories which do not exist (yet) cannot be watched
+
+		if(!watcher -> addPath(directory))
+			return nullptr;
+
+		if(listings.size() >= maxListings)
+			FindInDirs::clearCache();
+
+		QSet<QString> names;
+
+		for(const auto & name : QDir(directory).entryList(QDir::Files | QDir::Hidden))
+			names.insert(listingKey(name));
+
+		return & listings.insert(directory,names).value();
+	}
+
+	Presence presenceOf(const QFileInfo & info){
+
+		const auto listing = listingOf(QDir::cleanPath(info.absolutePath()));
+
+		if(!listing)
+			return Unknown;
+
+		return listing -> contains(listingKey(info.fileName()))
+			? Listed
+			: Absent ;
+	}
+}
+
+
 /*!
  * \brief     Creates a search object with search modifiers.
  * \param[in] mostRecent From all matching files return the most recent one.
@@ -118,7 +195,54 @@ QString FindInDirs::findAbsolute(const QString & path) const {
 
 
 bool FindInDirs::findCheckFile(const QFileInfo & info) const {
-	return (m_checkReadable) 
-		? info.isReadable() 
-		: info.exists();
+
+	switch(presenceOf(info)){
+	case Absent :
+		return false;
+	case Listed :
+		return (m_checkReadable)
+			? info.isReadable()
+			: true;
+	default:
+		return (m_checkReadable) 
+			? info.isReadable() 
+			: info.exists();
+	}
+}
+
+
+/*!
+ * \brief Drops the cached listings of the loaded search directories.
+ * \details Like clearCache(), but for callers which know where files were just
+ * created. The listings of all other directories are kept.
+ */
+
+void FindInDirs::clearCachedDirs() const {
+
+	if(listings.isEmpty())
+		return;
+
+	for(const auto & directory : m_absDirs){
+
+		const auto key = QDir::cleanPath(QDir(directory).absolutePath());
+
+		if(listings.remove(key) && watcher)
+			watcher -> removePath(key);
+	}
+}
+
+
+/*!
+ * \brief Drops all cached directory listings.
+ * \details Listings are invalidated by a file system watcher, but its notifications
+ * arrive through the event loop. Callers which just created files, e.g. after a build
+ * step finished, clear the cache so that the new files are found immediately.
+ */
+
+void FindInDirs::clearCache(){
+
+	if(watcher && !listings.isEmpty())
+		watcher -> removePaths(listings.keys());
+
+	listings.clear();
 }
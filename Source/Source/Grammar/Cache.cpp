@@ -0,0 +1,183 @@
+#include "grammarcheck.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+
+
+const quint32 CacheMagic = 0x54585347; // "TXSG"
+const quint32 CacheVersion = 1;
+
+
+GrammarCheckCache::GrammarCheckCache(int maxSentences)
+	: entries(maxSentences)
+	, modified(false) {}
+
+
+/*!
+ * \brief GrammarCheckCache::splitSentences
+ * Splits the text of a block (words joined by single spaces) into sentences.
+ * A sentence ends with . ! or ? followed by a space and an upper case letter.
+ * After a period, short words like "Dr." or "e.g." do not end a sentence,
+ * since splitting within a sentence would make the backend report errors
+ * that are not there.
+ * \param text
+ * \return sentences, covering the whole text except the separating spaces
+ */
+
+QList<GrammarCheckCache::Sentence> GrammarCheckCache::splitSentences(const QString & text){
+
+	QList<Sentence> sentences;
+
+	int start = 0;
+	int wordStart = 0;
+
+	for(int i = 0;i + 2 < text.length();i++){
+
+		if(text[i] == ' ')
+			wordStart = i + 1;
+
+		if(!QString(".!?").contains(text[i]) || text[i + 1] != ' ' || !text[i + 2].isUpper())
+			continue;
+
+		const auto word = QStringView(text).mid(wordStart,i + 1 - wordStart);
+
+		if(text[i] == '.' && (word.length() <= 3 || word.count('.') > 1))
+			continue;
+
+		sentences << Sentence { start , i + 1 - start };
+		start = i + 2;
+	}
+
+	if(start < text.length())
+		sentences << Sentence { start , int(text.length()) - start };
+
+	return sentences;
+}
+
+
+QByteArray GrammarCheckCache::key(const QString & language,const QString & rules,const QString & sentence){
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+
+	hash.addData((language + '\n' + rules + '\n').toUtf8());
+	hash.addData(sentence.toUtf8());
+
+	return hash.result();
+}
+
+
+bool GrammarCheckCache::lookup(const QString & language,const QString & rules,const QString & sentence,QList<GrammarError> & errors){
+
+	const auto cached = entries.object(key(language,rules,sentence));
+
+	if(!cached)
+		return false;
+
+	errors = * cached;
+	return true;
+}
+
+
+void GrammarCheckCache::insert(const QString & language,const QString & rules,const QString & sentence,const QList<GrammarError> & errors){
+	entries.insert(key(language,rules,sentence),new QList<GrammarError>(errors));
+	modified = true;
+}
+
+
+void GrammarCheckCache::clear(){
+	entries.clear();
+	modified = true;
+}
+
+
+bool GrammarCheckCache::load(const QString & fileName){
+
+	QFile file(fileName);
+
+	if(!file.open(QIODevice::ReadOnly))
+		return false;
+
+	QDataStream stream(& file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic, version, count;
+	stream >> magic >> version >> count;
+
+	if(magic != CacheMagic || version != CacheVersion)
+		return false;
+
+	for(quint32 i = 0;i < count && stream.status() == QDataStream::Ok;i++){
+
+		QByteArray key;
+		qint32 errorCount;
+
+		stream >> key >> errorCount;
+
+		auto errors = new QList<GrammarError>();
+
+		for(qint32 e = 0;e < errorCount && stream.status() == QDataStream::Ok;e++){
+
+			GrammarError error;
+			qint32 offset, length, type;
+
+			stream >> offset >> length >> type >> error.message >> error.corrections;
+
+			error.offset = offset;
+			error.length = length;
+			error.error = static_cast<GrammarErrorType>(type);
+
+			errors -> append(error);
+		}
+
+		if(stream.status() != QDataStream::Ok){
+			delete errors;
+			break;
+		}
+
+		entries.insert(key,errors);
+	}
+
+	modified = false;
+	return stream.status() == QDataStream::Ok;
+}
+
+
+bool GrammarCheckCache::save(const QString & fileName){
+
+	if(!modified)
+		return true;
+
+	QSaveFile file(fileName);
+
+	if(!file.open(QIODevice::WriteOnly))
+		return false;
+
+	QDataStream stream(& file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	const auto keys = entries.keys();
+
+	stream << CacheMagic << CacheVersion << quint32(keys.size());
+
+	for(const auto & key : keys){
+
+		const auto & errors = * entries.object(key);
+
+		stream << key << qint32(errors.size());
+
+		for(const auto & error : errors)
+			stream
+				<< qint32(error.offset)
+				<< qint32(error.length)
+				<< qint32(error.error)
+				<< error.message
+				<< error.corrections;
+	}
+
+	if(!file.commit())
+		return false;
+
+	modified = false;
+	return true;
+}
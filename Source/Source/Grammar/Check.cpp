@@ -4,6 +4,7 @@
 #include "latexparser/latexreader.h"
 
 #include <QThread>
+#include <QtConcurrentMap>
 #include <QJsonDocument>
 #include <QJsonArray>
 
@@ -57,6 +58,8 @@ GrammarCheck::GrammarCheck(QObject * parent)
 	, ltstatus(LTS_Unknown)
 	, backend(nullptr)
 	, ticket(0)
+	, cursorDoc(nullptr)
+	, cursorLine(0)
 	, pendingProcessing(false)
 	, shuttingDown(false) {
 
@@ -131,6 +134,27 @@ QString GrammarCheck::getLastErrorMessage(){
     return backend -> getLastErrorMessage();
 }
 
+/*!
+ * \brief GrammarCheck::statistics
+ * The counters are owned by the grammar check thread, call this through a blocking queued connection from other threads
+ */
+QString GrammarCheck::statistics(){
+    return backend ? backend -> statistics() : QString();
+}
+
+
+/*!
+ * \brief GrammarCheck::setCursorLine
+ * Blocks close to the cursor are checked first
+ * \param doc document being edited
+ * \param lineNr line of the cursor
+ */
+
+void GrammarCheck::setCursorLine(LatexDocument * doc,int lineNr){
+	cursorDoc = doc;
+	cursorLine = lineNr;
+}
+
 
 /*!
  * \brief readWordList
@@ -230,6 +254,30 @@ void GrammarCheck::check(
 		}
 	}
 
+	// blocks of requests which were already passed to the backend are not sent anymore if all their lines changed again
+
+	if(backend)
+		for(const auto & request : requests){
+
+			if(request.pending)
+				continue;
+
+			bool superseded = true;
+
+			for(const auto & line : request.inlines){
+
+				auto it = tickets.constFind(line.line);
+
+				if(it != tickets.constEnd() && it.value().first == request.ticket){
+					superseded = false;
+					break;
+				}
+			}
+
+			if(superseded)
+				backend -> cancel(request.ticket);
+		}
+
 	requests << CheckRequest(
 		languageFromHunspellToLanguageTool(language),
 		doc,inlines,firstLineNr,ticket
@@ -508,17 +556,33 @@ void GrammarCheck::process(int requestId){
 	}
 
 
+	// the local checks do not wait for the backend, its errors are added in backendChecked
+
+	checkLocally(request,! backend -> isAvailable());
+
+	// a backend which has not answered yet might take long, show what is known already
+
+	if(backend -> isAvailable() && ! backend -> isWorking())
+		for(int l = 0;l < request.inlines.size();l++)
+			if(! request.linesToSkip.contains(l))
+				emit checked(request.doc,request.inlines[l].line,request.firstLineNr + l,request.errors[l]);
+
 	//cr itself might become invalid during the following loop
 //	auto blocks = request.blocks;
     auto ticket = request.ticket;
 	auto language = request.language;
+	auto firstLine = request.firstLineNr;
+
+	// distance to the cursor, blocks of other documents come last
+	const int otherDocument = 1 << 24;
+	const bool cursorInDocument = request.doc == cursorDoc;
 
 	int b = 0;
 
 	for(auto & block : request.blocks){
 		
 		if(block.words.isEmpty() || ! backend -> isAvailable()){
-			backendChecked(ticket,b,QList<GrammarError>(),true);
+			backendChecked(ticket,b,QList<GrammarError>());
 			b++;
 			continue;
 		}
@@ -540,7 +604,11 @@ void GrammarCheck::process(int requestId){
 			combined += ' ';
 		}
 
-		backend -> check(ticket,b,language,combined);
+		const int priority = cursorInDocument
+			? qAbs(firstLine + block.lines.first() - cursorLine)
+			: otherDocument;
+
+		backend -> check(ticket,b,language,combined,priority);
 	}
 }
 
@@ -548,8 +616,7 @@ void GrammarCheck::process(int requestId){
 void GrammarCheck::backendChecked(
 	uint crticket,
 	int subticket,
-	const QList<GrammarError> & backendErrors,
-	bool directCall
+	const QList<GrammarError> & backendErrors
 ){
 	
 	if(shuttingDown)
@@ -570,24 +637,6 @@ void GrammarCheck::backendChecked(
 
 	auto & block = request.blocks[subticket];
 
-
-	const auto appendError2 = [ & ](auto index,auto type,auto description,auto removedChars){
-		request.errors[block.lines[index]]
-			<< GrammarError(
-				block.indices[index],
-				block.endindices[index] - block.indices[index] - removedChars,
-				type,
-				description,
-				QStringList() << ""
-			);
-	};
-
-	const auto appendError = [ & ](auto index,auto type,auto description){
-		appendError2(index,type,description,0);
-	};
-
-
-	
 	request.handledBlocks++;
 
 	for(int i = 0;i < request.inlines.size();i++){
@@ -625,125 +674,11 @@ void GrammarCheck::backendChecked(
 		return;
 	}
 
-	auto it = languages.constFind(request.language);
-	
-	if(it == languages.constEnd()){
-
-		LanguageGrammarData lgd;
-        
-		QString path = config.wordlistsDir + '/' + languageFromLanguageToolToHunspell(request.language) + ".stopWords";
-        
-		path = ConfigManagerInterface::getInstance() -> parseDir(path);
-        
-		lgd.stopWords = readWordList(path);
-        
-		path = config.wordlistsDir + '/' + languageFromLanguageToolToHunspell(request.language) + ".badWords";
-        path = ConfigManagerInterface::getInstance() -> parseDir(path);
-        
-		lgd.badWords = readWordList(path);
-		
-		languages.insert(request.language,lgd);
-		
-		it = languages.constFind(request.language);
-	}
-
-	const auto & ld = * it;
-
 	if(request.errors.size() != request.inlines.size())
 		request.errors.resize(request.inlines.size());
 
 	auto & words = block.words;
 
-	if(config.longRangeRepetitionCheck){
-
-		const int MAX_REP_DELTA = config.maxRepetitionDelta;
-		bool checkLastWord = directCall;
-		
-		QString prevSW;
-		//check repetition
-		QHash<QString, int> repeatedWordCheck;
-		int totalWords = 0;
-
-		for(int w = 0 ; w < words.size(); w++) {
-			
-			totalWords++;
-			
-			if(words[w].length() == 1  && getCommonEOW().contains(words[w][0]))
-				continue; //punctation
-
-			//check words
-			int truncatedChars = 0;
-			QString normalized = words[w].toLower();
-
-			if(normalized.endsWith('.')){
-				normalized = normalized.left(normalized.length() -1);
-				truncatedChars =  1;
-			}
-
-			if(ld.stopWords.contains(normalized)){
-				
-				if(checkLastWord){
-				
-					if(prevSW == normalized)
-						appendError(w,GET_WORD_REPETITION,tr("Word repetition"));
-						// request.errors[block.lines[w]] 
-							// << GrammarError(block.indices[w],block.endindices[w] - block.indices[w], GET_WORD_REPETITION, tr("Word repetition"), QStringList() << "");
-				
-					prevSW = normalized;
-				}
-
-				continue;
-			} else {
-				prevSW.clear();
-			}
-
-            int lastSeen = repeatedWordCheck.value(normalized,-1);
-
-            if(lastSeen > -1){
-
-                int delta = totalWords - lastSeen;
-              
-			    if(delta <= MAX_REP_DELTA){
-					appendError2(w,GET_WORD_REPETITION,tr("Word repetition. Distance %1").arg(delta),truncatedChars);
-                    // request.errors[block.lines[w]] 
-					// 	<< GrammarError(block.indices[w],block.endindices[w] - block.indices[w] - truncatedChars, GET_WORD_REPETITION, tr("Word repetition. Distance %1").arg(delta), QStringList() << "");
-				}
-				
-				if(config.maxRepetitionLongRangeDelta > config.maxRepetitionDelta && delta <= config.maxRepetitionLongRangeDelta && normalized.length() >= config.maxRepetitionLongRangeMinWordLength)
-                    appendError(w,GET_LONG_RANGE_WORD_REPETITION,tr("Long range word repetition. Distance %1").arg(delta));
-					// request.errors[block.lines[w]] 
-						// << GrammarError(block.indices[w],block.endindices[w] - block.indices[w], GET_LONG_RANGE_WORD_REPETITION, tr("Long range word repetition. Distance %1").arg(delta), QStringList() << "");
-            }
-
-			repeatedWordCheck.insert(normalized, totalWords);
-		}
-	}
-
-	if(config.badWordCheck)
-		for(int w = 0;w < words.size();w++){
-
-			QString normalized = words[w].toLower();
-			
-			if(ld.badWords.contains(normalized)){
-				appendError(w,GET_BAD_WORD,tr("Bad word"));
-				
-				// request.errors[block.lines[w]] 
-				// 	<< GrammarError(block.indices[w],block.endindices[w] - block.indices[w],GET_BAD_WORD,tr("Bad word"),QStringList() << "");
-				
-				continue;
-			}
-
-			if(
-				normalized.length() > 1 && 
-				normalized.endsWith('.') && 
-				ld.badWords.contains(normalized.left(normalized.length() - 1))
-			)
-				appendError2(w,GET_BAD_WORD,tr("Bad word"),1);
-				// request.errors[block.lines[w]] 
-					// << GrammarError(block.indices[w],block.endindices[w] - block.indices[w] - 1,GET_BAD_WORD,tr("Bad word"),QStringList() << "");
-		}
-
-
 	//map indices to latex lines and indices
 
 	int 
@@ -811,6 +746,115 @@ void GrammarCheck::backendChecked(
 }
 
 
+/*!
+ * \brief GrammarCheck::localChecker
+ * Loads the stop words and bad words of a language on first use
+ * \param language LanguageTool notation
+ */
+
+const GrammarCheckLocal & GrammarCheck::localChecker(const QString & language){
+
+	auto it = languages.constFind(language);
+
+	if(it != languages.constEnd())
+		return * it;
+
+	QString path = config.wordlistsDir + '/' + languageFromLanguageToolToHunspell(language) + ".stopWords";
+	path = ConfigManagerInterface::getInstance() -> parseDir(path);
+
+	const auto stopWords = readWordList(path);
+
+	path = config.wordlistsDir + '/' + languageFromLanguageToolToHunspell(language) + ".badWords";
+	path = ConfigManagerInterface::getInstance() -> parseDir(path);
+
+	const auto badWords = readWordList(path);
+
+	GrammarCheckLocal checker;
+	checker.setWordLists(stopWords,badWords);
+
+	return * languages.insert(language,checker);
+}
+
+
+struct LocalCheck {
+
+	const TokenizedBlock * block;
+	QList<GrammarCheckLocal::Error> errors;
+
+};
+
+
+/*!
+ * \brief GrammarCheck::checkLocally
+ * Runs the checks which do not need the backend on all blocks of a request in parallel
+ * \param request
+ * \param adjacentRepetition report repeated stop words, which the backend reports otherwise
+ */
+
+void GrammarCheck::checkLocally(CheckRequest & request,bool adjacentRepetition){
+
+	request.errors.resize(request.inlines.size());
+
+	if(!config.longRangeRepetitionCheck && !config.badWordCheck)
+		return;
+
+	const auto & checker = localChecker(request.language);
+
+	GrammarCheckLocal::Options options;
+	options.repetition = config.longRangeRepetitionCheck;
+	options.adjacentRepetition = adjacentRepetition;
+	options.badWords = config.badWordCheck;
+	options.maxRepetitionDelta = config.maxRepetitionDelta;
+	options.maxRepetitionLongRangeDelta = config.maxRepetitionLongRangeDelta;
+	options.maxRepetitionLongRangeMinWordLength = config.maxRepetitionLongRangeMinWordLength;
+
+	QVector<LocalCheck> checks;
+	checks.reserve(request.blocks.size());
+
+	for(const auto & block : request.blocks)
+		if(!block.words.isEmpty())
+			checks << LocalCheck { & block , QList<GrammarCheckLocal::Error>() };
+
+	QtConcurrent::blockingMap(checks,[ & checker,& options ](LocalCheck & check){
+		check.errors = checker.check(check.block -> words,options);
+	});
+
+	for(const auto & check : checks){
+
+		const auto & block = * check.block;
+
+		for(const auto & error : check.errors){
+
+			QString message;
+
+			switch(error.type){
+			case GET_WORD_REPETITION:
+				message = (error.distance > 0)
+					? tr("Word repetition. Distance %1").arg(error.distance)
+					: tr("Word repetition");
+				break;
+			case GET_LONG_RANGE_WORD_REPETITION:
+				message = tr("Long range word repetition. Distance %1").arg(error.distance);
+				break;
+			default:
+				message = tr("Bad word");
+			}
+
+			const int w = error.word;
+
+			request.errors[block.lines[w]]
+				<< GrammarError(
+					block.indices[w],
+					block.endindices[w] - block.indices[w] - error.removedChars,
+					error.type,
+					message,
+					QStringList() << ""
+				);
+		}
+	}
+}
+
+
 void GrammarCheck::updateLTStatus(){
 
     const auto status = (backend -> isWorking()) 
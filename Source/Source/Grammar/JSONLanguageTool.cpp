@@ -3,26 +3,28 @@
 #include <QtNetwork/QNetworkRequest>
 #include <QJsonDocument>
 #include <QJsonArray>
+#include <QElapsedTimer>
 #include <QThread>
+#include <QTimer>
 
 #include "grammarcheck.h"
 #include "smallUsefulFunctions.h"
 
+#include <algorithm>
 
-using Tool = GrammarCheckLanguageToolJSON;
 
+using Tool = GrammarCheckLanguageToolJSON;
 
-const QNetworkRequest::Attribute AttributeTicket =
-	static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User);
 
-const QNetworkRequest::Attribute AttributeLanguage =
-	static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 2);
+// at most this many requests are sent to the server at the same time
+const int MaxRequestsInFlight = 3;
 
-const QNetworkRequest::Attribute AttributeText =
-	static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 3);
+// small blocks of the same language are merged into one request up to this size
+const int MaxPayloadLength = 6000;
+const int MaxBlocksPerRequest = 16;
 
-const QNetworkRequest::Attribute AttributeSubTicket =
-	static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 4);
+// LanguageTool treats the blocks as separate paragraphs
+const QString BlockSeparator = "\n\n";
 
 
 
@@ -32,12 +34,21 @@ struct CheckRequestBackend {
     uint subticket;
     QString language;
     QString text;
+    int priority; // smaller is more urgent
+
+    QString requestText; // the uncached sentences of text
+    QVariantList sentences; // see mergeSentenceErrors
 
-	CheckRequestBackend(uint ti,uint st,const QString & la,const QString & te)
+    quint64 sequence;
+    QElapsedTimer queued;
+
+	CheckRequestBackend(uint ti,uint st,const QString & la,const QString & te,int pr)
 		: ticket(ti)
 		, subticket(st)
 		, language(la)
-		, text(te) {}
+		, text(te)
+		, priority(pr)
+		, sequence(0) {}
 };
 
 
@@ -47,11 +58,67 @@ Tool::GrammarCheckLanguageToolJSON(QObject * parent)
 	, nam(nullptr)
 	, connectionAvailability(Unknown)
 	, triedToStart(false)
-	, firstRequest(true)
-	, startTime(0) {}
+	, dispatchPending(false)
+	, startTime(0)
+	, sequence(0)
+	, requestsSent(0)
+	, blocksSent(0)
+	, blocksCancelled(0)
+	, blocksAnswered(0)
+	, totalLatency(0) {}
 
 Tool::~GrammarCheckLanguageToolJSON(){
     delete nam;
+
+    if(!cacheFileName.isEmpty())
+        cache.save(cacheFileName);
+}
+
+
+/*!
+ * \brief mergeSentenceErrors
+ * Combines the errors of the sentences of a block
+ * \param sentences offset, length, offset in the request text (-1 if cached) and cached errors per sentence
+ * \param requestErrors errors the backend reported for the request text
+ * \param newSentenceErrors receives the errors of the sentences which were sent, relative to the sentence
+ * \return errors relative to the block text
+ */
+
+static QList<GrammarError> mergeSentenceErrors(
+    const QVariantList & sentences,
+    const QList<GrammarError> & requestErrors,
+    QList<QList<GrammarError>> & newSentenceErrors
+){
+    QList<GrammarError> merged;
+
+    for(const auto & sentence : sentences){
+
+        const auto entry = sentence.toList();
+        
+        const int offset = entry[0].toInt();
+        const int length = entry[1].toInt();
+        const int requestOffset = entry[2].toInt();
+
+        QList<GrammarError> errors;
+
+        if(requestOffset < 0){
+            errors = entry[3].value<QList<GrammarError>>();
+        } else {
+
+            // the space separating the sentence from the next one belongs to it
+
+            for(const auto & error : requestErrors)
+                if(error.offset >= requestOffset && error.offset <= requestOffset + length)
+                    errors << GrammarError(error.offset - requestOffset,error.length,error);
+
+            newSentenceErrors << errors;
+        }
+
+        for(const auto & error : errors)
+            merged << GrammarError(error.offset + offset,error.length,error);
+    }
+
+    return merged;
 }
 
 
@@ -107,13 +174,17 @@ void Tool::init(const GrammarCheckerConfig & config){
     for(const auto & rule : config.languageToolIgnoredRules.split(','))
         ignoredRules << rule.trimmed();
 
+    if(cacheFileName.isEmpty()){
+        cacheFileName = config.configDir + "/languagetool.cache";
+        cache.load(cacheFileName);
+    }
+
     connectionAvailability = Unknown;
     
     if(config.languageToolURL.isEmpty())
         connectionAvailability = Broken;
     
     triedToStart = false;
-    firstRequest = true;
 
     specialRules.clear();
 
@@ -139,6 +210,19 @@ void Tool::init(const GrammarCheckerConfig & config){
         
         specialRules << rules;
     }
+
+    // cached results are only valid for the same server and rule configuration
+
+    QStringList signature;
+    signature << server.toString();
+
+    for(const auto & rules : QList<QSet<QString>>() << ignoredRules << specialRules){
+        auto sorted = rules.values();
+        sorted.sort();
+        signature << sorted.join(',');
+    }
+
+    rulesSignature = signature.join('|');
 }
 
 
@@ -174,6 +258,25 @@ QString Tool::url(){
 }
 
 
+/*!
+ * \brief GrammarCheckLanguageToolJSON::statistics
+ * \return number of requests and average latency from queueing a block to its result
+ */
+
+QString Tool::statistics(){
+
+    const int answered = blocksAnswered;
+    const qint64 latency = answered ? totalLatency / answered : 0;
+
+    return tr("%1 requests with %2 blocks sent, %3 blocks cancelled, %4 queued, average latency %5 ms")
+        .arg(requestsSent)
+        .arg(blocksSent)
+        .arg(blocksCancelled)
+        .arg(queue.size())
+        .arg(latency);
+}
+
+
 /*!
  * \brief GrammarCheckLanguageToolJSON::tryToStart
  * try to start LanguageTool-Server on local machine
@@ -233,14 +336,15 @@ void Tool::tryToStart(){
 
 /*!
  * \brief GrammarCheckLanguageToolJSON::check
- * Place data to be checked on LT-Server
+ * Queue data to be checked on LT-Server
  * \param ticket
  * \param subticket
  * \param language
  * \param text
+ * \param priority blocks with smaller priority are sent first
  */
 
-void Tool::check(uint ticket,uint subticket,const QString & language,const QString & text){
+void Tool::check(uint ticket,uint subticket,const QString & language,const QString & text,int priority){
     
     if(!nam){
         nam = new QNetworkAccessManager();
@@ -260,30 +364,185 @@ void Tool::check(uint ticket,uint subticket,const QString & language,const QStri
     if(languagesCodesFail.contains(lang) && lang.contains('-'))
         lang = lang.left(lang.indexOf('-'));
 
-    if(connectionAvailability == Unknown){
-        if(firstRequest){
-            firstRequest = false;
+    // only sentences without cached results are sent
+
+    CheckRequestBackend request(ticket,subticket,lang,text,priority);
+
+    for(const auto & sentence : GrammarCheckCache::splitSentences(text)){
+
+        const auto sentenceText = text.mid(sentence.offset,sentence.length);
+
+        QVariantList entry;
+        entry << sentence.offset << sentence.length;
+
+        QList<GrammarError> errors;
+
+        if(cache.lookup(lang,rulesSignature,sentenceText,errors)){
+            entry << -1 << QVariant::fromValue(errors);
         } else {
-            delayedRequests << CheckRequestBackend(ticket,subticket,lang,text);
-            return;
+
+            if(!request.requestText.isEmpty())
+                request.requestText += ' ';
+
+            entry << request.requestText.length() << QVariant();
+            request.requestText += sentenceText;
+        }
+
+        request.sentences << QVariant(entry);
+    }
+
+    if(request.requestText.isEmpty() || connectionAvailability == Broken){
+
+        QList<QList<GrammarError>> unused;
+        const auto results = mergeSentenceErrors(request.sentences,QList<GrammarError>(),unused);
+
+        // asynchronous like a reply, the caller does not expect the result during check()
+        QTimer::singleShot(0,this,[this,ticket,subticket,results](){
+            emit checked(ticket,subticket,results);
+        });
+
+        return;
+    }
+
+    request.sequence = sequence++;
+    request.queued.start();
+
+    queue << request;
+
+    scheduleDispatch();
+}
+
+
+/*!
+ * \brief GrammarCheckLanguageToolJSON::cancel
+ * Drop the queued blocks of a ticket whose lines have changed again
+ * \param ticket
+ */
+
+void Tool::cancel(uint ticket){
+
+    QList<CheckRequestBackend> cancelled;
+
+    for(int i = queue.size() - 1;i >= 0;i--)
+        if(queue[i].ticket == ticket)
+            cancelled.prepend(queue.takeAt(i));
+
+    if(cancelled.isEmpty())
+        return;
+
+    blocksCancelled += cancelled.size();
+
+    // the checker still expects an answer per block to release the request
+
+    QTimer::singleShot(0,this,[this,cancelled](){
+        answerEmpty(cancelled);
+    });
+}
+
+
+void Tool::answerEmpty(const QList<CheckRequestBackend> & requests){
+    for(const auto & request : requests)
+        emit checked(request.ticket,request.subticket,QList<GrammarError>());
+}
+
+
+/*!
+ * \brief GrammarCheckLanguageToolJSON::scheduleDispatch
+ * Blocks are sent from the event loop, so all blocks of a paragraph are queued
+ * and superseded ones are cancelled before anything is sent
+ */
+
+void Tool::scheduleDispatch(){
+
+    if(dispatchPending)
+        return;
+
+    dispatchPending = true;
+
+    QTimer::singleShot(0,this,SLOT(dispatch()));
+}
+
+
+/*!
+ * \brief GrammarCheckLanguageToolJSON::dispatch
+ * Send the most urgent queued blocks, as long as not too many requests are in flight
+ */
+
+void Tool::dispatch(){
+
+    dispatchPending = false;
+
+    if(!nam || connectionAvailability == Terminated || connectionAvailability == Broken)
+        return;
+
+    // while it is unknown whether there is a server at all, a single request probes it
+
+    const int maxInFlight = (connectionAvailability == WorkedAtLeastOnce)
+        ? MaxRequestsInFlight
+        : 1;
+
+    if(inFlight.size() >= maxInFlight || queue.isEmpty())
+        return;
+
+    std::sort(queue.begin(),queue.end(),[](const CheckRequestBackend & a,const CheckRequestBackend & b){
+        return (a.priority != b.priority)
+            ? a.priority < b.priority
+            : a.sequence < b.sequence;
+    });
+
+    while(inFlight.size() < maxInFlight && !queue.isEmpty()){
+
+        QList<CheckRequestBackend> batch;
+        batch << queue.takeFirst();
+
+        int length = batch.first().requestText.length();
+
+        for(int i = 0;i < queue.size() && batch.size() < MaxBlocksPerRequest;){
+
+            const auto & next = queue[i];
+
+            if(
+                next.language != batch.first().language ||
+                length + BlockSeparator.length() + next.requestText.length() > MaxPayloadLength
+            ){
+                i++;
+                continue;
+            }
+
+            length += BlockSeparator.length() + next.requestText.length();
+            batch << queue.takeAt(i);
         }
+
+        send(batch);
+    }
+}
+
+
+void Tool::send(const QList<CheckRequestBackend> & batch){
+
+    QString requestText;
+
+    for(const auto & request : batch){
+
+        if(!requestText.isEmpty())
+            requestText += BlockSeparator;
+
+        requestText += request.requestText;
     }
 
     QNetworkRequest request(server);
     request.setHeader(QNetworkRequest::ContentTypeHeader,"text/json");
 
     QString post;
-    post.reserve(text.length() + 50);
-    post.append("language=" + lang + "&text=");
-    post.append(QUrl::toPercentEncoding(text,QByteArray(),QByteArray(" ")));
+    post.reserve(requestText.length() + 50);
+    post.append("language=" + batch.first().language + "&text=");
+    post.append(QUrl::toPercentEncoding(requestText,QByteArray(),QByteArray(" ")));
     post.append('\n');
 
-    request.setAttribute(AttributeSubTicket,subticket);
-    request.setAttribute(AttributeLanguage,lang);
-    request.setAttribute(AttributeTicket,ticket);
-    request.setAttribute(AttributeText,text);
+    inFlight.insert(nam -> post(request,post.toUtf8()),batch);
 
-    nam -> post(request,post.toUtf8());
+    requestsSent++;
+    blocksSent += batch.size();
 }
 
 
@@ -300,6 +559,12 @@ void Tool::shutdown(){
     }
 
     connectionAvailability = Terminated;
+
+    queue.clear();
+    inFlight.clear();
+
+    if(!cacheFileName.isEmpty())
+        cache.save(cacheFileName);
     
     if(nam){
         nam -> deleteLater();
@@ -336,9 +601,13 @@ void Tool::finished(QNetworkReply * response){
     if(nam != sender())
         return; //safety check, in case nam was deleted and recreated
 
-    uint ticket = response -> request().attribute(AttributeTicket).toUInt();
-    int subticket = response -> request().attribute(AttributeSubTicket).toInt();
-    QString text = response -> request().attribute(AttributeText).toString();
+    const auto batch = inFlight.take(response);
+
+    if(batch.isEmpty()){
+        response -> deleteLater();
+        return;
+    }
+
     int status = response -> attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
     if(status == 0){
@@ -354,20 +623,30 @@ void Tool::finished(QNetworkReply * response){
             emit errorMessage(errorText);
         }
 
+        response -> deleteLater();
+
         if(connectionAvailability == Broken){
 
-            if(delayedRequests.size())
-                delayedRequests.clear();
-            
+            // the checker still gets its local checks for everything that was waiting
+
+            auto unanswered = batch + queue;
+
+            for(const auto & requests : inFlight)
+                unanswered << requests;
+
+            queue.clear();
+            inFlight.clear();
+
             nam -> deleteLater(); // shutdown unnecessary network manager (Bug 1717/1738)
             nam = nullptr;
+
+            answerEmpty(unanswered);
             return; //confirmed: no backend
         }
 
         //there might be a backend now, but we still don't have the results
-        firstRequest = true; //send this request directly, queue later ones
-        check(ticket,subticket,response -> request().attribute(AttributeLanguage).toString(),text);
-        response -> deleteLater();
+        queue = batch + queue;
+        dispatch();
         
         return;
     }
@@ -387,14 +666,22 @@ void Tool::finished(QNetworkReply * response){
         reply.contains("language code") && 
         reply.contains("IllegalArgumentException")
     ){
-        QString lang = response -> request()
-            .attribute(AttributeLanguage)
-            .toString();
+        response -> deleteLater();
+
+        const QString lang = batch.first().language;
      
-        if(lang.contains('-')){
-            languagesCodesFail.insert(lang);
-            check(ticket,subticket,lang,text);
+        if(!lang.contains('-')){
+            answerEmpty(batch);
+            dispatch();
+            return;
         }
+
+        // queue again with the shorter language code
+
+        languagesCodesFail.insert(lang);
+
+        for(const auto & request : batch)
+            check(request.ticket,request.subticket,lang,request.text,request.priority);
      
         return;
     }
@@ -408,6 +695,16 @@ void Tool::finished(QNetworkReply * response){
     QJsonObject dd = jsonDoc.object();
     QList<GrammarError> results;
     QJsonArray matches = dd["matches"].toArray();
+
+    QString requestText;
+
+    for(const auto & request : batch){
+
+        if(!requestText.isEmpty())
+            requestText += BlockSeparator;
+
+        requestText += request.requestText;
+    }
     
     for(
         QJsonArray::const_iterator lterrors = matches.constBegin();
@@ -431,7 +728,7 @@ void Tool::finished(QNetworkReply * response){
         QString context = contextObj["text"].toString();
         
         int contextoffset = contextObj["offset"].toInt();
-        int realfrom = text.indexOf(context,qMax(from - 5 - context.length(),0)); //don't trust from
+        int realfrom = requestText.indexOf(context,qMax(from - 5 - context.length(),0)); //don't trust from
 
         if(realfrom == -1)
             realfrom = from;
@@ -477,16 +774,47 @@ void Tool::finished(QNetworkReply * response){
             << GrammarError(realfrom,len,static_cast<GrammarErrorType>(type),message.join("<br>"), cors);
     }
 
-    emit checked(ticket,subticket,results);
+    // split the results of the merged request into the blocks
 
-    response -> deleteLater();
+    int blockOffset = 0;
 
-    if(delayedRequests.size()){
-        
-        auto delayedRequestsCopy = delayedRequests;
-        delayedRequests.clear();
-        
-        for(const auto & request : delayedRequestsCopy)
-            check(request.ticket,request.subticket,request.language,request.text);
+    for(const auto & request : batch){
+
+        QList<GrammarError> blockErrors;
+
+        for(const auto & error : results)
+            if(error.offset >= blockOffset && error.offset <= blockOffset + request.requestText.length())
+                blockErrors << GrammarError(error.offset - blockOffset,error.length,error);
+
+        blockOffset += request.requestText.length() + BlockSeparator.length();
+
+        QList<QList<GrammarError>> newSentenceErrors;
+        blockErrors = mergeSentenceErrors(request.sentences,blockErrors,newSentenceErrors);
+
+        // only cache real results, not the empty ones of a failed request
+
+        int sent = 0;
+
+        for(const auto & sentence : request.sentences){
+
+            const auto entry = sentence.toList();
+
+            if(entry[2].toInt() < 0)
+                continue;
+
+            if(status == 200)
+                cache.insert(request.language,rulesSignature,request.text.mid(entry[0].toInt(),entry[1].toInt()),newSentenceErrors[sent]);
+
+            sent++;
+        }
+
+        blocksAnswered++;
+        totalLatency += request.queued.elapsed();
+
+        emit checked(request.ticket,request.subticket,blockErrors);
     }
+
+    response -> deleteLater();
+
+    dispatch();
 }
@@ -0,0 +1,204 @@
+#include "grammarcheck.h"
+
+
+/*!
+ * \brief lowerCase
+ * Most words are lower case already, these are returned without a copy
+ * \param word
+ * \return word in lower case
+ */
+
+static QString lowerCase(const QString & word){
+
+	for(const auto & c : word)
+		if(c.isSurrogate() || c.toLower() != c)
+			return word.toLower();
+
+	return word;
+}
+
+
+/*!
+ * \brief intern
+ * Id of a word, words which are not in the word lists get an id per block
+ * \param ids ids of the word lists
+ * \param blockIds ids of the other words of the block
+ * \param word lower case word
+ */
+
+static int intern(const QHash<QString,int> & ids,QHash<QString,int> & blockIds,const QString & word){
+
+	auto it = ids.constFind(word);
+
+	if(it != ids.constEnd())
+		return it.value();
+
+	auto local = blockIds.constFind(word);
+
+	if(local != blockIds.constEnd())
+		return local.value();
+
+	const int id = ids.size() + blockIds.size();
+
+	blockIds.insert(word,id);
+
+	return id;
+}
+
+
+/*!
+ * \brief GrammarCheckLocal::setWordLists
+ * \param stopWords words which are only reported when repeated directly
+ * \param badWords words which are always reported
+ */
+
+void GrammarCheckLocal::setWordLists(const QSet<QString> & stopWords,const QSet<QString> & badWords){
+
+	ids.clear();
+	flags.clear();
+
+	const auto add = [ & ](const QSet<QString> & words,WordFlag flag){
+
+		for(const auto & word : words){
+
+			auto it = ids.constFind(word);
+
+			if(it == ids.constEnd()){
+				it = ids.insert(word,flags.size());
+				flags << 0;
+			}
+
+			flags[it.value()] |= flag;
+		}
+	};
+
+	add(stopWords,StopWord);
+	add(badWords,BadWord);
+}
+
+
+int GrammarCheckLocal::flagsOf(int id) const {
+	return (id < flags.size())
+		? flags[id]
+		: 0;
+}
+
+
+/*!
+ * \brief GrammarCheckLocal::check
+ * Check the words of a block for repetitions and bad words
+ * \param words tokenized block
+ * \param options
+ * \return errors, by index of the word
+ */
+
+QList<GrammarCheckLocal::Error> GrammarCheckLocal::check(const QStringList & words,const Options & options) const {
+
+	QList<Error> errors;
+
+	if(!options.repetition && !options.badWords)
+		return errors;
+
+	struct Word {
+
+		int id;
+		int baseId; // without a trailing dot
+		int baseLength;
+
+		bool truncated;
+		bool punctuation;
+
+	};
+
+	QHash<QString,int> blockIds;
+	QVector<Word> infos(words.size());
+
+	for(int w = 0;w < words.size();w++){
+
+		const auto & word = words[w];
+		auto & info = infos[w];
+
+		info.punctuation = word.length() == 1 && getCommonEOW().contains(word[0]);
+
+		const auto lower = lowerCase(word);
+
+		info.id = intern(ids,blockIds,lower);
+		info.truncated = lower.endsWith('.');
+
+		if(info.truncated){
+			const auto base = lower.left(lower.length() - 1);
+			info.baseId = intern(ids,blockIds,base);
+			info.baseLength = base.length();
+		} else {
+			info.baseId = info.id;
+			info.baseLength = lower.length();
+		}
+	}
+
+	if(options.repetition){
+
+		QHash<int,int> lastSeen;
+		int previousStopWord = -1;
+		int totalWords = 0;
+
+		for(int w = 0;w < infos.size();w++){
+
+			const auto & info = infos[w];
+
+			totalWords++;
+
+			if(info.punctuation)
+				continue;
+
+			if(flagsOf(info.baseId) & StopWord){
+
+				if(options.adjacentRepetition){
+
+					if(previousStopWord == info.baseId)
+						errors << Error { w , GET_WORD_REPETITION , 0 , 0 };
+
+					previousStopWord = info.baseId;
+				}
+
+				continue;
+			}
+
+			previousStopWord = -1;
+
+			auto seen = lastSeen.constFind(info.baseId);
+
+			if(seen != lastSeen.constEnd()){
+
+				const int delta = totalWords - seen.value();
+
+				if(delta <= options.maxRepetitionDelta)
+					errors << Error { w , GET_WORD_REPETITION , delta , info.truncated ? 1 : 0 };
+
+				if(
+					options.maxRepetitionLongRangeDelta > options.maxRepetitionDelta &&
+					delta <= options.maxRepetitionLongRangeDelta &&
+					info.baseLength >= options.maxRepetitionLongRangeMinWordLength
+				)
+					errors << Error { w , GET_LONG_RANGE_WORD_REPETITION , delta , 0 };
+			}
+
+			lastSeen.insert(info.baseId,totalWords);
+		}
+	}
+
+	if(options.badWords)
+		for(int w = 0;w < infos.size();w++){
+
+			const auto & info = infos[w];
+
+			if(flagsOf(info.id) & BadWord){
+				errors << Error { w , GET_BAD_WORD , 0 , 0 };
+				continue;
+			}
+
+			if(info.truncated && info.baseLength > 0 && (flagsOf(info.baseId) & BadWord))
+				errors << Error { w , GET_BAD_WORD , 0 , 1 };
+		}
+
+	return errors;
+}
@@ -3496,9 +3496,10 @@ void LatexDocument::gatherCompletionFiles(QStringList & files,QStringList & load
 	
 	LatexPackage package;
 
-	auto completerConfig = edView
-		-> getCompleter()
-		-> getConfig();
+	// documents without an editor (e.g. in the benchmark) load packages without usage counts
+	auto completerConfig = (edView)
+		? edView -> getCompleter() -> getConfig()
+		: nullptr;
 	
 	for(const auto & file :files){
 
@@ -3,6 +3,9 @@
 
 #include "Latex/Log.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 
 LatexLogModel::LatexLogModel(QObject * parent)
 	: QAbstractTableModel(parent){
@@ -116,6 +119,7 @@ void LatexLogModel::clear(){
 	beginResetModel();
 	
 	log.clear();
+	byLogLine.clear();
 	
 	endResetModel();
 }
@@ -151,6 +155,12 @@ void LatexLogModel::parseLogDocument(QTextDocument * doc,QString baseFileName){
 
 	log << laterLog;
 
+	byLogLine.resize(log.count());
+	std::iota(byLogLine.begin(),byLogLine.end(),0);
+	std::stable_sort(byLogLine.begin(),byLogLine.end(),[ & ](int a,int b){
+		return log.at(a).logline < log.at(b).logline;
+	});
+
 	foundType[LT_ERROR] = outputFilter.m_nErrors > 0;
 	foundType[LT_BADBOX] = outputFilter.m_nBadBoxes > 0;
 	foundType[LT_WARNING] = outputFilter.m_nWarnings > 0;
@@ -173,14 +183,28 @@ int LatexLogModel::markID(LogType type) const {
 
 int LatexLogModel::logLineNumberToLogEntryNumber(int line) const {
 
-	int entry = -1;
+	const auto lineOf = [ & ](int entry){
+		return log.at(entry).logline;
+	};
 
-	for (int i = 0;i < log.count();i++)
-		if(log.at(i).logline <= line)
-			if(entry == -1 || log.at(i).logline > log.at(entry).logline)
-				entry = i;
-	
-	return entry;
+	// last log line <= line
+
+	auto last = std::upper_bound(byLogLine.begin(),byLogLine.end(),line,[ & ](int line,int entry){
+		return line < lineOf(entry);
+	});
+
+	if(last == byLogLine.begin())
+		return -1;
+
+	// of several entries on that log line, the first one wins
+
+	const int found = lineOf(*(last - 1));
+
+	auto first = std::lower_bound(byLogLine.begin(),last,found,[ & ](int entry,int line){
+		return lineOf(entry) < line;
+	});
+
+	return * first;
 }
 
 #include <algorithm>
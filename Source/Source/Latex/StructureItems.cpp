@@ -0,0 +1,150 @@
+#include "Latex/StructureItems.hpp"
+#include "Latex/Structure.hpp"
+
+
+/*!
+ * \brief expand item and the sections below it as they were expanded before
+ */
+void expandStructureItems(QTreeWidgetItem *item){
+    StructureEntry *entry=item->data(0,Qt::UserRole).value<StructureEntry *>();
+    if(entry && entry->type==StructureEntry::SE_SECTION)
+        item->setExpanded(entry->expanded);
+    for(int i=0;i<item->childCount();++i)
+        expandStructureItems(item->child(i));
+}
+
+/*!
+ * \brief add item and the items below it to the index of the structure tree
+ */
+void indexStructureItems(QTreeWidgetItem *item,QHash<StructureEntry *,QTreeWidgetItem *> *index){
+    if(!index) return;
+    StructureEntry *entry=item->data(0,Qt::UserRole).value<StructureEntry *>();
+    if(entry)
+        index->insert(entry,item);
+    for(int i=0;i<item->childCount();++i)
+        indexStructureItems(item->child(i),index);
+}
+
+/*!
+ * \brief remove item and the items below it from the index of the structure tree
+ * An entry which moved may already be indexed with its new item, that one is kept.
+ */
+void unindexStructureItems(QTreeWidgetItem *item,QHash<StructureEntry *,QTreeWidgetItem *> *index){
+    if(!index) return;
+    StructureEntry *entry=item->data(0,Qt::UserRole).value<StructureEntry *>();
+    if(entry && index->value(entry)==item)
+        index->remove(entry);
+    for(int i=0;i<item->childCount();++i)
+        unindexStructureItems(item->child(i),index);
+}
+
+/*!
+ * \brief take text, icon and colors of a newly built item
+ */
+void copyStructureItemLook(QTreeWidgetItem *current,QTreeWidgetItem *item){
+    if(current->text(0)!=item->text(0))
+        current->setText(0,item->text(0));
+    if(current->icon(0).cacheKey()!=item->icon(0).cacheKey())
+        current->setIcon(0,item->icon(0));
+    if(current->foreground(0)!=item->foreground(0))
+        current->setForeground(0,item->foreground(0));
+    if(current->background(0)!=item->background(0))
+        current->setBackground(0,item->background(0));
+}
+
+/*!
+ * \brief update the children of a shown structure item to match a newly built one
+ * Items which are still present are updated in place, so only the rows which actually changed are removed or inserted
+ * and the tree keeps its expansion, selection and scroll position.
+ * Entries of removed items may already be deleted, they are only compared by address.
+ * \param live item in the structure tree
+ * \param built detached item created by parseStructLocally, its children are taken over or deleted
+ * \param index index of the structure tree which is kept up-to-date, may be nullptr
+ */
+void syncStructureItems(QTreeWidgetItem *live,QTreeWidgetItem *built,QHash<StructureEntry *,QTreeWidgetItem *> *index){
+    typedef QPair<StructureEntry *,QString> Key;
+    const auto keyOf=[](QTreeWidgetItem *item){
+        return Key(item->data(0,Qt::UserRole).value<StructureEntry *>(),item->data(0,Qt::UserRole+1).toString());
+    };
+
+    const QList<QTreeWidgetItem*> children=built->takeChildren();
+
+    // remove items whose entry is gone
+    QSet<Key> keys;
+    for(QTreeWidgetItem *item:children)
+        keys.insert(keyOf(item));
+    for(int i=live->childCount()-1;i>=0;--i){
+        if(!keys.contains(keyOf(live->child(i)))){
+            QTreeWidgetItem *item=live->takeChild(i);
+            unindexStructureItems(item,index);
+            delete item;
+        }
+    }
+
+    for(int i=0;i<children.size();++i){
+        QTreeWidgetItem *item=children.at(i);
+        QTreeWidgetItem *current=live->child(i);
+        if(!current || keyOf(current)!=keyOf(item)){
+            live->insertChild(i,item);
+            expandStructureItems(item);
+            indexStructureItems(item,index);
+            continue;
+        }
+        copyStructureItemLook(current,item);
+        syncStructureItems(current,item,index);
+        delete item;
+    }
+
+    // items which moved further down have been inserted again above
+    while(live->childCount()>children.size()){
+        QTreeWidgetItem *item=live->takeChild(children.size());
+        unindexStructureItems(item,index);
+        delete item;
+    }
+}
+
+/*!
+ * \brief check that the item still shows its entry at the place the entry has in the structure
+ * Entries are only compared by address until they are known to be part of the structure, removed entries may already be deleted.
+ */
+bool structureItemIsCurrent(QTreeWidgetItem *item){
+    QList<QTreeWidgetItem *> chain;
+    for(;item;item=item->parent())
+        chain.prepend(item);
+    StructureEntry *parent=nullptr;
+    for(QTreeWidgetItem *current:chain){
+        StructureEntry *entry=current->data(0,Qt::UserRole).value<StructureEntry *>();
+        if(!entry || (parent && !parent->children.contains(entry)))
+            return false;
+        parent=entry;
+    }
+    return true;
+}
+
+/*!
+ * \brief check that the items built for the children of entry are placed like their entries
+ * Includes which are not indented move the following sections to the top level, these need a complete build.
+ */
+bool structureItemsArePlaced(StructureEntry *entry,QTreeWidgetItem *built,bool includesIndented){
+    for(int i=0;i<built->childCount();++i){
+        QTreeWidgetItem *item=built->child(i);
+        StructureEntry *child=item->data(0,Qt::UserRole).value<StructureEntry *>();
+        if(child->parent!=entry || (!includesIndented && child->type==StructureEntry::SE_INCLUDE))
+            return false;
+        if(!structureItemsArePlaced(child,item,includesIndented))
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief remove entry and the entries below it from a set of recorded entries
+ * The document may delete an entry right after reporting its removal, so it must not stay recorded.
+ * A moved entry is built again with its new parent.
+ */
+void forgetStructureEntries(StructureEntry *entry,QSet<StructureEntry *> *entries){
+    if(entries->isEmpty()) return;
+    entries->remove(entry);
+    for(StructureEntry *child:entry->children)
+        forgetStructureEntries(child,entries);
+}
@@ -15,21 +15,23 @@
 
 
 LogEditor::LogEditor(QWidget * parent) 
-	: QTextEdit(parent) {
+	: QPlainTextEdit(parent) {
 
-	highlighter = new LogHighlighter(document());
-	
 	const auto config = ConfigManager::getInstance();
 	const auto fontFamily = config -> getOption("LogView/FontFamily");
 
+	auto font = this -> font();
+
 	if(fontFamily.isValid())
-		setFontFamily(fontFamily.toString());
+		font.setFamily(fontFamily.toString());
 	
 	bool ok;
 	int fontSize = config -> getOption("LogView/FontSize").toInt(& ok);
 	
 	if(ok && fontSize > 0)
-		setFontPointSize(fontSize);
+		font.setPointSize(fontSize);
+
+	setFont(font);
 
 	UtilsUi::enableTouchScrolling(this);
 }
@@ -45,31 +47,20 @@ void LogEditor::wheelEvent(QWheelEvent * event){
 	if(! config -> getOption("Editor/Mouse Wheel Zoom").toBool())
 		event -> setModifiers(event -> modifiers() & ~Qt::ControlModifier);
 
-	QTextEdit::wheelEvent(event);
+	QPlainTextEdit::wheelEvent(event);
 }
 
 
 void LogEditor::insertLine(const QString & line){
-    append(line);
+	appendPlainText(line);
 }
 
 
 void LogEditor::setCursorPosition(int para,int index){
 
 	auto cursor = textCursor();
-	int i = 0;
 
-	auto textblock = document() -> begin();
-	
-	while(textblock.isValid()){
-
-		if(i == para)
-			break;
-		
-		i++;
-		
-		textblock = textblock.next();
-	}
+	auto textblock = document() -> findBlockByNumber(para);
 	
 	cursor.movePosition(QTextCursor::End);
 	setTextCursor(cursor);
@@ -87,6 +78,8 @@ void LogEditor::mouseDoubleClickEvent(QMouseEvent *){
 
 void LogEditor::paintEvent(QPaintEvent * event){
 
+	highlightVisibleBlocks();
+
 	auto rect = cursorRect();
 	rect.setX(0);
 	rect.setWidth(viewport() -> width());
@@ -100,5 +93,44 @@ void LogEditor::paintEvent(QPaintEvent * event){
 	painter.fillRect(rect,brush);
 	painter.end();
 	
-	QTextEdit::paintEvent(event);
+	QPlainTextEdit::paintEvent(event);
+}
+
+
+/*
+ *	Colors the blocks in the viewport which have not been colored
+ *	yet. Marking them dirty schedules another repaint, which then
+ *	finds nothing left to do.
+ */
+
+void LogEditor::highlightVisibleBlocks(){
+
+	enum { Highlighted = 1 };
+
+	const auto offset = contentOffset();
+	const int bottom = viewport() -> rect().bottom();
+
+	int from = -1,to = -1;
+
+	for(auto block = firstVisibleBlock();block.isValid();block = block.next()){
+
+		if(blockBoundingGeometry(block).translated(offset).top() > bottom)
+			break;
+
+		if(block.userState() == Highlighted)
+			continue;
+
+		block.setUserState(Highlighted);
+
+		if(!highlighter.highlightBlock(block))
+			continue;
+
+		if(from < 0)
+			from = block.position();
+
+		to = block.position() + block.length();
+	}
+
+	if(from >= 0)
+		document() -> markContentsDirty(from,to - from);
 }
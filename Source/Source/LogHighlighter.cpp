@@ -2,15 +2,12 @@
 #include "loghighlighter.h"
 #include "Latex/OutputFilter.hpp"
 
+#include <QTextLayout>
 
-LogHighlighter::LogHighlighter(QTextDocument * document)
-	: QSyntaxHighlighter(document) 
-	, ColorFile(QColor(0x2b,0x94,0x2b)) {}
 
+LogHighlighter::LogHighlighter()
+	: ColorFile(QColor(0x2b,0x94,0x2b)) {}
 
-inline QRegExp regex(std::string pattern){
-	return QRegExp(pattern.c_str());
-}
 
 inline std::string all(char c){
 	std::string s;
@@ -18,70 +15,80 @@ inline std::string all(char c){
 	return "\\" + s + "+";
 }
 
+inline std::string group(std::string pattern){
+	return "(" + pattern + ")";
+}
+
 
 const std::string
-	texTypes = "(La|pdf|Lua)TeX",
+	texTypes = "(?:La|pdf|Lua)TeX",
 	space = "\\s*",
 	box = "full \\\\[hv]box .*",
 	any = ".*";
 
-const auto
-	regex_exclamationdots = regex( "!" + all('.') + space ),
-	regex_exclamation = regex( all('!') + space ),
-	regex_warning = regex( space + "(((! )?" + texTypes + ")|Package) " + any + "Warning" + any + ":" + any ),
-	regex_badbox = regex( space + "(Over|Under)" + box ),
-	regex_error	= regex( space + "! " + any ),
-	regex_stars	= regex( all('*') + space ),
-	regex_dots = regex( all('.') + space );
-
-
-using Entry = LatexLogEntry;
+const std::string
+	pattern_exclamationdots = "!" + all('.') + space,
+	pattern_exclamation = all('!') + space,
+	pattern_warning = space + "(?:(?:(?:! )?" + texTypes + ")|Package) " + any + "Warning" + any + ":" + any,
+	pattern_badbox = space + "(?:Over|Under)" + box,
+	pattern_error = space + "! " + any,
+	pattern_stars = all('*') + space,
+	pattern_dots = all('.') + space;
 
 
-inline QColor LogHighlighter::colorFor(const QString & text) const {
+/*
+ *	All line types in one anchored expression, one capture
+ *	group per type. Alternatives are tried in order, so the
+ *	first group that captures is the one with priority.
+ */
 
-	if(regex_exclamationdots.exactMatch(text))
-		return Entry::textColor(LT_ERROR);
+const QRegularExpression lineTypes(QString::fromStdString(
+	"\\A(?:"
+		+ group(pattern_exclamationdots + "|" + pattern_exclamation + "|" + pattern_error) + "|"
+		+ group(pattern_badbox) + "|"
+		+ group(pattern_warning + "|" + pattern_stars) + "|"
+		+ group(pattern_dots) +
+	")\\z"
+));
 
-	if(regex_exclamation.exactMatch(text))
-		return Entry::textColor(LT_ERROR);
+const LogType lineTypeOfGroup[] = { LT_NONE , LT_ERROR , LT_BADBOX , LT_WARNING , LT_INFO };
 
-	if(regex_error.exactMatch(text))
-		return Entry::textColor(LT_ERROR);
-	
 
-	if(regex_badbox.exactMatch(text))
-		return Entry::textColor(LT_BADBOX);
+using Entry = LatexLogEntry;
 
 
-	if(regex_warning.exactMatch(text))
-		return Entry::textColor(LT_WARNING);
+inline QColor LogHighlighter::colorFor(const QString & text) const {
 
-	if(regex_stars.exactMatch(text))
-		return Entry::textColor(LT_WARNING);
+	const auto match = lineTypes.match(text);
 
+	if(match.hasMatch())
+		return Entry::textColor(lineTypeOfGroup[match.lastCapturedIndex()]);
 
-	if(regex_dots.exactMatch(text))
-		return Entry::textColor(LT_INFO);
-	
 
 	if(!text.contains(".tex"))
-		return nullptr;
+		return QColor();
 
 	if(text.startsWith("Error:"))
-		return nullptr;
+		return QColor();
 
 
 	return ColorFile;
 }
 
 
-void LogHighlighter::highlightBlock(const QString & text){
+bool LogHighlighter::highlightBlock(const QTextBlock & block) const {
+
+	const auto color = colorFor(block.text());
+
+	if(!color.isValid())
+		return false;
 
-	const auto color = colorFor(text);
+	QTextLayout::FormatRange range;
+	range.start = 0;
+	range.length = block.length();
+	range.format.setForeground(color);
 
-	if(color == nullptr)
-		return;
+	block.layout() -> setFormats({ range });
 
-	setFormat(0,text.length(),color);
+	return true;
 }
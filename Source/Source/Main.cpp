@@ -6,20 +6,34 @@
 
 /*!
  *	@brief Print C++ Version
+ *
+ *	Goes to stderr, stdout carries the results of --benchmark
  */
 
 inline void printCppVersion(){
 
-	using std::cout;
+	using std::cerr;
 	using std::endl;
 
-	cout 
+	cerr 
 		<< "Using C++ " 
 		<< __cplusplus 
 		<< endl;
 }
 
 
+/*!
+ *	@brief The benchmark does not need a display
+ */
+
+inline void prepareHeadless(int count,char ** arguments){
+
+	for(int i = 1;i < count;i++)
+		if(qstrcmp(arguments[i],"--benchmark") == 0 && !qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+			qputenv("QT_QPA_PLATFORM","offscreen");
+}
+
+
 /*!
  *	@brief Entrypoint to MexStudio
  */
@@ -27,16 +41,16 @@ inline void printCppVersion(){
 int main(int count,char ** arguments){
 
 	printCppVersion();
-
+	prepareHeadless(count,arguments);
 
 	auto app = App(count,arguments);
 	
 	auto [ commandLine , allowSeparateInstance ] = parseArguments();
 
-	const bool alreadyDone = handleCommandLine(commandLine);
+	const auto exitCode = handleCommandLine(commandLine);
 
-	if(alreadyDone)
-		return 0;
+	if(exitCode)
+		return * exitCode;
 
 	if(!allowSeparateInstance && app.isRunning()){
 		app.instructOthers(commandLine);
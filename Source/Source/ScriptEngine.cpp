@@ -29,6 +29,8 @@ Texstudio * scriptengine::app = nullptr;
 int scriptengine::writeSecurityMode = 2;
 int scriptengine::readSecurityMode = 2;
 
+QList<scriptengine *> scriptengine::pool;
+
 
 template <typename Type> 
 
@@ -136,10 +138,19 @@ scriptengine::scriptengine(QObject * object)
 	: QObject(object)
 	, triggerId(-1)
 	, m_editor(nullptr)
-	, m_allowWrite(false) {
+	, m_allowWrite(false)
+	, m_pooled(false)
+	, m_background(false) {
 
 	engine = new QJSEngine(this);
 
+	static bool registered = false;
+
+	if(registered)
+		return;
+
+	registered = true;
+
 	qRegisterMetaType<RunCommandFlags>();
 
 
@@ -187,6 +198,8 @@ scriptengine::scriptengine(QObject * object)
 
 scriptengine::~scriptengine(){
 	
+	pool.removeAll(this);
+
 	engine -> collectGarbage();
 	delete engine;
 	
@@ -209,32 +222,89 @@ void scriptengine::setEditorView(LatexEditorView * view){
 }
 
 
-void scriptengine::run(const bool quiet){
+/*!
+ * \brief an engine for running a script, from the pool if possible
+ * Pooled engines keep their global object and compiled scripts, so
+ * a script which runs often, e.g. on a trigger, is only parsed once.
+ * Hand the engine back with release() after run().
+ * Pooled engines belong to the main window.
+ */
 
-	auto jsApp = engine -> newQObject(app);
-	
-	engine 
-		-> globalObject()
-		.  setProperty("app",jsApp);
-	
-	QQmlEngine::setObjectOwnership(app,QQmlEngine::CppOwnership);
+scriptengine * scriptengine::acquire(){
 
-	// create from handle, so modifying the cursor in the script directly affects the actual cursor
+	if(!pool.isEmpty())
+		return pool.takeLast();
 
-	QDocumentCursor c( m_editor ? m_editor->cursorHandle() : nullptr);
-	
-	QJSValue cursorValue;
+	auto pooled = new scriptengine(app);
+	pooled -> m_pooled = true;
+
+	return pooled;
+}
+
+
+void scriptengine::release(scriptengine * engine){
+
+	// an engine whose script registered itself, set a timer or connected
+	// to a signal during the run is kept alive for those callbacks
+
+	if(!engine -> m_pooled || engine -> m_background)
+		return;
+
+	engine -> resetGlobals();
+	engine -> m_editor = nullptr;
+	engine -> m_editorView = nullptr;
+	engine -> m_script.clear();
+	engine -> m_allowWrite = false;
+	engine -> triggerMatches.clear();
+	engine -> triggerId = -1;
+
+	// the pool only grows to the number of scripts running at the same time
+
+	pool.append(engine);
+}
+
+
+/*!
+ * \brief the script as a function in this engine, parsed on first use
+ * The function scope keeps declarations of one run from leaking into the next.
+ * No line is prepended, so error line numbers are unchanged.
+ */
+
+QJSValue scriptengine::compiled(const QString & script){
+
+	auto function = m_compiled.value(script);
+
+	if(!function.isUndefined())
+		return function;
+
+	function = engine -> evaluate("(function(){" + script + "\n})");
+
+	if(function.isError())
+		return function;
+
+	if(m_compiled.size() >= 64)
+		m_compiled.clear();
+
+	m_compiled.insert(script,function);
+
+	return function;
+}
+
+
+// everything which does not depend on the editor or the trigger
+
+void scriptengine::setupGlobals(){
+
+	auto global = engine -> globalObject();
+
+	global.setProperty("app",engine -> newQObject(app));
 	
-	if(m_editorView)
-		engine 
-			-> globalObject()
-			.  setProperty("editorView",engine -> newQObject(m_editorView));
+	QQmlEngine::setObjectOwnership(app,QQmlEngine::CppOwnership);
+	QQmlEngine::setObjectOwnership(this,QQmlEngine::CppOwnership);
 
     auto scriptJS = engine -> newQObject(this);
 
     // add general debug/warn functions
-
-	auto global = engine -> globalObject();
     
     global.setProperty("registerAsBackgroundScript",scriptJS.property("registerAsBackgroundScript"));
     global.setProperty("confirmWarning",scriptJS.property("confirmWarning"));
@@ -260,13 +330,88 @@ void scriptengine::run(const bool quiet){
 		global.setProperty("crash_assert",scriptJS.property("crash_assert"));
 	#endif
 
+    global.setProperty("setTimeout",scriptJS.property("setTimeout"));
+
+	// a connection made by the script outlives the run, see release()
+
+	auto trackConnections = engine -> evaluate(
+		"(function(connectionMade){"
+		"var connect = Function.prototype.connect;"
+		"if(typeof connect !== 'function') return;"
+		"Function.prototype.connect = function(){ connectionMade(); return connect.apply(this,arguments); };"
+		"})");
+
+	trackConnections.call({ scriptJS.property("connectionMade") });
+
+    auto qsMetaObject = engine -> newQMetaObject(& QDocumentCursor::staticMetaObject);
+    global.setProperty("QDocumentCursor",qsMetaObject);
+    global.setProperty("cursorEnums",qsMetaObject);
+
+	auto uidClass = engine -> newQMetaObject(& UniversalInputDialogScript::staticMetaObject);
+	global.setProperty("UniversalInputDialog",uidClass);
+
+	global.setProperty("documentManager",engine -> newQObject(& app -> documents));
+
+	QQmlEngine::setObjectOwnership(& app -> documents,QQmlEngine::CppOwnership);
+
+	auto bm = engine -> newQObject(& app -> buildManager);
+	QQmlEngine::setObjectOwnership(& app -> buildManager,QQmlEngine::CppOwnership);
+
+	global.setProperty("buildManager",bm);
+
+	QJSValueIterator it(global);
+
+	while(it.hasNext()){
+		it.next();
+		m_stableGlobals.insert(it.name());
+	}
+}
+
+
+// remove what the last run added to the global object
+
+void scriptengine::resetGlobals(){
+
+	auto global = engine -> globalObject();
+
+	QStringList added;
+
+	QJSValueIterator it(global);
+
+	while(it.hasNext()){
+		it.next();
+
+		if(!m_stableGlobals.contains(it.name()))
+			added << it.name();
+	}
+
+	for(const auto & name : added)
+		global.deleteProperty(name);
+}
+
+
+void scriptengine::run(const bool quiet){
+
+	if(m_stableGlobals.isEmpty())
+		setupGlobals();
+
+	auto global = engine -> globalObject();
+	auto scriptJS = engine -> newQObject(this);
+
+	// create from handle, so modifying the cursor in the script directly affects the actual cursor
+
+	QDocumentCursor c( m_editor ? m_editor->cursorHandle() : nullptr);
+	
+	QJSValue cursorValue;
+	
+	if(m_editorView)
+		global.setProperty("editorView",engine -> newQObject(m_editorView));
 
 	if(m_editor){
 		
 		auto editorValue = engine -> newQObject(m_editor);
 
 		QQmlEngine::setObjectOwnership(m_editor,QQmlEngine::CppOwnership);
-		QQmlEngine::setObjectOwnership(this,QQmlEngine::CppOwnership);
 		
 		editorValue.setProperty("replaceSelectedText",scriptJS.property("replaceSelectedText"));
 		editorValue.setProperty("insertSnippet",scriptJS.property("insertSnippet"));
@@ -292,21 +437,10 @@ void scriptengine::run(const bool quiet){
 		global.setProperty("triggerMatches",matches);
 	}
 
-    global.setProperty("setTimeout",scriptJS.property("setTimeout"));
 	global.setProperty("triggerId",QJSValue(triggerId));
 
-    auto qsMetaObject = engine -> newQMetaObject(& QDocumentCursor::staticMetaObject);
-    global.setProperty("QDocumentCursor",qsMetaObject);
-    global.setProperty("cursorEnums",qsMetaObject);
-
-	auto uidClass = engine -> newQMetaObject(& UniversalInputDialogScript::staticMetaObject);
-	global.setProperty("UniversalInputDialog",uidClass);
-
 	FileChooser flchooser(nullptr,scriptengine::tr("File Chooser"));
 	global.setProperty("fileChooser",engine -> newQObject(& flchooser));
-	global.setProperty("documentManager",engine -> newQObject(& app -> documents));
-
-	QQmlEngine::setObjectOwnership(& app -> documents,QQmlEngine::CppOwnership);
 
 	global.setProperty("documents",qScriptValueFromQList(engine,app -> documents.documents));
 
@@ -314,12 +448,16 @@ void scriptengine::run(const bool quiet){
 		global.setProperty("pdfs",qScriptValueFromQList(engine,PDFDocument::documentList()));
 	#endif
 
-	auto bm = engine -> newQObject(& app -> buildManager);
-	QQmlEngine::setObjectOwnership(& app -> buildManager,QQmlEngine::CppOwnership);
+	QJSValue result;
 
-	global.setProperty("buildManager",bm);
+	if(m_pooled){
+		result = compiled(m_script);
 
-	auto result = engine -> evaluate(m_script);
+		if(!result.isError())
+			result = result.call();
+	} else {
+		result = engine -> evaluate(m_script);
+	}
 
 	if(result.isError()){
 		auto error = QString(tr("Uncaught exception at line %1: %2\n"))
@@ -982,6 +1120,8 @@ void scriptengine::registerAsBackgroundScript(const QString & name){
 
     static QMap<QString,QPointer<scriptengine>> backgroundScripts;
 
+	m_background = true;
+
     const auto realName = name.isEmpty() 
 		? getScriptHash() 
 		: name;
@@ -993,23 +1133,43 @@ void scriptengine::registerAsBackgroundScript(const QString & name){
 }
 
 
-bool scriptengine::setTimeout(const QString & function,const int timeout){
+void scriptengine::connectionMade(){
+	m_background = true;
+}
+
 
-    auto timer = new QTimer();
-    auto parts = function.split(" ");
-    
-	timer -> singleShot(timeout,this,std::bind(& scriptengine::runTimed,this,parts.value(1)));
+bool scriptengine::setTimeout(const QJSValue & function,const int timeout){
+
+    m_background = true;
+
+	QTimer::singleShot(timeout,this,std::bind(& scriptengine::runTimed,this,function));
 
     return true;
 }
 
 
-void scriptengine::runTimed(const QString function){
+// the function is called directly, as it may be local to the script's run
+
+void scriptengine::runTimed(QJSValue function){
+
+	if(function.isCallable()){
+
+		const auto result = function.call();
+
+		if(result.isError())
+			qDebug() << result.toString();
+
+		return;
+	}
+
+	// otherwise the source of a global function, call it by name
+
+	const auto name = function.toString().split(" ").value(1);
 
-    if(function.isEmpty())
+    if(name.isEmpty())
 		return;
 
-    engine -> evaluate(function);
+    engine -> evaluate(name);
 }
 
 
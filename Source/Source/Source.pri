@@ -58,6 +58,7 @@ SOURCES += \
     $$PWD/Encoding.cpp \
     $$PWD/Main.cpp \
     $$PWD/App.cpp \
+    $$PWD/Benchmark.cpp \
     $$PWD/ScriptEngine.cpp \
     $$PWD/MathAssistant.cpp \
     $$PWD/FindInDirs.cpp \
@@ -111,10 +112,13 @@ SOURCES += \
     $$PWD/Latex/LogWidget.cpp \
     $$PWD/Latex/StructureEntry.cpp \
     $$PWD/Latex/StructureEntryIterator.cpp \
+    $$PWD/Latex/StructureItems.cpp \
     $$PWD/Latex/Log.cpp
 
 SOURCES += \
     $$PWD/Grammar/JSONLanguageTool.cpp \
+    $$PWD/Grammar/Cache.cpp \
+    $$PWD/Grammar/Local.cpp \
     $$PWD/Grammar/Check.cpp
 
 
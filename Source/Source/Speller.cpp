@@ -12,6 +12,9 @@
 #include "SpellerUtility.hpp"
 #include "smallUsefulFunctions.h"
 #include "JlCompress.h"
+#include "configmanagerinterface.h"
+
+#include <QCryptographicHash>
 
 
 bool SpellerUtility::hideNonTextSpellingErrors = true;
@@ -20,6 +23,34 @@ bool SpellerUtility::inlineSpellChecking = true;
 int SpellerUtility::spellcheckErrorFormat = -1;
 
 
+#ifdef HUNSPELL_STATIC
+
+/*!
+ * \brief dictionaryImagePath
+ * Location of the compiled image of a dictionary, which Hunspell maps instead of parsing the .dic file
+ * \return empty if there is no settings directory
+ */
+
+static QString dictionaryImagePath(const QString & dicFile){
+
+	const auto config = ConfigManagerInterface::getInstance();
+
+	if(!config)
+		return QString();
+
+	const auto dir = config -> parseDir("[txs-settings-dir]/dictionaries-cache");
+
+	if(!QDir().mkpath(dir))
+		return QString();
+
+	// dictionaries with the same name may be installed in several places
+	const auto hash = QCryptographicHash::hash(QFileInfo(dicFile).absoluteFilePath().toUtf8(),QCryptographicHash::Md5).toHex().left(8);
+
+	return dir + "/" + QFileInfo(dicFile).completeBaseName() + "-" + hash + ".img";
+}
+
+#endif
+
 SpellerUtility::SpellerUtility(QString name)
 	: mName(name)
 	, currentDic("")
@@ -56,7 +87,12 @@ bool SpellerUtility::loadDictionary(QString dictionary,QString ignoreFilePrefix)
 
 	currentDic = dictionary;
 	
-	pChecker = new Hunspell(affFile.toLocal8Bit(),dicFile.toLocal8Bit());
+	#ifdef HUNSPELL_STATIC
+		pChecker = new Hunspell(affFile.toLocal8Bit(),dicFile.toLocal8Bit(),nullptr,dictionaryImagePath(dicFile).toLocal8Bit());
+	#else
+		// the system library has no dictionary images
+		pChecker = new Hunspell(affFile.toLocal8Bit(),dicFile.toLocal8Bit());
+	#endif
 	
 	if(!pChecker){
 		currentDic = "";
@@ -1,8 +1,15 @@
 
 #include "symbollistmodel.h"
 #include "smallUsefulFunctions.h"
+#include "configmanagerinterface.h"
 #include "qsvgrenderer.h"
 
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtConcurrentMap>
+#include <QtMath>
+
 #include <optional>
 #include <functional>
 
@@ -52,6 +59,7 @@ void SymbolListModel::load(QString category){
 		qDebug() << ("No symbols found for category: " + category);
 
 	loadSymbols(category, fullNames);
+	loadIconAtlas(category);
 }
 
 
@@ -127,6 +135,105 @@ SymbolItem loadSymbolFromSvg(QString path){
 }
 
 
+/*!
+ * Metadata of the symbol files, kept in the settings directory so the panel does
+ * not parse every symbol file on start. An entry is used as long as size and
+ * modification time of its file are unchanged.
+ */
+
+struct SymbolMetadata {
+	qint64 size;
+	qint64 modified;
+	QString command;
+	QString packages;
+	QString unicode;
+};
+
+const quint32 SymbolIndexMagic = 0x54585359; // "TXSY"
+const quint32 SymbolIndexVersion = 1;
+
+static QHash<QString,SymbolMetadata> symbolIndex;
+static bool symbolIndexLoaded = false;
+static bool symbolIndexModified = false;
+
+QString symbolCacheDir(){
+	return ConfigManagerInterface::getInstance() -> parseDir("[txs-settings-dir]/symbols");
+}
+
+void loadSymbolIndex(){
+
+	if(symbolIndexLoaded)
+		return;
+
+	symbolIndexLoaded = true;
+
+	QFile file(symbolCacheDir() + "/index.dat");
+
+	if(!file.open(QIODevice::ReadOnly))
+		return;
+
+	QDataStream stream(& file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic , version , count;
+	stream >> magic >> version >> count;
+
+	if(magic != SymbolIndexMagic || version != SymbolIndexVersion)
+		return;
+
+	QHash<QString,SymbolMetadata> entries;
+
+	for(quint32 i = 0;i < count && stream.status() == QDataStream::Ok;i++){
+
+		QString path;
+		SymbolMetadata metadata;
+
+		stream 
+			>> path 
+			>> metadata.size 
+			>> metadata.modified 
+			>> metadata.command 
+			>> metadata.packages 
+			>> metadata.unicode;
+
+		entries.insert(path,metadata);
+	}
+
+	if(stream.status() == QDataStream::Ok)
+		symbolIndex = entries;
+}
+
+void saveSymbolIndex(){
+
+	if(!symbolIndexModified)
+		return;
+
+	QDir().mkpath(symbolCacheDir());
+
+	QSaveFile file(symbolCacheDir() + "/index.dat");
+
+	if(!file.open(QIODevice::WriteOnly))
+		return;
+
+	QDataStream stream(& file);
+	stream.setVersion(QDataStream::Qt_5_0);
+
+	stream << SymbolIndexMagic << SymbolIndexVersion << quint32(symbolIndex.size());
+
+	for(auto it = symbolIndex.constBegin();it != symbolIndex.constEnd();++it)
+		stream 
+			<< it.key() 
+			<< it.value().size 
+			<< it.value().modified 
+			<< it.value().command 
+			<< it.value().packages 
+			<< it.value().unicode;
+
+	if(file.commit())
+		symbolIndexModified = false;
+}
+
+
 /*!
  * \brief load symbols from files
  * png is inverted in dark mode.
@@ -157,6 +264,10 @@ QString toRealUnicode(const QString fake){
 
 void SymbolListModel::loadSymbols(const QString & category,const QStringList & fileNames){
 
+	loadSymbolIndex();
+
+	QCryptographicHash signature(QCryptographicHash::Md5);
+
 	for(int i = 0;i < fileNames.size();++i){
 		
 		QString iconName = fileNames.at(i);
@@ -165,19 +276,38 @@ void SymbolListModel::loadSymbols(const QString & category,const QStringList & f
 		if(fileName.isEmpty())
 			fileName = findResourceFile("symbols/" + iconName);
 
+		const QFileInfo info(fileName);
+		const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
 		SymbolItem symbolItem;
 
-		if(fileName.endsWith("svg")) {
-			symbolItem = loadSymbolFromSvg(fileName);
-		} else {
-			QImage img = QImage(fileName);
-			symbolItem.command = img.text("Command");
-			symbolItem.packages = img.text("Packages");
-			symbolItem.unicode = img.text("CommandUnicode");
+		auto it = symbolIndex.constFind(fileName);
+
+		if(it != symbolIndex.constEnd() && it.value().size == info.size() && it.value().modified == modified){
+			symbolItem.command = it.value().command;
+			symbolItem.packages = it.value().packages;
+			symbolItem.unicode = it.value().unicode;
 			symbolItem.iconFile = fileName;
-            symbolItem.icon = QIcon(fileName);
+			symbolItem.icon = QIcon(fileName);
+		} else {
+
+			if(fileName.endsWith("svg")) {
+				symbolItem = loadSymbolFromSvg(fileName);
+			} else {
+				QImage img = QImage(fileName);
+				symbolItem.command = img.text("Command");
+				symbolItem.packages = img.text("Packages");
+				symbolItem.unicode = img.text("CommandUnicode");
+				symbolItem.iconFile = fileName;
+	            symbolItem.icon = QIcon(fileName);
+			}
+
+			symbolIndex.insert(fileName,SymbolMetadata { info.size() , modified , symbolItem.command , symbolItem.packages , symbolItem.unicode });
+			symbolIndexModified = true;
 		}
 
+		signature.addData(QString("%1|%2|%3\n").arg(fileName).arg(info.size()).arg(modified).toUtf8());
+
 		if(!symbolItem.unicode.isEmpty())
 			symbolItem.unicode = toRealUnicode(symbolItem.unicode);
 
@@ -187,7 +317,9 @@ void SymbolListModel::loadSymbols(const QString & category,const QStringList & f
 		symbols.append(symbolItem);
 	}
 
-	return;
+	categorySignatures.insert(category,QString::fromLatin1(signature.result().toHex()));
+
+	saveSymbolIndex();
 }
 
 
@@ -304,7 +436,23 @@ void SymbolListModel::incrementUsage(const QString & id){
  */
 
 void SymbolListModel::setDarkmode(bool active){
+
+	if(m_darkMode == active)
+		return;
+
     m_darkMode = active;
+
+	QStringList categories;
+
+	for(const auto & symbol : symbols)
+		if(!categories.contains(symbol.category))
+			categories << symbol.category;
+
+	for(const auto & category : categories)
+		loadIconAtlas(category);
+
+	if(!symbols.isEmpty())
+		emit dataChanged(index(0,0),index(symbols.count() - 1,0),QVector<int>() << Qt::DecorationRole);
 }
 
 
@@ -344,10 +492,10 @@ void SymbolListModel::updateFavorites(const QString & id){
 }
 
 
-QImage svgImageFrom(const QString path){
+QImage svgImageFrom(const QString path,int scale = 4){
 	
 	QSvgRenderer renderer(path);
-	auto size = renderer.defaultSize() * 4;
+	auto size = renderer.defaultSize() * scale;
 
 	QImage image(size.width(),size.height(),QImage::Format_ARGB32);
 	QPainter painter(& image);
@@ -360,13 +508,11 @@ QImage svgImageFrom(const QString path){
 
 
 /*!
- * \brief return the icon for a symbol
- * This icon is manipulated in darkmode to be inverted (SVG only)
- * \param item
- * \return icon
+ * \brief whether the icons are shown rasterised instead of as the original files
+ * In dark mode they are inverted.
  */
 
-QIcon SymbolListModel::getIcon(const SymbolItem & item) const {
+bool SymbolListModel::rasterisedIcons() const {
 
 	// OSX workaround
 
@@ -376,9 +522,159 @@ QIcon SymbolListModel::getIcon(const SymbolItem & item) const {
 		bool OSX_Fallback = false;
 	#endif
 
-	if(!m_darkMode && !OSX_Fallback)
+	return m_darkMode || OSX_Fallback;
+}
+
+
+struct RenderedSymbol {
+	QString fileName;
+	QImage image;
+};
+
+
+/*!
+ * \brief put the rendered symbols into one image, row by row
+ * \param symbols
+ * \param rects receives the position of each symbol
+ * \return atlas
+ */
+
+QImage packIconAtlas(const QVector<RenderedSymbol> & symbols,QList<QRect> & rects){
+
+	const int maxWidth = 2048;
+
+	int x = 0 , y = 0 , rowHeight = 0 , width = 0;
+
+	rects.clear();
+
+	for(const auto & symbol : symbols){
+
+		const auto size = symbol.image.size();
+
+		if(x > 0 && x + size.width() > maxWidth){
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+
+		rects << QRect(QPoint(x,y),size);
+
+		x += size.width();
+		width = qMax(width,x);
+		rowHeight = qMax(rowHeight,size.height());
+	}
+
+	QImage atlas(qMax(width,1),qMax(y + rowHeight,1),QImage::Format_ARGB32);
+	atlas.fill(Qt::transparent);
+
+	QPainter painter(& atlas);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+	for(int i = 0;i < symbols.size();i++)
+		painter.drawImage(rects[i].topLeft(),symbols[i].image);
+
+	return atlas;
+}
+
+
+/*!
+ * \brief create the rasterised icons of a category
+ * They are taken from an atlas image in the settings directory, one per category, theme and
+ * resolution. If it is missing or the symbol files changed, the symbols are rendered in
+ * parallel and the atlas is written for the next start.
+ * \param category
+ */
+
+void SymbolListModel::loadIconAtlas(const QString & category){
+
+	QList<int> rows;
+
+	for(int i = 0;i < symbols.count();i++)
+		if(symbols[i].category == category)
+			rows << i;
+
+	if(!rasterisedIcons()){
+		for(int row : rows)
+			symbols[row].rasterisedIcon = QIcon();
+		return;
+	}
+
+	if(rows.isEmpty())
+		return;
+
+	const int scale = 2 * qCeil(qApp -> devicePixelRatio());
+	const QString theme = m_darkMode ? "dark" : "light";
+	const QString fileName = QString("%1/%2-%3-%4x.png")
+		.arg(symbolCacheDir(),QString(category).replace('/','_'),theme)
+		.arg(scale);
+
+	const QString signature = categorySignatures.value(category);
+
+	QImage atlas(fileName);
+	QList<QRect> rects;
+
+	if(!atlas.isNull() && atlas.text("Signature") == signature)
+		for(const auto & rect : atlas.text("Rects").split(';')){
+
+			const auto values = rect.split(',');
+
+			if(values.size() == 4)
+				rects << QRect(values[0].toInt(),values[1].toInt(),values[2].toInt(),values[3].toInt());
+		}
+
+	if(rects.size() != rows.size()){
+
+		QVector<RenderedSymbol> rendered;
+
+		for(int row : rows)
+			rendered << RenderedSymbol { symbols[row].iconFile , QImage() };
+
+		const bool invert = m_darkMode;
+
+		QtConcurrent::blockingMap(rendered,[scale,invert](RenderedSymbol & symbol){
+
+			symbol.image = (symbol.fileName.endsWith("svg"))
+				? svgImageFrom(symbol.fileName,scale)
+				: QImage(symbol.fileName).convertToFormat(QImage::Format_ARGB32);
+
+			if(invert)
+				symbol.image.invertPixels(QImage::InvertRgb);
+		});
+
+		atlas = packIconAtlas(rendered,rects);
+
+		QStringList positions;
+
+		for(const auto & rect : rects)
+			positions << QString("%1,%2,%3,%4").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
+
+		atlas.setText("Signature",signature);
+		atlas.setText("Rects",positions.join(';'));
+
+		QDir().mkpath(symbolCacheDir());
+		atlas.save(fileName,"PNG");
+	}
+
+	for(int i = 0;i < rows.size();i++)
+		symbols[rows[i]].rasterisedIcon = QIcon(QPixmap::fromImage(atlas.copy(rects[i])));
+}
+
+
+/*!
+ * \brief return the icon for a symbol
+ * This icon is manipulated in darkmode to be inverted (SVG only)
+ * \param item
+ * \return icon
+ */
+
+QIcon SymbolListModel::getIcon(const SymbolItem & item) const {
+
+	if(!rasterisedIcons())
 		return item.icon;
 
+	if(!item.rasterisedIcon.isNull())
+		return item.rasterisedIcon;
+
 	const auto file = item.iconFile;
 
 	QImage image = (file.endsWith("svg"))
@@ -72,10 +72,11 @@ int LatexTables::getColumn(QDocumentCursor & cur){
 
 
 void LatexTables::executeScript(QString script,LatexEditorView * view){
-	scriptengine engine;
-	engine.setEditorView(view);
-	engine.setScript(script);
-	engine.run();
+	auto engine = scriptengine::acquire();
+	engine -> setEditorView(view);
+	engine -> setScript(script);
+	engine -> run();
+	scriptengine::release(engine);
 }
 
 
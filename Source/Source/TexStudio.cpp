@@ -79,6 +79,7 @@
 
 #include "Latex/EditorView.hpp"
 #include "Latex/Structure.hpp"
+#include "Latex/StructureItems.hpp"
 #include "Latex/Package.hpp"
 #include "Latex/EditorViewConfig.hpp"
 
@@ -91,6 +92,7 @@
 #endif
 
 #include "qdocument.h"
+#include "qdocumentjournal.h"
 #include "qdocumentcursor.h"
 #include "qdocumentline.h"
 #include "qdocumentline_p.h"
@@ -156,6 +158,7 @@ Texstudio::Texstudio(QWidget *parent, Qt::WindowFlags flags, QSplashScreen *spla
 	programStopped = false;
 	spellLanguageActions = nullptr;
 	currentLine = -1;
+	structureTreeGroupsChanged = false;
 	svndlg = nullptr;
 	userMacroDialog = nullptr;
 	mCompleterNeedsUpdate = false;
@@ -170,6 +173,7 @@ Texstudio::Texstudio(QWidget *parent, Qt::WindowFlags flags, QSplashScreen *spla
 	previewIsAutoCompiling = false;
 	completerPreview = false;
 	recheckLabels = true;
+	deferEditorLoad = false;
 	cursorHistory = nullptr;
 	recentSessionList = nullptr;
 	editors = nullptr;
@@ -407,6 +411,8 @@ Texstudio::Texstudio(QWidget *parent, Qt::WindowFlags flags, QSplashScreen *spla
 	TemplateManager::ensureUserTemplateDirExists();
 	TemplateManager::checkForOldUserTemplates();
 
+	QDocumentJournal::setJournalDirectory(configManager.configBaseDir + "journal");
+
 	/* The encoding detection works as follow:
 		If QDocument detects the file is UTF16LE/BE, use that encoding
 		Else If QDocument detects UTF-8 {
@@ -493,6 +499,7 @@ Texstudio::~Texstudio()
 	programStopped = true;
 
 	Guardian::shutdown();
+	QDocumentJournal::shutdown();
 
 	if (latexStyleParser) latexStyleParser->stop();
 	if (packageListReader) packageListReader->stop();
@@ -1571,6 +1578,7 @@ void Texstudio::currentEditorChanged()
 	outputView->getTerminalWidget()->setCurrentFileName(getCurrentFileName());
 #endif
 	if (!currentEditorView()) return;
+	restoreDeferredFileState(currentEditorView());
 	if (configManager.watchedMenus.contains("main/view/documents"))
 		updateToolBarMenu("main/view/documents");
 	editorSpellerChanged(currentEditorView()->getSpeller());
@@ -1744,7 +1752,10 @@ void Texstudio::configureNewEditorViewEnd(LatexEditorView *edit, bool reloadFrom
     connect(edit, SIGNAL(thesaurus(int,int)), this, SLOT(editThesaurus(int,int)));
     connect(edit, SIGNAL(changeDiff(QPoint)), this, SLOT(editChangeDiff(QPoint)));
     connect(edit, SIGNAL(saveCurrentCursorToHistoryRequested()), this, SLOT(saveCurrentCursorToHistory()));
-    connect(edit->document,SIGNAL(structureUpdated(LatexDocument*)),this,SLOT(updateTOCs()));
+    connect(edit->document,SIGNAL(structureUpdated(LatexDocument*)),this,SLOT(patchTOCs()));
+    connect(edit->document,SIGNAL(addElement(StructureEntry*,int)),this,SLOT(structureElementAdded(StructureEntry*,int)));
+    connect(edit->document,SIGNAL(removeElement(StructureEntry*,int)),this,SLOT(structureElementRemoved(StructureEntry*,int)));
+    connect(edit->document,SIGNAL(updateElement(StructureEntry*)),this,SLOT(structureElementUpdated(StructureEntry*)));
     edit->document->saveLineSnapshot(); // best guess of the lines used during last latex compilation
 
     if (!hidden) {
@@ -1892,7 +1903,7 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
                 }
                 existingView->document->baseStructure->children.clear();*/
             //
-            existingView->editor->setLineWrapping(configManager.editorConfig->wordwrap > 0);
+            existingView->updateLineWrapping();
             documents.deleteDocument(existingView->document, true);
             existingView->editor->setSilentReloadOnExternalChanges(existingView->document->remeberAutoReload);
             existingView->editor->setHidden(false);
@@ -1952,7 +1963,7 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
     LatexEditorView *edit = new LatexEditorView(nullptr, configManager.editorConfig, doc);
     edit->setLatexPackageList(&latexPackageList);
     edit->setHelp(&help);
-    if (hidden) {
+    if (hidden || deferEditorLoad) {
         edit->editor->setLineWrapping(false); //disable linewrapping in hidden docs to speed-up updates
         doc->clearWidthConstraint();
     }
@@ -1970,6 +1981,16 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
     else if (edit->editor->fileInfo().suffix().toLower() != "tex")
         m_languages->setLanguage(edit->editor, f_real);
 
+    if (deferEditorLoad) {
+        // placeholder tab of a restored session, the file is read by loadPendingFile()
+        edit->editor->setFileName(f_real);
+        edit->document->setEditorView(edit);
+        configureNewEditorViewEnd(edit, asProject, hidden);
+        MarkCurrentFileAsRecent();
+        pendingFileLoads.append(edit);
+        return edit;
+    }
+
     edit->editor->load(f_real, QDocument::defaultCodec());
 
     if (!edit->editor->languageDefinition())
@@ -1988,6 +2009,36 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
 		MarkCurrentFileAsRecent();
 	}
 
+	finishLoad(edit, doc, f_real, asProject, hidden, recheck, bibTeXmodified);
+
+#ifndef Q_OS_MAC
+	if (!hidden) {
+		if (windowState() == Qt::WindowMinimized || !isVisible() || !QApplication::activeWindow()) {
+			show();
+			if (windowState() == Qt::WindowMinimized)
+				setWindowState((windowState() & ~Qt::WindowMinimized) | Qt::WindowActive);
+			show();
+			raise();
+			QApplication::setActiveWindow(this);
+			activateWindow();
+			setFocus();
+			edit->editor->setFocus();
+		}
+	}
+#endif
+
+	runScriptsInList(Macro::ST_LOAD_THIS_FILE, doc->localMacros);
+
+	emit infoLoadFile(f_real);
+
+	return edit;
+}
+
+/*!
+ * \brief set up a document after the file has been read into its editor
+ */
+void Texstudio::finishLoad(LatexEditorView *edit, LatexDocument *doc, const QString &f_real, bool asProject, bool hidden, bool recheck, bool bibTeXmodified)
+{
     documents.updateMasterSlaveRelations(doc, recheck);
 
     if (recheck || hidden) {
@@ -1995,7 +2046,13 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
 	}
 
 	if (!hidden) {
-		if (QFile::exists(f_real + ".recover.bak~")
+		if (QDocumentJournal::hasRecoveryData(f_real)) {
+			if (UtilsUi::txsConfirm(tr("A crash recovery journal from %1 has been found for \"%2\".\nDo you want to restore the unsaved changes?").arg(QFileInfo(QDocumentJournal::journalFileName(f_real)).lastModified().toString(),f_real))) {
+				if (!QDocumentJournal::replay(f_real, edit->editor->document()))
+					UtilsUi::txsWarning(tr("Failed to restore the changes from the recovery journal \"%1\".").arg(QDocumentJournal::journalFileName(f_real)));
+			}
+			QDocumentJournal::discardRecoveryData(f_real);
+		} else if (QFile::exists(f_real + ".recover.bak~")
 		        && QFileInfo(f_real + ".recover.bak~").lastModified() > QFileInfo(f_real).lastModified()) {
             if (UtilsUi::txsConfirm(tr("A crash recover file from %1 has been found for \"%2\".\nDo you want to restore it?").arg(QFileInfo(f_real + ".recover.bak~").lastModified().toString(),f_real))) {
 				QFile f(f_real + ".recover.bak~");
@@ -2007,6 +2064,9 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
 			}
 		}
 
+		if (configManager.recoveryJournal)
+			edit->editor->document()->startJournal();
+
 	}
 
 	updateStructure(true, doc, true);
@@ -2028,28 +2088,6 @@ LatexEditorView *Texstudio::load(const QString &f , bool asProject, bool hidden,
 			rootDoc->lastCompiledBibTeXFiles.insert(fnp.absolute);
 		}
     }
-
-#ifndef Q_OS_MAC
-	if (!hidden) {
-		if (windowState() == Qt::WindowMinimized || !isVisible() || !QApplication::activeWindow()) {
-			show();
-			if (windowState() == Qt::WindowMinimized)
-				setWindowState((windowState() & ~Qt::WindowMinimized) | Qt::WindowActive);
-			show();
-			raise();
-			QApplication::setActiveWindow(this);
-			activateWindow();
-			setFocus();
-			edit->editor->setFocus();
-		}
-	}
-#endif
-
-	runScriptsInList(Macro::ST_LOAD_THIS_FILE, doc->localMacros);
-
-	emit infoLoadFile(f_real);
-
-	return edit;
 }
 
 void Texstudio::completerNeedsUpdate()
@@ -2622,6 +2660,8 @@ void Texstudio::fileSaveAs(const QString &fileName, const bool saveSilently)
 		removeDiffMarkers();// clean document from diff markers first
 		currentEditor()->save(fn);
 		currentEditorView()->document->setEditorView(currentEditorView()); //update file name
+		if (configManager.recoveryJournal)
+			currentEditor()->document()->startJournal();
 		MarkCurrentFileAsRecent();
 
 		//update Master/Child relations
@@ -3171,6 +3211,18 @@ void Texstudio::restoreSession(const Session &s, bool showProgress, bool warnMis
 
     bookmarks->setBookmarks(s.bookmarks()); // set before loading, so that bookmarks are automatically restored on load
 
+    // only the current file, the master file and the front tab of each tab group are read right away,
+    // the others start as empty placeholder editors which are filled by loadNextPendingFile() in the background
+    // or when they are activated; their wrapping, cursor, scroll position, folds and reference check follow on first activation
+    QSet<QString> shownFiles;
+    shownFiles.insert(s.currentFile());
+    shownFiles.insert(s.masterFile());
+    QHash<int, QString> lastFileInGroup;
+    foreach (const FileInSession &f, s.files())
+        lastFileInGroup.insert(f.editorGroup, f.fileName);
+    foreach (const QString &fileName, lastFileInGroup)
+        shownFiles.insert(fileName);
+
     QStringList missingFiles;
     for (int i = 0; i < s.files().size(); i++) {
         FileInSession f = s.files().at(i);
@@ -3179,22 +3231,21 @@ void Texstudio::restoreSession(const Session &s, bool showProgress, bool warnMis
             progress.setValue(i);
             progress.setLabelText(QFileInfo(f.fileName).fileName());
         }
+        const bool deferred = !shownFiles.contains(f.fileName);
+        deferEditorLoad = deferred;
         LatexEditorView *edView = load(f.fileName, f.fileName == s.masterFile(), false, false, true);
+        deferEditorLoad = false;
         if (edView) {
-            int line = f.cursorLine;
-            int col = f.cursorCol;
-            if (line >= edView->document->lineCount()) {
-                line = 0;
-                col = 0;
+            editors->moveToTabGroup(edView, f.editorGroup, -1);
+            if (deferred && !deferredFileStates.contains(edView)) {
+                deferredFileStates.insert(edView, f);
+                connect(edView, &QObject::destroyed, this, [this](QObject *view) {
+                    deferredFileStates.remove(static_cast<LatexEditorView *>(view));
+                    pendingFileLoads.removeOne(static_cast<LatexEditorView *>(view));
+                });
             } else {
-                if (edView->document->line(line).length() < col) {
-                    col = 0;
-                }
+                restoreFileState(edView, f);
             }
-            edView->editor->setCursorPosition(line, col);
-            edView->editor->scrollToFirstLine(f.firstLine);
-            edView->document->foldLines(f.foldedLines);
-            editors->moveToTabGroup(edView, f.editorGroup, -1);
         } else {
             missingFiles.append(f.fileName);
         }
@@ -3203,7 +3254,10 @@ void Texstudio::restoreSession(const Session &s, bool showProgress, bool warnMis
     // update ref/labels in one go;
     QList<LatexDocument *> completedDocs;
     foreach (LatexDocument *doc, documents.getDocuments()) {
-        doc->recheckRefsLabels();
+        if (pendingFileLoads.contains(doc->getEditorView()))
+            continue;
+        if (!deferredFileStates.contains(doc->getEditorView()))
+            doc->recheckRefsLabels();
         if (completedDocs.contains(doc))
             continue;
 
@@ -3229,6 +3283,91 @@ void Texstudio::restoreSession(const Session &s, bool showProgress, bool warnMis
     if (warnMissing && !missingFiles.isEmpty()) {
         UtilsUi::txsInformation(tr("The following files could not be loaded:") + "\n" + missingFiles.join("\n"));
     }
+
+    if (!pendingFileLoads.isEmpty())
+        QTimer::singleShot(0, this, SLOT(loadNextPendingFile()));
+}
+
+/*!
+ * \brief read the file of a placeholder editor created by restoreSession
+ */
+void Texstudio::loadPendingFile(LatexEditorView *edView)
+{
+    if (!pendingFileLoads.removeOne(edView)) return;
+    if (edView->editor->isContentModified()) return; // never replace changes made to the placeholder
+    const QString fileName = edView->editor->fileName();
+    const bool bibTeXmodified = documents.bibTeXFilesModified;
+    const bool current = edView == currentEditorView();
+    const bool hidden = edView->document->isHidden(); // closed while its related documents stay open
+
+    recheckLabels = false; // the references are checked with the reference check of the editor or of all documents
+    edView->editor->load(fileName, QDocument::defaultCodec());
+    if (!edView->editor->languageDefinition())
+        guessLanguageFromContent(m_languages, edView->editor);
+    edView->editor->document()->setLineEndingDirect(edView->editor->document()->originalLineEnding());
+    edView->document->setEditorView(edView);
+
+    if (current)
+        checkSVNConflicted();
+    finishLoad(edView, edView->document, fileName, false, hidden, true, bibTeXmodified);
+    recheckLabels = true;
+
+    runScriptsInList(Macro::ST_LOAD_THIS_FILE, edView->document->localMacros);
+    emit infoLoadFile(fileName);
+}
+
+/*!
+ * \brief read the next placeholder editor of a restored session, one per event loop iteration
+ * When the last one is read, the references of all documents are checked again, as they may refer to labels of the late files.
+ */
+void Texstudio::loadNextPendingFile()
+{
+    if (pendingFileLoads.isEmpty()) return;
+    loadPendingFile(pendingFileLoads.first());
+    if (!pendingFileLoads.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(loadNextPendingFile()));
+        return;
+    }
+    foreach (LatexDocument *doc, documents.getDocuments()) {
+        if (!deferredFileStates.contains(doc->getEditorView()))
+            doc->recheckRefsLabels();
+    }
+    if (currentEditorView())
+        updateCompleter(currentEditorView());
+}
+
+/*!
+ * \brief restore cursor, scroll position and folds of a file in a session
+ */
+void Texstudio::restoreFileState(LatexEditorView *edView, const FileInSession &f)
+{
+    int line = f.cursorLine;
+    int col = f.cursorCol;
+    if (line >= edView->document->lineCount()) {
+        line = 0;
+        col = 0;
+    } else {
+        if (edView->document->line(line).length() < col) {
+            col = 0;
+        }
+    }
+    edView->editor->setCursorPosition(line, col);
+    edView->editor->scrollToFirstLine(f.firstLine);
+    edView->document->foldLines(f.foldedLines);
+}
+
+/*!
+ * \brief finish restoring an editor of a session when it is shown for the first time
+ */
+void Texstudio::restoreDeferredFileState(LatexEditorView *edView)
+{
+    if (!edView) return;
+    loadPendingFile(edView);
+    if (!deferredFileStates.contains(edView)) return;
+    const FileInSession f = deferredFileStates.take(edView);
+    edView->updateLineWrapping();
+    edView->document->recheckRefsLabels();
+    restoreFileState(edView, f);
 }
 
 Session Texstudio::getCurrentSession()
@@ -3237,12 +3376,16 @@ Session Texstudio::getCurrentSession()
 
 	foreach (LatexEditorView *edView, editors->editors()) {
 		FileInSession f;
+		if (deferredFileStates.contains(edView)) {
+			f = deferredFileStates.value(edView); // never shown, keep the restored state
+		} else {
+			f.cursorLine = edView->editor->cursor().lineNumber();
+			f.cursorCol = edView->editor->cursor().columnNumber();
+			f.firstLine = edView->editor->getFirstVisibleLine();
+			f.foldedLines = edView->document->foldedLines();
+		}
 		f.fileName = edView->editor->fileName();
 		f.editorGroup = editors->tabGroupIndexFromEditor(edView);
-		f.cursorLine = edView->editor->cursor().lineNumber();
-		f.cursorCol = edView->editor->cursor().columnNumber();
-		f.firstLine = edView->editor->getFirstVisibleLine();
-		f.foldedLines = edView->document->foldedLines();
 		if (!f.fileName.isEmpty())
 			s.addFile(f);
 	}
@@ -3871,8 +4014,6 @@ void Texstudio::editTextToTitlecase(bool smart)
 	if (text.isEmpty()) return;
 	m_cursor.beginEditBlock();
 	// easier to be done in javascript
-	scriptengine *eng = new scriptengine();
-	eng->setEditorView(currentEditorView());
 	QString script =
 	    "/* \n" \
 	    "	* To Title Case 2.1  http://individed.com/code/to-title-case/ \n" \
@@ -3901,8 +4042,11 @@ void Texstudio::editTextToTitlecase(bool smart)
 	    "});\n" \
 	    "};\n" \
 	    "editor.replaceSelectedText(toTitleCase)";
+	scriptengine *eng = scriptengine::acquire();
+	eng->setEditorView(currentEditorView());
 	eng->setScript(script);
 	eng->run();
+	scriptengine::release(eng);
 
 	m_cursor.endEditBlock();
 
@@ -5204,13 +5348,14 @@ void Texstudio::execMacro(const Macro &m, const MacroExecContext &context, bool
 
 void Texstudio::runScript(const QString &script, const MacroExecContext &context, bool allowWrite)
 {
-	scriptengine *eng = new scriptengine();
+	scriptengine *eng = scriptengine::acquire();
 	eng->triggerMatches = context.triggerMatches;
 	eng->triggerId = context.triggerId;
 	if (currentEditorView()) eng->setEditorView(currentEditorView());
 
 	eng->setScript(script, allowWrite);
 	eng->run();
+	scriptengine::release(eng);
 }
 
 void Texstudio::editMacros()
@@ -8510,6 +8655,8 @@ void Texstudio::cursorPositionChanged()
 	if (currentLine == i) return;
 	currentLine = i;
 
+	QMetaObject::invokeMethod(grammarCheck, "setCursorLine", Qt::QueuedConnection, Q_ARG(LatexDocument *, view->document), Q_ARG(int, i));
+
 	StructureEntry *newSection = currentEditorView()->document->findSectionForLine(currentLine);
 
     if(newSection!=currentSection){
@@ -10137,10 +10284,11 @@ void Texstudio::recoverFromCrash()
 	foreach (LatexEditorView *edView, txsInstance->editors->editors())
 		edView->hide();
 
-	//save recover information
+	//save recover information, documents with a journal only need their pending records written
+	bool journalsFlushed = QDocumentJournal::flushAll();
 	foreach (LatexEditorView *edView, txsInstance->editors->editors()) {
 	        QEditor *ed = edView ? edView->editor : nullptr;
-		if (ed && ed->isContentModified() && !ed->fileName().isEmpty())
+		if (ed && ed->isContentModified() && !ed->fileName().isEmpty() && (!journalsFlushed || !ed->document()->hasJournal()))
 			ed->saveEmergencyBackup(ed->fileName() + ".recover.bak~");
 	}
 
@@ -10482,6 +10630,10 @@ void Texstudio::checkLanguageTool()
     }
     result += "\n\n";
     result +=tr("LT-URL: %1\n").arg(grammarCheck->serverUrl());
+    // the counters are changed by the grammar check thread, so they are read there
+    QString statistics;
+    QMetaObject::invokeMethod(grammarCheck, "statistics", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QString, statistics));
+    result +=tr("LT requests: %1\n").arg(statistics);
 
     currentEditorView()->editor->setText(result, false);
 }
@@ -10831,6 +10983,45 @@ void Texstudio::updateTOCs(){
     updateTOC();
     updateStructureLocally();
 }
+/*!
+    \brief like updateTOCs, but only applies the recorded structure changes to the structure tree
+ */
+void Texstudio::patchTOCs(){
+    updateTOC();
+    // other documents may change how includes are shown
+    updateStructureLocally(sender()==structureTreeDocument);
+}
+/*!
+    \brief record which entries of the document shown in the structure tree got new or fewer children
+    Changes within the label, todo, magic comment and bibliography lists only need their groups to be updated.
+ */
+void Texstudio::structureElementAdded(StructureEntry *parent, int row){
+    Q_UNUSED(row)
+    if(!structureTreeDocument || sender()!=structureTreeDocument) return;
+    if(parent->type==StructureEntry::SE_OVERVIEW)
+        structureTreeGroupsChanged=true;
+    else
+        structureTreeChanged.insert(parent);
+}
+void Texstudio::structureElementRemoved(StructureEntry *entry, int row){
+    Q_UNUSED(row)
+    if(!structureTreeDocument || sender()!=structureTreeDocument) return;
+    if(entry->type==StructureEntry::SE_INCLUDE && !configManager.indentIncludesInStructure){
+        // the following sections are placed relative to the include, see parseStructLocally
+        structureTreeChanged.insert(structureTreeDocument->baseStructure);
+    }
+    if(entry->parent->type==StructureEntry::SE_OVERVIEW)
+        structureTreeGroupsChanged=true;
+    else
+        structureTreeChanged.insert(entry->parent);
+    // the entry may be deleted once it is removed
+    forgetStructureEntries(entry,&structureTreeChanged);
+    forgetStructureEntries(entry,&structureTreeUpdated);
+}
+void Texstudio::structureElementUpdated(StructureEntry *entry){
+    if(!structureTreeDocument || sender()!=structureTreeDocument) return;
+    structureTreeUpdated.insert(entry);
+}
 
 /*!
  * \brief Collect structure info from all subfiles and create a toplevel TOC
@@ -11482,19 +11673,121 @@ void Texstudio::gotoLineFromAction()
     }
 }
 
+/*!
+ * \brief apply the structure changes recorded since the last update to the tree of the current document
+ * Only the children of the changed entries are built again, so the effort depends on the size of the change and not on the size of the document.
+ * \return false if the tree needs to be built completely
+ */
+bool Texstudio::patchStructureItems(QTreeWidgetItem *root, LatexDocument *doc){
+    const QSet<StructureEntry *> changed=structureTreeChanged;
+    const QSet<StructureEntry *> updated=structureTreeUpdated;
+    const bool groupsChanged=structureTreeGroupsChanged;
+    structureTreeChanged.clear();
+    structureTreeUpdated.clear();
+    structureTreeGroupsChanged=false;
+    if(changed.contains(doc->baseStructure)) return false;
+
+    // updating the item of the current section drops its mark
+    QTreeWidgetItem *marked=structureTreeItems.value(currentSection);
+    const QBrush markBrush=marked ? marked->background(0) : QBrush();
+
+    for(StructureEntry *entry:changed){
+        // new entries are built with their parent, removed ones are dropped with it
+        QTreeWidgetItem *item=structureTreeItems.value(entry);
+        if(!item || !structureItemIsCurrent(item)) continue;
+
+        QTreeWidgetItem built;
+        QVector<QTreeWidgetItem *>rootVector(latexParser.MAX_STRUCTURE_LEVEL,&built);
+        QList<QTreeWidgetItem*> todoList;
+        QList<QTreeWidgetItem*> labelList;
+        QList<QTreeWidgetItem*> magicList;
+        QList<QTreeWidgetItem*> biblioList;
+        parseStructLocally(entry,rootVector,&todoList,&labelList,&magicList,&biblioList);
+        const bool grouped=!todoList.isEmpty() || !labelList.isEmpty() || !magicList.isEmpty() || !biblioList.isEmpty();
+        qDeleteAll(todoList);
+        qDeleteAll(labelList);
+        qDeleteAll(magicList);
+        qDeleteAll(biblioList);
+        if(grouped || !structureItemsArePlaced(entry,&built,configManager.indentIncludesInStructure))
+            return false;
+        syncStructureItems(item,&built,&structureTreeItems);
+    }
+
+    if(groupsChanged){
+        QTreeWidgetItem built;
+        QVector<QTreeWidgetItem *>rootVector(latexParser.MAX_STRUCTURE_LEVEL,&built);
+        QList<QTreeWidgetItem*> todoList;
+        QList<QTreeWidgetItem*> labelList;
+        QList<QTreeWidgetItem*> magicList;
+        QList<QTreeWidgetItem*> biblioList;
+        for(StructureEntry *entry:doc->baseStructure->children){
+            if(entry->type==StructureEntry::SE_OVERVIEW)
+                parseStructLocally(entry,rootVector,&todoList,&labelList,&magicList,&biblioList);
+        }
+        const QStringList keys={"LABEL","TODO","MAGIC","BIBLIO"};
+        QList<QTreeWidgetItem*> *lists[]={&labelList,&todoList,&magicList,&biblioList};
+        bool placed=true;
+        for(int g=0;g<keys.size();++g){
+            // the groups are placed before the sections
+            QTreeWidgetItem *group=nullptr;
+            for(int i=0;i<root->childCount() && !group;++i){
+                QTreeWidgetItem *item=root->child(i);
+                if(item->data(0,Qt::UserRole).value<StructureEntry *>()) break;
+                if(item->data(0,Qt::UserRole+1).toString()==keys.at(g))
+                    group=item;
+            }
+            if((group==nullptr)!=lists[g]->isEmpty()){
+                // a group appears or disappears
+                placed=false;
+                continue;
+            }
+            if(!group) continue;
+            QTreeWidgetItem items;
+            items.addChildren(*lists[g]);
+            lists[g]->clear();
+            syncStructureItems(group,&items,&structureTreeItems);
+        }
+        for(QList<QTreeWidgetItem*> *list:lists)
+            qDeleteAll(*list);
+        if(!placed) return false;
+    }
+
+    for(StructureEntry *entry:updated){
+        QTreeWidgetItem *item=structureTreeItems.value(entry);
+        if(entry==doc->baseStructure || !item || !structureItemIsCurrent(item)) continue; // the root item is set up by updateStructureLocally
+        QTreeWidgetItem *fresh=createStructureItem(entry);
+        copyStructureItemLook(item,fresh);
+        delete fresh;
+    }
+
+    if(marked){
+        QTreeWidgetItem *item=structureTreeItems.value(currentSection);
+        if(item && (item!=marked || item->background(0)!=markBrush)){
+            item->setData(0,Qt::UserRole+1,item->background(0));
+            item->setBackground(0,markBrush);
+        }
+    }
+    return true;
+}
+
 /*!
  * \brief Collect structure info from file and create a TOC
  * This approach avoid the model/view which repeatedly led to crashes because the view component caches info from the actual model and is not kept up-to-date properly
  *
  */
-void Texstudio::updateStructureLocally(){
-    if(!structureTreeWidget->isVisible()) return; // don't update if TOC is not shown, save unnecessary effort
+void Texstudio::updateStructureLocally(bool patch){
+    if(!structureTreeWidget->isVisible()){
+        // don't update if TOC is not shown, save unnecessary effort
+        structureTreeDocument=nullptr;
+        return;
+    }
     QTreeWidgetItem *root= nullptr;
 
     LatexDocument *doc=documents.getCurrentDocument();
     if(!doc){
         // no root document
         // clear TOC completely
+        structureTreeDocument=nullptr;
         structureTreeWidget->clear();
         return;
     }
@@ -11508,6 +11801,7 @@ void Texstudio::updateStructureLocally(){
     if(configManager.structureShowSingleDoc){
         root= structureTreeWidget->topLevelItem(0);
         if(structureTreeWidget->topLevelItemCount()>1){
+            structureTreeDocument=nullptr;
             for(int i=1;structureTreeWidget->topLevelItemCount()>1;){
                 QTreeWidgetItem *item=structureTreeWidget->takeTopLevelItem(i);
                 delete item;
@@ -11588,10 +11882,6 @@ void Texstudio::updateStructureLocally(){
         }
     }
     StructureEntry *selectedEntry=nullptr;
-    bool itemExpandedLABEL=false;
-    bool itemExpandedTODO=false;
-    bool itemExpandedMAGIC=false;
-    bool itemExpandedBIBLIO=false;
     bool addToTopLevel=false;
     if(!root){
         root=new QTreeWidgetItem();
@@ -11605,29 +11895,7 @@ void Texstudio::updateStructureLocally(){
                 selectedEntry = item->data(0,Qt::UserRole).value<StructureEntry *>();
             }
         }
-        // remove all item in topTOC but keep itemTODO
-        for(int i=0;i<root->childCount();++i){
-            QTreeWidgetItem *item=root->child(i);
-            if(item->data(0,Qt::UserRole+1).toString()=="TODO"){
-                itemExpandedTODO=item->isExpanded();
-            }
-            if(item->data(0,Qt::UserRole+1).toString()=="LABEL"){
-                itemExpandedLABEL=item->isExpanded();
-            }
-            if(item->data(0,Qt::UserRole+1).toString()=="MAGIC"){
-                itemExpandedMAGIC=item->isExpanded();
-            }
-            if(item->data(0,Qt::UserRole+1).toString()=="BIBLIO"){
-                itemExpandedBIBLIO=item->isExpanded();
-            }
-        }
-        QList<QTreeWidgetItem*> items=root->takeChildren();
-        qDeleteAll(items);
     }
-    QVector<QTreeWidgetItem *>rootVector(latexParser.MAX_STRUCTURE_LEVEL,root);
-    // fill TOC, starting by current master/top
-
-
     StructureEntry *base=doc->baseStructure;
 
     root->setText(0,doc->getFileInfo().fileName());
@@ -11641,6 +11909,15 @@ void Texstudio::updateStructureLocally(){
     font.setBold(true);
     root->setFont(0,font);
 
+    // while the same document is shown, only the recorded changes need to be applied
+    if(patch && !addToTopLevel && structureTreeDocument==doc && structureTreeItems.value(base)==root && patchStructureItems(root,doc))
+        return;
+
+    // fill TOC, starting by current master/top
+    // the items are built detached, only the differences are applied to the shown tree
+    QTreeWidgetItem built;
+    QVector<QTreeWidgetItem *>rootVector(latexParser.MAX_STRUCTURE_LEVEL,&built);
+
     QList<QTreeWidgetItem*> todoList;
     QList<QTreeWidgetItem*> labelList;
     QList<QTreeWidgetItem*> magicList;
@@ -11654,34 +11931,39 @@ void Texstudio::updateStructureLocally(){
         itemBIBLIO->setText(0,tr("BIBLIOGRAPHY"));
         itemBIBLIO->setData(0,Qt::UserRole+1,"BIBLIO");
         itemBIBLIO->insertChildren(0,biblioList);
-        root->insertChild(0,itemBIBLIO);
-        itemBIBLIO->setExpanded(itemExpandedBIBLIO);
+        built.insertChild(0,itemBIBLIO);
     }
     if(!magicList.isEmpty()){
         QTreeWidgetItem *itemTODO=new QTreeWidgetItem();
         itemTODO->setText(0,tr("MAGIC_COMMENTS"));
         itemTODO->setData(0,Qt::UserRole+1,"MAGIC");
         itemTODO->insertChildren(0,magicList);
-        root->insertChild(0,itemTODO);
-        itemTODO->setExpanded(itemExpandedMAGIC);
+        built.insertChild(0,itemTODO);
     }
     if(!todoList.isEmpty()){
         QTreeWidgetItem *itemTODO=new QTreeWidgetItem();
         itemTODO->setText(0,tr("TODO"));
         itemTODO->setData(0,Qt::UserRole+1,"TODO");
         itemTODO->insertChildren(0,todoList);
-        root->insertChild(0,itemTODO);
-        itemTODO->setExpanded(itemExpandedTODO);
+        built.insertChild(0,itemTODO);
     }
     if(!labelList.isEmpty()){
         QTreeWidgetItem *itemLABEL=new QTreeWidgetItem();
         itemLABEL->setText(0,tr("LABELS"));
         itemLABEL->setData(0,Qt::UserRole+1,"LABEL");
         itemLABEL->insertChildren(0,labelList);
-        root->insertChild(0,itemLABEL);
-        itemLABEL->setExpanded(itemExpandedLABEL);
+        built.insertChild(0,itemLABEL);
     }
 
+    syncStructureItems(root,&built);
+
+    structureTreeDocument=doc;
+    structureTreeChanged.clear();
+    structureTreeUpdated.clear();
+    structureTreeGroupsChanged=false;
+    structureTreeItems.clear();
+    indexStructureItems(root,&structureTreeItems);
+
     root->setExpanded(true);
     root->setSelected(false);
     updateCurrentPosInTOC(nullptr,nullptr,selectedEntry);
@@ -11703,9 +11985,6 @@ void Texstudio::parseStructLocally(
     QList<QTreeWidgetItem *> * magicList,
     QList<QTreeWidgetItem *> * biblioList
 ){
-    
-    static const QColor beyondEndColor(255,170,0);
-    static const QColor inAppendixColor(200,230,200);
 
 	for(auto entry : se -> children)
 		switch(entry -> type){
@@ -11717,59 +11996,34 @@ void Texstudio::parseStructLocally(
 			continue;
 		case StructureEntry::SE_TODO:
 
-			if(todoList){
-				auto item = new QTreeWidgetItem();
-				item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
-				item -> setText(0,entry -> title);
-				todoList -> append(item);
-			}
+			if(todoList)
+				todoList -> append(createStructureItem(entry));
 
 			continue;
 		case StructureEntry::SE_LABEL:
 
-			if(labelList){
-				auto item = new QTreeWidgetItem();
-				item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
-				item -> setText(0,entry -> title);
-				labelList -> append(item);
-			}
+			if(labelList)
+				labelList -> append(createStructureItem(entry));
 
 			continue;
 		case StructureEntry::SE_MAGICCOMMENT:
 
-			if(magicList){
-				auto item = new QTreeWidgetItem();
-				item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
-				item -> setText(0,entry -> title);
-				magicList -> append(item);
-			}
+			if(magicList)
+				magicList -> append(createStructureItem(entry));
 
 			continue;
 		case StructureEntry::SE_BIBTEX:
 
-			if(biblioList){
-				auto item = new QTreeWidgetItem();
-				item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
-				item -> setText(0,entry -> title);
-				biblioList -> append(item);
-			}
+			if(biblioList)
+				biblioList -> append(createStructureItem(entry));
 
 			continue;
 		case StructureEntry::SE_SECTION: {
 
-			auto item = new QTreeWidgetItem();
-            item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
-            item -> setText(0,entry -> title);
-            item -> setIcon(0,iconSection.value(entry -> level));
+			auto item = createStructureItem(entry);
             rootVector[entry -> level] -> addChild(item);
             item -> setExpanded(entry -> expanded);
             
-			if(documents.markStructureElementsInAppendix && entry -> hasContext(StructureEntry::InAppendix))
-				item -> setBackground(0,inAppendixColor);
-            
-			if(documents.markStructureElementsBeyondEnd && entry -> hasContext(StructureEntry::BeyondEnd))
-				item -> setBackground(0,beyondEndColor);
-            
 			// fill rootVector with item for subsequent lower level elements (which are children of item then)
             for(int i = entry -> level + 1;i < latexParser.MAX_STRUCTURE_LEVEL;i++)
                 rootVector[i] = item;
@@ -11781,23 +12035,7 @@ void Texstudio::parseStructLocally(
 			continue;
 		case StructureEntry::SE_INCLUDE: {
 
-			auto doc = entry -> document;
-            const auto root = doc -> getRootDocument();
-
-            QFileInfo fi(root -> getFileInfo().absolutePath(),entry -> title);
-            doc = documents.findDocumentFromName(fi.absoluteFilePath());
-
-            if(!doc)
-                doc = documents.findDocumentFromName(fi.absoluteFilePath() + ".tex");
-
-            auto item = new QTreeWidgetItem();
-            item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
-            item -> setText(0,entry -> title);
-
-            if(!doc)
-                item -> setForeground(0,Qt::red);
-
-            item -> setIcon(0,QIcon(":/images/include.png"));
+			auto item = createStructureItem(entry);
             
 			if(configManager.indentIncludesInStructure)
                 rootVector[latexParser.MAX_STRUCTURE_LEVEL - 1] -> addChild(item);
@@ -11814,6 +12052,57 @@ void Texstudio::parseStructLocally(
 		}
 }
 
+/*!
+ * \brief create the item of a single structure entry, without the items of its children
+ */
+QTreeWidgetItem *Texstudio::createStructureItem(StructureEntry *entry){
+
+    static const QColor beyondEndColor(255,170,0);
+    static const QColor inAppendixColor(200,230,200);
+
+    auto item = new QTreeWidgetItem();
+    item -> setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(entry));
+    item -> setText(0,entry -> title);
+
+	switch(entry -> type){
+	case StructureEntry::SE_SECTION:
+
+        item -> setIcon(0,iconSection.value(entry -> level));
+
+		if(documents.markStructureElementsInAppendix && entry -> hasContext(StructureEntry::InAppendix))
+			item -> setBackground(0,inAppendixColor);
+
+		if(documents.markStructureElementsBeyondEnd && entry -> hasContext(StructureEntry::BeyondEnd))
+			item -> setBackground(0,beyondEndColor);
+
+		break;
+	case StructureEntry::SE_INCLUDE: {
+
+		auto doc = entry -> document;
+        const auto root = doc -> getRootDocument();
+
+        QFileInfo fi(root -> getFileInfo().absolutePath(),entry -> title);
+        doc = documents.findDocumentFromName(fi.absoluteFilePath());
+
+        if(!doc)
+            doc = documents.findDocumentFromName(fi.absoluteFilePath() + ".tex");
+
+        if(!doc)
+            item -> setForeground(0,Qt::red);
+
+        static const QIcon includeIcon(":/images/include.png"); // shared, so that unchanged items keep their icon
+        item -> setIcon(0,includeIcon);
+
+		}
+
+		break;
+	default:
+		break;
+	}
+
+	return item;
+}
+
 
 void Texstudio::openAllRelatedDocuments(){
 
@@ -13,6 +13,7 @@
 #include "Latex/Document.hpp"
 
 #include <algorithm>
+#include <QtConcurrentMap>
 
 
 ClsWord::ClsWord(QString word,int count)
@@ -208,6 +209,267 @@ void TextAnalysisDialog::init(){
 }
 
 
+namespace {
+
+	struct CountOptions {
+		int sentenceLength , minSentenceLength , minimumWordLength;
+		bool respectSentenceEnd;
+		QString endCharacters;
+		int selectionStartLine , selectionStartIndex , selectionEndLine , selectionEndIndex;
+		int mapCount;
+	};
+
+
+	void tokenizeLine(TextAnalysisLine & line){
+
+		line.tokens.clear();
+
+		bool commentReached = false;
+		int state;
+
+		LatexReader lr(line.text);
+
+		while((state = lr.nextWord(true)) != LatexReader::NW_NOTHING){
+
+			if(lr.word.endsWith('.'))
+				lr.word.chop(1);
+
+			TextAnalysisToken token;
+			token.word = lr.word.toLower();
+			token.start = lr.wordStartIndex;
+			token.end = lr.index;
+			token.commentStart = ! commentReached && state == LatexReader::NW_COMMENT;
+
+			if(commentReached || state == LatexReader::NW_COMMENT)
+				token.type = 2;
+			else
+			if(state == LatexReader::NW_COMMAND)
+				token.type = 1;
+			else
+			if(state == LatexReader::NW_TEXT)
+				token.type = 0;
+			else
+				token.type = -1;
+
+			commentReached = commentReached || token.commentStart;
+			line.tokens.append(token);
+		}
+	}
+
+
+	/*!
+	 * Counts the words and phrases of the lines [from,to).
+	 * Phrases span lines, so lastWords and sentenceLengths have to be
+	 * initialized with the phrase state at from before run is called.
+	 */
+	struct CountChunk {
+
+		const CountOptions * options;
+		const QVector<TextAnalysisLine> * lines;
+		const QVector<int> * extraMaps;
+		int from , to;
+
+		QVector<QMap<QString,int> > maps[3];
+		QVector<int> lineCount[3];
+
+		QList<QString> lastWords[3];
+		int sentenceLengths[3];
+
+		void resetSentence(int type){
+			sentenceLengths[type] = 0;
+			lastWords[type].clear();
+		}
+
+		bool containsEndCharacter(const QString & text,int from,int to) const {
+
+			for(int i = from;i < to;i++)
+				if(options -> endCharacters.contains(text.at(i)))
+					return true;
+
+			return false;
+		}
+
+		void countLine(int l,bool record);
+		void run();
+	};
+
+
+	void CountChunk::countLine(int l,bool record){
+
+		const auto & o = * options;
+		const TextAnalysisLine & line = lines -> at(l);
+		const QString & text = line.text;
+		const int extraMap = extraMaps -> at(l);
+
+		if(record && extraMap != 0)
+			lineCount[0][extraMap]++;
+
+		bool commentReached = false;
+		bool lineCountedAsText = false;
+		int lastIndex = 0;
+
+		for(const auto & token : line.tokens){
+
+			bool inSelection = (o.selectionStartLine == o.selectionEndLine)
+				? (l == o.selectionStartLine) &&
+				  (token.end > o.selectionStartIndex) &&
+				  (token.start <= o.selectionEndIndex)
+				: (l < o.selectionEndLine) && (l > o.selectionStartLine) ||
+				  (l == o.selectionStartLine) && (token.end > o.selectionStartIndex) ||
+				  (l == o.selectionEndLine) && (token.start <= o.selectionEndIndex);
+
+			if(commentReached){
+
+				if(o.respectSentenceEnd && containsEndCharacter(text,lastIndex,token.start))
+					resetSentence(2);
+
+			} else
+			if(token.commentStart){
+
+				commentReached = true;
+
+				if(record){
+
+					lineCount[2][0]++;
+
+					if(inSelection)
+						lineCount[2][1]++;
+
+					if(extraMap != 0)
+						lineCount[2][extraMap]++;
+				}
+
+				//find sentence end characters which belong to the words before the comment start
+
+				if(o.respectSentenceEnd)
+					for(int i = lastIndex;i < token.start;i++){
+
+						if(
+							text.at(i) == QChar('%') &&
+							(i == 0 || text.at(i - 1) != QChar('\\'))
+						) break;
+
+						if(o.endCharacters.contains(text.at(i))){
+							resetSentence(0);
+							break;
+						}
+					}
+			} else
+			if(token.type == 0 && ! lineCountedAsText){
+
+				lineCountedAsText = true;
+
+				if(record){
+
+					lineCount[1][0]++;
+
+					if(inSelection)
+						lineCount[1][1]++;
+
+					if(extraMap != 0)
+						lineCount[1][extraMap]++;
+				}
+			}
+
+			if(o.respectSentenceEnd && !commentReached && containsEndCharacter(text,lastIndex,token.start))
+				resetSentence(0);
+
+			lastIndex = token.end;
+
+			const int type = token.type;
+
+			if(type == -1 || token.word.size() < o.minimumWordLength)
+				continue;
+
+			lastWords[type].append(token.word);
+			sentenceLengths[type] += token.word.size() + 1;
+
+			if(lastWords[type].size() > o.sentenceLength){
+				sentenceLengths[type] -= lastWords[type].first().size() + 1;
+				lastWords[type].removeFirst();
+			}
+
+			if(!record || lastWords[type].size() < o.minSentenceLength)
+				continue;
+
+			QString phrase;
+			phrase.reserve(sentenceLengths[type]);
+
+			for(const auto & word : lastWords[type])
+				phrase += word + " ";
+
+			phrase.truncate(phrase.size() - 1);
+			maps[type][0][phrase]++;
+
+			if(inSelection)
+				maps[type][1][phrase]++;
+
+			if(extraMap != 0)
+				maps[type][extraMap][phrase]++;
+		}
+
+
+		//it makes sense to ignore in something like .%. the sentence end after the % (and is less work)
+
+		if(o.respectSentenceEnd && containsEndCharacter(text,lastIndex,text.size()))
+			resetSentence(commentReached ? 2 : 0);
+	}
+
+
+	void CountChunk::run(){
+
+		for(int i = 0;i < 3;i++){
+			maps[i].resize(options -> mapCount);
+			lineCount[i].fill(0,options -> mapCount);
+		}
+
+		for(int l = from;l < to;l++)
+			countLine(l,true);
+	}
+}
+
+
+QVector<TextAnalysisLine> textAnalysisLines(QDocument * document){
+
+	const int lines = document -> lines();
+
+	QVector<TextAnalysisLine> lineData(lines);
+	QList<TextAnalysisLine> changedLines;
+	QList<int> changedLineNumbers;
+
+	for(int l = 0;l < lines;l++){
+
+		QDocumentLine line = document -> line(l);
+		QString text = line.text();
+		QVariant cookie = line.getCookie(QDocumentLine::TEXT_ANALYSIS_COOKIE);
+
+		if(cookie.isValid()){
+
+			TextAnalysisLine cached = cookie.value<TextAnalysisLine>();
+
+			if(cached.text == text){
+				lineData[l] = cached;
+				continue;
+			}
+		}
+
+		TextAnalysisLine changed;
+		changed.text = text;
+		changedLines.append(changed);
+		changedLineNumbers.append(l);
+	}
+
+	QtConcurrent::blockingMap(changedLines,tokenizeLine);
+
+	for(int i = 0;i < changedLines.size();i++){
+		lineData[changedLineNumbers[i]] = changedLines[i];
+		document -> line(changedLineNumbers[i]).setCookie(QDocumentLine::TEXT_ANALYSIS_COOKIE,QVariant::fromValue(changedLines[i]));
+	}
+
+	return lineData;
+}
+
+
 void TextAnalysisDialog::needCount(){
 
 	if(
@@ -244,7 +506,9 @@ void TextAnalysisDialog::needCount(){
 			lineCount[i][j] = 0;
 	}
 	
-	lineCount[0][0] = document -> lines();
+	const int lines = document -> lines();
+
+	lineCount[0][0] = lines;
 
 	int
 		selectionStartIndex = -1,
@@ -274,12 +538,25 @@ void TextAnalysisDialog::needCount(){
 		lineCount[0][1] = selectionEndLine - selectionStartLine + 1;
 	}
 
+	CountOptions options;
+	options.sentenceLength = lastSentenceLength;
+	options.minSentenceLength = lastMinSentenceLength;
+	options.minimumWordLength = minimumWordLength;
+	options.respectSentenceEnd = respectSentenceEnd;
+	options.endCharacters = lastEndCharacters;
+	options.selectionStartLine = selectionStartLine;
+	options.selectionStartIndex = selectionStartIndex;
+	options.selectionEndLine = selectionEndLine;
+	options.selectionEndIndex = selectionEndIndex;
+	options.mapCount = maps[0].size();
+
+	const QVector<TextAnalysisLine> lineData = textAnalysisLines(document);
+
+	QVector<int> extraMaps(lines);
 	int nextChapter = 0;
 	int extraMap = 0;
-	QList<QString> lastWords[3];
-	int sentenceLengths[3] = { 0 , 0 , 0 };
 
-	for(int l = 0;l < document -> lines();l++){
+	for(int l = 0;l < lines;l++){
 
 		if(nextChapter < chapters.size() && l + 1 >= chapters[nextChapter].second) {
 			if (nextChapter == 0) extraMap = 2;
@@ -288,162 +565,63 @@ void TextAnalysisDialog::needCount(){
 			if (extraMap >= maps[0].size()) extraMap = 0;
 		}
 
-		if(extraMap != 0)
-			lineCount[0][extraMap]++;
-		
-		QString line = document -> line(l).text();
-		
-		bool commentReached = false;
-		bool lineCountedAsText = false;
-		int state;
-		int lastIndex = 0;
+		extraMaps[l] = extraMap;
+	}
 
-		LatexReader lr(line);
-		
-		while((state = lr.nextWord(true)) != LatexReader::NW_NOTHING){
+	//count chunks of lines in parallel and merge the results
 
-			if(lr.word.endsWith('.'))
-				lr.word.chop(1);
-			
-			bool inSelection = (selectionStartLine == selectionEndLine)
-				? (l == selectionStartLine) && 
-				  (lr.index > selectionStartIndex) && 
-				  (lr.wordStartIndex <= selectionEndIndex)
-				: (l < selectionEndLine) && (l > selectionStartLine) ||
-				  (l == selectionStartLine) && (lr.index > selectionStartIndex) ||
-				  (l == selectionEndLine) && (lr.wordStartIndex <= selectionEndIndex);
-				
-			
-			auto curWord = lr.word.toLower();
-			int curType = -1;
+	//the phrase state at the start of a chunk is carried over from the previous one
+	//in a single pass which does not record anything, that is cheap compared to counting
 
-			if(commentReached){
-				if(respectSentenceEnd) 
-					for(int l = lastIndex;l < lr.wordStartIndex;l++)
-						if(lastEndCharacters.contains(line.at(l))){
-							sentenceLengths[2] = 0;
-							lastWords[2].clear();
-							break;
-						}
+	const int chunkSize = qMax(1000,lines / (4 * qMax(1,QThread::idealThreadCount())) + 1);
+	QList<CountChunk> chunks;
 
-				curType = 2;
+	CountChunk state;
+	state.options = & options;
+	state.lines = & lineData;
+	state.extraMaps = & extraMaps;
 
-			} else 
-			if(state == LatexReader::NW_COMMENT){
+	for(int i = 0;i < 3;i++)
+		state.sentenceLengths[i] = 0;
 
-				//comment is only % character
-				curType = 2;
+	for(int from = 0;from < lines;from += chunkSize){
 
-				if(!commentReached){
-					
-					commentReached = true;
-					
-					lineCount[2][0]++;
+		CountChunk chunk = state;
+		chunk.from = from;
+		chunk.to = qMin(lines,from + chunkSize);
+		chunks.append(chunk);
 
-					if(inSelection)
-						lineCount[2][1]++;
-					
-					if(extraMap != 0)
-						lineCount[2][extraMap]++;
-					
-					//find sentence end characters which belong to the words before the comment start
-					
-					if(respectSentenceEnd)
-						for(int i = lastIndex;i < lr.wordStartIndex;i++){
-							
-							if(
-								line.at(i) == QChar('%') && 
-								(i == 0 || line.at(i - 1) != QChar('\\'))
-							){
-								lastIndex = i;
-								break;
-							}
+		for(int l = chunk.from;l < chunk.to;l++)
+			state.countLine(l,false);
+	}
 
-							if(lastEndCharacters.contains(line.at(i))){
-								sentenceLengths[0] = 0;
-								lastWords[0].clear();
-								break;
-							}
-						}
-				}
-			} else
-			if(state == LatexReader::NW_COMMAND){
-				curType = 1;
-			} else 
-			if(state == LatexReader::NW_TEXT){
-			
-				curType = 0;
-			
-				if(!lineCountedAsText){
+	QtConcurrent::blockingMap(chunks,[](CountChunk & chunk){ chunk.run(); });
 
-					lineCountedAsText = true;
-					lineCount[1][0]++;
-					
-					if(inSelection)
-						lineCount[1][1]++;
-					
-					if(extraMap != 0)
-						lineCount[1][extraMap]++;
-				}
-			}
+	for(const auto & chunk : chunks)
+		mergeCount(chunk.maps,chunk.lineCount);
 
-			if(respectSentenceEnd && !commentReached)
-				for(int i = lastIndex;i < lr.wordStartIndex;i++)
-					if(lastEndCharacters.contains(line.at(i))){
-						
-						sentenceLengths[0] = 0;
-						lastWords[0].clear();
-						
-						break;
-					}
-					
-			lastIndex = lr.index;
-			
-			if(curType != -1 && curWord.size() >= minimumWordLength){
+	alreadyCount = true;
+}
 
-				lastWords[curType].append(curWord);
-				sentenceLengths[curType] += curWord.size() + 1;
 
-				if(lastWords[curType].size() > lastSentenceLength){
-					sentenceLengths[curType] -= lastWords[curType].first().size() + 1;
-					lastWords[curType].removeFirst();
-				}
+void TextAnalysisDialog::mergeCount(const QVector<QMap<QString,int> > (& chunkMaps)[3],const QVector<int> (& chunkLineCount)[3]){
 
-				if(lastWords[curType].size() >= lastMinSentenceLength){
+	for(int i = 0;i < 3;i++){
 
-					curWord = "";
-					curWord.reserve(sentenceLengths[curType]);
-					
-					for(const auto & word : lastWords[curType])
-						curWord += word + " ";
+		for(int j = 0;j < maps[i].size();j++){
 
-					curWord.truncate(curWord.size() - 1);
-					maps[curType][0][curWord] = maps[curType][0][curWord] + 1;
-					
-					if(inSelection)
-						maps[curType][1][curWord] = maps[curType][1][curWord] + 1;
-					
-					if(extraMap != 0)
-						maps[curType][extraMap][curWord] = maps[curType][extraMap][curWord] + 1;
-				}
+			if(maps[i][j].isEmpty()){
+				maps[i][j] = chunkMaps[i][j];
+				continue;
 			}
-		}
-
-
-		//it makes sense to ignore in something like .%. the sentence end after the % (and is less work)
 
-		const auto c = (commentReached) ? 2 : 0 ;
+			for(auto it = chunkMaps[i][j].constBegin();it != chunkMaps[i][j].constEnd();++it)
+				maps[i][j][it.key()] += it.value();
+		}
 
-		if(respectSentenceEnd)
-			for(int i = lastIndex;i < line.size();i++)
-				if(lastEndCharacters.contains(line.at(i))){
-					sentenceLengths[c] = 0;
-					lastWords[c].clear();
-					break;
-				}
+		for(int j = 0;j < lineCount[i].size();j++)
+			lineCount[i][j] += chunkLineCount[i][j];
 	}
-
-	alreadyCount = true;
 }
 
 
@@ -455,3 +455,180 @@ bool Macro::loadFromText(const QString & text){
 }
 
 
+
+
+/*!
+ * Rebuilds the index if macros is not the list indexed last time.
+ */
+void MacroTriggerIndex::update(const QList<Macro> & macros){
+
+	if(indexedMacros.isSharedWith(macros) || (indexedMacros.isEmpty() && macros.isEmpty()))
+		return;
+
+	indexedMacros = macros;
+	byLastChar.clear();
+	withoutSuffix.clear();
+	suffixes.fill(QString(),macros.size());
+
+	for(int i = 0;i < macros.size();i++){
+
+		const Macro & macro = macros.at(i);
+
+		if(!macro.isActiveForTrigger(Macro::ST_REGEX))
+			continue;
+
+		// triggerRegex is "(?:" + trigger + ")$"
+		QString pattern = macro.triggerRegex.pattern();
+		QString suffix = literalSuffix(pattern.mid(3,pattern.length() - 5));
+
+		suffixes[i] = suffix;
+
+		if(suffix.isEmpty())
+			withoutSuffix.append(i);
+		else
+			byLastChar[suffix.at(suffix.length() - 1)].append(i);
+	}
+}
+
+
+/*!
+ * Returns the indices of the regex triggered macros which might match text, in macro order.
+ */
+QList<int> MacroTriggerIndex::candidates(const QString & text) const {
+
+	QList<int> result;
+
+	if(text.isEmpty())
+		return withoutSuffix;
+
+	const QList<int> withSuffix = byLastChar.value(text.at(text.length() - 1));
+
+	int j = 0;
+
+	for(int i : withSuffix){
+
+		while(j < withoutSuffix.size() && withoutSuffix.at(j) < i)
+			result.append(withoutSuffix.at(j++));
+
+		if(text.endsWith(suffixes.at(i)))
+			result.append(i);
+	}
+
+	while(j < withoutSuffix.size())
+		result.append(withoutSuffix.at(j++));
+
+	return result;
+}
+
+
+// returns the index of the ] closing the character class starting at start
+static int skipCharacterClass(const QString & pattern,int start){
+
+	int i = start + 1;
+
+	// a ] directly after [ or [^ is a member of the set
+	if(i < pattern.length() && pattern.at(i) == '^')
+		i++;
+
+	if(i < pattern.length() && pattern.at(i) == ']')
+		i++;
+
+	for(;i < pattern.length() && pattern.at(i) != ']';i++)
+		if(pattern.at(i) == '\\')
+			i++;
+
+	return i;
+}
+
+
+/*!
+ * Returns the literal characters every match of the regular expression pattern ends with.
+ * The result is conservative, i.e. it is empty if the end of the pattern is not a plain string.
+ */
+QString MacroTriggerIndex::literalSuffix(const QString & pattern){
+
+	QString suffix;
+
+	for(int i = 0;i < pattern.length();i++){
+
+		const QChar c = pattern.at(i);
+		bool literal = false;
+		QChar atom = c;
+
+		switch(c.unicode()){
+		case '\\': {
+
+			if(i + 1 >= pattern.length())
+				return QString();
+
+			const QChar e = pattern.at(++i);
+
+			if(!e.isLetterOrNumber()){
+				literal = true;
+				atom = e;
+			} else
+			if(e == 'n' || e == 't'){
+				literal = true;
+				atom = (e == 'n') ? QChar('\n') : QChar('\t');
+			} else
+			if(e == 'x'){
+				for(int k = 0;k < 4 && i + 1 < pattern.length() && QString("0123456789abcdefABCDEF").contains(pattern.at(i + 1));k++)
+					i++;
+			} else
+			if(e == '0'){
+				for(int k = 0;k < 3 && i + 1 < pattern.length() && pattern.at(i + 1) >= '0' && pattern.at(i + 1) <= '7';k++)
+					i++;
+			}
+
+			break;
+		}
+		case '[':
+
+			i = skipCharacterClass(pattern,i);
+			break;
+
+		case '(': {
+
+			int depth = 1;
+
+			for(i++;i < pattern.length();i++){
+
+				const QChar g = pattern.at(i);
+
+				if(g == '\\')
+					i++;
+				else if(g == '[')
+					i = skipCharacterClass(pattern,i);
+				else if(g == '(')
+					depth++;
+				else if(g == ')' && --depth == 0)
+					break;
+			}
+
+			break;
+		}
+		case '{':
+
+			while(i < pattern.length() && pattern.at(i) != '}')
+				i++;
+
+			break;
+
+		case '|':
+			return QString();
+
+		case '.': case '^': case '$': case '*': case '+': case '?': case ')': case ']': case '}':
+			break;
+
+		default:
+			literal = true;
+		}
+
+		if(literal)
+			suffix.append(atom);
+		else
+			suffix.clear();
+	}
+
+	return suffix;
+}
@@ -6,6 +6,9 @@
 #include "ExecProgram.hpp"
 #include "findindirs.h"
 
+#include <QCryptographicHash>
+#include <QtConcurrentMap>
+
 #include "Dialogs/UserQuick.hpp"
 
 #ifdef Q_OS_WIN32
@@ -30,6 +33,7 @@ bool BuildManager::m_replaceEnvironmentVariables = true;
 bool BuildManager::m_interpetCommandDefinitionInMagicComment = true;
 bool BuildManager::m_supportShellStyleLiteralQuotes = true;
 bool BuildManager::singleViewerInstance = false;
+bool BuildManager::skipUnchangedSteps = true;
 QString BuildManager::autoRerunCommands;
 QString BuildManager::additionalSearchPaths, BuildManager::additionalPdfPaths, BuildManager::additionalLogPaths;
 
@@ -330,10 +334,10 @@ void BuildManager::initDefaultCommandNames()
 	REQUIRE (commands.isEmpty());
 
 	//id, platform-independent command, display name, arguments
-	registerCommand("latex",       "latex",        "LaTeX",       "-src -interaction=nonstopmode %.tex", "Tools/Latex");
-	registerCommand("pdflatex",    "pdflatex",     "PdfLaTeX",    "-synctex=1 -interaction=nonstopmode %.tex", "Tools/Pdflatex");
-	registerCommand("xelatex",     "xelatex",      "XeLaTeX",     "-synctex=1 -interaction=nonstopmode %.tex", "");
-	registerCommand("lualatex",    "lualatex",     "LuaLaTeX",    "-synctex=1 -interaction=nonstopmode %.tex", "");
+	registerCommand("latex",       "latex",        "LaTeX",       "-src -interaction=nonstopmode -recorder %.tex", "Tools/Latex");
+	registerCommand("pdflatex",    "pdflatex",     "PdfLaTeX",    "-synctex=1 -interaction=nonstopmode -recorder %.tex", "Tools/Pdflatex");
+	registerCommand("xelatex",     "xelatex",      "XeLaTeX",     "-synctex=1 -interaction=nonstopmode -recorder %.tex", "");
+	registerCommand("lualatex",    "lualatex",     "LuaLaTeX",    "-synctex=1 -interaction=nonstopmode -recorder %.tex", "");
 	registerCommand("view-dvi",    "",             tr("DVI Viewer"), "%.dvi", "Tools/Dvi", &getCommandLineViewDvi);
 	registerCommand("view-ps",     "",             tr("PS Viewer"), "%.ps", "Tools/Ps", &getCommandLineViewPs);
 	registerCommand("view-pdf-external", "",        tr("External PDF Viewer"), "%.pdf", "Tools/Pdf", &getCommandLineViewPdfExternal);
@@ -1319,6 +1323,7 @@ void BuildManager::registerOptions(ConfigManagerInterface &cmi)
 	cmi.registerOption("Preview/Precompile Preamble", &previewPrecompilePreamble, true);
 
 	cmi.registerOption("Tools/Automatic Rerun Commands", &autoRerunCommands, "compile|latex|pdflatex|lualatex|xelatex");
+	cmi.registerOption("Tools/Skip Unchanged Steps", &skipUnchangedSteps, true); //hidden option
 
 	cmi.registerOption("User/ToolNames", &deprecatedUserToolNames, QStringList());
 	cmi.registerOption("User/Tools", &deprecatedUserToolCommands, QStringList());
@@ -1576,41 +1581,63 @@ bool BuildManager::runCommandInternal(const ExpandedCommands &expandedCommands,
 		bool lastCommandToRun = i == commands.size() - 1;
 		bool waitForCommand = latexCompiler || (!lastCommandToRun && !singleInstance) || cur.flags & RCF_WAITFORFINISHED;
 
-		ProcessX *p = newProcessInternal(cur.command, mainFile, singleInstance);
-		REQUIRE_RET(p, false);
-		p->subCommandName = cur.parentCommand;
-		p->subCommandPrimary = expandedCommands.primaryCommand;
-		p->subCommandFlags = cur.flags;
-        connect(p, SIGNAL(finished(int,QProcess::ExitStatus)), SLOT(emitEndRunningSubCommandFromProcessX(int)));
+		StepInputs inputs;
+		QString stepKey = mainFile.absoluteFilePath() + '\n' + cur.command;
+		bool tracked = skipUnchangedSteps && !singleInstance && collectStepInputs(cur, mainFile, inputs);
+		if (tracked && stepInputsUnchanged(stepKey, inputs)) {
+			// reported like a successful run, so that e.g. the log of a skipped compile is still loaded and checked
+			emit processNotification(tr("Process skipped, input files unchanged: %1").arg(cur.command));
+			ProcessX *p = new ProcessX(this, cur.command, mainFile.absoluteFilePath());
+			p->subCommandName = cur.parentCommand;
+			p->subCommandPrimary = expandedCommands.primaryCommand;
+			p->subCommandFlags = cur.flags;
+			emit beginRunningSubCommand(p, expandedCommands.primaryCommand, cur.parentCommand, cur.flags);
+			emit endRunningSubCommand(p, expandedCommands.primaryCommand, cur.parentCommand, cur.flags);
+			p->deleteLater();
+		} else {
+			lastStepInputs.remove(stepKey);
+
+			ProcessX *p = newProcessInternal(cur.command, mainFile, singleInstance);
+			REQUIRE_RET(p, false);
+			p->subCommandName = cur.parentCommand;
+			p->subCommandPrimary = expandedCommands.primaryCommand;
+			p->subCommandFlags = cur.flags;
+            connect(p, SIGNAL(finished(int,QProcess::ExitStatus)), SLOT(emitEndRunningSubCommandFromProcessX(int)));
 
 
-		p->setStdoutBuffer(buffer);
-        p->setStderrBuffer(errorMsg);
-		p->setStdoutCodec(codecForBuffer);
+			p->setStdoutBuffer(buffer);
+            p->setStderrBuffer(errorMsg);
+			p->setStdoutCodec(codecForBuffer);
 
-		emit beginRunningSubCommand(p, expandedCommands.primaryCommand, cur.parentCommand, cur.flags);
+			emit beginRunningSubCommand(p, expandedCommands.primaryCommand, cur.parentCommand, cur.flags);
 
-        if (!waitForCommand) connect(p, SIGNAL(finished(int,QProcess::ExitStatus)), p, SLOT(deleteLater()));
+            if (!waitForCommand) connect(p, SIGNAL(finished(int,QProcess::ExitStatus)), p, SLOT(deleteLater()));
 
-		p->startCommand();
-		if (!p->waitForStarted(1000)) return false;
+			p->startCommand();
+			if (!p->waitForStarted(1000)) return false;
 
-		if (latexCompiler || (!lastCommandToRun && !singleInstance) )
-			if (!waitForProcess(p)) {
+			if (latexCompiler || (!lastCommandToRun && !singleInstance) )
+				if (!waitForProcess(p)) {
+					p->deleteLater();
+					return false;
+				}
+
+			if (waitForCommand) { //what is this? does not really make any sense (waiting is done in the block above) and breaks multiple single-instance pdf viewer calls (30 sec delay)
+				p->waitForFinished();
+				if (tracked && p->exitStatus() == QProcess::NormalExit && p->exitCode() == 0)
+					lastStepInputs.insert(stepKey, inputs.hashes);
 				p->deleteLater();
-				return false;
 			}
-
-		if (waitForCommand) { //what is this? does not really make any sense (waiting is done in the block above) and breaks multiple single-instance pdf viewer calls (30 sec delay)
-			p->waitForFinished();
-			p->deleteLater();
 		}
 
 		bool rerunnable = (cur.flags & RCF_RERUN) && (cur.flags & RCF_RERUNNABLE);
 		if (rerunnable || latexCompiler) {
 			LatexCompileResult result = LCR_NORMAL;
 			emit latexCompiled(&result);
-			if (result == LCR_ERROR) return false;
+			if (result == LCR_ERROR) {
+				lastStepInputs.remove(stepKey);
+				return false;
+			}
 			if (result == LCR_NORMAL || !rerunnable) continue;
 			if (remainingReRunCount <= 0) continue; //do not abort since the rerun condition might have been trigged accidentally
 			if (result == LCR_RERUN_WITH_BIBLIOGRAPHY) {
@@ -1628,10 +1655,179 @@ bool BuildManager::runCommandInternal(const ExpandedCommands &expandedCommands,
 	return true;
 }
 
+static QString braceArgument(const QByteArray &line)
+{
+	int start = line.indexOf('{') + 1;
+	return QFile::decodeName(line.mid(start, line.lastIndexOf('}') - start));
+}
+
+/*!
+ * Collects the input files of a build step with their current content hashes, and the
+ * files the step is expected to leave behind. Returns false if the inputs of the step
+ * are unknown, such steps are always run.
+ * LaTeX compilers are only tracked if they are called with -recorder (the default command
+ * lines are), so that the recorder file is rewritten by every run. Only their inputs inside the
+ * directory of the main file are hashed, files outside of it (fonts, packages, ...) are compared
+ * by size and modification time.
+ * bibtex only depends on the citation related lines of the aux files. It looks for the databases
+ * in its working directory, which is the output directory if the aux files are written there.
+ */
+bool BuildManager::collectStepInputs(const CommandToRun &cmd, const QFileInfo &mainFile, StepInputs &inputs)
+{
+	const QString &id = cmd.parentCommand;
+	const QString baseName = mainFile.completeBaseName();
+	const QDir mainDir = mainFile.absoluteDir();
+	if (baseName.isEmpty() || !cmd.command.contains(baseName)) return false;
+
+	if (id == "bibtex" || id == "bibtex8") {
+		QStringList auxFiles(findCompiledFile(baseName + ".aux", mainFile));
+		QDir auxDir = QFileInfo(auxFiles.first()).absoluteDir();
+		QStringList databases, styles;
+		QCryptographicHash citations(QCryptographicHash::Md5);
+		for (int i = 0; i < auxFiles.size() && i < 1000; i++) {
+			QFile f(auxFiles[i]);
+			if (!f.open(QFile::ReadOnly)) return false;
+			while (!f.atEnd()) {
+				QByteArray line = f.readLine();
+				if (line.startsWith("\\@input{")) auxFiles << auxDir.absoluteFilePath(braceArgument(line));
+				else if (line.startsWith("\\bibdata{")) databases << braceArgument(line).split(',');
+				else if (line.startsWith("\\bibstyle{")) styles << braceArgument(line);
+				else if (!line.startsWith("\\citation{")) continue;
+				citations.addData(line);
+			}
+		}
+		inputs.hashes.insert(auxFiles.first(), citations.result());
+		foreach (QString database, databases) {
+			database = database.trimmed();
+			if (!database.endsWith(".bib")) database += ".bib";
+			QString localDatabase = auxDir.absoluteFilePath(database);
+			if (!QFileInfo::exists(localDatabase)) localDatabase = mainDir.absoluteFilePath(database);
+			if (!QFileInfo::exists(localDatabase)) return false; // found by kpathsea, cannot be tracked
+			inputs.hashedFiles << localDatabase;
+		}
+		foreach (const QString &style, styles) {
+			QString localStyle = auxDir.absoluteFilePath(style.trimmed() + ".bst");
+			if (!QFileInfo::exists(localStyle)) localStyle = mainDir.absoluteFilePath(style.trimmed() + ".bst");
+			if (QFileInfo::exists(localStyle)) inputs.hashedFiles << localStyle;
+		}
+		inputs.outputs << findCompiledFile(baseName + ".bbl", mainFile);
+	} else if (id == "biber") {
+		QString bcf = findCompiledFile(baseName + ".bcf", mainFile);
+		QFile f(bcf);
+		if (!f.open(QFile::ReadOnly)) return false;
+		QByteArray content = f.readAll();
+		inputs.hashes.insert(bcf, QCryptographicHash::hash(content, QCryptographicHash::Md5));
+		static const QRegularExpression datasource("<bcf:datasource[^>]*>([^<]+)</bcf:datasource>");
+		QRegularExpressionMatchIterator it = datasource.globalMatch(QString::fromUtf8(content));
+		while (it.hasNext()) {
+			QString database = mainDir.absoluteFilePath(it.next().captured(1).trimmed());
+			if (!QFileInfo::exists(database)) return false; // remote or found by kpathsea
+			inputs.hashedFiles << database;
+		}
+		inputs.outputs << findCompiledFile(baseName + ".bbl", mainFile);
+	} else if (id == "makeindex" || id == "texindy") {
+		if (!cmd.command.contains(baseName + ".idx")) return false;
+		QString idx = findCompiledFile(baseName + ".idx", mainFile);
+		if (!QFileInfo::exists(idx)) return false;
+		inputs.hashedFiles << idx;
+		static const QRegularExpression styleFile("[^\\s\"]+\\.(?:ist|xdy)");
+		QRegularExpressionMatchIterator it = styleFile.globalMatch(cmd.command);
+		while (it.hasNext()) {
+			QString style = mainDir.absoluteFilePath(it.next().captured());
+			if (QFileInfo::exists(style)) inputs.hashedFiles << style;
+		}
+		inputs.outputs << findCompiledFile(baseName + ".ind", mainFile);
+	} else if ((cmd.flags & RCF_COMPILES_TEX) && (id == "latex" || id == "pdflatex" || id == "xelatex" || id == "lualatex")) {
+		if (!cmd.command.contains("-recorder")) return false;
+		QFile f(findCompiledFile(baseName + ".fls", mainFile));
+		if (!f.open(QFile::ReadOnly)) return false;
+		const QString projectDir = QDir::cleanPath(mainDir.absolutePath()) + '/';
+		QDir pwd = mainDir;
+		while (!f.atEnd()) {
+			QString line = QFile::decodeName(f.readLine());
+			while (line.endsWith('\n') || line.endsWith('\r')) line.chop(1);
+			if (line.startsWith("PWD ")) pwd = QDir(line.mid(4));
+			else if (line.startsWith("INPUT ")) {
+				QString input = QDir::cleanPath(pwd.absoluteFilePath(line.mid(6)));
+				if (inputs.hashes.contains(input) || inputs.hashedFiles.contains(input)) continue;
+				if (input.startsWith(projectDir)) inputs.hashedFiles << input;
+				else {
+					QFileInfo info(input);
+					inputs.hashes.insert(input, info.exists() ? (QByteArray::number(info.size()) + ' ' + QByteArray::number(info.lastModified().toMSecsSinceEpoch())) : QByteArray());
+				}
+			} else if (line.startsWith("OUTPUT ")) inputs.outputs << pwd.absoluteFilePath(line.mid(7));
+		}
+		if (inputs.hashes.isEmpty() && inputs.hashedFiles.isEmpty()) return false;
+	} else return false;
+	hashStepInputs(inputs);
+	return true;
+}
+
+bool BuildManager::stepInputsUnchanged(const QString &stepKey, const StepInputs &inputs) const
+{
+	QHash<QString, QHash<QString, QByteArray> >::const_iterator it = lastStepInputs.constFind(stepKey);
+	if (it == lastStepInputs.constEnd() || it.value() != inputs.hashes) return false;
+	foreach (const QString &output, inputs.outputs)
+		if (!QFileInfo::exists(output)) return false;
+	return true;
+}
+
+static QByteArray md5OfFile(const QString &fileName)
+{
+	QFile f(fileName);
+	if (!f.open(QFile::ReadOnly)) return QByteArray();
+	QCryptographicHash hash(QCryptographicHash::Md5);
+	hash.addData(&f);
+	return hash.result();
+}
+
+/*!
+ * Adds the content hashes of inputs.hashedFiles to inputs.hashes. Files which were not modified
+ * since they were hashed last are taken from the cache. The others are hashed on worker threads,
+ * the event loop keeps running meanwhile like in waitForProcess().
+ */
+void BuildManager::hashStepInputs(StepInputs &inputs)
+{
+	QStringList pending;
+	QList<QFileInfo> pendingInfos;
+	foreach (const QString &fileName, inputs.hashedFiles) {
+		QFileInfo info(fileName);
+		QHash<QString, FileHash>::const_iterator cached = fileHashes.constFind(fileName);
+		if (!info.exists())
+			inputs.hashes.insert(fileName, QByteArray());
+		else if (cached != fileHashes.constEnd() && cached.value().modified == info.lastModified() && cached.value().size == info.size())
+			inputs.hashes.insert(fileName, cached.value().hash);
+		else {
+			pending << fileName;
+			pendingInfos << info;
+		}
+	}
+	if (pending.isEmpty()) return;
+
+	QFutureWatcher<QByteArray> watcher;
+	QEventLoop loop;
+	connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+	watcher.setFuture(QtConcurrent::mapped(pending, md5OfFile));
+	if (!watcher.isFinished()) loop.exec();
+
+	for (int i = 0; i < pending.size(); i++) {
+		QByteArray hash = watcher.future().resultAt(i);
+		inputs.hashes.insert(pending[i], hash);
+		if (hash.isEmpty()) continue;
+		FileHash entry;
+		entry.modified = pendingInfos[i].lastModified();
+		entry.size = pendingInfos[i].size();
+		entry.hash = hash;
+		fileHashes.insert(pending[i], entry);
+	}
+}
+
 void BuildManager::emitEndRunningSubCommandFromProcessX(int)
 {
 	ProcessX *p = qobject_cast<ProcessX *>(sender());
+	if (!p) FindInDirs::clearCache();
 	REQUIRE(p); //p can be NULL (although sender() is not null) ! If multiple single instance viewers are in a command. Why? should not happen
+	clearCompiledFileDirs(QFileInfo(p->getFile())); //the command may have created or removed compiled files
 	emit endRunningSubCommand(p, p->subCommandPrimary, p->subCommandName, p->subCommandFlags);
 }
 
@@ -2161,6 +2357,25 @@ bool BuildManager::testAndRunInternalCommand(const QString &cmd, const QFileInfo
 	return false;
 }
 
+/*!
+ * \brief drop the cached listings of the directories where commands on mainFile write their output
+ * These are the directory of mainFile and the additional search, log and pdf paths.
+ */
+void BuildManager::clearCompiledFileDirs(const QFileInfo &mainFile)
+{
+	if (mainFile.fileName().isEmpty()) {
+		FindInDirs::clearCache();
+		return;
+	}
+	QString mainDir(mainFile.absolutePath());
+	FindInDirs findInDirs(true, false, mainDir);
+	findInDirs.loadDirs(mainDir);
+	findInDirs.loadDirs(resolvePaths(additionalSearchPaths));
+	findInDirs.loadDirs(resolvePaths(additionalLogPaths));
+	findInDirs.loadDirs(resolvePaths(additionalPdfPaths));
+	findInDirs.clearCachedDirs();
+}
+
 QString BuildManager::findCompiledFile(const QString &compiledFilename, const QFileInfo &mainFile)
 {
 	QString mainDir(mainFile.absolutePath());
@@ -287,6 +287,7 @@ class BuildManager : public QObject {
 		Q_INVOKABLE QString getCommandLine(const QString &id, bool *user);
 
 		friend class ProcessX;
+		friend class BuildManagerTest;
 
 		CommandMapping commands;
 		QStringList internalCommands, commandSortingsOrder;
@@ -295,6 +296,23 @@ class BuildManager : public QObject {
 
 		QStringList latexCommands, rerunnableCommands, pdfCommands, stdoutCommands, viewerCommands;
 
+		struct StepInputs {
+			QHash<QString, QByteArray> hashes; // input file -> content hash
+			QStringList hashedFiles; // inputs whose content hash is added by hashStepInputs()
+			QStringList outputs; // files the step leaves behind, must exist to skip it
+		};
+		struct FileHash {
+			QDateTime modified;
+			qint64 size;
+			QByteArray hash;
+		};
+		QHash<QString, QHash<QString, QByteArray> > lastStepInputs; // main file + command line -> input hashes at the start of its last successful run
+		QHash<QString, FileHash> fileHashes; // avoids rehashing files which were not modified
+
+		bool collectStepInputs(const CommandToRun &cmd, const QFileInfo &mainFile, StepInputs &inputs);
+		bool stepInputsUnchanged(const QString &stepKey, const StepInputs &inputs) const;
+		void hashStepInputs(StepInputs &inputs);
+
 	public:
 
 		static int autoRerunLatex;
@@ -303,11 +321,13 @@ class BuildManager : public QObject {
 		static bool m_interpetCommandDefinitionInMagicComment;
 		static bool m_supportShellStyleLiteralQuotes;
 		static bool singleViewerInstance;
+		static bool skipUnchangedSteps;
 
 		static QString autoRerunCommands;
 		static QString additionalSearchPaths, additionalLogPaths, additionalPdfPaths;
 
 		static QString findCompiledFile(const QString &compiledFilename, const QFileInfo &mainFile);
+		static void clearCompiledFileDirs(const QFileInfo &mainFile);
 
 		void addPreviewFileName(QString fn){
 			if (!previewFileNames.contains(fn))
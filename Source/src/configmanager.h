@@ -207,6 +207,7 @@ class ConfigManager: public QObject, public ConfigManagerInterface {
 
 		//autosave
 		int autosaveEveryMinutes;
+		bool recoveryJournal;
 
 		bool addRecentFile(const QString &fileName, bool asMaster);  //adds a recent file
 		void updateRecentFiles(bool alwaysRecreateMenuItems = false);
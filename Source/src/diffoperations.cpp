@@ -4,36 +4,231 @@
 #include "Latex/Document.hpp"
 #include "Latex/EditorView.hpp"
 
+#include <QtConcurrentMap>
+
 
 DiffOp::DiffOp(): start(0), length(0), type(Insert), lineWasModified(false), dlh(nullptr) {}
 
-void diffDocs(LatexDocument *doc, LatexDocument *doc2, bool dontAddLines)
-{
-	QString text = doc->text();
-	QString text2 = doc2->text();
-	diff_match_patch dmp;
+namespace {
+
+// edit distances (in lines) beyond this are not worth the memory of the Myers trace, the
+// remaining range is then diffed as one block
+const int MaxLineEditDistance = 4000;
+
+struct DiffHunk {
+	QString text1, text2;
+	QList<Diff> diffs;
 	QString error;
-	QList<Diff> diffList;
+};
+
+QStringList splitKeepingNewlines(const QString &text)
+{
+	QStringList lines;
+	int start = 0;
+	while (start < text.length()) {
+		int end = text.indexOf('\n', start);
+		end = (end < 0) ? text.length() : end + 1;
+		lines << text.mid(start, end - start);
+		start = end;
+	}
+	return lines;
+}
+
+QString diffTexts(diff_match_patch &dmp, const QString &text1, const QString &text2, QList<Diff> &diffs)
+{
 	try {
-		diffList = dmp.diff_main(text, text2, true);
-		dmp.diff_cleanupSemantic(diffList);
+		diffs = dmp.diff_main(text1, text2, true);
+		dmp.diff_cleanupSemantic(diffs);
 	} catch (const char *c) {
-		if (c) error = QString(c);
+		if (c) return QString(c);
 #ifndef _MSC_VER
 	} catch (char *c) {
-		if (c) error = QString(c);
+		if (c) return QString(c);
 #endif
 	} catch (const QString &s) {
-		error = s;
+		return s;
 	} catch (...) {
-		error = LatexDocument::tr("Unknown error. Potential crash. You are advised to restart TeXstudio");
+		return LatexDocument::tr("Unknown error. Potential crash. You are advised to restart TeXstudio");
+	}
+	return QString();
+}
+
+void diffHunk(DiffHunk &hunk)
+{
+	diff_match_patch dmp;
+	// dmp's deadline is measured with clock(), i.e. in process cpu time on most platforms, which
+	// runs faster while several hunks are diffed concurrently
+	dmp.Diff_Timeout *= qMax(1, QThread::idealThreadCount());
+	hunk.error = diffTexts(dmp, hunk.text1, hunk.text2, hunk.diffs);
+}
+
+/*!
+ * Myers' O(ND) diff of the line ids a[from1..to1) and b[from2..to2).
+ * Lines which are part of the longest common subsequence are marked in common1/common2.
+ * Returns false if the edit distance exceeds MaxLineEditDistance.
+ */
+bool diffLines(const QVector<int> &a, int from1, int to1, const QVector<int> &b, int from2, int to2, QVector<bool> &common1, QVector<bool> &common2)
+{
+	const int n = to1 - from1, m = to2 - from2;
+	const int maxD = qMin(n + m, MaxLineEditDistance);
+	const int offset = maxD + 1;
+	QVector<int> v(2 * offset + 1, 0);
+	QList<QVector<int> > trace; // trace[d] = v[-d-1..d+1] before step d
+	bool found = false;
+	for (int d = 0; d <= maxD && !found; d++) {
+		trace << v.mid(offset - d - 1, 2 * d + 3);
+		for (int k = -d; k <= d; k += 2) {
+			int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) ? v[offset + k + 1] : v[offset + k - 1] + 1;
+			int y = x - k;
+			while (x < n && y < m && a[from1 + x] == b[from2 + y]) {
+				x++;
+				y++;
+			}
+			v[offset + k] = x;
+			if (x >= n && y >= m) {
+				found = true;
+				break;
+			}
+		}
+	}
+	if (!found)
+		return false;
+
+	int x = n, y = m;
+	for (int d = trace.size() - 1; d >= 0; d--) {
+		const QVector<int> &vd = trace.at(d);
+		const int vo = d + 1;
+		int k = x - y;
+		int prevK = (k == -d || (k != d && vd[vo + k - 1] < vd[vo + k + 1])) ? k + 1 : k - 1;
+		int prevX = vd[vo + prevK];
+		int prevY = prevX - prevK;
+		while (x > prevX && y > prevY) {
+			x--;
+			y--;
+			common1[from1 + x] = true;
+			common2[from2 + y] = true;
+		}
+		x = prevX;
+		y = prevY;
 	}
+	return true;
+}
+
+void appendDiff(QList<Diff> &diffs, Operation op, const QString &text)
+{
+	if (text.isEmpty())
+		return;
+	if (!diffs.isEmpty() && diffs.last().operation == op)
+		diffs.last().text += text;
+	else
+		diffs << Diff(op, text);
+}
+
+/*!
+ * Character level diff of text1 and text2 like dmp.diff_main + diff_cleanupSemantic.
+ * To keep large documents fast, the lines are compared first (by interned ids) and dmp
+ * only runs on the changed hunks, which are processed in parallel.
+ */
+QList<Diff> diffByLines(const QString &text1, const QString &text2, QString &error)
+{
+	const QStringList lines1 = splitKeepingNewlines(text1);
+	const QStringList lines2 = splitKeepingNewlines(text2);
+
+	QHash<QString, int> lineIds;
+	auto lineId = [&lineIds](const QString &line) {
+		QHash<QString, int>::const_iterator it = lineIds.constFind(line);
+		if (it != lineIds.constEnd())
+			return it.value();
+		int id = lineIds.size();
+		lineIds.insert(line, id);
+		return id;
+	};
+	QVector<int> ids1, ids2;
+	ids1.reserve(lines1.size());
+	ids2.reserve(lines2.size());
+	foreach (const QString &line, lines1)
+		ids1 << lineId(line);
+	foreach (const QString &line, lines2)
+		ids2 << lineId(line);
+
+	int prefix = 0;
+	while (prefix < ids1.size() && prefix < ids2.size() && ids1[prefix] == ids2[prefix])
+		prefix++;
+	int end1 = ids1.size(), end2 = ids2.size();
+	while (end1 > prefix && end2 > prefix && ids1[end1 - 1] == ids2[end2 - 1]) {
+		end1--;
+		end2--;
+	}
+
+	QVector<bool> common1(ids1.size(), false), common2(ids2.size(), false);
+	for (int i = 0; i < prefix; i++)
+		common1[i] = common2[i] = true;
+	for (int i = end1, j = end2; i < ids1.size(); i++, j++)
+		common1[i] = common2[j] = true;
+	diffLines(ids1, prefix, end1, ids2, prefix, end2, common1, common2);
+
+	// split into runs of equal lines and changed hunks
+	QList<DiffHunk> hunks;
+	QList<QString> equalBefore; // equalBefore[h] precedes hunks[h], the last entry follows all hunks
+	QString equal;
+	int i = 0, j = 0;
+	while (i < lines1.size() || j < lines2.size()) {
+		if (i < lines1.size() && j < lines2.size() && common1[i] && common2[j]) {
+			equal += lines1.at(i);
+			i++;
+			j++;
+			continue;
+		}
+		DiffHunk hunk;
+		while (i < lines1.size() && !common1[i])
+			hunk.text1 += lines1.at(i++);
+		while (j < lines2.size() && !common2[j])
+			hunk.text2 += lines2.at(j++);
+		equalBefore << equal;
+		equal.clear();
+		hunks << hunk;
+	}
+	equalBefore << equal;
+
+	QtConcurrent::blockingMap(hunks, diffHunk);
+
+	QList<Diff> diffs;
+	for (int h = 0; h < hunks.size(); h++) {
+		if (!hunks.at(h).error.isEmpty()) {
+			error = hunks.at(h).error;
+			return QList<Diff>();
+		}
+		appendDiff(diffs, EQUAL, equalBefore.at(h));
+		foreach (const Diff &d, hunks.at(h).diffs)
+			appendDiff(diffs, d.operation, d.text);
+	}
+	appendDiff(diffs, EQUAL, equalBefore.last());
+	// equalities between hunks may be too short to keep, as when the whole texts are diffed
+	diff_match_patch().diff_cleanupSemantic(diffs);
+	return diffs;
+}
+
+}
+
+void diffDocs(LatexDocument *doc, LatexDocument *doc2, bool dontAddLines)
+{
+	QString error;
+	QList<Diff> diffList = diffByLines(doc->text(), doc2->text(), error);
 
 	if (!error.isEmpty()) {
 		UtilsUi::txsWarning("Diff: " + error);
 		return;
 	}
 
+	diffAddMarkers(doc, doc2, diffList, dontAddLines);
+}
+
+/*!
+ * Store the differences of doc to doc2 as DiffOp lists in the line cookies of doc.
+ * Text which only doc2 has is inserted into doc, unless dontAddLines is set and it starts new lines.
+ */
+void diffAddMarkers(LatexDocument *doc, LatexDocument *doc2, const QList<Diff> &diffList, bool dontAddLines)
+{
 	int lineNr = 0;
 	int lineNr2 = 0;
 	int col = 0;
@@ -47,6 +47,7 @@ void diffChangeOpType(QDocumentCursor range,DiffOp::DiffType);
 void diffChange(LatexDocument *,int ln,int col,bool theirs);
 void diffMerge(LatexDocument *);
 void diffDocs(LatexDocument *,LatexDocument *,bool dontAddLines = false);
+void diffAddMarkers(LatexDocument *,LatexDocument *,const QList<Diff> &,bool dontAddLines = false);
 
 QDocumentCursor diffSearchBoundaries(LatexDocument *,int ln,int col,int fid,int direction = 0);
 QString diffCollectText(QDocumentCursor range);
@@ -9,6 +9,7 @@
  * \brief   Search for a given filename in a specified list of directories
  * \details This class implements search for a given filename in a list of directories.
  * It also supports optional search modifiers for the search criteria.
+ * Directory listings are cached and shared between search objects, see clearCache() and clearCachedDirs().
  * TODO: Merge other file search functions (e.g. findResourceFile) into this class.
 */
 
@@ -23,6 +24,10 @@ class FindInDirs {
 
 		QString findAbsolute(const QString & pathname) const;
 
+		void clearCachedDirs() const;
+
+		static void clearCache();
+
 	private:
 
 		bool findCheckFile(const QFileInfo & fileInfo) const;
@@ -6,6 +6,8 @@
 #include "latexparser/latexparser.h"
 #include "configmanagerinterface.h"
 
+#include <QCache>
+
 
 //TODO: move this away
 #include "GrammarCheckConfig.hpp"
@@ -71,10 +73,86 @@ Q_DECLARE_METATYPE(QList<LineInfo>)
 Q_DECLARE_METATYPE(QList<GrammarError>)
 
 
-struct LanguageGrammarData {
+/*!
+ * The checks which do not need the backend: word repetitions and bad words.
+ * Words are compared by ids of their lower case form. The stop and bad words of
+ * the language get their ids once, other words per checked block. Checking is
+ * thread safe, so independent blocks can be checked in parallel.
+ */
+class GrammarCheckLocal {
+
+	public:
+
+		struct Options {
+
+			bool repetition;
+			bool adjacentRepetition; // of stop words, the backend usually reports these itself
+			bool badWords;
+
+			int maxRepetitionDelta;
+			int maxRepetitionLongRangeDelta;
+			int maxRepetitionLongRangeMinWordLength;
+
+		};
+
+		struct Error {
+
+			int word; // index in the words of the block
+			GrammarErrorType type;
+			int distance; // in words, 0 for adjacent words
+			int removedChars; // at the end of the word
+
+		};
+
+		void setWordLists(const QSet<QString> & stopWords,const QSet<QString> & badWords);
+
+		QList<Error> check(const QStringList & words,const Options & options) const;
+
+	private:
+
+		enum WordFlag { StopWord = 1 , BadWord = 2 };
+
+		int flagsOf(int id) const;
+
+		QHash<QString,int> ids;
+		QVector<int> flags;
+
+};
+
+
+/*!
+ * Results of the grammar backend per sentence, keyed by language, enabled rules and
+ * sentence text. Shared by all documents and kept between sessions, so unchanged
+ * sentences are never sent again.
+ */
+class GrammarCheckCache {
+
+	public:
+
+		struct Sentence {
+
+			int offset;
+			int length;
+
+		};
+
+		explicit GrammarCheckCache(int maxSentences = 50000);
 
-	QSet<QString> stopWords;
-	QSet<QString> badWords;
+		static QList<Sentence> splitSentences(const QString & text);
+
+		bool lookup(const QString & language,const QString & rules,const QString & sentence,QList<GrammarError> & errors);
+		void insert(const QString & language,const QString & rules,const QString & sentence,const QList<GrammarError> & errors);
+		void clear();
+
+		bool load(const QString & fileName);
+		bool save(const QString & fileName);
+
+	private:
+
+		static QByteArray key(const QString & language,const QString & rules,const QString & sentence);
+
+		QCache<QByteArray,QList<GrammarError> > entries;
+		bool modified;
 
 };
 
@@ -103,6 +181,7 @@ class GrammarCheck : public QObject {
 
 		QString getLastErrorMessage();
 		QString serverUrl();
+		Q_INVOKABLE QString statistics();
 
 	signals:
 
@@ -114,12 +193,13 @@ class GrammarCheck : public QObject {
 
 		void check(const QString & language,LatexDocument *,const QList<LineInfo> & lines,int firstLineNr);
 		void init(const LatexParser &,const GrammarCheckerConfig &);
+		void setCursorLine(LatexDocument *,int lineNr);
 
 		void shutdown();
 
 	private slots:
 
-		void backendChecked(uint ticket,int subticket,const QList<GrammarError> & errors,bool directCall = false);
+		void backendChecked(uint ticket,int subticket,const QList<GrammarError> & errors);
 		void process(int reqId);
 
 		void updateLTStatus();
@@ -129,15 +209,20 @@ class GrammarCheck : public QObject {
 
 		QString languageFromHunspellToLanguageTool(QString language);
 		QString languageFromLanguageToolToHunspell(QString language);
+		const GrammarCheckLocal & localChecker(const QString & language);
+		void checkLocally(CheckRequest & request,bool adjacentRepetition);
 
 		LTStatus ltstatus;
 		LatexParser * latexParser;
 		GrammarCheckerConfig config;
 		GrammarCheckBackend * backend;
-		QMap<QString, LanguageGrammarData> languages;
+		QMap<QString, GrammarCheckLocal> languages;
 
 		uint ticket;
 
+		LatexDocument * cursorDoc;
+		int cursorLine;
+
 		bool pendingProcessing;
 		bool shuttingDown;
 
@@ -160,7 +245,8 @@ class GrammarCheckBackend : public QObject {
 
 		GrammarCheckBackend(QObject * parent);
 
-		virtual void check(uint ticket,uint subticket,const QString & language,const QString & text) = 0;
+		virtual void check(uint ticket,uint subticket,const QString & language,const QString & text,int priority) = 0;
+		virtual void cancel(uint ticket) = 0;
 		virtual void init(const GrammarCheckerConfig &) = 0;
 
 		virtual bool isAvailable() = 0;
@@ -169,6 +255,7 @@ class GrammarCheckBackend : public QObject {
 
 		virtual QString getLastErrorMessage() = 0;
 		virtual QString url() = 0;
+		virtual QString statistics() = 0;
 
 	signals:
 
@@ -193,11 +280,13 @@ class GrammarCheckLanguageToolJSON: public GrammarCheckBackend {
         GrammarCheckLanguageToolJSON(QObject *parent = nullptr);
         ~GrammarCheckLanguageToolJSON();
 
-        virtual void check(uint ticket,uint subticket,const QString & language,const QString & text);
+        virtual void check(uint ticket,uint subticket,const QString & language,const QString & text,int priority);
+        virtual void cancel(uint ticket);
         virtual void init(const GrammarCheckerConfig &);
 
         virtual QString getLastErrorMessage();
         virtual QString url();
+        virtual QString statistics();
 
         virtual bool isAvailable();
         virtual bool isWorking();
@@ -206,6 +295,7 @@ class GrammarCheckLanguageToolJSON: public GrammarCheckBackend {
     private slots:
 
         void finished(QNetworkReply * reply);
+        void dispatch();
 
     private:
 
@@ -217,7 +307,7 @@ class GrammarCheckLanguageToolJSON: public GrammarCheckBackend {
         Availability connectionAvailability;
 
         bool triedToStart;
-        bool firstRequest;
+        bool dispatchPending;
 
         QPointer<QProcess> javaProcess;
 
@@ -227,12 +317,29 @@ class GrammarCheckLanguageToolJSON: public GrammarCheckBackend {
         uint startTime;
 
         void tryToStart();
-
-        QList<CheckRequestBackend> delayedRequests;
+        void scheduleDispatch();
+        void send(const QList<CheckRequestBackend> & batch);
+        void answerEmpty(const QList<CheckRequestBackend> & requests);
+
+        // blocks waiting to be sent, ordered by priority when dispatched
+        QList<CheckRequestBackend> queue;
+        QHash<QNetworkReply *,QList<CheckRequestBackend>> inFlight;
+        quint64 sequence;
+
+        // counters for statistics()
+        int requestsSent;
+        int blocksSent;
+        int blocksCancelled;
+        int blocksAnswered;
+        qint64 totalLatency;
 
         QSet<QString> languagesCodesFail;
         QString errorText; // last error message
 
+        GrammarCheckCache cache;
+        QString cacheFileName;
+        QString rulesSignature; // server and rule configuration the cached results depend on
+
 };
 
 
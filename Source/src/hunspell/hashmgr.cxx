@@ -74,6 +74,21 @@
 #include <ctype.h>
 #include <limits>
 #include <sstream>
+#include <algorithm>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unordered_map>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "hashmgr.hxx"
 #include "csutil.hxx"
@@ -82,7 +97,7 @@
 
 // build a hash table from a munched word list
 
-HashMgr::HashMgr(const char* tpath, const char* apath, const char* key)
+HashMgr::HashMgr(const char* tpath, const char* apath, const char* key, const char* imagepath)
     : tablesize(0),
       tableptr(NULL),
       flag_mode(FLAG_CHAR),
@@ -94,11 +109,20 @@ HashMgr::HashMgr(const char* tpath, const char* apath, const char* key)
       aliasf(NULL),
       aliasflen(0),
       numaliasm(0),
-      aliasm(NULL) {
+      aliasm(NULL),
+      image(NULL),
+      image_size(0) {
   langnum = 0;
   csconv = 0;
   load_config(apath, key);
+  // encrypted dictionaries are never written to an image
+  bool use_image = imagepath && *imagepath && !key;
+  if (use_image && map_image(imagepath, tpath, apath))
+    return;
+  size_t reptable_start = reptable.size();
   int ec = load_tables(tpath, key);
+  if (!ec && use_image)
+    write_image(imagepath, tpath, apath, reptable_start);
   if (ec) {
     /* error condition - what should we do here */
     HUNSPELL_WARNING(stderr, "Hash Manager Error : %d\n", ec);
@@ -121,16 +145,19 @@ HashMgr::~HashMgr() {
       struct hentry* nt = NULL;
       while (pt) {
         nt = pt->next;
-        if (pt->astr &&
+        if (pt->astr && !is_mapped(pt->astr) &&
             (!aliasf || TESTAFF(pt->astr, ONLYUPCASEFLAG, pt->alen)))
           free(pt->astr);
-        free(pt);
+        if (!is_mapped(pt))
+          free(pt);
         pt = nt;
       }
     }
-    free(tableptr);
+    if (!is_mapped(tableptr))
+      free(tableptr);
   }
   tablesize = 0;
+  unmap_image();
 
   if (aliasf) {
     for (int j = 0; j < (numaliasf); j++)
@@ -371,7 +398,8 @@ int HashMgr::add_word(const std::string& in_word,
       // remove hidden onlyupcase homonym
       if (!onlyupcase) {
         if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-          free(dp->astr);
+          if (!is_mapped(dp->astr))
+            free(dp->astr);
           dp->astr = hp->astr;
           dp->alen = hp->alen;
           free(hp);
@@ -391,7 +419,8 @@ int HashMgr::add_word(const std::string& in_word,
     // remove hidden onlyupcase homonym
     if (!onlyupcase) {
       if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-        free(dp->astr);
+        if (!is_mapped(dp->astr))
+          free(dp->astr);
         dp->astr = hp->astr;
         dp->alen = hp->alen;
         free(hp);
@@ -490,7 +519,8 @@ int HashMgr::remove(const std::string& word) {
       for (int i = 0; i < dp->alen; i++)
         flags[i] = dp->astr[i];
       flags[dp->alen] = forbiddenword;
-      free(dp->astr);
+      if (!is_mapped(dp->astr))
+        free(dp->astr);
       dp->astr = flags;
       dp->alen++;
       std::sort(flags, flags + dp->alen);
@@ -701,6 +731,418 @@ int HashMgr::load_tables(const char* tpath, const char* key) {
   return 0;
 }
 
+// Dictionary images
+//
+// Parsing a large .dic file takes a noticeable time at every start. After the
+// first parse, the hash table is written to an image file: the table, the
+// entries with their flag vectors and morphological aliases, and the REP
+// entries created from ph: fields. The pointers in the image are written for a
+// preferred base address, so if the image can be mapped there, it is used as
+// is and its pages are shared by all processes using the dictionary. Otherwise
+// the pointers are relocated, which only touches the table and the entries.
+// The image is mapped copy-on-write, so words added at runtime can still be
+// linked into the chains. It is invalidated by the mtime (in milliseconds) and
+// size of the .dic and .aff files; the affix tables are always parsed from the
+// .aff file. An image is only used after every pointer and length in it has
+// been checked to stay inside the file, otherwise the .dic file is parsed and
+// the image is written again.
+
+namespace {
+
+const char image_magic[8] = {'H', 'U', 'N', 'I', 'M', 'G', '0', '2'};
+
+struct image_header {
+  char magic[8];
+  uint32_t hentry_size;
+  uint32_t pointer_size;
+  int32_t tablesize;
+  uint32_t rep_count;
+  uint64_t base;
+  uint64_t size;
+  int64_t dic_mtime;
+  int64_t dic_size;
+  int64_t aff_mtime;
+  int64_t aff_size;
+  uint64_t table_offset;
+  uint64_t rep_offset;
+};
+
+// mtime in milliseconds, a dictionary saved twice within a second still invalidates the image
+bool file_stamp(const char* path, int64_t& mtime, int64_t& size) {
+#ifdef _WIN32
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+    return false;
+  // FILETIME counts 100 ns intervals
+  uint64_t t = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+  mtime = (int64_t)(t / 10000);
+  size = (int64_t)(((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow);
+#else
+  struct stat st;
+  if (stat(path, &st) != 0)
+    return false;
+#ifdef __APPLE__
+  mtime = (int64_t)st.st_mtimespec.tv_sec * 1000 + st.st_mtimespec.tv_nsec / 1000000;
+#else
+  mtime = (int64_t)st.st_mtim.tv_sec * 1000 + st.st_mtim.tv_nsec / 1000000;
+#endif
+  size = st.st_size;
+#endif
+  return true;
+}
+
+// a slot of 256 MB per dictionary path in an address range which is usually free
+uint64_t preferred_base(const char* tpath) {
+  if (sizeof(void*) < 8)
+    return 0;
+  uint64_t h = 5381;
+  for (const char* c = tpath; *c; ++c)
+    h = h * 33 + (unsigned char)*c;
+  return 0x3f0000000000ULL + (h % 1024) * 0x10000000ULL;
+}
+
+size_t align_up(size_t size) {
+  const size_t a = sizeof(void*);
+  return (size + a - 1) & ~(a - 1);
+}
+
+// same size as allocated in add_word
+size_t entry_size(const struct hentry* hp) {
+  size_t descl = 0;
+  if (hp->var & H_OPT)
+    descl = (hp->var & H_OPT_ALIASM) ? sizeof(char*) : strlen(HENTRY_WORD(hp) + hp->blen + 1) + 1;
+  return sizeof(struct hentry) + hp->blen + descl;
+}
+
+void append_string(std::string& out, const std::string& s) {
+  uint32_t len = (uint32_t)s.size();
+  out.append((const char*)&len, sizeof(len));
+  out.append(s);
+}
+
+bool read_string(const char*& p, const char* end, std::string& s) {
+  uint32_t len;
+  if (end - p < (ptrdiff_t)sizeof(len))
+    return false;
+  memcpy(&len, p, sizeof(len));
+  p += sizeof(len);
+  if (end - p < (ptrdiff_t)len)
+    return false;
+  s.assign(p, len);
+  p += len;
+  return true;
+}
+
+// offset of a pointer written for header.base, if [ptr, ptr + length) lies inside the image
+bool image_offset(const image_header& header, const void* ptr, uint64_t length, uint64_t& offset) {
+  offset = (uint64_t)(uintptr_t)ptr - header.base;
+  return offset <= header.size && length <= header.size - offset;
+}
+
+// Checks a mapped image before anything in it is used or relocated: every
+// table slot, chain and homonym pointer has to point to a complete entry,
+// entries must not overlap each other or the table (this also rejects cycles),
+// and flag vectors and morphological aliases have to be inside the image and
+// outside of the entries, so that relocating cannot change them.
+bool valid_image(const char* p, const image_header& header) {
+  const uint64_t size = header.size;
+  const uint64_t a = sizeof(void*);
+  if (size < sizeof(header) || header.table_offset < sizeof(header) || header.table_offset % a != 0 ||
+      header.table_offset > size ||
+      (uint64_t)header.tablesize > (size - header.table_offset) / sizeof(struct hentry*) ||
+      header.rep_offset > size)
+    return false;
+  const uint64_t table_end = header.table_offset + (uint64_t)header.tablesize * sizeof(struct hentry*);
+
+  // one flag per pointer sized word, set for the words covered by entries
+  std::vector<bool> used(size / a + 1, false);
+  std::vector<uint64_t> entries, homonyms;
+  std::vector<std::pair<uint64_t, uint64_t> > data;  // offset, length
+  const struct hentry* const* table = (const struct hentry* const*)(p + header.table_offset);
+  for (int i = 0; i < header.tablesize; i++) {
+    for (const struct hentry* next = table[i]; next;) {
+      uint64_t off;
+      if (!image_offset(header, next, sizeof(struct hentry), off) || off % a != 0 || off < table_end)
+        return false;
+      const struct hentry* hp = (const struct hentry*)(p + off);
+      const char* word = HENTRY_WORD(hp);
+      if (sizeof(struct hentry) + hp->blen > size - off || word[hp->blen] != '\0')
+        return false;
+      uint64_t span = sizeof(struct hentry) + hp->blen;
+      if (hp->var & H_OPT) {
+        const char* desc = word + hp->blen + 1;
+        const uint64_t left = size - (desc - p);
+        if (hp->var & H_OPT_ALIASM) {
+          uint64_t doff;
+          if (left < sizeof(char*) || !image_offset(header, get_stored_pointer(desc), 1, doff))
+            return false;
+          const char* nul = (const char*)memchr(p + doff, '\0', size - doff);
+          if (!nul)
+            return false;
+          data.push_back(std::make_pair(doff, (uint64_t)(nul - (p + doff)) + 1));
+          span += sizeof(char*);
+        } else {
+          const char* nul = (const char*)memchr(desc, '\0', left);
+          if (!nul)
+            return false;
+          span += nul - desc + 1;
+        }
+      }
+      for (uint64_t w = off / a; w < (off + span + a - 1) / a; ++w) {
+        if (used[w])
+          return false;
+        used[w] = true;
+      }
+      entries.push_back(off);
+      if (hp->astr) {
+        uint64_t aoff;
+        if (hp->alen < 0 || !image_offset(header, hp->astr, (uint64_t)hp->alen * sizeof(unsigned short), aoff) ||
+            aoff % sizeof(unsigned short) != 0)
+          return false;
+        data.push_back(std::make_pair(aoff, (uint64_t)hp->alen * sizeof(unsigned short)));
+      } else if (hp->alen > 0) {
+        return false;
+      }
+      if (hp->next_homonym) {
+        uint64_t hoff;
+        if (!image_offset(header, hp->next_homonym, sizeof(struct hentry), hoff))
+          return false;
+        homonyms.push_back(hoff);
+      }
+      next = hp->next;
+    }
+  }
+  // homonyms are linked within the chains, so they point to the start of a checked entry
+  std::sort(entries.begin(), entries.end());
+  for (size_t i = 0; i < homonyms.size(); ++i)
+    if (!std::binary_search(entries.begin(), entries.end(), homonyms[i]))
+      return false;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i].first < table_end)
+      return false;
+    for (uint64_t w = data[i].first / a; w < (data[i].first + data[i].second + a - 1) / a; ++w)
+      if (used[w])
+        return false;
+  }
+  return true;
+}
+
+template <typename T>
+T* relocate(T* p, uintptr_t delta) {
+  return p ? (T*)((uintptr_t)p + delta) : NULL;
+}
+
+}  // namespace
+
+bool HashMgr::is_mapped(const void* p) const {
+  return image && (const char*)p >= image && (const char*)p < image + image_size;
+}
+
+bool HashMgr::map_image(const char* imagepath, const char* tpath, const char* apath) {
+  image_header header;
+  FILE* f = fopen(imagepath, "rb");
+  if (!f)
+    return false;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1;
+  fclose(f);
+
+  int64_t dic_mtime, dic_size, aff_mtime, aff_size;
+  if (!ok || memcmp(header.magic, image_magic, sizeof(image_magic)) != 0 ||
+      header.hentry_size != sizeof(struct hentry) ||
+      header.pointer_size != sizeof(void*) ||
+      !file_stamp(tpath, dic_mtime, dic_size) ||
+      !file_stamp(apath, aff_mtime, aff_size) ||
+      header.dic_mtime != dic_mtime || header.dic_size != dic_size ||
+      header.aff_mtime != aff_mtime || header.aff_size != aff_size ||
+      header.tablesize <= 0 || header.size > std::numeric_limits<size_t>::max())
+    return false;
+
+  char* p = NULL;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(imagepath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER file_size;
+  ok = GetFileSizeEx(file, &file_size) && (uint64_t)file_size.QuadPart == header.size;
+  HANDLE mapping = ok ? CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL) : NULL;
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+  p = (char*)MapViewOfFileEx(mapping, FILE_MAP_COPY, 0, 0, 0, (LPVOID)(uintptr_t)header.base);
+  if (!p)
+    p = (char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!p)
+    return false;
+#else
+  int fd = open(imagepath, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != header.size) {
+    close(fd);
+    return false;
+  }
+  void* m = mmap((void*)(uintptr_t)header.base, header.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (m == MAP_FAILED)
+    return false;
+  p = (char*)m;
+#endif
+  image = p;
+  image_size = header.size;
+
+  // a truncated or damaged image is dropped, the caller parses the .dic file and writes it again
+  std::vector<replentry> reps;
+  ok = valid_image(p, header);
+  const char* end = p + image_size;
+  const char* rp = ok ? p + header.rep_offset : end;
+  for (uint32_t i = 0; ok && i < header.rep_count; ++i) {
+    replentry entry;
+    ok = read_string(rp, end, entry.pattern);
+    for (int j = 0; ok && j < 4; ++j)
+      ok = read_string(rp, end, entry.outstrings[j]);
+    reps.push_back(entry);
+  }
+  if (!ok) {
+    HUNSPELL_WARNING(stderr, "warning: damaged dictionary image %s\n", imagepath);
+    unmap_image();
+    return false;
+  }
+
+  tablesize = header.tablesize;
+  tableptr = (struct hentry**)(p + header.table_offset);
+
+  if ((uintptr_t)p != header.base) {
+    // every entry is in exactly one chain, homonyms are linked within their chain
+    uintptr_t delta = (uintptr_t)p - (uintptr_t)header.base;
+    for (int i = 0; i < tablesize; i++) {
+      tableptr[i] = relocate(tableptr[i], delta);
+      for (struct hentry* hp = tableptr[i]; hp; hp = hp->next) {
+        hp->next = relocate(hp->next, delta);
+        hp->next_homonym = relocate(hp->next_homonym, delta);
+        hp->astr = relocate(hp->astr, delta);
+        if ((hp->var & H_OPT) && (hp->var & H_OPT_ALIASM)) {
+          char* data = HENTRY_WORD(hp) + hp->blen + 1;
+          store_pointer(data, relocate(get_stored_pointer(data), delta));
+        }
+      }
+    }
+  }
+  reptable.insert(reptable.end(), reps.begin(), reps.end());
+  return true;
+}
+
+void HashMgr::unmap_image() {
+  if (!image)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(image);
+#else
+  munmap(image, image_size);
+#endif
+  image = NULL;
+  image_size = 0;
+}
+
+bool HashMgr::write_image(const char* imagepath, const char* tpath, const char* apath, size_t reptable_start) const {
+  image_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, image_magic, sizeof(image_magic));
+  header.hentry_size = sizeof(struct hentry);
+  header.pointer_size = sizeof(void*);
+  header.tablesize = tablesize;
+  header.base = preferred_base(tpath);
+  if (!file_stamp(tpath, header.dic_mtime, header.dic_size) ||
+      !file_stamp(apath, header.aff_mtime, header.aff_size))
+    return false;
+
+  // layout: header, table, entries, flag vectors and morphological aliases, REP entries
+  std::unordered_map<const void*, size_t> offsets;
+  std::unordered_map<const void*, int> flag_lengths;
+  size_t size = align_up(sizeof(header));
+  header.table_offset = size;
+  size += align_up(tablesize * sizeof(struct hentry*));
+  for (int i = 0; i < tablesize; i++) {
+    for (struct hentry* hp = tableptr[i]; hp; hp = hp->next) {
+      offsets[hp] = size;
+      size += align_up(entry_size(hp));
+      if (hp->astr) {
+        // flag vectors are shared if aliases are used
+        int& len = flag_lengths[hp->astr];
+        len = std::max(len, std::max<int>(hp->alen, 1));
+      }
+    }
+  }
+  for (std::unordered_map<const void*, int>::const_iterator it = flag_lengths.begin(); it != flag_lengths.end(); ++it) {
+    offsets[it->first] = size;
+    size += align_up(it->second * sizeof(unsigned short));
+  }
+  for (int i = 0; i < tablesize; i++) {
+    for (struct hentry* hp = tableptr[i]; hp; hp = hp->next) {
+      if ((hp->var & H_OPT) && (hp->var & H_OPT_ALIASM)) {
+        const char* data = HENTRY_DATA(hp);
+        if (offsets.find(data) == offsets.end()) {
+          offsets[data] = size;
+          size += align_up(strlen(data) + 1);
+        }
+      }
+    }
+  }
+  std::string reps;
+  for (size_t i = reptable_start; i < reptable.size(); ++i) {
+    append_string(reps, reptable[i].pattern);
+    for (int j = 0; j < 4; ++j)
+      append_string(reps, reptable[i].outstrings[j]);
+  }
+  header.rep_count = (uint32_t)(reptable.size() - reptable_start);
+  header.rep_offset = size;
+  size += reps.size();
+  header.size = size;
+
+  std::vector<char> buffer(size, 0);
+  char* out = &buffer[0];
+  memcpy(out, &header, sizeof(header));
+  const uint64_t base = header.base;
+  struct hentry** table = (struct hentry**)(out + header.table_offset);
+  for (int i = 0; i < tablesize; i++) {
+    table[i] = tableptr[i] ? (struct hentry*)(uintptr_t)(base + offsets[tableptr[i]]) : NULL;
+    for (struct hentry* hp = tableptr[i]; hp; hp = hp->next) {
+      struct hentry* copy = (struct hentry*)(out + offsets[hp]);
+      memcpy(copy, hp, entry_size(hp));
+      copy->next = hp->next ? (struct hentry*)(uintptr_t)(base + offsets[hp->next]) : NULL;
+      copy->next_homonym = hp->next_homonym ? (struct hentry*)(uintptr_t)(base + offsets[hp->next_homonym]) : NULL;
+      if (hp->astr) {
+        copy->astr = (unsigned short*)(uintptr_t)(base + offsets[hp->astr]);
+        memcpy(out + offsets[hp->astr], hp->astr, hp->alen * sizeof(unsigned short));
+      }
+      if ((hp->var & H_OPT) && (hp->var & H_OPT_ALIASM)) {
+        const char* data = HENTRY_DATA(hp);
+        strcpy(out + offsets[data], data);
+        store_pointer(HENTRY_WORD(copy) + copy->blen + 1, (char*)(uintptr_t)(base + offsets[data]));
+      }
+    }
+  }
+  if (!reps.empty())
+    memcpy(out + header.rep_offset, reps.data(), reps.size());
+
+  // write a temporary file first, another process may map the old image
+  std::string tmppath = std::string(imagepath) + ".tmp";
+  FILE* f = fopen(tmppath.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(out, 1, size, f) == size;
+  ok = (fclose(f) == 0) && ok;
+  if (ok) {
+    ::remove(imagepath);
+    ok = rename(tmppath.c_str(), imagepath) == 0;
+  }
+  if (!ok)
+    ::remove(tmppath.c_str());
+  return ok;
+}
+
 // the hash function is a simple load and rotate
 // algorithm borrowed
 int HashMgr::hash(const char* word) const {
@@ -109,9 +109,12 @@ class HashMgr {
   // of the dic file. It contains phonetic and other common misspellings
   // (letters, letter groups and words) for better suggestions
   std::vector<replentry> reptable;
+  // memory mapped dictionary image, see map_image()
+  char* image;
+  size_t image_size;
 
  public:
-  HashMgr(const char* tpath, const char* apath, const char* key = NULL);
+  HashMgr(const char* tpath, const char* apath, const char* key = NULL, const char* imagepath = NULL);
   ~HashMgr();
 
   struct hentry* lookup(const char*) const;
@@ -153,6 +156,10 @@ class HashMgr {
   bool parse_aliasm(const std::string& line, FileMgr* af);
   bool parse_reptable(const std::string& line, FileMgr* af);
   int remove_forbidden_flag(const std::string& word);
+  bool is_mapped(const void* p) const;
+  bool map_image(const char* imagepath, const char* tpath, const char* apath);
+  void unmap_image();
+  bool write_image(const char* imagepath, const char* tpath, const char* apath, size_t reptable_start) const;
 };
 
 #endif
@@ -87,7 +87,7 @@
 class HunspellImpl
 {
 public:
-  HunspellImpl(const char* affpath, const char* dpath, const char* key = NULL);
+  HunspellImpl(const char* affpath, const char* dpath, const char* key = NULL, const char* imagepath = NULL);
   ~HunspellImpl();
   int add_dic(const char* dpath, const char* key = NULL);
   std::vector<std::string> suffix_suggest(const std::string& root_word);
@@ -169,14 +169,14 @@ private:
   HunspellImpl& operator=(const HunspellImpl&);
 };
 
-HunspellImpl::HunspellImpl(const char* affpath, const char* dpath, const char* key) {
+HunspellImpl::HunspellImpl(const char* affpath, const char* dpath, const char* key, const char* imagepath) {
   csconv = NULL;
   utf8 = 0;
   complexprefixes = 0;
   affixpath = mystrdup(affpath);
 
   /* first set up the hash manager */
-  m_HMgrs.push_back(new HashMgr(dpath, affpath, key));
+  m_HMgrs.push_back(new HashMgr(dpath, affpath, key, imagepath));
 
   /* next set up the affix manager */
   /* it needs access to the hash manager lookup methods */
@@ -2021,8 +2021,8 @@ int HunspellImpl::input_conv(const char* word, char* dest, size_t destsize) {
   return 0;
 }
 
-Hunspell::Hunspell(const char* affpath, const char* dpath, const char* key)
-  : m_Impl(new HunspellImpl(affpath, dpath, key)) {
+Hunspell::Hunspell(const char* affpath, const char* dpath, const char* key, const char* imagepath)
+  : m_Impl(new HunspellImpl(affpath, dpath, key, imagepath)) {
 }
 
 Hunspell::~Hunspell() {
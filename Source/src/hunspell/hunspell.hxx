@@ -112,8 +112,11 @@ class LIBHUNSPELL_DLL_EXPORTED Hunspell {
    * prefix \\\\?\\ to handle system-independent character encoding and very
    * long path names (without the long path prefix Hunspell will use fopen()
    * with system-dependent character encoding instead of _wfopen()).
+   *
+   * If imagepath is given, the parsed dictionary is stored there and memory
+   * mapped on later loads, as long as the dictionary files are unchanged.
    */
-  Hunspell(const char* affpath, const char* dpath, const char* key = NULL);
+  Hunspell(const char* affpath, const char* dpath, const char* key = NULL, const char* imagepath = NULL);
   ~Hunspell();
 
   /* load extra dictionaries (only dic files) */
@@ -16,6 +16,7 @@
 #include "qdocumentline.h"
 #include "qdocumentline_p.h"
 #include "qdocumentcommand.h"
+#include "qdocumentundostack.h"
 
 #include "qlinemarksinfocenter.h"
 #include "qformatfactory.h"
@@ -90,6 +91,7 @@ private:
 	const LatexCompleterConfig *completerConfig;
 	const LatexEditorViewConfig *editorViewConfig;
 	QList<QAction *> baseActions;
+	MacroTriggerIndex macroTriggers;
 
 	QMenu *contextMenu;
 	QString lastSpellCheckedWord;
@@ -107,9 +109,10 @@ bool DefaultInputBinding::runMacros(QKeyEvent *event, QEditor *editor)
     QLanguageDefinition *language = editor->document() ? editor->document()->languageDefinition() : nullptr;
 	QDocumentLine line = editor->cursor().selectionStart().line();
 	int column = editor->cursor().selectionStart().columnNumber();
-	QString prev = line.text().mid(0, column) + event->text(); //TODO: optimize
-	foreach (const Macro &m, completerConfig->userMacros) {
-		if (!m.isActiveForTrigger(Macro::ST_REGEX)) continue;
+	QString prev = line.text().mid(0, column) + event->text();
+	macroTriggers.update(completerConfig->userMacros);
+	foreach (int i, macroTriggers.candidates(prev)) {
+		const Macro &m = completerConfig->userMacros.at(i);
 		if (!m.isActiveForLanguage(language)) continue;
 		if (!(m.isActiveForFormat(line.getFormatAt(column)) || (column > 0 && m.isActiveForFormat(line.getFormatAt(column - 1))))) continue; //two checks, so it works at beginning and end of an environment
 		QRegExp &r = const_cast<QRegExp &>(m.triggerRegex); //a const qregexp doesn't exist
@@ -1596,10 +1599,11 @@ QList<int> LatexEditorView::grammarFormats;
 QVector<bool> LatexEditorView::grammarFormatsDisabled;
 QList<int> LatexEditorView::formatsList;
 
-void LatexEditorView::updateSettings()
+/*!
+ * \brief apply the configured wrap mode, also restores the width constraint of documents whose wrapping was disabled
+ */
+void LatexEditorView::updateLineWrapping()
 {
-	lineNumberPanel->setVerboseMode(config->showlinemultiples != 10);
-	editor->setFont(QFont(config->fontFamily, config->fontSize));
 	editor->setLineWrapping(config->wordwrap > 0);
 	editor->setSoftLimitedLineWrapping(config->wordwrap == 2);
 	editor->setHardLineWrapping(config->wordwrap > 2);
@@ -1608,6 +1612,13 @@ void LatexEditorView::updateSettings()
 	} else {
 		editor->setWrapAfterNumChars(0);
 	}
+}
+
+void LatexEditorView::updateSettings()
+{
+	lineNumberPanel->setVerboseMode(config->showlinemultiples != 10);
+	editor->setFont(QFont(config->fontFamily, config->fontSize));
+	updateLineWrapping();
 	editor->setFlag(QEditor::AutoIndent, config->autoindent);
 	editor->setFlag(QEditor::WeakIndent, config->weakindent);
 	editor->setFlag(QEditor::ReplaceIndentTabs, config->replaceIndentTabs);
@@ -1648,6 +1659,8 @@ void LatexEditorView::updateSettings()
 	QDocument::setShowSpaces(config->showWhitespace ? (QDocument::ShowTrailing | QDocument::ShowLeading | QDocument::ShowTabs) : QDocument::ShowNone);
 	QDocument::setTabStop(config->tabStop);
 	QDocument::setLineSpacingFactor(config->lineSpacingPercent / 100.0);
+	QDocumentUndoStack::setMemoryLimit(qint64(config->undoHistoryLimitMB) * 1024 * 1024);
+	QDocumentUndoStack::setSpillEnabled(config->undoHistorySpill);
 
 	editor->m_preEditFormat = preEditFormat;
 
@@ -17,21 +17,26 @@
 #include "mostQtHeaders.h"
 
 
-class QTextDocument;
+class QTextBlock;
 
 
-class LogHighlighter : public QSyntaxHighlighter {
+/*!
+ *	@brief Colors the lines of a log or message view
+ *
+ *	Not a QSyntaxHighlighter: that one styles every block of the
+ *	document as soon as it changes, which is too slow for logs of
+ *	several megabytes. The owning view calls highlightBlock() for
+ *	the blocks that actually become visible.
+ */
 
-	Q_OBJECT
+class LogHighlighter {
 
 	public:
 
-		LogHighlighter(QTextDocument * parent = 0);
+		LogHighlighter();
 		QColor ColorFile;
 
-	protected:
-
-		void highlightBlock(const QString & text);
+		bool highlightBlock(const QTextBlock &) const; // true if the block needs a relayout
 
 	private:
 
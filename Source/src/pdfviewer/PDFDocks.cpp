@@ -336,7 +336,7 @@ QVariant PDFOverviewModel::data ( const QModelIndex &index, int role) const
 		while (index.row() >= cache.size()) cache << QPixmap();
 		if (cache[index.row()].isNull()) {
 			const QObject *o = this; //TODO: get rid of const_cast
-			cache[index.row()] = document->renderManager->renderToImage(index.row(), const_cast<QObject *>(o), "updateImage", -1, -1, -1, -1, -1, -1, false).scaled(128, 128, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+			cache[index.row()] = document->renderManager->renderThumbnail(index.row(), const_cast<QObject *>(o), "updateImage", 128);
 		}
 		return cache[index.row()];
     case Qt::BackgroundRole:
@@ -361,7 +361,7 @@ void PDFOverviewModel::setDocument(PDFDocument *doc)
 void PDFOverviewModel::updateImage(const QPixmap &pm, int page)
 {
 	if (!document || page < 0 || page >= cache.size()) return;
-	cache[page] = pm.scaled(128, 128, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	cache[page] = pm;
 	emit dataChanged(index(page), index(page));
 }
 
@@ -2414,7 +2414,7 @@ QList<PDFDocument *> PDFDocument::docList;
 
 PDFDocument::PDFDocument(PDFDocumentConfig *const pdfConfig, bool embedded)
     : renderManager(nullptr), curFileSize(0), menubar(nullptr), exitFullscreen(nullptr), watcher(nullptr), reloadTimer(nullptr), dwClock(nullptr), dwOutline(nullptr), dwFonts(nullptr), dwInfo(nullptr), dwOverview(nullptr), dwSearch(nullptr),
-      syncFromSourceBlocked(false), syncToSourceBlocked(false)
+      syncFromSourceBlocked(false), syncToSourceBlocked(false), syncFromSourcePending(false)
 {
     REQUIRE(pdfConfig);
     Q_ASSERT(!globalConfig || (globalConfig == pdfConfig));
@@ -2426,6 +2426,7 @@ PDFDocument::PDFDocument(PDFDocumentConfig *const pdfConfig, bool embedded)
 
     watcher = new QFileSystemWatcher(this);
     connect(watcher, SIGNAL(fileChanged(const QString&)), this, SLOT(reloadWhenIdle()));
+    connect(&scanner, SIGNAL(loaded(bool)), this, SLOT(syncDataLoaded(bool)));
 
     if (!embedded) {
         int &x = globalConfig->windowLeft;
@@ -3651,12 +3652,22 @@ void PDFDocument::gotoAnnotation(const PDFAnnotation *ann)
 
 void PDFDocument::loadSyncData()
 {
-	scanner.load(curFileUnnormalized);
-	if (!scanner.isValid())
+	scanner.loadInBackground(curFileUnnormalized);
+}
+
+void PDFDocument::syncDataLoaded(bool success)
+{
+	if (!success)
 		statusBar()->showMessage(tr("No SyncTeX data available"), 3000);
 	else {
 		statusBar()->showMessage(tr("SyncTeX: \"%1\"").arg(QDir::toNativeSeparators(scanner.synctexFilename())), 3000);
 	}
+	// a sync requested while the data was loading, e.g. directly after a compilation
+	if (syncFromSourcePending) {
+		syncFromSourcePending = false;
+		if (success)
+			syncFromSource(lastSyncPoint.filename, lastSyncPoint.line - 1, lastSyncPoint.column - 1, pendingDisplayFlags);
+	}
 }
 
 void PDFDocument::syncClick(int pageIndex, const QPointF &pos, bool activate)
@@ -3665,11 +3676,8 @@ void PDFDocument::syncClick(int pageIndex, const QPointF &pos, bool activate)
 		return;
 	pdfWidget->setHighlightPath(-1, QPainterPath());
 	pdfWidget->update();
-	QDir curDir(QFileInfo(curFile).canonicalPath());
-    QSynctex::NodeIterator iter = scanner.editQuery(pageIndex + 1, static_cast<float>(pos.x()), static_cast<float>(pos.y()));
-	while (iter.hasNext()) {
-		QSynctex::Node node = iter.next();
-		QString fullName = scanner.getNameFileInfo(curDir, node).canonicalFilePath();
+	foreach (const QSynctex::TeXSyncPoint &point, scanner.syncToTeX(pageIndex + 1, pos, curFile)) {
+		const QString &fullName = point.filename;
 		if (!globalConfig->syncFileMask.trimmed().isEmpty()) {
 			bool found = false;
 			foreach (const QString & s, globalConfig->syncFileMask.split(";"))
@@ -3698,7 +3706,7 @@ void PDFDocument::syncClick(int pageIndex, const QPointF &pos, bool activate)
 		}
 
 		syncFromSourceBlocked = true;
-		emit syncSource(fullName, node.line() - 1, activate, word.trimmed()); //-1 because txs is 0 based, but synctex seems to be 1 based
+		emit syncSource(fullName, point.line - 1, activate, word.trimmed()); //-1 because txs is 0 based, but synctex seems to be 1 based
 		syncFromSourceBlocked = false;
 		break; // FIXME: currently we just take the first hit
 	}
@@ -3717,6 +3725,11 @@ int PDFDocument::syncFromSource(const QString &sourceFile, int lineNo, int colum
 	QSynctex::TeXSyncPoint sourcePoint(sourceFile, lineNo + 1, column + 1);  // synctex uses 1-based line and column
 	lastSyncPoint = sourcePoint;
 
+	if (scanner.isLoading() && !syncFromSourceBlocked) {
+		syncFromSourcePending = true;
+		pendingDisplayFlags = displayFlags;
+		return -1;
+	}
 	if (!scanner.isValid() || syncFromSourceBlocked || ignoreSynchronization())
 		return -1;
 
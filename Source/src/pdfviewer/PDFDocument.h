@@ -443,6 +443,7 @@ private slots:
 	void enableZoomActions(qreal);
 	void adjustScaleActions(autoScaleOption);
 	void syncClick(int page, const QPointF &pos, bool activate);
+	void syncDataLoaded(bool success);
 	void stopReloadTimer();
 	void reloadWhenIdle();
 	void idleReload();
@@ -656,6 +657,8 @@ private:
 	bool wasMaximized;
 	bool syncFromSourceBlocked;  //temporary disable sync from source
 	bool syncToSourceBlocked;    //temporary disable sync to source (only for continuous scrolling)
+	bool syncFromSourcePending;  //sync from source requested while the sync data is loading
+	DisplayFlags pendingDisplayFlags;
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(PDFDocument::DisplayFlags)
 
@@ -14,9 +14,60 @@
 #include "pdfrenderengine.h"
 #include "pdfrendermanager.h"
 
+#include <QCryptographicHash>
+#include <QSaveFile>
+
 RenderCommand::RenderCommand(int p, double xr, double yr, int x, int y, int w, int h) :
-	pageNr(p), xres(xr), yres(yr), x(x), y(y), w(w), h(h), rotate(Poppler::Page::Rotate0), ticket(-1), priority(false)
+	pageNr(p), xres(xr), yres(yr), x(x), y(y), w(w), h(h), rotate(Poppler::Page::Rotate0), ticket(-1), priority(false), thumbnail(false)
+{
+}
+
+/*!
+ * \brief fingerprint of a page for the thumbnail cache
+ * \param salt identity of the document (path, size and modification time) and settings which change the rendering, e.g. paper color
+ */
+QByteArray PDFThumbnailCache::key(Poppler::Page *page, int pageNr, double res, const QByteArray &salt)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	const QSizeF size = page->pageSizeF();
+	hash.addData(QByteArray::number(pageNr) + ':' + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height()) + '@' + QByteArray::number(res) + '/' + QByteArray::number(page->orientation()) + '/' + salt);
+	return hash.result().toHex();
+}
+
+QImage PDFThumbnailCache::lookup(const QString &dir, const QByteArray &key)
+{
+	if (dir.isEmpty())
+		return QImage();
+	QFile file(dir + "/" + key + ".png");
+	if (!file.open(QFile::ReadWrite))
+		return QImage();
+	QImage image;
+	image.loadFromData(file.readAll(), "PNG");
+	if (!image.isNull())
+		file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);  // for prune()
+	return image;
+}
+
+void PDFThumbnailCache::store(const QString &dir, const QByteArray &key, const QImage &image)
 {
+	if (dir.isEmpty() || image.isNull() || !QDir().mkpath(dir))
+		return;
+	QSaveFile file(dir + "/" + key + ".png");  // other render threads may read it concurrently
+	if (file.open(QFile::WriteOnly) && image.save(&file, "PNG"))
+		file.commit();
+}
+
+/*!
+ * \brief remove the least recently used thumbnails until the cache is smaller than \a maxBytes
+ */
+void PDFThumbnailCache::prune(const QString &dir, qint64 maxBytes)
+{
+	qint64 total = 0;
+	foreach (const QFileInfo &info, QDir(dir).entryInfoList(QStringList() << "*.png", QDir::Files, QDir::Time)) {
+		total += info.size();
+		if (total > maxBytes)
+			QFile::remove(info.absoluteFilePath());
+	}
 }
 
 PDFRenderEngine::PDFRenderEngine(QObject *parent, PDFQueue *mQueue) :
@@ -38,6 +89,32 @@ void PDFRenderEngine::setDocument(const QSharedPointer<Poppler::Document> &doc)
 	cachedNumPages = (document.isNull()) ? 0 : document->numPages();
 }
 
+QImage PDFRenderEngine::render(Poppler::Page *page, const RenderCommand &command)
+{
+	QImage image = page->renderToImage(command.xres, command.yres,
+	                                   command.x, command.y, command.w, command.h, command.rotate);
+	QSizeF pageSize = page->pageSizeF();
+
+	QPainter p(&image);
+	p.scale(command.xres * pageSize.width() / 72.0, command.yres * pageSize.height() / 72.0);
+	QPen pen;
+	pen.setWidthF(0.01);
+	pen.setColor(Qt::blue);
+	p.setPen(pen);
+	if (command.x != -1 && command.y != -1) p.translate(command.x, command.y);
+	if (command.rotate != Poppler::Page::Rotate0) {
+		if (command.rotate == Poppler::Page::Rotate90) p.rotate(90);
+		else if (command.rotate == Poppler::Page::Rotate180) p.rotate(180);
+		else if (command.rotate == Poppler::Page::Rotate270) p.rotate(270);
+	}
+	for (auto &annon: page->annotations())
+		if (annon->subType() == Poppler::Annotation::AMovie){
+			p.drawRect(annon->boundary() );
+		}
+	p.end();
+	return image;
+}
+
 void PDFRenderEngine::run()
 {
 	forever {
@@ -53,11 +130,11 @@ void PDFRenderEngine::run()
                 }
 				// get Linedata
 				queue->mQueueLock.lock();
-				command = queue->mCommands.dequeue();
+				command = queue->dequeue();
 				if (command.priority) {
 					leave = true;
 				} else {
-					queue->mCommands.prepend(command);
+					queue->requeue(command);
 					queue->mCommandsAvailable.release();
 				}
 				queue->mQueueLock.unlock();
@@ -73,7 +150,7 @@ void PDFRenderEngine::run()
 			if (queue->stopped) break;
 			// get Linedata
 			queue->mQueueLock.lock();
-			command = queue->mCommands.dequeue();
+			command = queue->dequeue();
 			queue->mQueueLock.unlock();
 		}
 		if (queue->stopped)
@@ -83,26 +160,17 @@ void PDFRenderEngine::run()
 		if (!document.isNull() && command.pageNr >= 0 && command.pageNr < cachedNumPages) {
             std::unique_ptr<Poppler::Page> page(document->page(command.pageNr));
 			if (page) {
-				QImage image = page->renderToImage(command.xres, command.yres,
-				                                   command.x, command.y, command.w, command.h, command.rotate);
-				QSizeF pageSize = page->pageSizeF();
-
-				QPainter p(&image);
-                p.scale(command.xres * pageSize.width() / 72.0, command.yres * pageSize.height() / 72.0);
-                QPen pen;
-                pen.setWidthF(0.01);
-                pen.setColor(Qt::blue);
-                p.setPen(pen);
-                if (command.x != -1 && command.y != -1) p.translate(command.x, command.y);
-                if (command.rotate != Poppler::Page::Rotate0) {
-                    if (command.rotate == Poppler::Page::Rotate90) p.rotate(90);
-                    else if (command.rotate == Poppler::Page::Rotate180) p.rotate(180);
-                    else if (command.rotate == Poppler::Page::Rotate270) p.rotate(270);
-                }
-                for (auto &annon: page->annotations())
-                    if (annon->subType() == Poppler::Annotation::AMovie){
-                        p.drawRect(annon->boundary() );
-                    }
+				QImage image;
+				QByteArray thumbnailKey;
+				if (command.thumbnail) {
+					thumbnailKey = PDFThumbnailCache::key(page.get(), command.pageNr, command.xres, command.thumbnailSalt);
+					image = PDFThumbnailCache::lookup(queue->thumbnailDir, thumbnailKey);
+				}
+				if (image.isNull()) {
+					image = render(page.get(), command);
+					if (command.thumbnail && !queue->stopped)
+						PDFThumbnailCache::store(queue->thumbnailDir, thumbnailKey, image);
+				}
 
                 //delete page;
 				if (!queue->stopped) //qDebug() << command.ticket << " send from "<<QThread::currentThreadId(),
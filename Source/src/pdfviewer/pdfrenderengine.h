@@ -31,6 +31,17 @@ public:
 	Poppler::Page::Rotation rotate;
 	int ticket;
 	bool priority;
+	bool thumbnail;
+	QByteArray thumbnailSalt; // copied from the queue when the command is enqueued
+};
+
+class PDFThumbnailCache
+{
+public:
+	static QByteArray key(Poppler::Page *page, int pageNr, double res, const QByteArray &salt);
+	static QImage lookup(const QString &dir, const QByteArray &key);
+	static void store(const QString &dir, const QByteArray &key, const QImage &image);
+	static void prune(const QString &dir, qint64 maxBytes);
 };
 
 class PDFRenderEngine : public SafeThread
@@ -53,6 +64,8 @@ protected:
 	void run();
 
 private:
+	QImage render(Poppler::Page *page, const RenderCommand &command);
+
 	QSharedPointer<Poppler::Document> document;
 	int cachedNumPages;
 	PDFQueue *queue;
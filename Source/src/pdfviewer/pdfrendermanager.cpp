@@ -15,6 +15,7 @@
 #include "smallUsefulFunctions.h"
 #include "configmanagerinterface.h"
 #include <QtCore/qmath.h>
+#include <QtConcurrentRun>
 
 const int kMaxPageZoom = 1000000;
 
@@ -24,6 +25,8 @@ const int kMaxPageZoom = 1000000;
 // that users with high resolution screens have reasonable cpu power.
 const qreal kMaxDpiForFullPage = 1000.0;
 
+const qint64 kMaxThumbnailCacheBytes = 64 * 1024 * 1024;
+
 
 SetImageForwarder::SetImageForwarder(QObject *parent, QObject *obj, const char *rec, QPixmap img, int pageNr):
     QObject(parent), obj(obj), rec(rec), img(img), pageNr(pageNr)
@@ -51,6 +54,28 @@ void PDFQueue::deref()
 	}
 }
 
+/*!
+ * \brief take the next command, thumbnails come after all page renderings
+ * mQueueLock has to be locked and a command has to be available
+ */
+RenderCommand PDFQueue::dequeue()
+{
+	if (!mCommands.isEmpty())
+		return mCommands.dequeue();
+	return mThumbnailCommands.dequeue();
+}
+
+/*!
+ * \brief put a command taken by dequeue() back at the front of its queue
+ */
+void PDFQueue::requeue(const RenderCommand &command)
+{
+	if (command.thumbnail)
+		mThumbnailCommands.prepend(command);
+	else
+		mCommands.prepend(command);
+}
+
 CachePixmap::CachePixmap(const QPixmap &pixmap) :
 	QPixmap(pixmap), resolution(0), x(0), y(0)
 {
@@ -88,6 +113,12 @@ PDFRenderManager::PDFRenderManager(QObject *parent, int limitQueues) :
             queueAdministration->num_renderQueues = -limitQueues;
         }
 	}
+	queueAdministration->thumbnailDir = ConfigManagerInterface::getInstance()->parseDir("[txs-settings-dir]/thumbnails");
+	static bool thumbnailsPruned = false;
+	if (!thumbnailsPruned) {
+		thumbnailsPruned = true;
+		QtConcurrent::run(&PDFThumbnailCache::prune, queueAdministration->thumbnailDir, kMaxThumbnailCacheBytes);
+	}
 	for (int i = 0; i < queueAdministration->num_renderQueues; i++) {
         auto *renderQueue = new PDFRenderEngine(nullptr, queueAdministration);
         connect(renderQueue, SIGNAL(sendImage(QImage,int,int)), this, SLOT(addToCache(QImage,int,int)));
@@ -223,6 +254,9 @@ QSharedPointer<Poppler::Document> PDFRenderManager::loadDocument(const QString &
 	if (paperColor.isValid()) {
 		docPtr->setPaperColor(paperColor);
 	}
+	const QFileInfo fileInfo(fileName);
+	queueAdministration->thumbnailSalt = fileInfo.absoluteFilePath().toUtf8() + '|' + QByteArray::number(fileInfo.size()) + '|' + QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch())
+	                                     + '|' + QByteArray::number(backend) + paperColor.name().toLatin1();
 
     document = QSharedPointer<Poppler::Document>(docPtr.release());
 
@@ -258,6 +292,7 @@ QPixmap PDFRenderManager::renderToImage(int pageNr, QObject *obj, const char *re
 	info.cache = cache;
 	info.xres = xres;
 	info.priority = priority;
+	info.thumbnail = false;
 	currentTicket++;
 	int mCurrentTicket = currentTicket;
 	bool enqueueCmd = !checkDuplicate(mCurrentTicket, info);
@@ -386,6 +421,51 @@ QPixmap PDFRenderManager::renderToImage(int pageNr, QObject *obj, const char *re
     return std::move(img);
 }
 
+/*!
+ * \brief request a thumbnail of a page
+ * The thumbnail is rendered directly at a resolution where its larger side is \a size pixels, after all pending
+ * page renderings. Rendered thumbnails are kept in a disk cache, which is shared by all documents and sessions.
+ * \a rec of \a obj is called with the result.
+ * \return a scaled version of the cached page if available, an empty placeholder otherwise
+ */
+QPixmap PDFRenderManager::renderThumbnail(int pageNr, QObject *obj, const char *rec, int size)
+{
+	if (document.isNull()) return QPixmap();
+	if (pageNr < 0 || pageNr >= cachedNumPages) return QPixmap();
+	std::unique_ptr<Poppler::Page> page(document->page(pageNr));
+	if (!page)
+		return QPixmap();
+	QSizeF sz = page->pageSizeF();
+	double res = 72.0 * size / qMax(1.0, qMax(sz.width(), sz.height()));
+
+	RecInfo info;
+	info.obj = obj;
+	info.slot = rec;
+	info.x = info.y = info.w = info.h = -1;
+	info.pageNr = pageNr;
+	info.cache = false;
+	info.xres = res;
+	info.priority = false;
+	info.thumbnail = true;
+	currentTicket++;
+	lstOfReceivers.insert(currentTicket, info);
+
+	RenderCommand cmd(pageNr, res, res);
+	cmd.ticket = currentTicket;
+	cmd.thumbnail = true;
+	cmd.thumbnailSalt = queueAdministration->thumbnailSalt;
+	queueAdministration->mQueueLock.lock();
+	queueAdministration->mThumbnailCommands.enqueue(cmd);
+	queueAdministration->mQueueLock.unlock();
+	queueAdministration->mCommandsAvailable.release();
+
+	if (renderedPages.contains(pageNr))
+		return renderedPages[pageNr]->scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	QPixmap img((sz * res / 72.0).toSize());
+	img.fill(QApplication::palette().color(QPalette::Light).rgb());
+	return img;
+}
+
 void PDFRenderManager::addToCache(QImage img, int pageNr, int ticket)
 {
 	//qDebug() << ticket << " rec at "<<QThread::currentThreadId();
@@ -454,7 +534,7 @@ bool PDFRenderManager::checkDuplicate(int &, RecInfo &info)
 	//check if a similar picture is not already in the renderqueue
 	QMultiMap<int, RecInfo>::const_iterator i = lstOfReceivers.constBegin();
 	for (; i != lstOfReceivers.constEnd(); ++i) {
-		if (i.value().pageNr != info.pageNr)
+		if (i.value().pageNr != info.pageNr || i.value().thumbnail)
 			continue;
 		if (i.value().x < 0 && i.value().y < 0 && i.value().w < 0 && i.value().h < 0
 		        && info.x < 0 && info.y < 0 && info.w < 0 && info.h < 0) {
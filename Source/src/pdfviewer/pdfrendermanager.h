@@ -20,6 +20,7 @@ public:
 	qreal xres;
 	bool cache;
 	bool priority;
+	bool thumbnail;
 };
 
 
@@ -59,7 +60,11 @@ public:
 		return m_ref.fetchAndAddRelaxed(0);
 	}
 
+	RenderCommand dequeue();
+	void requeue(const RenderCommand &command);
+
 	QQueue<RenderCommand> mCommands;
+	QQueue<RenderCommand> mThumbnailCommands;  // only rendered if there is nothing else to do
 	QSemaphore mCommandsAvailable;
 	QMutex mQueueLock;
 	bool stopped;
@@ -72,6 +77,9 @@ public:
 
 	QByteArray documentData;
 
+	QString thumbnailDir;
+	QByteArray thumbnailSalt; // only used on the GUI thread, the render engines get it through RenderCommand
+
 private:
 	QAtomicInt m_ref;
 };
@@ -107,6 +115,7 @@ public:
 	enum Error {NoError, FileOpenFailed, PopplerError, PopplerErrorBadAlloc, PopplerErrorException, FileLocked, FileIncomplete };
 
     QPixmap renderToImage(int pageNr, QObject *obj, const char *rec, double xres = 72.0, double yres = 72.0, int x = -1, int y = -1, int w = -1, int h = -1, bool cache = true, bool priority = false, int delayTimeout = -1, Poppler::Page::Rotation rotate = Poppler::Page::Rotate0);
+	QPixmap renderThumbnail(int pageNr, QObject *obj, const char *rec, int size);
     QSharedPointer<Poppler::Document> loadDocument(const QString &fileName, Error &error, const QString &userPasswordStr,  bool foreceLoad = false);
 	void stopRendering();
 	void setCacheSize(int megabyte);
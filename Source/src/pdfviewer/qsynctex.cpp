@@ -18,6 +18,8 @@
 #include "qsynctex.h"
 
 #include <QDir>
+#include <QtMath>
+#include <QtConcurrentRun>
 
 #include <synctex_parser_c-auto.h>
 #include "synctex_parser_utils.h"
@@ -35,9 +37,302 @@ QRectF Node::boxVisibleRect() const
 }
 
 
-Scanner::Scanner(QObject *parent) : QObject(parent), scanner(nullptr)
+static QFileInfo fileInfoForName(const QDir &curDir, const char *synctex_name)
 {
+	if (!synctex_name) return QFileInfo();
+
+	QFileInfo fileinfo = QFileInfo(curDir, QFile::decodeName(synctex_name)); //old synctex
+	if (fileinfo.exists()) return fileinfo;
+
+	fileinfo = QFileInfo(curDir, QString::fromUtf8(synctex_name)); //new synctex
+	if (fileinfo.exists()) return fileinfo;
+
+	fileinfo = QFileInfo(curDir, QString::fromLatin1(synctex_name)); //for safety (not used afaik)
+	if (fileinfo.exists()) return fileinfo;
+
+	return QFileInfo();
+}
+
+static qreal distanceTo(const QRectF &rect, const QPointF &pos)
+{
+	const qreal dx = qMax(qMax(rect.left() - pos.x(), pos.x() - rect.right()), qreal(0));
+	const qreal dy = qMax(qMax(rect.top() - pos.y(), pos.y() - rect.bottom()), qreal(0));
+	return dx * dx + dy * dy;
+}
+
+
+// size of a grid cell in pdf points, a line of text spans one or two cells vertically
+static const qreal CellSize = 24;
+static const int MaxCells = 256;
+
+/*!
+ * Collects the boxes of all sheets of \a scanner. Boxes and leaf nodes (glue, kern, math, ...)
+ * are put into a grid per page for inverse search, and the enclosing boxes of each source line
+ * are stored for forward search, so that neither has to walk the node tree.
+ * The leaf nodes get the horizontal extent of the node and the vertical one of their box.
+ */
+void Index::build(synctex_scanner_p scanner, const QString &pdfFilename)
+{
+	clear();
+	if (!scanner)
+		return;
+
+	const QDir curDir(QFileInfo(pdfFilename).canonicalPath());
+	for (synctex_node_p input = synctex_scanner_input(scanner); input; input = synctex_node_sibling(input)) {
+		const int tag = synctex_node_tag(input);
+		const QString fileName = fileInfoForName(curDir, synctex_scanner_get_name(scanner, tag)).canonicalFilePath();
+		if (fileName.isEmpty())
+			continue;
+		fileNames.insert(tag, fileName);
+		tags.insert(fileName, tag);
+	}
+
+	for (synctex_node_p sheet = synctex_sheet(scanner, 1); sheet; sheet = synctex_node_sibling(sheet)) {
+		const int page = synctex_node_page(sheet);
+		QHash<synctex_node_p, int> boxes;
+		QVector<int> gridded;
+		QRectF bounds;
+
+		for (synctex_node_p node = synctex_node_next(sheet); node; node = synctex_node_next(node)) {
+			bool isBox = false, isContainer = false;
+			switch (synctex_node_type(node)) {
+			case synctex_node_type_vbox:
+			case synctex_node_type_proxy_vbox:
+				isContainer = true;
+				isBox = true;
+				break;
+			case synctex_node_type_void_vbox:
+			case synctex_node_type_hbox:
+			case synctex_node_type_void_hbox:
+			case synctex_node_type_proxy_hbox:
+				isBox = true;
+				break;
+			case synctex_node_type_kern:
+			case synctex_node_type_glue:
+			case synctex_node_type_rule:
+			case synctex_node_type_math:
+			case synctex_node_type_boundary:
+			case synctex_node_type_proxy:
+			case synctex_node_type_proxy_last:
+				break;
+			default:
+				continue;
+			}
+
+			Entry entry;
+			entry.tag = synctex_node_tag(node);
+			entry.line = synctex_node_line(node);
+			entry.page = page;
+			entry.isBox = isBox;
+			entry.parent = boxes.value(synctex_node_parent(node), -1);
+
+			const QRectF box = Node(node).boxVisibleRect();
+			const QRectF rect = isBox ? box : QRectF(synctex_node_visible_h(node), box.top(), synctex_node_visible_width(node), box.height()).normalized();
+			entry.x = rect.x();
+			entry.y = rect.y();
+			entry.width = rect.width();
+			entry.height = rect.height();
+
+			const int index = entries.size();
+			entries.append(entry);
+			if (isBox)
+				boxes.insert(node, index);
+			if (entry.tag <= 0 || entry.line <= 0)
+				continue;
+
+			// a node is highlighted by its enclosing box, like the results of synctex_iterator_new_display
+			const int target = (isBox || entry.parent < 0) ? index : entry.parent;
+			QVector<int> &targets = lines[entry.tag][entry.line];
+			if (targets.isEmpty() || targets.last() != target)
+				targets.append(target);
+
+			if (!isContainer) {
+				gridded.append(index);
+				bounds = bounds.united(rect.isEmpty() ? QRectF(rect.topLeft(), QSizeF(1, 1)) : rect);
+			}
+		}
+
+		if (gridded.isEmpty())
+			continue;
+
+		Grid &grid = grids[page];
+		grid.bounds = bounds;
+		grid.columns = qBound(1, qCeil(bounds.width() / CellSize), MaxCells);
+		grid.rows = qBound(1, qCeil(bounds.height() / CellSize), MaxCells);
+		grid.cells.resize(grid.columns * grid.rows);
+		foreach (int index, gridded) {
+			const QRectF rect = entries[index].rect();
+			int left, top, right, bottom;
+			cellAt(grid, rect.topLeft(), &left, &top);
+			cellAt(grid, rect.bottomRight(), &right, &bottom);
+			for (int row = top; row <= bottom; row++)
+				for (int column = left; column <= right; column++)
+					grid.cells[row * grid.columns + column].append(index);
+		}
+	}
+	entries.squeeze();
+}
+
+void Index::clear()
+{
+	entries.clear();
+	grids.clear();
+	lines.clear();
+	tags.clear();
+	fileNames.clear();
+}
+
+/*!
+ * \return the cell containing \a pos, positions outside of the grid are clamped to the border cells
+ */
+int Index::cellAt(const Grid &grid, const QPointF &pos, int *column, int *row) const
+{
+	const int c = qBound(0, qFloor((pos.x() - grid.bounds.left()) / CellSize), grid.columns - 1);
+	const int r = qBound(0, qFloor((pos.y() - grid.bounds.top()) / CellSize), grid.rows - 1);
+	if (column) *column = c;
+	if (row) *row = r;
+	return r * grid.columns + c;
+}
+
+/*!
+ * \return the smallest entry containing \a pos or, if there is none, the closest one.
+ * The cells are searched in rings around \a pos, and one ring beyond the first hit since
+ * an entry in the next ring may still be closer.
+ */
+int Index::hitAt(int page, const QPointF &pos) const
+{
+	QHash<int, Grid>::const_iterator it = grids.constFind(page);
+	if (it == grids.constEnd())
+		return -1;
+	const Grid &grid = it.value();
+
+	int column, row;
+	cellAt(grid, pos, &column, &row);
+
+	int best = -1;
+	qreal bestDistance = 0, bestArea = 0;
+	auto visit = [&](int c, int r) {
+		if (c < 0 || r < 0 || c >= grid.columns || r >= grid.rows)
+			return;
+		foreach (int index, grid.cells[r * grid.columns + c]) {
+			const QRectF rect = entries[index].rect();
+			const qreal distance = distanceTo(rect, pos);
+			const qreal area = rect.width() * rect.height();
+			if (best < 0 || distance < bestDistance || (distance == bestDistance && area < bestArea)) {
+				best = index;
+				bestDistance = distance;
+				bestArea = area;
+			}
+		}
+	};
+
+	const int maxRing = qMax(grid.columns, grid.rows);
+	int hitRing = -1;
+	for (int ring = 0; ring <= maxRing && (hitRing < 0 || ring <= hitRing + 1); ring++) {
+		if (ring == 0) {
+			visit(column, row);
+		} else {
+			for (int c = column - ring; c <= column + ring; c++) {
+				visit(c, row - ring);
+				visit(c, row + ring);
+			}
+			for (int r = row - ring + 1; r < row + ring; r++) {
+				visit(column - ring, r);
+				visit(column + ring, r);
+			}
+		}
+		if (best >= 0 && hitRing < 0)
+			hitRing = ring;
+	}
+	return best;
+}
+
+/*!
+ * If \a box is hit on a glyph, the closest node of the box on the same line gives a more precise source line than the box itself.
+ */
+int Index::refinedHit(int page, int box, const QPointF &pos) const
+{
+	if (!entries[box].isBox)
+		return box;
+	const Grid &grid = grids.constFind(page).value();
+
+	int column, row;
+	cellAt(grid, pos, &column, &row);
+
+	int best = box;
+	qreal bestDistance = 0;
+	for (int c = qMax(0, column - 2); c <= qMin(grid.columns - 1, column + 2); c++)
+		foreach (int index, grid.cells[row * grid.columns + c]) {
+			if (entries[index].parent != box)
+				continue;
+			const qreal distance = distanceTo(entries[index].rect(), pos);
+			if (best == box || distance < bestDistance) {
+				best = index;
+				bestDistance = distance;
+			}
+		}
+	return best;
+}
+
+QList<TeXSyncPoint> Index::syncToTeX(int page, const QPointF &pos) const
+{
+	QList<TeXSyncPoint> result;
+	const int hit = hitAt(page, pos);
+	if (hit < 0)
+		return result;
+
+	// the enclosing boxes are the fallbacks, e.g. if the node comes from a file excluded from syncing
+	QString lastFileName;
+	int lastLine = -1;
+	for (int index = refinedHit(page, hit, pos); index >= 0; index = entries[index].parent) {
+		const Entry &entry = entries[index];
+		const QString fileName = fileNames.value(entry.tag);
+		if (fileName.isEmpty() || entry.line <= 0 || (entry.line == lastLine && fileName == lastFileName))
+			continue;
+		result.append(TeXSyncPoint(fileName, entry.line, 0));
+		lastFileName = fileName;
+		lastLine = entry.line;
+	}
+	return result;
+}
+
+/*!
+ * \return the boxes of the source line, or of the next line with boxes if there are none.
+ * The filename of the result is empty if the source file is not known to the index.
+ */
+PDFSyncPoint Index::syncFromTeX(const TeXSyncPoint &src, const QString &pdfFilename) const
+{
+	PDFSyncPoint pdfPoint;
+	pdfPoint.page = -1;
+
+	const int tag = tags.value(QFileInfo(src.filename).canonicalFilePath(), -1);
+	if (tag < 0)
+		return pdfPoint;
+	pdfPoint.filename = pdfFilename;
 
+	const QMap<int, QVector<int> > fileLines = lines.value(tag);
+	if (fileLines.isEmpty())
+		return pdfPoint;
+	QMap<int, QVector<int> >::const_iterator it = fileLines.lowerBound(src.line);
+	if (it == fileLines.constEnd())
+		--it;
+
+	foreach (int index, it.value())
+		if (pdfPoint.page < 0 || entries[index].page < pdfPoint.page)
+			pdfPoint.page = entries[index].page;
+	foreach (int index, it.value()) {
+		const QRectF rect = entries[index].rect();
+		if (entries[index].page == pdfPoint.page && !pdfPoint.rects.contains(rect))
+			pdfPoint.rects.append(rect);
+	}
+	return pdfPoint;
+}
+
+
+Scanner::Scanner(QObject *parent) : QObject(parent), scanner(nullptr), generation(0), loading(false)
+{
+	loadWatcher = new QFutureWatcher<QSharedPointer<LoadResult> >(this);
+	connect(loadWatcher, SIGNAL(finished()), this, SLOT(backgroundLoadFinished()));
 }
 
 Scanner::~Scanner()
@@ -45,8 +340,10 @@ Scanner::~Scanner()
 	clear();
 }
 
-Scanner::Scanner(const QString &filename, QObject *parent) : QObject(parent), scanner(nullptr)
+Scanner::Scanner(const QString &filename, QObject *parent) : QObject(parent), scanner(nullptr), generation(0), loading(false)
 {
+	loadWatcher = new QFutureWatcher<QSharedPointer<LoadResult> >(this);
+	connect(loadWatcher, SIGNAL(finished()), this, SLOT(backgroundLoadFinished()));
 	load(filename);
 }
 
@@ -57,12 +354,45 @@ bool Scanner::load(const QString &filename)
     return scanner != nullptr;
 }
 
+/*!
+ * Parses the synctex file of \a filename and builds the Index on a worker thread.
+ * The scanner is invalid until loaded() is emitted, a running load is discarded by clear() or another load.
+ */
+void Scanner::loadInBackground(const QString &filename)
+{
+	clear();
+	loading = true;
+	const int loadGeneration = generation;
+	loadWatcher->setFuture(QtConcurrent::run([filename, loadGeneration]() {
+		QSharedPointer<LoadResult> result(new LoadResult);
+		result->generation = loadGeneration;
+		result->scanner = synctex_scanner_new_with_output_file(QFile::encodeName(filename).data(), nullptr, 1);
+		result->index.build(result->scanner, filename);
+		return result;
+	}));
+}
+
+void Scanner::backgroundLoadFinished()
+{
+	QSharedPointer<LoadResult> result = loadWatcher->result();
+	if (!result || result->generation != generation)
+		return;  // superseded
+	loading = false;
+	scanner = result->scanner;
+	result->scanner = nullptr;
+	qSwap(index, result->index);
+	emit loaded(scanner != nullptr);
+}
+
 void Scanner::clear()
 {
+	generation++;
+	loading = false;
 	if (scanner) {
 		synctex_scanner_free(scanner);
 	}
     scanner = nullptr;
+	index.clear();
 }
 
 QString Scanner::synctexFilename() const
@@ -72,22 +402,9 @@ QString Scanner::synctexFilename() const
 
 QFileInfo Scanner::getNameFileInfo(const QDir &curDir, const Node &node, const char **rawName) const
 {
-	QFileInfo fileinfo;
-
 	const char *synctex_name = synctex_scanner_get_name(scanner, synctex_node_tag(node.node));
 	if (rawName) *rawName = synctex_name;
-	if (!synctex_name) return QFileInfo();
-
-	fileinfo = QFileInfo(curDir, QFile::decodeName(synctex_name)); //old synctex
-	if (fileinfo.exists()) return fileinfo;
-
-	fileinfo = QFileInfo(curDir, QString::fromUtf8(synctex_name)); //new synctex
-	if (fileinfo.exists()) return fileinfo;
-
-	fileinfo = QFileInfo(curDir, QString::fromLatin1(synctex_name)); //for safety (not used afaik)
-	if (fileinfo.exists()) return fileinfo;
-
-	return QFileInfo();
+	return fileInfoForName(curDir, synctex_name);
 }
 
 NodeIterator Scanner::displayQuery(const char *name, int line, int column, int page_hint) const
@@ -109,6 +426,12 @@ Node Scanner::inputNode() const
 //virtual
 PDFSyncPoint Scanner::syncFromTeX(const TeXSyncPoint &src, const QString &pdfFilename) const
 {
+	if (!index.isEmpty()) {
+		PDFSyncPoint pdfPoint = index.syncFromTeX(src, pdfFilename);
+		if (!pdfPoint.filename.isEmpty())
+			return pdfPoint;
+	}
+
 	PDFSyncPoint pdfPoint;
 	pdfPoint.page = -1;
 
@@ -145,6 +468,24 @@ PDFSyncPoint Scanner::syncFromTeX(const TeXSyncPoint &src, const QString &pdfFil
 	return pdfPoint;
 }
 
+/*!
+ * \return the source locations at \a pos on the 1-based \a page, best match first
+ */
+QList<TeXSyncPoint> Scanner::syncToTeX(int page, const QPointF &pos, const QString &pdfFilename) const
+{
+	if (!index.isEmpty())
+		return index.syncToTeX(page, pos);
+
+	QList<TeXSyncPoint> result;
+	QDir curDir(QFileInfo(pdfFilename).canonicalPath());
+	NodeIterator iter(synctex_iterator_new_edit(scanner, page, static_cast<float>(pos.x()), static_cast<float>(pos.y())));
+	while (iter.hasNext()) {
+		Node node = iter.next();
+		result.append(TeXSyncPoint(getNameFileInfo(curDir, node).canonicalFilePath(), node.line(), 0));
+	}
+	return result;
+}
+
 
 void debugNodeTree(QSynctex::Node node, int level)
 {
@@ -23,6 +23,12 @@
 #include <QFileInfo>
 #include <QRectF>
 #include <QDebug>
+#include <QDir>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+#include <QVector>
 
 #include <synctex_parser.h>
 #include <synctex_parser_advanced.h>
@@ -120,6 +126,46 @@ private:
 	synctex_iterator_p iter;
 };
 
+///! Boxes of a parsed synctex file, indexed by their position on the page and by their source line
+class Index {
+
+public:
+	void build(synctex_scanner_p scanner, const QString &pdfFilename);
+	void clear();
+	bool isEmpty() const { return entries.isEmpty(); }
+
+	QList<TeXSyncPoint> syncToTeX(int page, const QPointF &pos) const;  // best match first
+	PDFSyncPoint syncFromTeX(const TeXSyncPoint &src, const QString &pdfFilename) const;
+
+private:
+	struct Entry {
+		float x, y, width, height;
+		int tag;
+		int line;
+		int page;
+		int parent;  // enclosing box, -1 for boxes directly on the sheet
+		bool isBox;
+
+		QRectF rect() const { return QRectF(x, y, width, height); }
+	};
+	struct Grid {
+		QRectF bounds;
+		int columns;
+		int rows;
+		QVector<QVector<int> > cells;
+	};
+
+	int cellAt(const Grid &grid, const QPointF &pos, int *column = nullptr, int *row = nullptr) const;
+	int hitAt(int page, const QPointF &pos) const;
+	int refinedHit(int page, int box, const QPointF &pos) const;
+
+	QVector<Entry> entries;
+	QHash<int, Grid> grids;  // by 1-based page
+	QHash<int, QMap<int, QVector<int> > > lines;  // tag -> line -> entries to highlight
+	QHash<QString, int> tags;  // canonical file name -> tag
+	QHash<int, QString> fileNames;
+};
+
 class Scanner : public QObject
 {
 	Q_OBJECT
@@ -129,8 +175,10 @@ public:
 	Scanner(const QString &filename, QObject *parent = Q_NULLPTR);
 
 	bool load(const QString &filename);
+	void loadInBackground(const QString &filename);
 	void clear();
 	bool isValid() const { return scanner != NULL; }
+	bool isLoading() const { return loading; }
 
 	QString synctexFilename() const;
 	QFileInfo getNameFileInfo(const QDir &curDir, const Node &node, const char **rawName = 0) const;
@@ -148,13 +196,30 @@ public:
 	QString fileName(int tag) { return QFile::decodeName(synctex_scanner_get_name(scanner, tag)); }
 
 	PDFSyncPoint syncFromTeX(const TeXSyncPoint &src, const QString &pdfFilename) const;
+	QList<TeXSyncPoint> syncToTeX(int page, const QPointF &pos, const QString &pdfFilename) const;
 
 signals:
+	void loaded(bool success);
 
 public slots:
 
+private slots:
+	void backgroundLoadFinished();
+
 private:
+	struct LoadResult {
+		LoadResult() : scanner(nullptr), generation(0) {}
+		~LoadResult() { if (scanner) synctex_scanner_free(scanner); }
+		synctex_scanner_p scanner;
+		Index index;
+		int generation;
+	};
+
 	synctex_scanner_p scanner;
+	Index index;
+	QFutureWatcher<QSharedPointer<LoadResult> > *loadWatcher;
+	int generation;
+	bool loading;
 };
 
 void debugNodeTree(QSynctex::Node node, int level=0);
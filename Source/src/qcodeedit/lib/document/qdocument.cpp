@@ -97,6 +97,7 @@ inline int ncolsToNextTabStop(int column,int tabstop){
 
 #include "qdocument_p.h"
 #include "qdocumentcommand.h"
+#include "qdocumentjournal.h"
 
 #include "qformat.h"
 #include "qformatscheme.h"
@@ -113,6 +114,7 @@ inline int ncolsToNextTabStop(int column,int tabstop){
 #include <QTextLayout>
 #include <QApplication>
 #include <QVarLengthArray>
+#include <QMutex>
 #include <QMessageBox>
 
 struct RenderRange
@@ -533,18 +535,19 @@ void QDocument::clearUndo()
  */
 QString QDocument::debugUndoStack(int limit) const{
 	if (!m_impl) return QString();
-	const QUndoStack& commands = m_impl->m_commands;
+	const QDocumentUndoStack& commands = m_impl->m_commands;
 
 	QStringList result;
 
 	result << QString("Current: %1/%2").arg(commands.index()).arg(commands.count());
+	result << QString("History memory: %1 kB (%2 kB spilled to disk)").arg(commands.memoryUsage() / 1024).arg(commands.spilledBytes() / 1024);
 
 	int from = commands.index() - limit, to = commands.index() + limit;
 	if (from < 0) from = 0;
 	if (to >= commands.count()) to = commands.count() - 1;
 
 	for (int i=from; i<=to; i++)
-		result << QString("%1: ").arg(i) << dynamic_cast<const QDocumentCommand*>(commands.command(i))->debugRepresentation();
+		result << QString("%1: ").arg(i) << commands.command(i)->debugRepresentation();
 
 	QString res = result.join("\n");
 
@@ -679,7 +682,7 @@ void QDocument::setText(const QString& s, bool allowUndo)
 	m_impl->discardAutoUpdatedCursors();
 
 	m_impl->m_lines.clear();
-	m_impl->m_marks.clear();
+	m_impl->clearMarks();
 	m_impl->m_status.clear();
 	m_impl->m_hidden.clear();
 	m_impl->m_wrapped.clear();
@@ -739,6 +742,9 @@ void QDocument::setText(const QString& s, bool allowUndo)
 
 	m_impl->m_lastModified = QDateTime::currentDateTime();
 
+	if ( m_impl->m_journal )
+		m_impl->m_journal->reset();
+
 	if ( lineEnding() == Conservative )
 		setLineEndingDirect(Conservative);
 
@@ -750,10 +756,7 @@ void QDocument::setText(const QString& s, bool allowUndo)
 	m_impl->emitContentsChange(0, m_impl->m_lines.count());
 }
 
-QTextCodec* guessEncoding(const QByteArray& data){
-	QTextCodec* guess = nullptr;
-	int sure = 1;
-	guess = Encoding::guessEncodingBasic(data, &sure);
+static QTextCodec* guessEncoding(const QByteArray& data, QTextCodec* guess, int sure){
     if (!guessEncodingCallbacks.empty()){
 		foreach (const GuessEncodingCallback& callback, guessEncodingCallbacks)
 			callback(data, guess, sure);
@@ -762,10 +765,27 @@ QTextCodec* guessEncoding(const QByteArray& data){
 	else return QTextCodec::codecForName("UTF-8"); //default
 }
 
+/*
+	true if '\n' and '\r' bytes are always line breaks in the encoding, i.e.
+	the lines can be found and decoded separately without decoding the whole
+	text first
+*/
+static bool splitsByBytes(QTextCodec* codec){
+	const int mib = codec->mibEnum();
+	return mib == Encoding::MIB_UTF8
+		|| (mib >= 4 && mib <= 12) // ISO 8859-1 to -9
+		|| (mib >= 109 && mib <= 112) // ISO 8859-13 to -16
+		|| (mib >= 2250 && mib <= 2258); // windows-1250 to -1258
+}
+
 /*!
  * \brief load text from file using codec
  * \param file
  * \param codec
+ *
+ * The file is memory mapped. A single pass over its bytes guesses the
+ * encoding and finds the line breaks, for the common encodings every line
+ * is then decoded straight into its line handle.
  */
 void QDocument::load(const QString& file, QTextCodec* codec){
 	QFile f(file);
@@ -779,43 +799,77 @@ void QDocument::load(const QString& file, QTextCodec* codec){
 	}
 
 	const qint64 size = f.size();
-	//const int size = m_lastFileState.size = f.size();
 
 	bool slow = (size > 30 * 1024);
 	if (slow) emit slowOperationStarted();
 
-    if ( size < 500000 )
+	const uchar *mapped = size > 0 ? f.map(0, size) : nullptr;
+	const QByteArray data = mapped ? QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), int(size)) : f.readAll();
+
+	QVector<int> breaks;
+	int sure = 1;
+	QTextCodec *guess = Encoding::guessEncodingBasic(data, &sure, &breaks);
+	if (codec == nullptr)
+		codec = guessEncoding(data, guess, sure);
+
+	startChunkLoading();
+
+	if ( splitsByBytes(codec) )
 	{
-		// instant load for files smaller than 500kb
-		QByteArray d = f.readAll();
-		if (codec == nullptr)
-			codec=guessEncoding(d);
+		const char *str = data.constData();
+		const bool utf8 = codec->mibEnum() == Encoding::MIB_UTF8;
+		const bool latin1 = codec->mibEnum() == Encoding::MIB_LATIN1;
 
-		setText(codec->toUnicode(d), false);
-	} else {
-		// load by chunks of 100kb otherwise to avoid huge peaks of memory usage
-		// and driving mad the disk drivers
+		m_impl->m_lines.reserve(breaks.count() + 1);
+
+		int last = 0;
+		for ( int i = 0; i < breaks.count(); ++i )
+		{
+			const int idx = breaks.at(i);
 
-		int count = 0;
-		QByteArray ba;
+			if ( str[idx] == '\r' && i + 1 < breaks.count() && breaks.at(i + 1) == idx + 1 && str[idx + 1] == '\n' )
+			{
+				++(m_impl->_dos);
+				++i;
+			} else if ( str[idx] == '\r' ) {
+				++(m_impl->_mac);
+			} else {
+				++(m_impl->_nix);
+			}
 
-        startChunkLoading();
+			// the codec skips a byte order mark at the start of the file
+			QString text;
+			if ( last == 0 )
+				text = codec->toUnicode(str, idx);
+			else if ( utf8 )
+				text = QString::fromUtf8(str + last, idx - last);
+			else if ( latin1 )
+				text = QString::fromLatin1(str + last, idx - last);
+			else
+				text = codec->toUnicode(str + last, idx - last);
 
-		ba = f.read(100000);
-		if (codec == nullptr)
-			codec=guessEncoding(ba);
+			m_impl->m_lines << new QDocumentLineHandle(text, this);
+			last = breaks.at(i) + 1;
+		}
 
+		m_leftOver = codec->toUnicode(str + last, data.size() - last);
+	} else {
+		// load by chunks of 100kb to avoid huge peaks of memory usage
 		QTextDecoder *dec = codec->makeDecoder();
-		do
-		{
-			count += ba.count();
-			//m_lastFileState.checksum ^= qChecksum(ba.constData(), ba.size());
-			addChunk(dec->toUnicode(ba));
-			ba = f.read(100000);
-		} while ( (count < size) && ba.count() );
+		for ( int i = 0; i < data.size(); i += 100000 )
+			addChunk(dec->toUnicode(data.constData() + i, qMin(100000, data.size() - i)));
 		delete dec;
-		stopChunkLoading();
 	}
+
+	stopChunkLoading();
+
+	// highlighting a large document is triggered by the caller
+	if ( size < 500000 )
+		m_impl->emitContentsChange(0, m_impl->m_lines.count());
+
+	if (mapped)
+		f.unmap(const_cast<uchar*>(mapped));
+
 	if (slow) emit slowOperationEnded();
 
 	setCodecDirect(codec);
@@ -860,7 +914,7 @@ void QDocument::startChunkLoading()
 	m_impl->discardAutoUpdatedCursors();
 
 	m_impl->m_lines.clear();
-	m_impl->m_marks.clear();
+	m_impl->clearMarks();
 	m_impl->m_status.clear();
 	m_impl->m_hidden.clear();
 	m_impl->m_wrapped.clear();
@@ -905,6 +959,9 @@ void QDocument::stopChunkLoading()
 
 	m_impl->m_lastModified = QDateTime::currentDateTime();
 
+	if ( m_impl->m_journal )
+		m_impl->m_journal->reset();
+
 	if ( lineEnding() == Conservative )
 		setLineEndingDirect(Conservative);
 
@@ -1039,6 +1096,43 @@ void QDocument::setFileName_DONOTCALLTHIS(const QString& fileName){
 	m_impl->m_fileInfo = QFileInfo(fileName);
 	m_impl->m_fileName = m_impl->m_fileInfo.absoluteFilePath();
 	m_impl->m_name = m_impl->m_fileInfo.fileName();
+	if (m_impl->m_journal) m_impl->m_journal->setFileName(m_impl->m_fileName);
+}
+
+/*!
+	\brief Start recording all edits in a crash recovery journal
+
+	The journal is written to QDocumentJournal::journalDirectory() and removed
+	when the document is closed. It requires the document to have a file name.
+
+	\see QDocumentJournal
+*/
+void QDocument::startJournal()
+{
+	if ( !m_impl || m_impl->m_journal || m_impl->m_fileName.isEmpty() )
+		return;
+
+	m_impl->m_journal = new QDocumentJournal(this, m_impl->m_fileName);
+}
+
+/*!
+	\brief Stop recording edits and remove the journal file
+*/
+void QDocument::stopJournal()
+{
+	if ( !m_impl )
+		return;
+
+	delete m_impl->m_journal;
+	m_impl->m_journal = nullptr;
+}
+
+/*!
+	\return whether edits are recorded in a crash recovery journal
+*/
+bool QDocument::hasJournal() const
+{
+	return m_impl && m_impl->m_journal;
 }
 
 /*!
@@ -2138,6 +2232,9 @@ void QDocument::setClean()
 			it->second = it->first;
 			++it;
 		}
+
+		if ( m_impl->m_journal )
+			m_impl->m_journal->reset();
 	}
 }
 
@@ -2216,6 +2313,18 @@ int QDocument::findPreviousMark(int id, int from, int until) const
 	return m_impl ? m_impl->findPreviousMark(id, from, until) : -1;
 }
 
+/*!
+	\brief Find all marks of a given type within a range of lines
+	\return the sorted numbers of the lines in [first, last] which carry a mark of type \a id, or any mark if \a id is -1
+
+	\a first and \a last can be negatives, in which case they indicate
+	positions from the end of the document, as in findNextMark().
+*/
+QVector<int> QDocument::linesWithMark(int id, int first, int last) const
+{
+	return m_impl ? m_impl->linesWithMark(id, first, last) : QVector<int>();
+}
+
 void QDocument::removeMarks(int id){
 	if (m_impl) m_impl->removeMarks(id);
 }
@@ -2271,6 +2380,173 @@ void QDocument::setOverwriteMode(bool overwrite)
 	\brief Private implementation of a document line
 */
 
+/*
+	Line handles are carved out of chunks of equally sized slots rather than
+	being allocated one by one, so that loading or closing a large document
+	costs one heap allocation per chunk instead of one per line.
+
+	Handles are reference counted and regularly outlive the document that
+	created them (undo history, syntax checker, line snapshots), which is why
+	the slab is shared by all documents instead of being owned by one.
+	Lines are released from worker threads too, hence the mutex.
+*/
+namespace {
+
+class QDocumentLineHandleSlab
+{
+	public:
+		static QDocumentLineHandleSlab* instance()
+		{
+			// intentionally never destroyed: handles may still be released during shutdown
+			static QDocumentLineHandleSlab *slab = new QDocumentLineHandleSlab;
+			return slab;
+		}
+
+		void* allocate()
+		{
+			QMutexLocker locker(&m_mutex);
+
+			Chunk *c = m_partial;
+
+			if ( !c )
+			{
+				if ( m_spare )
+				{
+					c = m_spare;
+					m_spare = nullptr;
+				} else {
+					c = static_cast<Chunk*>(::operator new(sizeof(Chunk)));
+					c->free = nullptr;
+					c->used = 0;
+					c->fresh = 0;
+				}
+
+				link(c);
+			}
+
+			Slot *s = c->free;
+
+			if ( s )
+				c->free = s->next;
+			else
+				s = &c->slots[c->fresh++];
+
+			s->chunk = c;
+
+			if ( ++c->used == ChunkSize )
+				unlink(c);
+
+			return s->data;
+		}
+
+		void release(void *p)
+		{
+			Slot *s = reinterpret_cast<Slot*>(static_cast<char*>(p) - offsetof(Slot, data));
+			Chunk *c = s->chunk;
+
+			QMutexLocker locker(&m_mutex);
+
+			if ( c->used == ChunkSize )
+				link(c);
+
+			s->next = c->free;
+			c->free = s;
+
+			if ( --c->used )
+				return;
+
+			// keep one empty chunk around so that a line added right after
+			// the last one of a chunk was removed does not allocate again
+			unlink(c);
+
+			if ( m_spare )
+			{
+				::operator delete(c);
+			} else {
+				c->free = nullptr;
+				c->fresh = 0;
+				m_spare = c;
+			}
+		}
+
+	private:
+		enum { ChunkSize = 256 };
+
+		struct Chunk;
+
+		struct Slot
+		{
+			Chunk *chunk;
+
+			union
+			{
+				Slot *next; // free list, only valid while the slot is unused
+				alignas(QDocumentLineHandle) char data[sizeof(QDocumentLineHandle)];
+			};
+		};
+
+		// a chunk is linked into m_partial as long as it has unused slots
+		struct Chunk
+		{
+			Chunk *prev;
+			Chunk *next;
+
+			Slot *free; // slots given back
+			int used;
+			int fresh; // slots never handed out, starting at slots[fresh]
+
+			Slot slots[ChunkSize];
+		};
+
+		void link(Chunk *c)
+		{
+			c->prev = nullptr;
+			c->next = m_partial;
+
+			if ( m_partial )
+				m_partial->prev = c;
+
+			m_partial = c;
+		}
+
+		void unlink(Chunk *c)
+		{
+			if ( c->prev )
+				c->prev->next = c->next;
+			else
+				m_partial = c->next;
+
+			if ( c->next )
+				c->next->prev = c->prev;
+		}
+
+		QMutex m_mutex;
+		Chunk *m_partial = nullptr;
+		Chunk *m_spare = nullptr;
+};
+
+}
+
+void* QDocumentLineHandle::operator new(size_t size)
+{
+	if ( size != sizeof(QDocumentLineHandle) )
+		return ::operator new(size);
+
+	return QDocumentLineHandleSlab::instance()->allocate();
+}
+
+void QDocumentLineHandle::operator delete(void *p, size_t size)
+{
+	if ( !p )
+		return;
+
+	if ( size != sizeof(QDocumentLineHandle) )
+		::operator delete(p);
+	else
+		QDocumentLineHandleSlab::instance()->release(p);
+}
+
+
 /*!
 	\
 */
@@ -2310,6 +2586,59 @@ QDocumentLineHandle::~QDocumentLineHandle()
 		m_doc->impl()->emitLineDeleted(this);
 }
 
+/*!
+	\return an estimate of the memory held by the line (in bytes)
+
+	Cookies are only counted, not measured.
+*/
+int QDocumentLineHandle::memoryUsage() const
+{
+	int usage = sizeof(QDocumentLineHandle) + m_text.capacity() * sizeof(QChar);
+
+	usage += m_cache.capacity() * sizeof(int);
+	usage += m_frontiers.capacity() * sizeof(QPair<int, qreal>);
+	usage += m_formats.capacity() * sizeof(int);
+	usage += m_parens.capacity() * sizeof(QParenthesis);
+	usage += m_overlays.count() * sizeof(QFormatRange);
+	usage += mCookies.count() * 64;
+
+	if ( m_layout )
+		usage += sizeof(QTextLayout) + m_text.length() * 16;
+
+	return usage;
+}
+
+/*!
+	\brief Release all data of a line that is recomputed when it is (re)inserted into a document
+
+	This is used for lines which have been erased and are only kept by the
+	undo history. Cookies which are not recomputed (e.g. pictures, diffs)
+	are kept.
+*/
+void QDocumentLineHandle::releaseCaches()
+{
+	lockForWrite();
+
+	delete m_layout;
+	m_layout = nullptr;
+	setFlag(QDocumentLine::LayoutedByQTextLayout, false);
+	setFlag(QDocumentLine::LayoutDirty, true);
+
+	m_cache = QVector<int>();
+	m_frontiers = QVector< QPair<int, qreal> >();
+	m_formats = QVector<int>();
+	m_parens = QVector<QParenthesis>();
+	m_overlays.clear();
+
+	mCookies.remove(QDocumentLine::LEXER_COOKIE);
+	mCookies.remove(QDocumentLine::LEXER_RAW_COOKIE);
+	mCookies.remove(QDocumentLine::TEXT_ANALYSIS_COOKIE);
+
+	m_text.squeeze();
+
+	unlock();
+}
+
 int QDocumentLineHandle::count() const
 {
 	return m_text.count();
@@ -6564,14 +6893,18 @@ QDocumentPrivate::QDocumentPrivate(QDocument *d)
 	m_lineCacheXOffset(0), m_lineCacheWidth(0),
 	m_instanceCachesLogicalDpiY(-1),
 	m_forceLineWrapCalculation(false),
-	m_overwrite(false)
+	m_overwrite(false),
+	m_journal(nullptr)
 {
 	m_documents << this;
 }
 
 QDocumentPrivate::~QDocumentPrivate()
 {
-	m_marks.clear();
+	delete m_journal;
+	m_journal = nullptr;
+
+	clearMarks();
 	m_largest.clear();
 
 	m_deleting = true;
@@ -6591,6 +6924,129 @@ QDocumentPrivate::~QDocumentPrivate()
 	m_documents.removeAll(this);
 }
 
+/*!
+	\return the sorted numbers of the lines which carry a mark of type \a id, or any mark if \a id is -1
+
+	The index is built by a scan of the document on first use. It is shifted
+	when lines are inserted or removed and updated for the single line whose
+	marks change.
+*/
+const QVector<int>& QDocumentPrivate::markIndex(int id)
+{
+	QHash<int, QVector<int> >::iterator it = m_markIndex.find(id);
+
+	if ( it == m_markIndex.end() )
+	{
+		QVector<int> lines;
+
+		if ( !m_marks.isEmpty() )
+		{
+			QHash<QDocumentLineHandle*, QList<int> >::const_iterator e = m_marks.constEnd();
+
+			for ( int i = 0; i < m_lines.count(); ++i )
+			{
+				QHash<QDocumentLineHandle*, QList<int> >::const_iterator mit = m_marks.constFind(m_lines.at(i));
+
+				if ( mit != e && !mit->isEmpty() && (id == -1 || mit->contains(id)) )
+					lines << i;
+			}
+		}
+
+		it = m_markIndex.insert(id, lines);
+	}
+
+	return *it;
+}
+
+/*!
+	\brief Update the mark index after \a count lines were inserted at \a line (or removed if \a count is negative)
+*/
+void QDocumentPrivate::shiftMarkIndex(int line, int count)
+{
+	for ( QHash<int, QVector<int> >::iterator it = m_markIndex.begin(); it != m_markIndex.end(); ++it )
+	{
+		QVector<int>& lines = *it;
+		QVector<int>::iterator i = std::lower_bound(lines.begin(), lines.end(), line);
+
+		if ( count < 0 )
+			i = lines.erase(i, std::lower_bound(i, lines.end(), line - count));
+
+		for ( ; i != lines.end(); ++i )
+			*i += count;
+	}
+}
+
+/*!
+	\brief Add \a line to (or remove it from) the index of mark type \a id, if that index was built
+*/
+void QDocumentPrivate::setMarkIndexed(int id, int line, bool marked)
+{
+	QHash<int, QVector<int> >::iterator it = m_markIndex.find(id);
+
+	if ( it == m_markIndex.end() || line < 0 )
+		return;
+
+	QVector<int>& lines = *it;
+	QVector<int>::iterator i = std::lower_bound(lines.begin(), lines.end(), line);
+	bool indexed = i != lines.end() && *i == line;
+
+	if ( marked && !indexed )
+		lines.insert(i, line);
+	else if ( !marked && indexed )
+		lines.erase(i);
+}
+
+/*!
+	\brief Update the mark index after the marks of type \a mid on \a h changed
+*/
+void QDocumentPrivate::updateMarkIndex(QDocumentLineHandle *h, int mid)
+{
+	if ( !m_markIndex.contains(mid) && !m_markIndex.contains(-1) )
+		return;
+
+	// lines which are not part of the document (e.g. removed ones kept by the undo stack) are not indexed
+	int line = indexOf(h);
+
+	if ( line < 0 )
+		return;
+
+	QHash<QDocumentLineHandle*, QList<int> >::const_iterator it = m_marks.constFind(h);
+	bool marked = it != m_marks.constEnd() && !it->isEmpty();
+
+	setMarkIndexed(mid, line, marked && it->contains(mid));
+	setMarkIndexed(-1, line, marked);
+}
+
+/*!
+	\brief Keep m_maxMarksPerLine up to date when the number of marks on a line changes from \a before to \a after
+*/
+void QDocumentPrivate::updateMarksPerLine(int before, int after)
+{
+	if ( before > 0 )
+		--m_marksPerLineCount[before];
+
+	if ( after > 0 )
+	{
+		if ( after >= m_marksPerLineCount.count() )
+			m_marksPerLineCount.resize(after + 1);
+
+		++m_marksPerLineCount[after];
+	}
+
+	m_maxMarksPerLine = qMax(after, m_maxMarksPerLine);
+
+	while ( m_maxMarksPerLine > 0 && !m_marksPerLineCount.at(m_maxMarksPerLine) )
+		--m_maxMarksPerLine;
+}
+
+void QDocumentPrivate::clearMarks()
+{
+	m_marks.clear();
+	m_marksPerLineCount.clear();
+	m_markIndex.clear();
+	m_maxMarksPerLine = 0;
+}
+
 int QDocumentPrivate::findNextMark(int id, int from, int until)
 {
 	if ( from < 0 ) {
@@ -6599,8 +7055,6 @@ int QDocumentPrivate::findNextMark(int id, int from, int until)
 	} else if (from >= m_lines.count())
 	from=m_lines.count()-1;
 
-	QHash<QDocumentLineHandle*, QList<int> >::const_iterator e = m_marks.constEnd();
-
 	int max = until;
 
 	if ( max < 0 )
@@ -6608,30 +7062,15 @@ int QDocumentPrivate::findNextMark(int id, int from, int until)
 	else if ( max < from )
 		max = m_lines.count() - 1;
 
-	for ( int i = from; i <= max; ++i )
-	{
-		QDocumentLineHandle *h = m_lines.at(i);
-
-		QHash<QDocumentLineHandle*, QList<int> >::const_iterator it = m_marks.constFind(h);
-
-		if ( it != e && !it->isEmpty() && (id==-1 || it->contains(id))  )
-			return i;
-
-	}
+	const QVector<int>& lines = markIndex(id);
 
-	if ( until > 0 && until < from )
-	{
-		for ( int i = 0; i <= until; ++i )
-		{
-			QDocumentLineHandle *h = m_lines.at(i);
+	QVector<int>::const_iterator it = std::lower_bound(lines.constBegin(), lines.constEnd(), from);
 
-			QHash<QDocumentLineHandle*, QList<int> >::const_iterator it = m_marks.constFind(h);
-
-			if ( it != e && !it->isEmpty() && (id==-1 || it->contains(id))  )
-				return i;
+	if ( it != lines.constEnd() && *it <= max )
+		return *it;
 
-		}
-	}
+	if ( until > 0 && until < from && !lines.isEmpty() && lines.first() <= until )
+		return lines.first();
 
 	return -1;
 }
@@ -6651,39 +7090,48 @@ int QDocumentPrivate::findPreviousMark(int id, int from, int until)
 		until = m_lines.count() - 1;
 	}
 
-	QHash<QDocumentLineHandle*, QList<int> >::const_iterator e = m_marks.constEnd();
-
 	int min = until;
 
 	if ( min > from )
 		min = 0;
 
-	for ( int i = from; i >= min; --i )
-	{
-		QDocumentLineHandle *h = m_lines.at(i);
+	const QVector<int>& lines = markIndex(id);
 
-		QHash<QDocumentLineHandle*, QList<int> >::const_iterator it = m_marks.constFind(h);
+	QVector<int>::const_iterator it = std::upper_bound(lines.constBegin(), lines.constEnd(), from);
 
-		if ( it != e && !it->isEmpty() && (id==-1 || it->contains(id)))
-			return i;
+	if ( it != lines.constBegin() && *(it - 1) >= min )
+		return *(it - 1);
 
-	}
+	if ( until > 0 && until > from && !lines.isEmpty() && lines.last() >= until )
+		return lines.last();
 
-	if ( until > 0 && until > from )
-	{
-		for ( int i = m_lines.count() - 1; i >= until; --i )
-		{
-			QDocumentLineHandle *h = m_lines.at(i);
+	return -1;
+}
 
-			QHash<QDocumentLineHandle*, QList<int> >::const_iterator it = m_marks.constFind(h);
+QVector<int> QDocumentPrivate::linesWithMark(int id, int first, int last)
+{
+	if ( first < 0 )
+		first = qMax(0, first + m_lines.count());
 
-			if ( it != e && !it->isEmpty() && (id==-1 || it->contains(id)))
-				return i;
+	if ( last < 0 )
+		last += m_lines.count();
 
-		}
-	}
+	QVector<int> result;
 
-	return -1;
+	if ( last < first )
+		return result;
+
+	const QVector<int>& lines = markIndex(id);
+
+	QVector<int>::const_iterator b = std::lower_bound(lines.constBegin(), lines.constEnd(), first),
+	                             e = std::upper_bound(b, lines.constEnd(), last);
+
+	result.reserve(e - b);
+
+	for ( ; b != e; ++b )
+		result << *b;
+
+	return result;
 }
 
 void QDocumentPrivate::removeMarks(int id){
@@ -6693,20 +7141,30 @@ void QDocumentPrivate::removeMarks(int id){
 	it = m_marks.begin(),
 	end = m_marks.end();
 	//change all silently
-	m_maxMarksPerLine = 0;
 	while (it!=end) {
+		int count = it->count();
 		int n = it->removeAll(id);
-		if (n) changed << it.key();
-		if ( it->isEmpty() ) it=m_marks.erase(it);
-		else {
-			if (it->count() > m_maxMarksPerLine) m_maxMarksPerLine = it->count();
-			++it;
+		if (n) {
+			changed << it.key();
+			updateMarksPerLine(count, count - n);
 		}
+		if ( it->isEmpty() ) it=m_marks.erase(it);
+		else ++it;
+	}
+
+	if (!changed.isEmpty()) {
+		QHash<int, QVector<int> >::iterator index = m_markIndex.find(id);
+		if (index != m_markIndex.end())
+			index->clear();
+		if (m_markIndex.contains(-1))
+			foreach (QDocumentLineHandle *h, changed)
+				if (!m_marks.contains(h))
+					setMarkIndexed(-1, indexOf(h), false);
 	}
 
 	//then notify
 	for (int i=0; i<changed.size();i++){
-	emitMarkChanged(changed[i], id, false);
+		emitMarkChanged(changed[i], id, false);
 		changed[i]->setFlag(QDocumentLine::LayoutDirty,true);
 	}
 }
@@ -7882,6 +8340,26 @@ void QDocumentPrivate::insertLines(int after, const QList<QDocumentLineHandle*>&
 		++i;
 	}
 
+	shiftMarkIndex(after, l.count());
+
+	// lines restored by undo can carry marks
+	if ( !m_marks.isEmpty() && !m_markIndex.isEmpty() )
+	{
+		for ( i = 0; i < l.count(); ++i )
+		{
+			QHash<QDocumentLineHandle*, QList<int> >::const_iterator mit = m_marks.constFind(l.at(i));
+
+			if ( mit == m_marks.constEnd() || mit->isEmpty() )
+				continue;
+
+			for ( QHash<int, QVector<int> >::iterator it = m_markIndex.begin(); it != m_markIndex.end(); ++it )
+				if ( it.key() == -1 || mit->contains(it.key()) )
+					setMarkIndexed(it.key(), after + i, true);
+		}
+	}
+
+	shiftDelayedUpdates(after, l.count());
+
 	emit m_doc->lineCountChanged(m_lines.count());
 }
 
@@ -7975,6 +8453,8 @@ void QDocumentPrivate::removeLines(int after, int n)
 		emit m_doc->lineRemoved(m_lines[i]);
 	}
 	m_lines.remove(after, n);
+	shiftMarkIndex(after, -n);
+	shiftDelayedUpdates(after, -n);
 
 	emit m_doc->lineCountChanged(m_lines.count());
 	setHeight();
@@ -8045,9 +8525,13 @@ QDocumentLineHandle* QDocumentPrivate::previous(const QDocumentLineHandle *l) co
 	return (idx > 0) ? m_lines.at(idx - 1) : nullptr;
 }
 
-void QDocumentPrivate::beginChangeBlock()
+/*!
+	\brief Start a macro, if \a delayedUpdates is set, undoing and redoing it is also a delayed update block
+*/
+void QDocumentPrivate::beginChangeBlock(bool delayedUpdates)
 {
 	QDocumentCommandBlock *b = new QDocumentCommandBlock(m_doc);
+	b->setDelayedUpdates(delayedUpdates);
 
 	m_macros.push(b);
 }
@@ -8076,8 +8560,39 @@ void QDocumentPrivate::endDelayedUpdateBlock(){
 	if (m_delayedUpdateBlocks <= 0){
 		QList<QPair<int,int> > c = m_delayedUpdates; //make a copy, emitContentsChange can call everything
 		m_delayedUpdates.clear();
-		for (int i=0;i<c.size();i++)
-			emitContentsChange(c[i].first,c[i].second);
+		std::sort(c.begin(), c.end());
+		//coalesce nearby changes (e.g. one per cursor of a column edit), so that listeners reparse them at once
+		const int maxGap = 64;
+		for (int i=0;i<c.size();){
+			int first = c[i].first, end = first + c[i].second;
+			for (++i; i<c.size() && c[i].first <= end + maxGap; i++)
+				end = qMax(end, c[i].first + c[i].second);
+			end = qMin(end, m_lines.count());
+			if (first < end)
+				emitContentsChange(first, end - first);
+		}
+	}
+}
+
+/*!
+	\brief Keep the changes pending in a delayed update block on their lines when \a count lines are inserted (or removed if negative) at \a line
+*/
+void QDocumentPrivate::shiftDelayedUpdates(int line, int count)
+{
+	for (int i=m_delayedUpdates.size()-1;i>=0;i--){
+		int first = m_delayedUpdates[i].first, end = first + m_delayedUpdates[i].second;
+		if (count > 0) {
+			if (first >= line) first += count;
+			if (end > line) end += count;
+		} else {
+			int removedEnd = line - count;
+			first = first >= removedEnd ? first + count : qMin(first, line);
+			end = end >= removedEnd ? end + count : qMin(end, line);
+		}
+		if (first < end)
+			m_delayedUpdates[i] = QPair<int,int>(first, end - first);
+		else
+			m_delayedUpdates.removeAt(i); //all its lines are gone, the removal is reported on its own
 	}
 }
 
@@ -8270,6 +8785,7 @@ QList<int> QDocumentPrivate::marks(QDocumentLineHandle *h) const
 void QDocumentPrivate::addMark(QDocumentLineHandle *h, int mid)
 {
 	QList<int>& l = m_marks[h];
+	int count = l.count();
 
 	if (l.empty()) l << mid;
 	else {
@@ -8283,7 +8799,8 @@ void QDocumentPrivate::addMark(QDocumentLineHandle *h, int mid)
 		if (i==l.size()) l << mid;
 	}
 
-	m_maxMarksPerLine = qMax(l.count(), m_maxMarksPerLine);
+	updateMarksPerLine(count, l.count());
+	updateMarkIndex(h, mid);
 
 	emitMarkChanged(h, mid, true);
 }
@@ -8311,19 +8828,10 @@ void QDocumentPrivate::removeMark(QDocumentLineHandle *h, int mid)
 	if ( it->isEmpty() )
 		m_marks.erase(it);
 
-	if ( n && (count == m_maxMarksPerLine) )
+	if ( n )
 	{
-		QHash<QDocumentLineHandle*, QList<int> >::const_iterator
-			rit = m_marks.constBegin(),
-			end = m_marks.constEnd();
-
-		m_maxMarksPerLine = 0;
-
-		while ( rit != end )
-		{
-			m_maxMarksPerLine = qMax(rit->count(), m_maxMarksPerLine);
-			++rit;
-		}
+		updateMarksPerLine(count, count - n);
+		updateMarkIndex(h, mid);
 	}
 
 	emitMarkChanged(h, mid, false);
@@ -8731,7 +9239,12 @@ void QDocumentPrivate::emitLineDeleted(QDocumentLineHandle *h)
 {
 	if ( !m_deleting )
 	{
-		m_marks.remove(h);
+		QHash<QDocumentLineHandle*, QList<int> >::iterator mit = m_marks.find(h);
+		if ( mit != m_marks.end() )
+		{
+			updateMarksPerLine(mit->count(), 0);
+			m_marks.erase(mit);
+		}
 		m_status.remove(h);
 
 		int idx = m_lines.indexOf(h);
@@ -8741,6 +9254,8 @@ void QDocumentPrivate::emitLineDeleted(QDocumentLineHandle *h)
 			//qDebug("removing line %i", idx);
 
 			m_lines.remove(idx);
+			shiftMarkIndex(idx, -1);
+			shiftDelayedUpdates(idx, -1);
 
 			if ( m_largest.count() && (m_largest.at(0).first == h) )
 			{
@@ -197,6 +197,10 @@ class QCE_EXPORT QDocument : public QObject
 		QString getName() const;
 		void setFileName_DONOTCALLTHIS(const QString& fileName);
 
+		void startJournal();
+		void stopJournal();
+		bool hasJournal() const;
+
 		LineEnding lineEnding() const;
 		LineEnding originalLineEnding() const;
 		Q_INVOKABLE QString lineEndingString() const;
@@ -242,6 +246,7 @@ class QCE_EXPORT QDocument : public QObject
 		int maxMarksPerLine() const;
 		int findNextMark(int id, int from = 0, int until = -1) const;
 		int findPreviousMark(int id, int from = -1, int until = 0) const;
+		QVector<int> linesWithMark(int id, int first = 0, int last = -1) const;
 		void removeMarks(int id);
         QList<int> marks(QDocumentLineHandle *dlh) const;
         void removeMark(QDocumentLineHandle *dlh, int mid);
@@ -281,8 +286,7 @@ class QCE_EXPORT QDocument : public QObject
 		Q_INVOKABLE void endMacro();
 		Q_INVOKABLE bool hasMacros();
 
-		//Defer contentChange-signals until the last call of endDelayedUpdateBlock() and then emit all of them.
-		//ATTENTION: This only works if the commands don't change the document line count or all changes occur top-to-bottom.
+		//Defer contentChange-signals until the last call of endDelayedUpdateBlock() and then emit them, nearby changes merged into one.
 		Q_INVOKABLE void beginDelayedUpdateBlock();
 		Q_INVOKABLE void endDelayedUpdateBlock();
 
@@ -26,6 +26,7 @@
 #include "qdocument.h"
 #include "qdocumentline.h"
 #include "qdocumentcursor.h"
+#include "qdocumentundostack.h"
 
 #include <QHash>
 #include <QFont>
@@ -43,6 +44,7 @@ class QDocumentBuffer;
 class QDocumentPrivate;
 class QDocumentCommand;
 class QDocumentCommandBlock;
+class QDocumentJournal;
 
 class QLanguageDefinition;
 
@@ -119,7 +121,7 @@ protected:
 		void updateInstanceCaches(const QPaintDevice *pd, QDocument::PaintContext &cxt);
 
 public:
-		void beginChangeBlock();
+		void beginChangeBlock(bool delayedUpdates = false);
 		void endChangeBlock();
 		bool hasChangeBlocks();
 		
@@ -141,7 +143,9 @@ public:
 		
 		int findNextMark(int id, int from = 0, int until = -1);
 		int findPreviousMark(int id, int from = -1, int until = 0);
+		QVector<int> linesWithMark(int id, int first, int last);
 		void removeMarks(int id);
+		void clearMarks();
 		
 		
 		int getNextGroupId();
@@ -238,7 +242,7 @@ public:
 		
 	private:
 		QDocument *m_doc;
-		QUndoStack m_commands;
+		QDocumentUndoStack m_commands;
 		QDocumentCursor *m_editCursor;
 		bool m_drawCursorBold;
 		
@@ -312,7 +316,16 @@ public:
 		static QList<QDocumentPrivate*> m_documents;
 		
 		int m_maxMarksPerLine;
+		QVector<int> m_marksPerLineCount; // number of lines with exactly i marks
 		QHash<QDocumentLineHandle*, QList<int> > m_marks;
+		QHash<int, QVector<int> > m_markIndex; // sorted line numbers of the lines with a mark of a given type (-1: any), built on demand
+
+		const QVector<int>& markIndex(int id);
+		void shiftMarkIndex(int line, int count);
+		void setMarkIndexed(int id, int line, bool marked);
+		void updateMarkIndex(QDocumentLineHandle *h, int mid);
+		void shiftDelayedUpdates(int line, int count);
+		void updateMarksPerLine(int before, int after);
 		QHash<QDocumentLineHandle*, QPair<int, int> > m_status;
 		
 		int _nix, _dos, _mac;
@@ -338,6 +351,8 @@ public:
 		bool m_forceLineWrapCalculation;
 
 		bool m_overwrite;
+
+		QDocumentJournal *m_journal;
 };
 
 #endif
@@ -21,6 +21,8 @@
 */
 
 #include "qdocument_p.h"
+#include "qdocumentjournal.h"
+#include "qdocumentundostack.h"
 
 #include "stdint.h"
 
@@ -51,6 +53,38 @@ QStringList QDocumentCommand::debugRepresentation() const {
 	return QStringList() << "UNKNOWN COMMAND";
 }
 
+/*!
+	\return an estimate of the memory held by the command (in bytes)
+*/
+qint64 QDocumentCommand::memoryUsage() const
+{
+	return sizeof(QDocumentCommand);
+}
+
+/*!
+	\brief Reduce the memory held by a command deep in the undo history
+
+	\param stack the owning stack, used to spill data to disk
+	\param spill whether data may be moved to disk
+
+	The default implementation does nothing.
+*/
+void QDocumentCommand::compact(QDocumentUndoStack */*stack*/, bool /*spill*/)
+{
+}
+
+/*!
+	\brief Read back the data moved to disk by compact(), called before the command is undone
+
+	\return false if the data could not be read back, the command must not be undone then
+
+	The default implementation does nothing.
+*/
+bool QDocumentCommand::restoreSpilled(QDocumentUndoStack */*stack*/)
+{
+	return true;
+}
+
 /*!
 	\brief dtor
 */
@@ -508,6 +542,25 @@ void QDocumentCommand::markUndone(QDocumentLineHandle *h)
 	}
 }
 
+/*!
+	\brief Reconstruct the text spanned by a command from its data
+
+	The handles of \a d must be part of the document, i.e. this is valid
+	after QDocumentInsertCommand::redo() and QDocumentEraseCommand::undo().
+*/
+static QString spannedText(const QDocumentCommand::TextCommandData& d)
+{
+	QString text = d.begin;
+
+	foreach ( QDocumentLineHandle *h, d.handles )
+		text += QLatin1Char('\n') + h->text();
+
+	if ( d.handles.count() )
+		text.chop(d.end.length());
+
+	return text;
+}
+
 ////////////////////////////
 
 /*!
@@ -636,6 +689,9 @@ void QDocumentInsertCommand::redo()
 	if (commandAffectsFolding)
 		m_doc->correctFolding(m_data.lineNumber, m_data.lineNumber+m_data.handles.count());
 
+	if ( m_doc->impl()->m_journal )
+		m_doc->impl()->m_journal->recordInsert(m_data.lineNumber, m_data.startOffset, spannedText(m_data));
+
 	//m_doc->impl()->emitContentsChanged();
 	m_first = false;
 }
@@ -673,6 +729,11 @@ void QDocumentInsertCommand::undo()
 
 	if (commandAffectsFolding)
 		m_doc->correctFolding(m_data.lineNumber, m_data.lineNumber+m_data.handles.count());
+
+	if ( m_doc->impl()->m_journal )
+		m_doc->impl()->m_journal->recordErase(m_data.lineNumber, m_data.startOffset,
+		                                      m_data.lineNumber + m_data.handles.count(),
+		                                      m_data.handles.count() ? m_data.endOffset : m_data.startOffset + m_data.begin.length());
 	//m_doc->impl()->emitContentsChanged();
 }
 
@@ -731,6 +792,22 @@ QDocumentEraseCommand::QDocumentEraseCommand(	int bl, int bo,
 
 	m_state = true;
     m_mergedLines=false;
+	m_spillOffset = 0;
+	m_spillSize = -1;
+}
+
+qint64 QDocumentInsertCommand::memoryUsage() const
+{
+	qint64 usage = sizeof(QDocumentInsertCommand) + (m_data.begin.capacity() + m_data.end.capacity()) * sizeof(QChar);
+
+	// the inserted lines belong to the command only while it is undone
+	if ( m_state )
+		usage += m_data.handles.count() * sizeof(QDocumentLineHandle*);
+	else
+		foreach ( const QDocumentLineHandle *h, m_data.handles )
+			usage += h->memoryUsage();
+
+	return usage;
 }
 
 QStringList QDocumentInsertCommand::debugRepresentation() const{
@@ -832,6 +909,11 @@ void QDocumentEraseCommand::redo()
 	if (commandAffectsFolding)
 		m_doc->correctFolding(m_data.lineNumber, m_data.lineNumber+m_data.handles.count(), foldStart);
 
+	if ( m_doc->impl()->m_journal )
+		m_doc->impl()->m_journal->recordErase(m_data.lineNumber, m_data.startOffset,
+		                                      m_data.lineNumber + m_data.handles.count(),
+		                                      m_data.handles.count() ? m_data.endOffset : m_data.startOffset + m_data.begin.length());
+
 	//m_doc->impl()->emitContentsChanged();
 	m_first = false;
 }
@@ -889,9 +971,103 @@ void QDocumentEraseCommand::undo()
 	if (commandAffectsFolding)
 		m_doc->correctFolding(m_data.lineNumber,m_data.lineNumber+m_data.handles.count());
 
+	if ( m_doc->impl()->m_journal )
+		m_doc->impl()->m_journal->recordInsert(m_data.lineNumber, m_data.startOffset, spannedText(m_data));
+
 	//m_doc->impl()->emitContentsChanged();
 }
 
+qint64 QDocumentEraseCommand::memoryUsage() const
+{
+	qint64 usage = sizeof(QDocumentEraseCommand) + (m_data.begin.capacity() + m_data.end.capacity()) * sizeof(QChar);
+
+	// the erased lines belong to the command while it is done
+	if ( m_state )
+		usage += m_data.handles.count() * sizeof(QDocumentLineHandle*);
+	else
+		foreach ( const QDocumentLineHandle *h, m_data.handles )
+			usage += h->memoryUsage();
+
+	return usage;
+}
+
+/*!
+	\brief Release the caches of the erased lines and optionally move their text to disk
+
+	The line handles themselves are kept, since other commands on the stack
+	may refer to them. Only lines that are referenced by this command alone
+	are touched, lines still held elsewhere (cursors, marks, the structure
+	of a latex document, ...) keep their text and caches.
+*/
+void QDocumentEraseCommand::compact(QDocumentUndoStack *stack, bool spill)
+{
+	if ( m_state || m_data.handles.isEmpty() )
+		return;
+
+	QList<QDocumentLineHandle*> owned;
+	foreach ( QDocumentLineHandle *h, m_data.handles )
+		if ( h->getRef() == 1 )
+			owned << h;
+
+	foreach ( QDocumentLineHandle *h, owned )
+		h->releaseCaches();
+
+	m_data.begin.squeeze();
+	m_data.end.squeeze();
+
+	if ( !spill || !stack || m_spillSize >= 0 || owned.isEmpty() )
+		return;
+
+	QStringList lines;
+	foreach ( QDocumentLineHandle *h, owned )
+		lines << h->text();
+
+	QByteArray packed = lines.join(QLatin1Char('\n')).toUtf8();
+	qint64 offset = stack->spill(packed);
+
+	if ( offset < 0 )
+		return;
+
+	m_spillOffset = offset;
+	m_spillSize = packed.size();
+	m_spilled = owned;
+
+	foreach ( QDocumentLineHandle *h, m_spilled )
+	{
+		h->lockForWriteText();
+		h->textBuffer() = QString();
+		h->unlock();
+	}
+}
+
+bool QDocumentEraseCommand::restoreSpilled(QDocumentUndoStack *stack)
+{
+	if ( m_spillSize < 0 )
+		return true;
+
+	QByteArray packed = stack ? stack->unspill(m_spillOffset, m_spillSize) : QByteArray();
+	QStringList lines = QString::fromUtf8(packed).split(QLatin1Char('\n'));
+
+	if ( packed.size() != m_spillSize || lines.count() != m_spilled.count() )
+	{
+		// leave the lines alone, putting back wrong text would corrupt the document
+		qWarning("QDocumentEraseCommand: spilled undo data could not be read back");
+		return false;
+	}
+
+	for ( int i = 0; i < m_spilled.count(); ++i )
+	{
+		QDocumentLineHandle *h = m_spilled.at(i);
+		h->lockForWriteText();
+		h->textBuffer() = lines.at(i);
+		h->unlock();
+	}
+
+	m_spilled.clear();
+	m_spillSize = -1;
+	return true;
+}
+
 QStringList QDocumentEraseCommand::debugRepresentation() const{
 	QStringList result;
 	result << QString("ERASE COMMAND: %1:%2 to %3:%4").arg(m_data.lineNumber).arg(m_data.startOffset).arg(m_data.lineNumber+m_data.handles.size()).arg(m_data.endOffset);
@@ -948,7 +1124,7 @@ void QDocumentReplaceCommand::undo()
 	\param d host document
 */
 QDocumentCommandBlock::QDocumentCommandBlock(QDocument *d)
- : QDocumentCommand(Custom, d), m_weakLocked(false)
+ : QDocumentCommand(Custom, d), m_weakLocked(false), m_delayedUpdates(false)
 {
 
 }
@@ -969,17 +1145,29 @@ void QDocumentCommandBlock::redo()
 		return;
 	}
 
+	if ( m_delayedUpdates )
+		m_doc->beginDelayedUpdateBlock();
+
 	for ( int i = 0; i < m_commands.count(); ++i )
 		m_commands.at(i)->redo();
 
+	if ( m_delayedUpdates )
+		m_doc->endDelayedUpdateBlock();
 }
 
 void QDocumentCommandBlock::undo()
 {
     if(m_commands.isEmpty()) return;
+
+	if ( m_delayedUpdates )
+		m_doc->beginDelayedUpdateBlock();
+
     for (int i = m_commands.count() - 1; i >= 0; --i )
 		m_commands.at(i)->undo();
 
+	if ( m_delayedUpdates )
+		m_doc->endDelayedUpdateBlock();
+
     QDocumentCursorHandle *c=m_commands.at(0)->getTargetCursor();
     m_doc->setProposedPosition(c);
 }
@@ -1004,6 +1192,25 @@ bool QDocumentCommandBlock::isWeakLocked() const
 	return m_weakLocked;
 }
 
+/*!
+	\brief Set whether undoing and redoing the block reports its content changes merged
+
+	This is set for edits applied at every cursor mirror, which were done
+	in a delayed update block, so that undoing them is reparsed once as well.
+*/
+void QDocumentCommandBlock::setDelayedUpdates(bool d)
+{
+	m_delayedUpdates = d;
+}
+
+/*!
+	\return whether undoing and redoing the block is a delayed update block
+*/
+bool QDocumentCommandBlock::hasDelayedUpdates() const
+{
+	return m_delayedUpdates;
+}
+
 /*!
 	\brief Add a command to the group
 
@@ -1026,6 +1233,31 @@ void QDocumentCommandBlock::removeCommand(QDocumentCommand *c)
 	m_commands.removeAll(c);
 }
 
+qint64 QDocumentCommandBlock::memoryUsage() const
+{
+	qint64 usage = sizeof(QDocumentCommandBlock) + m_commands.count() * sizeof(QDocumentCommand*);
+
+	foreach ( const QDocumentCommand *c, m_commands )
+		usage += c->memoryUsage();
+
+	return usage;
+}
+
+void QDocumentCommandBlock::compact(QDocumentUndoStack *stack, bool spill)
+{
+	foreach ( QDocumentCommand *c, m_commands )
+		c->compact(stack, spill);
+}
+
+bool QDocumentCommandBlock::restoreSpilled(QDocumentUndoStack *stack)
+{
+	foreach ( QDocumentCommand *c, m_commands )
+		if ( !c->restoreSpilled(stack) )
+			return false;
+
+	return true;
+}
+
 QStringList QDocumentCommandBlock::debugRepresentation() const{
 	QStringList result;
 	result << "BLOCK:";
@@ -32,6 +32,7 @@
 class QDocumentLine;
 class QDocumentLineHandle;
 class QDocumentCursorHandle;
+class QDocumentUndoStack;
 
 class QCE_EXPORT QDocumentCommand : public QUndoCommand
 {
@@ -75,6 +76,10 @@ class QCE_EXPORT QDocumentCommand : public QUndoCommand
 		void setUndoOffset(int off);	
 		
 		virtual QStringList debugRepresentation() const;
+
+		virtual qint64 memoryUsage() const;
+		virtual void compact(QDocumentUndoStack *stack, bool spill);
+		virtual bool restoreSpilled(QDocumentUndoStack *stack);
 	protected:
 		bool m_state, m_first;
 		QDocument *m_doc;
@@ -118,6 +123,8 @@ class QCE_EXPORT QDocumentInsertCommand : public QDocumentCommand
 		virtual void undo();
 		
 		virtual QStringList debugRepresentation() const;
+
+		virtual qint64 memoryUsage() const;
 	private:
 		TextCommandData m_data;
 };
@@ -138,9 +145,16 @@ class QCE_EXPORT QDocumentEraseCommand : public QDocumentCommand
 		virtual void undo();
 		
 		virtual QStringList debugRepresentation() const;
+
+		virtual qint64 memoryUsage() const;
+		virtual void compact(QDocumentUndoStack *stack, bool spill);
+		virtual bool restoreSpilled(QDocumentUndoStack *stack);
 	private:
 		TextCommandData m_data;
         bool m_mergedLines;
+		qint64 m_spillOffset;
+		int m_spillSize;
+		QList<QDocumentLineHandle*> m_spilled;
 };
 
 class QCE_EXPORT QDocumentCommandBlock : public QDocumentCommand
@@ -155,12 +169,20 @@ public:
 	void setWeakLock(bool l);
 	bool isWeakLocked() const;
 
+	void setDelayedUpdates(bool d);
+	bool hasDelayedUpdates() const;
+
 	virtual void addCommand(QDocumentCommand *c);
 	virtual void removeCommand(QDocumentCommand *c);
 
 	virtual QStringList debugRepresentation() const;
+
+	virtual qint64 memoryUsage() const;
+	virtual void compact(QDocumentUndoStack *stack, bool spill);
+	virtual bool restoreSpilled(QDocumentUndoStack *stack);
 private:
 	bool m_weakLocked;
+	bool m_delayedUpdates;
 	QList<QDocumentCommand*> m_commands;
 };
 
@@ -0,0 +1,669 @@
+/****************************************************************************
+**
+** This file is part of the TeXstudio project.
+**
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and appearing in the
+** file GPL.txt included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qdocumentjournal.h"
+
+/*!
+	\file qdocumentjournal.cpp
+	\brief Implementation of the QDocumentJournal class
+*/
+
+#include "qdocument.h"
+#include "qdocumentline.h"
+#include "qdocumentcommand.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QWaitCondition>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/*!
+	\ingroup document
+	@{
+*/
+
+namespace {
+
+const quint32 JournalMagic = 0x54584a4c; // "TXJL"
+const quint32 JournalVersion = 1;
+const QDataStream::Version JournalStreamVersion = QDataStream::Qt_5_0;
+
+const unsigned long FlushIntervalMs = 500;
+const int FlushBatchBytes = 16 * 1024;
+const int CrashFlushTimeoutMs = 2000;
+
+void syncToDisk(QFile& file)
+{
+	file.flush();
+#ifdef Q_OS_WIN
+	FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+	::fsync(file.handle());
+#endif
+}
+
+/*
+	Single background thread shared by all journals. Records are queued by the
+	gui thread and written in small batches, followed by one fsync per file and
+	batch. Tasks are processed strictly in queue order, so a rewrite (checkpoint
+	or reset) is always applied before the records appended after it.
+	Once the writer is stopped, tasks are processed on the enqueuing thread.
+*/
+class JournalWriter : public QThread
+{
+	public:
+		enum Kind
+		{
+			Append,
+			Rewrite,
+			Remove
+		};
+
+		struct Task
+		{
+			Kind kind;
+			QString fileName;
+			QByteArray data;
+		};
+
+		static JournalWriter* instance(bool create = true)
+		{
+			static JournalWriter *writer = nullptr;
+			if ( !writer && create )
+			{
+				writer = new JournalWriter();
+				writer->start(QThread::LowPriority);
+			}
+			return writer;
+		}
+
+		void enqueue(Kind kind, const QString& fileName, const QByteArray& data = QByteArray())
+		{
+			bool stopped;
+			{
+				QMutexLocker locker(&m_mutex);
+				Task t;
+				t.kind = kind;
+				t.fileName = fileName;
+				t.data = data;
+				m_tasks << t;
+				m_pendingBytes += data.size();
+				stopped = m_stopped;
+				if ( m_pendingBytes >= FlushBatchBytes )
+					m_wake.wakeAll();
+			}
+			if ( stopped )
+				processPending();
+		}
+
+		// writes everything queued so far on the calling thread
+		void processPending()
+		{
+			QMutexLocker ioLocker(&m_ioMutex);
+			process(takeTasks());
+		}
+
+		/*
+			Same as processPending(), but gives up if the queue cannot be locked
+			within timeoutMs. The crash handler may run on a thread that already
+			holds one of the locks, so it must never block on them.
+		*/
+		bool tryProcessPending(int timeoutMs)
+		{
+			if ( !m_ioMutex.tryLock(timeoutMs) )
+				return false;
+			if ( !m_mutex.tryLock(timeoutMs) )
+			{
+				m_ioMutex.unlock();
+				return false;
+			}
+			QList<Task> tasks;
+			tasks.swap(m_tasks);
+			m_pendingBytes = 0;
+			m_mutex.unlock();
+			process(tasks);
+			m_ioMutex.unlock();
+			return true;
+		}
+
+		// stops the thread after it has written everything queued so far
+		void stop()
+		{
+			{
+				QMutexLocker locker(&m_mutex);
+				m_stopped = true;
+				m_wake.wakeAll();
+			}
+			wait();
+			processPending();
+		}
+
+	protected:
+		void run() override
+		{
+			forever
+			{
+				{
+					QMutexLocker locker(&m_mutex);
+					if ( m_stopped )
+						break;
+					if ( m_tasks.isEmpty() || m_pendingBytes < FlushBatchBytes )
+						m_wake.wait(&m_mutex, FlushIntervalMs);
+				}
+				processPending();
+			}
+		}
+
+	private:
+		JournalWriter() : m_pendingBytes(0), m_stopped(false) {}
+
+		QList<Task> takeTasks()
+		{
+			QMutexLocker locker(&m_mutex);
+			QList<Task> tasks;
+			tasks.swap(m_tasks);
+			m_pendingBytes = 0;
+			return tasks;
+		}
+
+		void process(const QList<Task>& tasks)
+		{
+			int i = 0;
+			while ( i < tasks.size() )
+			{
+				const Task& t = tasks.at(i);
+				switch ( t.kind )
+				{
+					case Remove:
+						QFile::remove(t.fileName);
+						++i;
+						break;
+					case Rewrite:
+					{
+						QSaveFile file(t.fileName);
+						if ( file.open(QIODevice::WriteOnly) )
+						{
+							file.write(t.data);
+							file.commit();
+						}
+						++i;
+						break;
+					}
+					case Append:
+					{
+						// coalesce consecutive appends to the same journal into one write + fsync
+						QFile file(t.fileName);
+						bool ok = file.open(QIODevice::WriteOnly | QIODevice::Append);
+						while ( i < tasks.size() && tasks.at(i).kind == Append && tasks.at(i).fileName == t.fileName )
+						{
+							if ( ok )
+								file.write(tasks.at(i).data);
+							++i;
+						}
+						if ( ok )
+							syncToDisk(file);
+						break;
+					}
+				}
+			}
+		}
+
+		QMutex m_mutex;
+		QMutex m_ioMutex;
+		QWaitCondition m_wake;
+		QList<Task> m_tasks;
+		int m_pendingBytes;
+		bool m_stopped;
+};
+
+bool baseMatches(const QString& fileName, qint64 size, qint64 modified)
+{
+	QFileInfo info(fileName);
+	if ( !info.exists() )
+		return size < 0;
+	return info.size() == size && info.lastModified().toMSecsSinceEpoch() == modified;
+}
+
+/*
+	Applies a journal record to the text \a lines, as the corresponding
+	document command would. Returns false if the record does not fit the
+	text, i.e. the journal does not belong to it.
+*/
+bool replayInsert(QStringList& lines, int line, int column, const QString& text)
+{
+	if ( line < 0 || line >= lines.size() || column < 0 || column > lines.at(line).length() )
+		return false;
+
+	const QString& l = lines.at(line);
+	QStringList inserted = (l.left(column) + text + l.mid(column)).split('\n');
+	lines.removeAt(line);
+	for ( int i = 0; i < inserted.size(); ++i )
+		lines.insert(line + i, inserted.at(i));
+	return true;
+}
+
+bool replayErase(QStringList& lines, int line, int column, int endLine, int endColumn)
+{
+	if ( line < 0 || endLine < line || endLine >= lines.size() )
+		return false;
+	if ( column < 0 || column > lines.at(line).length() || endColumn < 0 || endColumn > lines.at(endLine).length() )
+		return false;
+	if ( line == endLine && endColumn < column )
+		return false;
+
+	QString joined = lines.at(line).left(column) + lines.at(endLine).mid(endColumn);
+	for ( int i = endLine; i > line; --i )
+		lines.removeAt(i);
+	lines[line] = joined;
+	return true;
+}
+
+struct ReplayRecord
+{
+	quint8 op;
+	qint32 line, column, endLine, endColumn;
+	QString text;
+};
+
+}
+
+/*!
+	\class QDocumentJournal
+	\brief Append-only crash recovery journal of a document
+
+	Every insertion and erasure executed on the document (including undo and
+	redo) is serialized as a small record and appended to
+	journalFileName(fileName) by a background thread, which fsyncs in batches.
+	The journals are kept in journalDirectory(), not next to the files.
+	The journal starts at the last saved state of the file; once the records
+	written since the last checkpoint outgrow the checkpoint itself, the
+	journal is compacted into a snapshot of the current text. The I/O cost
+	is thus proportional to the edits and not to the document size.
+
+	After a crash, replay() applies the records onto the file on disk (or
+	onto the checkpoint) to restore the last state of the document.
+*/
+
+int QDocumentJournal::m_compactionThreshold = 256 * 1024;
+QString QDocumentJournal::m_journalDirectory;
+
+/*!
+	\brief ctor
+	\param doc journaled document
+	\param fileName name of the file the document is saved to
+*/
+QDocumentJournal::QDocumentJournal(QDocument *doc, const QString& fileName)
+ : m_doc(doc), m_fileName(fileName), m_bytesSinceCheckpoint(-1), m_checkpointSize(0)
+{
+	reset();
+}
+
+/*!
+	\brief dtor
+
+	Removes the journal file, a document that is closed regularly does not
+	need to be recovered.
+*/
+QDocumentJournal::~QDocumentJournal()
+{
+	discard();
+}
+
+/*!
+	\return the name of the file the journal refers to
+*/
+QString QDocumentJournal::fileName() const
+{
+	return m_fileName;
+}
+
+/*!
+	\brief Move the journal to another file (e.g. after "save as")
+*/
+void QDocumentJournal::setFileName(const QString& fileName)
+{
+	if ( fileName == m_fileName )
+		return;
+
+	discard();
+	m_fileName = fileName;
+	reset();
+}
+
+/*!
+	\return the name of the journal file belonging to \a fileName
+
+	The name is derived from a hash of the absolute path, so files with the
+	same name in different directories do not share a journal.
+*/
+QString QDocumentJournal::journalFileName(const QString& fileName)
+{
+	QString path = QFileInfo(fileName).absoluteFilePath();
+	QByteArray hash = QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex();
+	return journalDirectory() + "/" + QFileInfo(path).fileName() + "-" + QString::fromLatin1(hash) + ".journal";
+}
+
+/*!
+	\return the directory the journals are written to
+
+	Defaults to a subdirectory of the cache location of the application.
+*/
+QString QDocumentJournal::journalDirectory()
+{
+	if ( m_journalDirectory.isEmpty() )
+		setJournalDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/journal");
+	return m_journalDirectory;
+}
+
+/*!
+	\brief Set the directory the journals are written to, it is created if necessary
+*/
+void QDocumentJournal::setJournalDirectory(const QString& directory)
+{
+	m_journalDirectory = QDir::cleanPath(directory);
+	QDir().mkpath(m_journalDirectory);
+}
+
+/*!
+	\return the number of journal bytes after which the journal is compacted
+*/
+int QDocumentJournal::compactionThreshold()
+{
+	return m_compactionThreshold;
+}
+
+/*!
+	\brief Set the minimal number of journal bytes after which the journal is compacted
+*/
+void QDocumentJournal::setCompactionThreshold(int bytes)
+{
+	m_compactionThreshold = qMax(4096, bytes);
+}
+
+QByteArray QDocumentJournal::header(bool withCheckpoint) const
+{
+	QFileInfo info(m_fileName);
+
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream.setVersion(JournalStreamVersion);
+	stream << JournalMagic << JournalVersion
+		   << qint64(info.exists() ? info.size() : -1)
+		   << qint64(info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1)
+		   << quint8(withCheckpoint ? 1 : 0);
+	return data;
+}
+
+void QDocumentJournal::append(const QByteArray& record)
+{
+	if ( m_bytesSinceCheckpoint < 0 )
+	{
+		// the journal file is only created on the first edit after load/save
+		JournalWriter::instance()->enqueue(JournalWriter::Rewrite, journalFileName(m_fileName), header(false));
+		m_bytesSinceCheckpoint = 0;
+		m_checkpointSize = 0;
+	}
+
+	JournalWriter::instance()->enqueue(JournalWriter::Append, journalFileName(m_fileName), record);
+	m_bytesSinceCheckpoint += record.size();
+
+	if ( m_bytesSinceCheckpoint > qMax<qint64>(m_compactionThreshold, m_checkpointSize) )
+		checkpoint();
+}
+
+/*!
+	\brief Record the insertion of \a text at \a line, \a column
+*/
+void QDocumentJournal::recordInsert(int line, int column, const QString& text)
+{
+	if ( m_fileName.isEmpty() || text.isEmpty() )
+		return;
+
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(JournalStreamVersion);
+	stream << quint8(Insert) << qint32(line) << qint32(column) << text;
+	append(record);
+}
+
+/*!
+	\brief Record the erasure of the text between (\a line, \a column) and (\a endLine, \a endColumn)
+*/
+void QDocumentJournal::recordErase(int line, int column, int endLine, int endColumn)
+{
+	if ( m_fileName.isEmpty() || (line == endLine && column == endColumn) )
+		return;
+
+	QByteArray record;
+	QDataStream stream(&record, QIODevice::WriteOnly);
+	stream.setVersion(JournalStreamVersion);
+	stream << quint8(Erase) << qint32(line) << qint32(column) << qint32(endLine) << qint32(endColumn);
+	append(record);
+}
+
+/*!
+	\brief Compact the journal into a snapshot of the current document text
+*/
+void QDocumentJournal::checkpoint()
+{
+	if ( m_fileName.isEmpty() || !m_doc )
+		return;
+
+	QByteArray data = header(true);
+	QDataStream stream(&data, QIODevice::WriteOnly | QIODevice::Append);
+	stream.setVersion(JournalStreamVersion);
+	stream << m_doc->textLines().join("\n");
+
+	JournalWriter::instance()->enqueue(JournalWriter::Rewrite, journalFileName(m_fileName), data);
+	m_checkpointSize = data.size();
+	m_bytesSinceCheckpoint = 0;
+}
+
+/*!
+	\brief Restart the journal from the file on disk, e.g. after saving
+
+	If the document still differs from the file, the journal starts with a
+	checkpoint of the current text.
+*/
+void QDocumentJournal::reset()
+{
+	if ( m_fileName.isEmpty() )
+		return;
+
+	if ( m_bytesSinceCheckpoint >= 0 )
+		JournalWriter::instance()->enqueue(JournalWriter::Remove, journalFileName(m_fileName));
+	m_bytesSinceCheckpoint = -1;
+	m_checkpointSize = 0;
+
+	if ( m_doc && !m_doc->isClean() )
+		checkpoint();
+}
+
+/*!
+	\brief Remove the journal file synchronously
+*/
+void QDocumentJournal::discard()
+{
+	if ( m_fileName.isEmpty() || m_bytesSinceCheckpoint < 0 )
+		return;
+
+	JournalWriter::instance()->enqueue(JournalWriter::Remove, journalFileName(m_fileName));
+	JournalWriter::instance()->processPending();
+	m_bytesSinceCheckpoint = -1;
+}
+
+/*!
+	\brief Write all pending records of all journals to disk on the calling thread
+
+	This is meant to be called from the crash handler. It does not block if the
+	journal queue is locked (e.g. by the crashed thread), in that case only the
+	records already written by the background thread can be recovered.
+
+	\return whether the pending records could be written
+*/
+bool QDocumentJournal::flushAll()
+{
+	JournalWriter *writer = JournalWriter::instance(false);
+	return !writer || writer->tryProcessPending(CrashFlushTimeoutMs);
+}
+
+/*!
+	\brief Write all pending records and stop the background writer thread
+
+	Records of journals that are changed afterwards are written synchronously.
+*/
+void QDocumentJournal::shutdown()
+{
+	JournalWriter *writer = JournalWriter::instance(false);
+	if ( writer && writer->isRunning() )
+		writer->stop();
+}
+
+/*!
+	\return whether a journal for \a fileName exists that can be replayed
+*/
+bool QDocumentJournal::hasRecoveryData(const QString& fileName)
+{
+	QFile f(journalFileName(fileName));
+	if ( !f.open(QFile::ReadOnly) )
+		return false;
+
+	QDataStream stream(&f);
+	stream.setVersion(JournalStreamVersion);
+
+	quint32 magic, version;
+	qint64 baseSize, baseModified;
+	quint8 hasCheckpoint;
+	stream >> magic >> version >> baseSize >> baseModified >> hasCheckpoint;
+
+	if ( stream.status() != QDataStream::Ok || magic != JournalMagic || version != JournalVersion )
+		return false;
+
+	if ( hasCheckpoint )
+		return true;
+
+	// a journal without checkpoint only applies to the exact file it was started on
+	return !stream.atEnd() && baseMatches(fileName, baseSize, baseModified);
+}
+
+/*!
+	\brief Remove the journal of \a fileName
+*/
+void QDocumentJournal::discardRecoveryData(const QString& fileName)
+{
+	QFile::remove(journalFileName(fileName));
+}
+
+/*!
+	\brief Replay the journal of \a fileName onto \a doc
+
+	\a doc must contain the text of \a fileName as it is on disk. All changes
+	are applied as a single undoable macro. A torn record at the end of the
+	journal (crash during a write) is ignored.
+
+	Every record is checked against the text it is applied to before \a doc is
+	modified, a journal with a record that is out of range is not applied at all.
+
+	\return whether the journal could be applied
+*/
+bool QDocumentJournal::replay(const QString& fileName, QDocument *doc)
+{
+	if ( !doc || !hasRecoveryData(fileName) )
+		return false;
+
+	QFile f(journalFileName(fileName));
+	if ( !f.open(QFile::ReadOnly) )
+		return false;
+
+	QDataStream stream(&f);
+	stream.setVersion(JournalStreamVersion);
+
+	quint32 magic, version;
+	qint64 baseSize, baseModified;
+	quint8 hasCheckpoint;
+	stream >> magic >> version >> baseSize >> baseModified >> hasCheckpoint;
+
+	QString checkpointText;
+	if ( hasCheckpoint )
+	{
+		stream >> checkpointText;
+		if ( stream.status() != QDataStream::Ok )
+			return false;
+	}
+
+	QStringList lines = hasCheckpoint ? checkpointText.split('\n') : doc->textLines();
+	QList<ReplayRecord> records;
+
+	while ( !stream.atEnd() )
+	{
+		ReplayRecord r;
+		r.endLine = r.endColumn = 0;
+		stream >> r.op >> r.line >> r.column;
+
+		bool valid;
+		if ( r.op == Insert )
+		{
+			stream >> r.text;
+			if ( stream.status() != QDataStream::Ok )
+				break;
+			valid = replayInsert(lines, r.line, r.column, r.text);
+		} else if ( r.op == Erase ) {
+			stream >> r.endLine >> r.endColumn;
+			if ( stream.status() != QDataStream::Ok )
+				break;
+			valid = replayErase(lines, r.line, r.column, r.endLine, r.endColumn);
+		} else if ( stream.status() != QDataStream::Ok ) {
+			break;
+		} else {
+			valid = false;
+		}
+
+		if ( !valid )
+			return false;
+
+		records << r;
+	}
+
+	doc->beginMacro();
+
+	if ( hasCheckpoint )
+		doc->setText(checkpointText, true);
+
+	foreach ( const ReplayRecord& r, records )
+	{
+		if ( r.op == Insert )
+			doc->execute(new QDocumentInsertCommand(r.line, r.column, r.text, doc));
+		else
+			doc->execute(new QDocumentEraseCommand(r.line, r.column, r.endLine, r.endColumn, doc));
+	}
+
+	doc->endMacro();
+
+	return true;
+}
+
+/*! @} */
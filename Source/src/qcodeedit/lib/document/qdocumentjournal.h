@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** This file is part of the TeXstudio project.
+**
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and appearing in the
+** file GPL.txt included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef Header_QDocument_Journal
+#define Header_QDocument_Journal
+
+#include "qce-config.h"
+
+/*!
+	\file qdocumentjournal.h
+	\brief Definition of the QDocumentJournal class
+*/
+
+#include <QByteArray>
+#include <QString>
+
+class QDocument;
+
+class QCE_EXPORT QDocumentJournal
+{
+	public:
+		enum Operation
+		{
+			Insert = 1,
+			Erase = 2
+		};
+
+		QDocumentJournal(QDocument *doc, const QString& fileName);
+		~QDocumentJournal();
+
+		QString fileName() const;
+		void setFileName(const QString& fileName);
+
+		void recordInsert(int line, int column, const QString& text);
+		void recordErase(int line, int column, int endLine, int endColumn);
+
+		void reset();
+		void checkpoint();
+		void discard();
+
+		static QString journalFileName(const QString& fileName);
+		static bool hasRecoveryData(const QString& fileName);
+		static bool replay(const QString& fileName, QDocument *doc);
+		static void discardRecoveryData(const QString& fileName);
+		static bool flushAll();
+		static void shutdown();
+
+		static QString journalDirectory();
+		static void setJournalDirectory(const QString& directory);
+
+		static int compactionThreshold();
+		static void setCompactionThreshold(int bytes);
+
+	private:
+		QByteArray header(bool withCheckpoint) const;
+		void append(const QByteArray& record);
+
+		QDocument *m_doc;
+		QString m_fileName;
+		qint64 m_bytesSinceCheckpoint;
+		qint64 m_checkpointSize;
+
+		static int m_compactionThreshold;
+		static QString m_journalDirectory;
+};
+
+#endif
@@ -136,6 +136,9 @@ public:
 
 		~QDocumentLineHandle();
 
+		static void* operator new(size_t size);
+		static void operator delete(void *p, size_t size);
+
 		QVector<int> compose() const;
 		QVector<int> getFormats() const;
 		QVector<int> getCachedFormats() const;
@@ -167,6 +170,9 @@ public:
 		bool isRTLByLayout() const;
 		bool isRTLByText() const;
 		void layout(int lineNr) const; //public for unittests
+
+		int memoryUsage() const;
+		void releaseCaches();
 	private:
 		void drawBorders(QPainter *p, qreal yStart, qreal yEnd) const;
 
@@ -197,7 +203,6 @@ public:
 
 		enum SelectionState {noSel,partialSel,fullSel};
 		SelectionState lineHasSelection;
-		QBitmap wv;
 		mutable QReadWriteLock mLock;
 		int mTicket; // increment on each write access to detect obsolete info in parallel thread
 		QMap<int,QVariant> mCookies; // store additional info on lines. Helpful for to retrieve info on multiline commands
@@ -31,6 +31,22 @@
 #include "qformatscheme.h"
 
 #include <QMessageBox>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+
+namespace {
+// number of non empty matches of \a re in \a text, starting at \a offset
+int countMatches(const QRegularExpression& re, const QString& text, int offset)
+{
+	int count = 0;
+	QRegularExpressionMatchIterator it = re.globalMatch(text, offset);
+	while ( it.hasNext() )
+		if ( it.next().capturedLength() > 0 )
+			count++;
+	return count;
+}
+}
 
 /*!
 	\class QDocumentSearch
@@ -40,7 +56,7 @@
 */
 
 QDocumentSearch::QDocumentSearch(QEditor *e, const QString& f, Options opt, const QString& r)
-  : m_option(opt), m_string(f), m_replace(r), m_editor(e), m_replaced(0), m_replaceDeltaLength(0)
+  : m_option(opt), m_string(f), m_replace(r), m_editor(e), m_replaced(0), m_replaceDeltaLength(0), m_matchCount(0), m_matchLinesDocLines(-1), m_scanWatcher(nullptr)
 {
 	connectToEditor();
 }
@@ -55,6 +71,7 @@ void QDocumentSearch::connectToEditor(){
 
 QDocumentSearch::~QDocumentSearch()
 {
+	blockSignals(true); // nobody is interested in the match count anymore
 	clearMatches();
 }
 
@@ -69,8 +86,10 @@ void QDocumentSearch::searchMatches(const QDocumentCursor& subHighlightScope, bo
 	if ( !hasOption(HighlightAll) )
 		return;
 	
-	if ( clearAll )
+	if ( clearAll ) {
 		clearMatches();
+		startFullScan();
+	}
 
 	QDocument* d= currentDocument();
 	if ( !d || !d->lines()) return;
@@ -183,38 +202,291 @@ void QDocumentSearch::searchMatches(const QDocumentCursor& subHighlightScope, bo
 			}
 		} else hc.movePosition(1, QDocumentCursor::NextBlock, QDocumentCursor::ThroughFolding);
 	}
-	int begLine=0;
-	int endLine=d->lines();
-	int offset=0;
-	int endOffset=-1;
-	if (m_scope.isValid() && m_scope.hasSelection()){
-		QDocumentSelection boundaries=m_scope.selection();
-		begLine=boundaries.startLine;
-		endLine=boundaries.endLine+1;
-		offset=boundaries.start;
-		endOffset=boundaries.end;
+	m_editor->viewport()->update();
+}
+
+/*!
+	\return the number of matches in the search scope, -1 while they are being counted
+*/
+int QDocumentSearch::matchCount() const
+{
+	return m_matchCount;
+}
+
+/*!
+	\return the number of matches up to and including the one starting at \a c
+*/
+int QDocumentSearch::matchIndex(const QDocumentCursor& c) const
+{
+	if ( m_matchCount <= 0 || !c.isValid() || !c.document() )
+		return 0;
+
+	QDocument* d = c.document();
+	QDocumentCursor start = c.selectionStart();
+	int ln = start.lineNumber();
+
+	if ( m_matchLinesDocLines != d->lines() )
+		rebuildMatchLines(d);
+
+	// matches in the lines before ln
+	int pos = std::lower_bound(m_matchLines.constBegin(), m_matchLines.constEnd(), ln) - m_matchLines.constBegin();
+	int index = pos > 0 ? m_matchesUpTo.at(pos - 1) : 0;
+
+	QDocumentLine l = d->line(ln);
+	int offset, length;
+	if ( !m_matchesPerLine.contains(l.handle()) || !lineScope(ln, offset, length) )
+		return index;
+
+	QRegularExpressionMatchIterator it = m_regularExpression.globalMatch(length < 0 ? l.text() : l.text().left(length), offset);
+	while ( it.hasNext() ) {
+		QRegularExpressionMatch match = it.next();
+		if ( match.capturedStart() > start.columnNumber() )
+			break;
+		if ( match.capturedLength() > 0 )
+			index++;
 	}
-	if(clearSelection){
-		// don't run again when only visibleLines is changed
-		// remove old marks first
-		m_editor->removeMark("search");
-		bool needsUpdate=false;
-		for(int i=begLine;i<endLine;i++){
-			QString txt=d->line(i).text();
-			if((endOffset>=0)&&(i+1==endLine)){
-				txt=txt.left(endOffset);
-			}
-			QRegularExpressionMatch match=m_regularExpression.match(txt,offset);
-			if(match.hasMatch()){
-				m_editor->addMarkDelayed(i,Qt::darkYellow,"search");
-				needsUpdate=true;
-			}
-			offset=0;
+	return index;
+}
+
+/*
+	recomputes the prefix sums of the matches per line used by matchIndex(). This walks the
+	whole document, so it is only done after lines have been inserted or removed, changed
+	match counts of single lines are applied by updateMatchLines()
+	*/
+void QDocumentSearch::rebuildMatchLines(QDocument* d) const
+{
+	m_matchLines.clear();
+	m_matchesUpTo.clear();
+	m_matchLinesDocLines = d->lines();
+	if ( m_matchesPerLine.isEmpty() )
+		return;
+
+	int sum = 0;
+	for ( int i = 0; i < d->lines(); i++ ) {
+		int count = m_matchesPerLine.value(d->line(i).handle(), 0);
+		if ( !count )
+			continue;
+		sum += count;
+		m_matchLines << i;
+		m_matchesUpTo << sum;
+	}
+}
+
+/*
+	updates the prefix sums after the match count of \a line changed from \a oldCount to \a newCount
+	*/
+void QDocumentSearch::updateMatchLines(int line, int oldCount, int newCount)
+{
+	QDocument* d = currentDocument();
+	if ( !d || m_matchLinesDocLines != d->lines() ) {
+		m_matchLinesDocLines = -1;
+		return;
+	}
+	if ( oldCount == newCount )
+		return;
+
+	int pos = std::lower_bound(m_matchLines.constBegin(), m_matchLines.constEnd(), line) - m_matchLines.constBegin();
+	bool listed = pos < m_matchLines.size() && m_matchLines.at(pos) == line;
+	if ( listed != (oldCount > 0) ) {
+		m_matchLinesDocLines = -1;
+		return;
+	}
+
+	if ( !listed ) {
+		m_matchLines.insert(pos, line);
+		m_matchesUpTo.insert(pos, pos > 0 ? m_matchesUpTo.at(pos - 1) : 0);
+	}
+	for ( int i = pos; i < m_matchesUpTo.size(); i++ )
+		m_matchesUpTo[i] += newCount - oldCount;
+	if ( !newCount ) {
+		m_matchLines.remove(pos);
+		m_matchesUpTo.remove(pos);
+	}
+}
+
+/*
+	returns whether \a line is in the search scope and which part of it: from \a offset, the first \a length characters (-1 for the whole line)
+	*/
+bool QDocumentSearch::lineScope(int line, int& offset, int& length) const
+{
+	offset = 0;
+	length = -1;
+	if ( !m_scope.isValid() || !m_scope.hasSelection() )
+		return true;
+
+	QDocumentSelection boundaries = m_scope.selection();
+	if ( line < boundaries.startLine || line > boundaries.endLine )
+		return false;
+	if ( line == boundaries.startLine )
+		offset = boundaries.start;
+	if ( line == boundaries.endLine )
+		length = boundaries.end;
+	return true;
+}
+
+/*
+	counts the matches of all lines in the search scope on a worker thread, using a snapshot of the line texts.
+	Changes of the document are applied incrementally by updateMatchCount() afterwards
+	*/
+void QDocumentSearch::startFullScan()
+{
+	cancelFullScan();
+
+	QDocument* d = currentDocument();
+	if ( !d || !m_editor || m_string.isEmpty() || !hasOption(HighlightAll) )
+		return;
+
+	recreateRegExp();
+	if ( !m_regularExpression.isValid() )
+		return;
+
+	int begLine = 0, endLine = d->lines() - 1;
+	if ( m_scope.isValid() && m_scope.hasSelection() ) {
+		QDocumentSelection boundaries = m_scope.selection();
+		begLine = boundaries.startLine;
+		endLine = qMin(endLine, boundaries.endLine);
+	}
+
+	QVector<QString> texts;
+	QVector<int> offsets;
+	for ( int i = begLine; i <= endLine; i++ ) {
+		int offset, length;
+		if ( !lineScope(i, offset, length) )
+			continue;
+		QDocumentLine l = d->line(i);
+		m_scanLines << l.handle();
+		texts << (length < 0 ? l.text() : l.text().left(length));
+		offsets << offset;
+	}
+
+	QSharedPointer<QAtomicInt> cancelled(new QAtomicInt(0));
+	QRegularExpression re = m_regularExpression;
+
+	m_matchCount = -1;
+	m_scanCancelled = cancelled;
+	m_scanWatcher = new QFutureWatcher<QVector<int> >(this);
+	connect(m_scanWatcher, SIGNAL(finished()), SLOT(fullScanFinished()));
+	m_scanWatcher->setFuture(QtConcurrent::run([re, texts, offsets, cancelled]() {
+		QVector<int> counts(texts.size());
+		for ( int i = 0; i < texts.size(); i++ ) {
+			if ( (i & 255) == 0 && cancelled->loadAcquire() )
+				return QVector<int>();
+			counts[i] = countMatches(re, texts[i], offsets[i]);
 		}
-		if(needsUpdate)
-			m_editor->paintMarks();
+		return counts;
+	}));
+
+	emit matchCountChanged();
+}
+
+void QDocumentSearch::cancelFullScan()
+{
+	if ( m_scanCancelled )
+		m_scanCancelled->storeRelease(1);
+	m_scanCancelled.clear();
+
+	if ( m_scanWatcher ) {
+		m_scanWatcher->disconnect(this);
+		m_scanWatcher->deleteLater();
+		m_scanWatcher = nullptr;
 	}
-	m_editor->viewport()->update();
+
+	m_scanLines.clear();
+	m_scanChanged.clear();
+	m_scanDeleted.clear();
+}
+
+void QDocumentSearch::fullScanFinished()
+{
+	if ( !m_scanWatcher )
+		return;
+
+	QVector<int> counts = m_scanWatcher->result();
+	QVector<QDocumentLineHandle*> lines = m_scanLines;
+	QSet<QDocumentLineHandle*> changed = m_scanChanged, deleted = m_scanDeleted;
+	m_scanCancelled.clear();
+	cancelFullScan();
+
+	if ( counts.size() != lines.size() )
+		return;
+
+	m_matchesPerLine.clear();
+	m_matchCount = 0;
+	m_matchLinesDocLines = -1;
+	for ( int i = 0; i < lines.size(); i++ ) {
+		if ( !counts[i] || deleted.contains(lines[i]) || changed.contains(lines[i]) )
+			continue;
+		m_matchesPerLine.insert(lines[i], counts[i]);
+		m_matchCount += counts[i];
+	}
+
+	// lines edited during the scan are counted again
+	QDocument* d = currentDocument();
+	if ( d )
+		foreach ( QDocumentLineHandle* h, changed ) {
+			int ln = d->indexOf(h);
+			if ( ln >= 0 )
+				updateLineMatches(ln);
+		}
+
+	updateMarks();
+	emit matchCountChanged();
+}
+
+void QDocumentSearch::updateLineMatches(int line)
+{
+	QDocumentLine l = currentDocument()->line(line);
+	int oldCount = m_matchesPerLine.take(l.handle());
+	m_matchCount -= oldCount;
+
+	int offset, length, count = 0;
+	if ( lineScope(line, offset, length) )
+		count = countMatches(m_regularExpression, length < 0 ? l.text() : l.text().left(length), offset);
+	if ( count ) {
+		m_matchesPerLine.insert(l.handle(), count);
+		m_matchCount += count;
+	}
+
+	updateMatchLines(line, oldCount, count);
+}
+
+/*
+	updates the match count after the lines \a first to \a last changed, without scanning the rest of the document
+	*/
+void QDocumentSearch::updateMatchCount(int first, int last)
+{
+	QDocument* d = currentDocument();
+	if ( !d || m_string.isEmpty() )
+		return;
+
+	if ( m_scanWatcher ) {
+		for ( int i = first; i <= last; i++ )
+			m_scanChanged.insert(d->line(i).handle());
+		return;
+	}
+
+	if ( m_matchCount < 0 )
+		return;
+
+	for ( int i = first; i <= last; i++ )
+		updateLineMatches(i);
+
+	updateMarks();
+	emit matchCountChanged();
+}
+
+/*
+	shows the lines with matches on the scroll bar of the editor
+	*/
+void QDocumentSearch::updateMarks()
+{
+	if ( !m_editor )
+		return;
+
+	m_editor->removeMark("search");
+	for ( QHash<QDocumentLineHandle*, int>::const_iterator it = m_matchesPerLine.constBegin(); it != m_matchesPerLine.constEnd(); ++it )
+		m_editor->addMarkDelayed(it.key(), Qt::darkYellow, "search");
+	m_editor->paintMarks();
 }
 
 /*!
@@ -237,6 +509,11 @@ void QDocumentSearch::clearMatches()
 	m_editor->removeMark("search");
 	m_editor->removeMark("replace");
 	m_highlights.clear();
+	cancelFullScan();
+	m_matchesPerLine.clear();
+	m_matchCount = 0;
+	m_matchLinesDocLines = -1;
+	emit matchCountChanged();
 	m_newReplacementOverlays.clear();
 	m_searchedScope = QDocumentCursor();
 	//qDebug("clearing matches");
@@ -1001,6 +1278,7 @@ void QDocumentSearch::documentContentChanged(int line, int n){
 	c.setColumnNumber(le.length(), QDocumentCursor::KeepAnchor);
 	highlightSelection(c);
 	searchMatches(c,false);
+	updateMatchCount(line, lineend);
 }
 
 void QDocumentSearch::visibleLinesChanged(){
@@ -1046,5 +1324,12 @@ void QDocumentSearch::highlightSelection(const QDocumentCursor& subHighlightScop
 void QDocumentSearch::lineDeleted(QDocumentLineHandle* line){
 	m_highlightedReplacements.remove(line);
 	m_highlights.remove(line);
+	if ( m_matchCount > 0 )
+		m_matchCount -= m_matchesPerLine.take(line);
+	m_matchLinesDocLines = -1;
+	if ( m_scanWatcher ) {
+		m_scanChanged.remove(line);
+		m_scanDeleted.insert(line);
+	}
 }
 //TODO:  disable seleciton hide
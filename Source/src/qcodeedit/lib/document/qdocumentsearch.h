@@ -24,6 +24,9 @@
 */
 
 #include <QString>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QSharedPointer>
 #include <QRegExp>
 #include <QRegularExpression>
 #include <QPointer>
@@ -88,8 +91,14 @@ class QCE_EXPORT QDocumentSearch: public QObject
 
 		void highlightSelection(const QDocumentCursor& subHighlightScope=QDocumentCursor());
 
+		int matchCount() const;
+		int matchIndex(const QDocumentCursor& c) const;
+
 		QDocument* currentDocument();
 
+	signals:
+		void matchCountChanged();
+
 	private:
 		void connectToEditor();
 
@@ -104,6 +113,15 @@ class QCE_EXPORT QDocumentSearch: public QObject
 		bool isAcceptedFormat(int formatIds) const;
 		
 		void recreateRegExp();
+
+		bool lineScope(int line, int& offset, int& length) const;
+		void startFullScan();
+		void cancelFullScan();
+		void updateLineMatches(int line);
+		void updateMatchCount(int first, int last);
+		void rebuildMatchLines(QDocument* d) const;
+		void updateMatchLines(int line, int oldCount, int newCount);
+		void updateMarks();
 		
 //		int m_index;
 		Options m_option;
@@ -121,7 +139,20 @@ class QCE_EXPORT QDocumentSearch: public QObject
 
 		QList<int> m_filteredIds;
 		bool m_filteredIdsInverted;
+
+		// matches per line in the whole search scope, counted in the background by startFullScan()
+		QHash<QDocumentLineHandle*, int> m_matchesPerLine;
+		int m_matchCount;
+		// sorted numbers of the lines with matches and the number of matches up to and including each of them,
+		// valid while the document has m_matchLinesDocLines lines (-1: must be rebuilt)
+		mutable QVector<int> m_matchLines, m_matchesUpTo;
+		mutable int m_matchLinesDocLines;
+		QFutureWatcher<QVector<int> > *m_scanWatcher;
+		QSharedPointer<QAtomicInt> m_scanCancelled;
+		QVector<QDocumentLineHandle*> m_scanLines;
+		QSet<QDocumentLineHandle*> m_scanChanged, m_scanDeleted;
 	private slots:
+		void fullScanFinished();
 		void documentContentChanged(int line, int n);
 		void visibleLinesChanged();
 		void lineDeleted(QDocumentLineHandle* line);
@@ -0,0 +1,371 @@
+/****************************************************************************
+**
+** This file is part of the TeXstudio project.
+**
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and appearing in the
+** file GPL.txt included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#include "qdocumentundostack.h"
+
+/*!
+	\file qdocumentundostack.cpp
+	\brief Implementation of the QDocumentUndoStack class
+*/
+
+#include "qdocumentcommand.h"
+
+#include <QDir>
+#include <QTemporaryFile>
+
+/*!
+	\ingroup document
+	@{
+*/
+
+/*!
+	\class QDocumentUndoStack
+	\brief Memory bounded undo/redo history of a document
+
+	A replacement for QUndoStack with the same semantics for pushing,
+	merging, undoing and tracking the clean state, which additionally keeps
+	the memory used by the history in check:
+
+	\li all but the most recent commands are compacted, i.e. the caches
+	of the lines they removed from the document (layout, formats, lexer
+	tokens) are released, since they are recomputed when a line is put back.
+	\li if spilling is enabled, the text of removed lines of the oldest
+	commands is moved to a temporary file and read back on undo.
+	\li once the estimated history size exceeds memoryLimit(), the oldest
+	commands are dropped.
+*/
+
+namespace {
+// the most recent commands are left untouched so that undoing a few steps stays cheap
+const int KeepUncompacted = 32;
+}
+
+qint64 QDocumentUndoStack::m_memoryLimit = 64 * 1024 * 1024;
+bool QDocumentUndoStack::m_spillEnabled = false;
+
+QDocumentUndoStack::QDocumentUndoStack(QObject *p)
+ : QObject(p), m_memory(0), m_index(0), m_cleanIndex(0), m_compacted(0), m_spillFile(nullptr)
+{
+
+}
+
+QDocumentUndoStack::~QDocumentUndoStack()
+{
+	qDeleteAll(m_commands);
+	delete m_spillFile;
+}
+
+/*!
+	\return the maximal estimated size of the history of one document in bytes, 0 means unlimited
+*/
+qint64 QDocumentUndoStack::memoryLimit()
+{
+	return m_memoryLimit;
+}
+
+/*!
+	\brief Set the maximal estimated size of the history of one document in bytes, 0 means unlimited
+*/
+void QDocumentUndoStack::setMemoryLimit(qint64 bytes)
+{
+	m_memoryLimit = qMax<qint64>(0, bytes);
+}
+
+/*!
+	\return whether the text of old history entries is moved to a temporary file
+*/
+bool QDocumentUndoStack::spillEnabled()
+{
+	return m_spillEnabled;
+}
+
+/*!
+	\brief Set whether the text of old history entries is moved to a temporary file
+*/
+void QDocumentUndoStack::setSpillEnabled(bool spill)
+{
+	m_spillEnabled = spill;
+}
+
+/*!
+	\brief Execute \a cmd and push it on the stack
+
+	Like QUndoStack::push() the command is merged with the previous one
+	if possible, and commands that could be redone are discarded.
+*/
+void QDocumentUndoStack::push(QDocumentCommand *cmd)
+{
+	if ( !cmd )
+		return;
+
+	cmd->redo();
+
+	bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+	QDocumentCommand *cur = m_index > 0 ? m_commands.at(m_index - 1) : nullptr;
+
+	while ( m_commands.count() > m_index )
+	{
+		m_memory -= m_usage.takeLast();
+		delete m_commands.takeLast();
+	}
+
+	if ( m_cleanIndex > m_index )
+		m_cleanIndex = -1; // the clean state has been discarded
+
+	m_compacted = qMin(m_compacted, m_index);
+
+	if ( cur && cur->id() != -1 && cur->id() == cmd->id() && m_index != m_cleanIndex && cur->mergeWith(cmd) )
+	{
+		delete cmd;
+		updateUsage(m_index - 1);
+	} else {
+		m_commands << cmd;
+		m_usage << 0;
+		updateUsage(m_commands.count() - 1);
+		++m_index;
+	}
+
+	compactHistory();
+	enforceMemoryLimit();
+
+	emitChanges(wasClean, couldUndo, couldRedo);
+}
+
+/*!
+	\brief Undo the last command
+*/
+void QDocumentUndoStack::undo()
+{
+	if ( !canUndo() )
+		return;
+
+	bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+	if ( !m_commands.at(m_index - 1)->restoreSpilled(this) )
+	{
+		// the command cannot be undone, nor anything before it
+		qWarning("QDocumentUndoStack: undo history lost, the spill file could not be read");
+		dropUndoHistory();
+		emitChanges(wasClean, couldUndo, couldRedo);
+		return;
+	}
+
+	--m_index;
+	m_commands.at(m_index)->undo();
+	updateUsage(m_index);
+
+	// an undone command has to be compacted again once it is redone
+	m_compacted = qMin(m_compacted, m_index);
+
+	emitChanges(wasClean, couldUndo, couldRedo);
+}
+
+/*!
+	\brief Redo the last undone command
+*/
+void QDocumentUndoStack::redo()
+{
+	if ( !canRedo() )
+		return;
+
+	bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+	m_commands.at(m_index)->redo();
+	updateUsage(m_index);
+	++m_index;
+
+	emitChanges(wasClean, couldUndo, couldRedo);
+}
+
+bool QDocumentUndoStack::canUndo() const
+{
+	return m_index > 0;
+}
+
+bool QDocumentUndoStack::canRedo() const
+{
+	return m_index < m_commands.count();
+}
+
+/*!
+	\brief Delete all commands and mark the current state as clean
+*/
+void QDocumentUndoStack::clear()
+{
+	bool wasClean = isClean(), couldUndo = canUndo(), couldRedo = canRedo();
+
+	qDeleteAll(m_commands);
+	m_commands.clear();
+	m_usage.clear();
+	m_memory = 0;
+	m_index = m_cleanIndex = m_compacted = 0;
+
+	delete m_spillFile;
+	m_spillFile = nullptr;
+
+	emitChanges(wasClean, couldUndo, couldRedo);
+}
+
+/*!
+	\brief Mark the current state as clean
+*/
+void QDocumentUndoStack::setClean()
+{
+	bool wasClean = isClean();
+	m_cleanIndex = m_index;
+	if ( !wasClean )
+		emit cleanChanged(true);
+}
+
+bool QDocumentUndoStack::isClean() const
+{
+	return m_cleanIndex == m_index;
+}
+
+/*!
+	\return the number of commands that can be undone
+*/
+int QDocumentUndoStack::index() const
+{
+	return m_index;
+}
+
+/*!
+	\return the number of commands on the stack
+*/
+int QDocumentUndoStack::count() const
+{
+	return m_commands.count();
+}
+
+const QDocumentCommand* QDocumentUndoStack::command(int i) const
+{
+	return (i >= 0 && i < m_commands.count()) ? m_commands.at(i) : nullptr;
+}
+
+/*!
+	\return the estimated memory used by the commands on the stack (in bytes)
+*/
+qint64 QDocumentUndoStack::memoryUsage() const
+{
+	return m_memory;
+}
+
+/*!
+	\return the number of bytes moved to the temporary spill file
+*/
+qint64 QDocumentUndoStack::spilledBytes() const
+{
+	return m_spillFile ? m_spillFile->size() : 0;
+}
+
+/*!
+	\brief Append \a data to the spill file
+	\return the offset of the data in the file or -1 on failure
+*/
+qint64 QDocumentUndoStack::spill(const QByteArray& data)
+{
+	if ( !m_spillFile )
+	{
+		m_spillFile = new QTemporaryFile(QDir::tempPath() + "/txs_undo_XXXXXX");
+		if ( !m_spillFile->open() )
+		{
+			delete m_spillFile;
+			m_spillFile = nullptr;
+			return -1;
+		}
+	}
+
+	qint64 offset = m_spillFile->size();
+	if ( !m_spillFile->seek(offset) || m_spillFile->write(data) != data.size() )
+		return -1;
+
+	return offset;
+}
+
+/*!
+	\brief Read back data written with spill()
+*/
+QByteArray QDocumentUndoStack::unspill(qint64 offset, int size)
+{
+	if ( !m_spillFile || !m_spillFile->seek(offset) )
+		return QByteArray();
+
+	return m_spillFile->read(size);
+}
+
+void QDocumentUndoStack::emitChanges(bool wasClean, bool couldUndo, bool couldRedo)
+{
+	if ( wasClean != isClean() )
+		emit cleanChanged(isClean());
+	if ( couldUndo != canUndo() )
+		emit canUndoChanged(canUndo());
+	if ( couldRedo != canRedo() )
+		emit canRedoChanged(canRedo());
+}
+
+void QDocumentUndoStack::updateUsage(int i)
+{
+	qint64 usage = m_commands.at(i)->memoryUsage();
+	m_memory += usage - m_usage.at(i);
+	m_usage[i] = usage;
+}
+
+void QDocumentUndoStack::compactHistory()
+{
+	for ( ; m_compacted < m_index - KeepUncompacted; ++m_compacted )
+	{
+		bool spill = m_spillEnabled && m_memoryLimit > 0 && m_memory > m_memoryLimit / 2;
+		m_commands.at(m_compacted)->compact(this, spill);
+		updateUsage(m_compacted);
+	}
+}
+
+/*!
+	\brief Delete all commands that could be undone, keeping those that can be redone
+*/
+void QDocumentUndoStack::dropUndoHistory()
+{
+	for ( ; m_index > 0; --m_index )
+	{
+		m_memory -= m_usage.takeFirst();
+		delete m_commands.takeFirst();
+
+		if ( m_cleanIndex >= 0 )
+			--m_cleanIndex;
+		if ( m_compacted > 0 )
+			--m_compacted;
+	}
+}
+
+void QDocumentUndoStack::enforceMemoryLimit()
+{
+	if ( m_memoryLimit <= 0 )
+		return;
+
+	// the most recent command always stays undoable
+	while ( m_memory > m_memoryLimit && m_index > 1 )
+	{
+		m_memory -= m_usage.takeFirst();
+		delete m_commands.takeFirst();
+
+		--m_index;
+		if ( m_cleanIndex >= 0 )
+			--m_cleanIndex; // becomes -1 (unreachable) when the clean state is dropped
+		if ( m_compacted > 0 )
+			--m_compacted;
+	}
+}
+
+/*! @} */
@@ -0,0 +1,94 @@
+/****************************************************************************
+**
+** This file is part of the TeXstudio project.
+**
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and appearing in the
+** file GPL.txt included in the packaging of this file.
+**
+** This file is provided AS IS with NO WARRANTY OF ANY KIND, INCLUDING THE
+** WARRANTY OF DESIGN, MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE.
+**
+****************************************************************************/
+
+#ifndef Header_QDocument_UndoStack
+#define Header_QDocument_UndoStack
+
+#include "qce-config.h"
+
+/*!
+	\file qdocumentundostack.h
+	\brief Definition of the QDocumentUndoStack class
+*/
+
+#include "modifiedQObject.h"
+
+#include <QObject>
+#include <QList>
+#include <QVector>
+
+class QTemporaryFile;
+class QDocumentCommand;
+
+class QCE_EXPORT QDocumentUndoStack : public QObject
+{
+	Q_OBJECT
+
+	public:
+		QDocumentUndoStack(QObject *p = nullptr);
+		virtual ~QDocumentUndoStack();
+
+		void push(QDocumentCommand *cmd);
+
+		void undo();
+		void redo();
+
+		bool canUndo() const;
+		bool canRedo() const;
+
+		void clear();
+
+		void setClean();
+		bool isClean() const;
+
+		int index() const;
+		int count() const;
+		const QDocumentCommand* command(int i) const;
+
+		qint64 memoryUsage() const;
+		qint64 spilledBytes() const;
+
+		qint64 spill(const QByteArray& data);
+		QByteArray unspill(qint64 offset, int size);
+
+		static qint64 memoryLimit();
+		static void setMemoryLimit(qint64 bytes);
+
+		static bool spillEnabled();
+		static void setSpillEnabled(bool spill);
+
+	signals:
+		void cleanChanged(bool clean);
+		void canUndoChanged(bool canUndo);
+		void canRedoChanged(bool canRedo);
+
+	private:
+		void emitChanges(bool wasClean, bool couldUndo, bool couldRedo);
+		void updateUsage(int i);
+		void compactHistory();
+		void dropUndoHistory();
+		void enforceMemoryLimit();
+
+		QList<QDocumentCommand*> m_commands;
+		QVector<qint64> m_usage;
+		qint64 m_memory;
+		int m_index, m_cleanIndex;
+		int m_compacted;
+
+		QTemporaryFile *m_spillFile;
+
+		static qint64 m_memoryLimit;
+		static bool m_spillEnabled;
+};
+
+#endif
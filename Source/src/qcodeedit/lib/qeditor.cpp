@@ -2643,14 +2643,39 @@ void QEditor::tabOrIndentSelection()
 void QEditor::insertTab()
 {
 	bool macroing = m_mirrors.count();
-	if (macroing) m_doc->beginMacro();
+	if (macroing) beginMirrorEdit();
 
 	insertTab(m_cursor);
 	for ( int i = 0; i < m_mirrors.count(); ++i ) {
 		insertTab(m_mirrors[i]);
 	}
 
-	if (macroing) m_doc->endMacro();
+	if (macroing) endMirrorEdit();
+}
+
+/*!
+	\internal
+	\brief Start an edit which is applied at every cursor mirror
+
+	The edits form a single undo step and their content changes are reported
+	merged when endMirrorEdit() is called, so the document is tokenized and
+	reparsed once instead of once per cursor. The same holds when the step
+	is undone or redone.
+*/
+void QEditor::beginMirrorEdit()
+{
+	m_doc->impl()->beginChangeBlock(true);
+	m_doc->beginDelayedUpdateBlock();
+}
+
+/*!
+	\internal
+	\brief End an edit started by beginMirrorEdit()
+*/
+void QEditor::endMirrorEdit()
+{
+	m_doc->endDelayedUpdateBlock();
+	m_doc->endMacro();
 }
 
 /*!
@@ -2664,7 +2689,7 @@ void QEditor::indentSelection()
 	
 	if ( m_mirrors.count() )
 	{
-		m_doc->beginMacro();
+		beginMirrorEdit();
 
 		if ( !protectedCursor(m_cursor) )
 			insertAtLineStart(m_cursor, txt);
@@ -2673,7 +2698,7 @@ void QEditor::indentSelection()
 			if ( !protectedCursor(m) )
 				insertAtLineStart(m, txt);
 
-		m_doc->endMacro();
+		endMirrorEdit();
 
 	} else if ( !protectedCursor(m_cursor) ) {
 		if ( !m_cursor.hasSelection() )
@@ -2708,7 +2733,7 @@ void QEditor::unindentSelection()
 {
 	if ( m_mirrors.count() )
 	{
-		m_doc->beginMacro();
+		beginMirrorEdit();
 
 		if ( !protectedCursor(m_cursor) )
 			unindent(m_cursor);
@@ -2718,7 +2743,7 @@ void QEditor::unindentSelection()
 				unindent(m);
 		}
 
-		m_doc->endMacro();
+		endMirrorEdit();
 
 	} else if ( !protectedCursor(m_cursor) ) {
 		if ( !m_cursor.hasSelection())
@@ -2755,7 +2780,7 @@ void QEditor::commentSelection()
 
 	if ( m_mirrors.count() )
 	{
-		m_doc->beginMacro();
+		beginMirrorEdit();
 
 		m_definition->clearMatches(m_doc);  // Matches are not handled inside comments. We have to remove them. Otherwise they will stay forever in the comment line.
 
@@ -2766,7 +2791,7 @@ void QEditor::commentSelection()
 			if ( !protectedCursor(m) )
 				insertAtLineStart(m, txt);
 
-		m_doc->endMacro();
+		endMirrorEdit();
 
 	} else if ( !protectedCursor(m_cursor) ) {
 		m_definition->clearMatches(m_doc);  // Matches are not handled inside comments. We have to remove them. Otherwise they will stay forever in the comment line.
@@ -2809,7 +2834,7 @@ void QEditor::uncommentSelection()
 
 	if ( m_mirrors.count() )
 	{
-		m_doc->beginMacro();
+		beginMirrorEdit();
 
 		if ( !protectedCursor(m_cursor) )
 			removeFromStart(m_cursor, txt);
@@ -2819,7 +2844,7 @@ void QEditor::uncommentSelection()
 				removeFromStart(m, txt);
 		}
 
-		m_doc->endMacro();
+		endMirrorEdit();
 
 	} else if ( !protectedCursor(m_cursor) ){
 		if ( !m_cursor.hasSelection() )
@@ -3482,7 +3507,7 @@ void QEditor::keyPressEvent(QKeyEvent *e)
 		bool macroing = isMirrored() || m_mirrors.count() > 0;
 
 		if ( macroing )
-			m_doc->beginMacro();
+			beginMirrorEdit();
 
 		//TODO: blocked key
 		if(!m_blockKey)
@@ -3520,7 +3545,7 @@ void QEditor::keyPressEvent(QKeyEvent *e)
 		}
 
 		if ( macroing )
-			m_doc->endMacro();
+			endMirrorEdit();
 
 	}
 
@@ -5390,7 +5415,7 @@ void QEditor::write(const QString& s)
 	document()->clearLanguageMatches();
 	
 	if (!m_mirrors.empty())
-		m_doc->beginMacro();
+		beginMirrorEdit();
 	
 	insertText(m_cursor, s);
 	
@@ -5398,7 +5423,7 @@ void QEditor::write(const QString& s)
 		insertText(m_mirrors[i], s);
 	
 	if (!m_mirrors.empty())
-		m_doc->endMacro();
+		endMirrorEdit();
 	
 	emitCursorPositionChanged();
 	setFlag(CursorOn, true);
@@ -5848,7 +5873,7 @@ void QEditor::insertFromMimeData(const QMimeData *d)
 										d->data("text/column-selection")
 									).split('\n');
 
-			m_doc->beginMacro();
+			beginMirrorEdit();
 
 			if ( m_cursor.hasSelection() )
 				m_cursor.removeSelectedText();
@@ -5879,7 +5904,7 @@ void QEditor::insertFromMimeData(const QMimeData *d)
 				addCursorMirror(c);
 			}
 
-			m_doc->endMacro();
+			endMirrorEdit();
 
 		} else {
 			QString txt;
@@ -5898,7 +5923,7 @@ void QEditor::insertFromMimeData(const QMimeData *d)
             bool macroing = true; //isMirrored() || m_mirrors.size();
 
 			if ( macroing )
-				m_doc->beginMacro();
+				beginMirrorEdit();
 
 			//if ( s )
 			//{
@@ -5930,7 +5955,7 @@ void QEditor::insertFromMimeData(const QMimeData *d)
 			}
 
 			if ( macroing )
-				m_doc->endMacro();
+				endMirrorEdit();
 			
 			if (slow) emit slowOperationEnded();
 		}
@@ -5982,10 +6007,17 @@ void QEditor::addCursorMirror(const QDocumentCursor& c)
 
 void QEditor::cursorMirrorsRemoveSelectedText()
 {
+	if ( m_mirrors.isEmpty() )
+		return;
+
+	m_doc->beginDelayedUpdateBlock();
+
 	for ( int i = 0; i < m_mirrors.count(); ++i )
 	{
 		m_mirrors[i].removeSelectedText();
 	}
+
+	m_doc->endDelayedUpdateBlock();
 }
 
 void QEditor::setCursorBold(bool bold)
@@ -6299,6 +6331,12 @@ void QEditor::addMarkDelayed(int pos, QColor color, QString type){
     scrlBar->addMark(pos,color,type);
     //scrlBar->repaint();
 }
+void QEditor::addMarkDelayed(QDocumentLineHandle *dlh, QColor color, QString type){
+    if(dlh==nullptr)
+        return;
+    MarkedScrollBar *scrlBar=qobject_cast<MarkedScrollBar*>(verticalScrollBar());
+    scrlBar->addMark(dlh,color,type);
+}
 void QEditor::paintMarks(){
     MarkedScrollBar *scrlBar=qobject_cast<MarkedScrollBar*>(verticalScrollBar());
     scrlBar->repaint();
@@ -371,6 +371,7 @@ class QCE_EXPORT QEditor : public QAbstractScrollArea
 
         void addMark(int pos,QColor color,QString type="");
         void addMarkDelayed(int pos, QColor color, QString type);
+        void addMarkDelayed(QDocumentLineHandle *dlh, QColor color, QString type);
         void addMark(QDocumentLineHandle *dlh, QColor color, QString type="");
         void addMarkRange(int start,int end,QColor color,QString type="");
         void removeMark(int pos, QString type="");
@@ -418,6 +419,8 @@ class QCE_EXPORT QEditor : public QAbstractScrollArea
 		
 	protected:
 		void insertTab(QDocumentCursor &cur);
+		void beginMirrorEdit();
+		void endMirrorEdit();
     public slots:
 		void tabOrIndentSelection();
 		void insertTab();
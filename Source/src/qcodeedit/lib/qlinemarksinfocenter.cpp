@@ -85,10 +85,27 @@ QLineMarkList QLineMarksInfoCenter::marks(const QString& file) const
 	QLineMarkList l;
 	bool check = file.count();
 	
+	// line numbers of the marked lines, from the mark index of each document instead of a search per mark
+	QHash<QDocument*, QHash<QDocumentLineHandle*, int> > markedLines;
+	
 	foreach ( QLineMarkHandle m, m_lineMarks )
 	{
-		if ( !check || (m.file == file) )
-			l << QLineMark(file, m.line->document()->indexOf(m.line) + 1, m.mark);
+		if ( check && (m.file != file) )
+			continue;
+		
+		QDocument *d = m.line->document();
+		QHash<QDocument*, QHash<QDocumentLineHandle*, int> >::iterator it = markedLines.find(d);
+		
+		if ( it == markedLines.end() )
+		{
+			it = markedLines.insert(d, QHash<QDocumentLineHandle*, int>());
+			
+			foreach ( int ln, d->linesWithMark(-1) )
+				it->insert(d->line(ln).handle(), ln);
+		}
+		
+		QHash<QDocumentLineHandle*, int>::const_iterator line = it->constFind(m.line);
+		l << QLineMark(file, (line != it->constEnd() ? *line : d->indexOf(m.line)) + 1, m.mark);
 	}
 	
 	return l;
@@ -133,6 +133,12 @@ bool QLineMarkPanel::paint(QPainter *p, QEditor *e)
 	n = d->lineNumber(contentsY);
 	posY = 2 + d->y(n) - contentsY;
 
+	// only the marked lines of the visible range are looked up
+	QVector<int> marked;
+	if ( realMarksPerLine )
+		marked = d->linesWithMark(-1, n, qMin(d->lineNumber(contentsY + pageBottom + ls), d->lines() - 1));
+	int nextMarked = 0;
+
 	//qDebug("first = %i; last = %i", first, last);
 	//qDebug("beg pos : %i", posY);
 	//qDebug("<session>");
@@ -150,7 +156,10 @@ bool QLineMarkPanel::paint(QPainter *p, QEditor *e)
 		m_lines << n;
         m_rects << QRectF(0, posY, width(), ls);
 
-		if ( realMarksPerLine )
+		while ( nextMarked < marked.count() && marked.at(nextMarked) < n )
+			++nextMarked;
+
+		if ( nextMarked < marked.count() && marked.at(nextMarked) == n )
 		{
 			int count = 1;
 			QList<int> lm = line.marks();
@@ -143,6 +143,11 @@ QSearchReplacePanel::QSearchReplacePanel(QWidget *p)
     bCount->setIconSize(buttonSize);
     flowLayout->addWidget(bCount);
 
+    lMatchCount = new QLabel(this);
+    lMatchCount->setObjectName(("lMatchCount"));
+    lMatchCount->setMinimumHeight(buttonSize.height());
+    flowLayout->addWidget(lMatchCount);
+
     QLabel *spacer = new QLabel("  ");
     flowLayout->addWidget(spacer);
 
@@ -621,6 +626,7 @@ void QSearchReplacePanel::findReplace(bool backward, bool replace, bool replaceA
 		else cFind->setFocus();
 		}*/
 	updateReplacementHint();
+	updateMatchCount();
 }
 
 void QSearchReplacePanel::find(QString text, bool backward, bool highlight, bool regex, bool word, bool caseSensitive, bool fromCursor, bool selection){
@@ -1127,13 +1133,14 @@ void QSearchReplacePanel::init()
 	                                  );
 
 
+	connect(m_search, SIGNAL(matchCountChanged()), SLOT(updateMatchCount()));
+
 	if ( cbSelection->isChecked() && editor()->cursor().hasSelection()){
 		m_search->setScope(editor()->cursor());
 	} else if ( cbCursor->isChecked() )
 		m_search->setCursor(editor()->cursor());
 
-
-
+	updateMatchCount();
 }
 
 void QSearchReplacePanel::cursorPositionChanged()
@@ -1151,7 +1158,25 @@ void QSearchReplacePanel::cursorPositionChanged()
 		}*/
 		if ( cbCursor->isChecked() )
 			m_search->setCursor(editor()->cursor());
+		if ( isVisible() )
+			updateMatchCount();
+	}
+}
+
+/*!
+	\brief Show the number of matches in the search scope and the one at the cursor as "k of N"
+*/
+void QSearchReplacePanel::updateMatchCount(){
+	if (!m_search || !m_search->hasOption(QDocumentSearch::HighlightAll) || m_search->searchText().isEmpty()) {
+		lMatchCount->setText("");
+		return;
+	}
+	int count = m_search->matchCount();
+	if (count < 0) {
+		lMatchCount->setText(tr("counting..."));
+		return;
 	}
+	lMatchCount->setText(tr("%1 of %2").arg(m_search->matchIndex(editor()->cursor())).arg(count));
 }
 
 void QSearchReplacePanel::updateReplacementHint(){
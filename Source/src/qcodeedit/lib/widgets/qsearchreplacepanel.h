@@ -112,6 +112,7 @@ class QCE_EXPORT QSearchReplacePanel : public QPanel //, private Ui::SearchRepla
 		
 		void cursorPositionChanged();
 		void updateReplacementHint();
+		void updateMatchCount();
 
 	private:
 		void init();
@@ -154,6 +155,7 @@ class QCE_EXPORT QSearchReplacePanel : public QPanel //, private Ui::SearchRepla
         QToolButton *cbPrompt;
         QToolButton *cbEscapeSeq;
         QLabel *lReplacementText;
+        QLabel *lMatchCount;
 		
 		bool useLineForSearch, searchOnlyInSelection;
 
@@ -27,6 +27,8 @@ HEADERS += $$PWD/lib/qce-config.h \
     $$PWD/lib/document/qdocument.h \
     $$PWD/lib/document/qdocument_p.h \
     $$PWD/lib/document/qdocumentcommand.h \
+    $$PWD/lib/document/qdocumentjournal.h \
+    $$PWD/lib/document/qdocumentundostack.h \
     $$PWD/lib/document/qdocumentcursor.h \
     $$PWD/lib/document/qdocumentline.h \
     $$PWD/lib/document/qdocumentsearch.h \
@@ -57,6 +59,8 @@ SOURCES += $$PWD/lib/qeditor.cpp \
     $$PWD/lib/qformat.cpp \
     $$PWD/lib/document/qdocument.cpp \
     $$PWD/lib/document/qdocumentcommand.cpp \
+    $$PWD/lib/document/qdocumentjournal.cpp \
+    $$PWD/lib/document/qdocumentundostack.cpp \
     $$PWD/lib/document/qdocumentcursor.cpp \
     $$PWD/lib/document/qdocumentcursor_p.h \
     $$PWD/lib/document/qdocumentline.cpp \
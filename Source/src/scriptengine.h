@@ -29,6 +29,9 @@ class scriptengine : public QObject {
 		void setScript(const QString & script,bool allowWrite = false);
 		void setEditorView(LatexEditorView *);
 
+		static scriptengine * acquire();
+		static void release(scriptengine *);
+
 		static BuildManager * buildManager;
 		static Texstudio * app;
 
@@ -68,7 +71,7 @@ class scriptengine : public QObject {
 		QVariant readFile(const QString & filename);
 		QVariant getPersistent(const QString &name);
 
-		bool setTimeout(const QString &fun,const int timeout);
+		bool setTimeout(const QJSValue & function,const int timeout);
 		bool hasPersistent(const QString & name);
 
 		void writeFile(const QString & filename,const QString & content);
@@ -76,7 +79,8 @@ class scriptengine : public QObject {
 		void registerAsBackgroundScript(const QString & name = "");
 		void save(const QString fn = "");
 		void saveCopy(const QString & fileName);
-		void runTimed(const QString fun);
+		void runTimed(QJSValue function);
+		void connectionMade();
 
 	protected:
 
@@ -91,6 +95,10 @@ class scriptengine : public QObject {
 
 		QJSEngine * engine;
 
+		void setupGlobals();
+		void resetGlobals();
+		QJSValue compiled(const QString & script);
+
 		QJSValue searchReplaceFunction(QJSValue searchText,QJSValue,QJSValue,QJSValue,bool replace);
 
 		QPointer<LatexEditorView> m_editorView;
@@ -99,6 +107,12 @@ class scriptengine : public QObject {
 
 		bool m_allowWrite;
 
+		bool m_pooled , m_background;
+		QSet<QString> m_stableGlobals; // set up once, kept between runs
+		QHash<QString,QJSValue> m_compiled; // script source -> function
+
+		static QList<scriptengine *> pool;
+
 		static int writeSecurityMode , readSecurityMode;
 		static QStringList privilegedReadScripts , privilegedWriteScripts;
 
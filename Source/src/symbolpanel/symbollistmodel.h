@@ -13,6 +13,7 @@ struct SymbolItem {
 	QString packages;
 	QString iconFile;
 	QIcon icon;
+	QIcon rasterisedIcon; // from the icon atlas, see SymbolListModel::loadIconAtlas
 };
 
 
@@ -55,6 +56,8 @@ signals:
 
 protected:
 	void loadSymbols(const QString &category, const QStringList &fileNames);
+	void loadIconAtlas(const QString &category);
+	bool rasterisedIcons() const;
 	QIcon getIcon(const SymbolItem &item) const;
 	QString getTooltip(const SymbolItem &item) const;
 
@@ -62,6 +65,7 @@ private:
 	QList<SymbolItem> symbols;
 	QHash<QString, int> usageCount;
 	QStringList favoriteIds;
+	QHash<QString, QString> categorySignatures; // of the symbol files, invalidates the icon atlas
     bool m_darkMode;
 };
 
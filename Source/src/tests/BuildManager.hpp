@@ -6,6 +6,7 @@
 
 #include "mostQtHeaders.h"
 #include "buildmanager.h"
+#include <QTemporaryDir>
 #include <QtTest/QtTest>
 #include "tests/Util.hpp"
 
@@ -246,9 +247,121 @@ class BuildManagerTest : public QObject {
 			QEQUAL(stdErr,expectedStdErr);
 		}
 
+		void skipUnchangedSteps_index(){
+
+			QTemporaryDir dir;
+			QFileInfo mainFile(dir.filePath("main.tex"));
+			writeFile(dir.filePath("main.tex"),"\\makeindex");
+			writeFile(dir.filePath("main.idx"),"\\indexentry{a}{1}\n");
+			writeFile(dir.filePath("main.ind"),"");
+
+			CommandToRun cmd("makeindex main.idx");
+			cmd.parentCommand = "makeindex";
+			QString key = mainFile.absoluteFilePath() + "\nmakeindex";
+
+			BuildManager::StepInputs inputs;
+			QVERIFY(bm -> collectStepInputs(cmd,mainFile,inputs));
+			QVERIFY(!bm -> stepInputsUnchanged(key,inputs));
+			bm -> lastStepInputs.insert(key,inputs.hashes);
+			QVERIFY(bm -> stepInputsUnchanged(key,inputs));
+
+			writeFile(dir.filePath("main.idx"),"\\indexentry{a}{1}\n\\indexentry{b}{2}\n");
+			QVERIFY(!stepUnchanged(cmd,mainFile,key));
+
+			// only the content counts, not the modification time
+			writeFile(dir.filePath("main.idx"),"\\indexentry{a}{1}\n");
+			QVERIFY(stepUnchanged(cmd,mainFile,key));
+
+			QFile::remove(dir.filePath("main.ind"));
+			QVERIFY(!stepUnchanged(cmd,mainFile,key));
+
+			bm -> lastStepInputs.remove(key);
+		}
+
+		void skipUnchangedSteps_bibtex(){
+
+			QTemporaryDir dir;
+			QFileInfo mainFile(dir.filePath("main.tex"));
+			writeFile(dir.filePath("main.tex"),"\\cite{a}\\bibliography{refs}");
+			writeFile(dir.filePath("main.aux"),"\\relax\n\\citation{a}\n\\bibdata{refs}\n\\bibstyle{plain}\n");
+			writeFile(dir.filePath("refs.bib"),"@book{a, title={A}}\n");
+			writeFile(dir.filePath("main.bbl"),"");
+
+			CommandToRun cmd("bibtex main");
+			cmd.parentCommand = "bibtex";
+			QString key = mainFile.absoluteFilePath() + "\nbibtex";
+
+			BuildManager::StepInputs inputs;
+			QVERIFY(bm -> collectStepInputs(cmd,mainFile,inputs));
+			QVERIFY(inputs.hashes.contains(QFileInfo(dir.filePath("refs.bib")).absoluteFilePath()));
+			bm -> lastStepInputs.insert(key,inputs.hashes);
+
+			// labels and other aux content do not matter to bibtex
+			writeFile(dir.filePath("main.aux"),"\\relax\n\\citation{a}\n\\newlabel{x}{{1}{1}}\n\\bibdata{refs}\n\\bibstyle{plain}\n");
+			QVERIFY(stepUnchanged(cmd,mainFile,key));
+
+			writeFile(dir.filePath("main.aux"),"\\relax\n\\citation{a}\n\\citation{b}\n\\bibdata{refs}\n\\bibstyle{plain}\n");
+			QVERIFY(!stepUnchanged(cmd,mainFile,key));
+
+			writeFile(dir.filePath("main.aux"),"\\relax\n\\citation{a}\n\\bibdata{refs}\n\\bibstyle{plain}\n");
+			QVERIFY(stepUnchanged(cmd,mainFile,key));
+
+			writeFile(dir.filePath("refs.bib"),"@book{a, title={Another A}}\n");
+			QVERIFY(!stepUnchanged(cmd,mainFile,key));
+
+			// databases found by kpathsea cannot be tracked
+			writeFile(dir.filePath("main.aux"),"\\relax\n\\citation{a}\n\\bibdata{elsewhere}\n");
+			QVERIFY(!bm -> collectStepInputs(cmd,mainFile,inputs));
+
+			bm -> lastStepInputs.remove(key);
+		}
+
+		void skipUnchangedSteps_latex(){
+
+			QTemporaryDir dir;
+			QString dirPath = QFileInfo(dir.path()).absoluteFilePath();
+			QFileInfo mainFile(dir.filePath("main.tex"));
+			writeFile(dir.filePath("main.tex"),"\\input{chapter}");
+			writeFile(dir.filePath("chapter.tex"),"text");
+			writeFile(dir.filePath("main.fls"),QString("PWD %1\nINPUT %1/main.tex\nINPUT chapter.tex\nINPUT /nonexistent/texmf/article.cls\nOUTPUT main.pdf\n").arg(dirPath).toUtf8());
+			writeFile(dir.filePath("main.pdf"),"");
+
+			CommandToRun cmd("pdflatex -interaction=nonstopmode main.tex");
+			cmd.parentCommand = "pdflatex";
+			cmd.flags = RCF_COMPILES_TEX;
+
+			// a leftover recorder file is not rewritten by compiles without -recorder
+			BuildManager::StepInputs inputs;
+			QVERIFY(!bm -> collectStepInputs(cmd,mainFile,inputs));
+
+			cmd.command = "pdflatex -interaction=nonstopmode -recorder main.tex";
+			QString key = mainFile.absoluteFilePath() + "\npdflatex";
+			QVERIFY(bm -> collectStepInputs(cmd,mainFile,inputs));
+			QVERIFY(inputs.hashes.contains(dirPath + "/main.tex"));
+			QVERIFY(inputs.hashes.contains(dirPath + "/chapter.tex"));
+			QVERIFY(inputs.hashes.contains("/nonexistent/texmf/article.cls"));
+			bm -> lastStepInputs.insert(key,inputs.hashes);
+
+			writeFile(dir.filePath("chapter.tex"),"changed text");
+			QVERIFY(!stepUnchanged(cmd,mainFile,key));
+
+			bm -> lastStepInputs.remove(key);
+		}
+
 
 	private:
 
+		static void writeFile(const QString & fileName,const QByteArray & content){
+			QFile f(fileName);
+			QVERIFY(f.open(QFile::WriteOnly));
+			f.write(content);
+		}
+
+		bool stepUnchanged(const CommandToRun & cmd,const QFileInfo & mainFile,const QString & key){
+			BuildManager::StepInputs inputs;
+			return bm -> collectStepInputs(cmd,mainFile,inputs) && bm -> stepInputsUnchanged(key,inputs);
+		}
+
 		QMap<QString,QString> cmdToResult = {
 			{ "mocka" , "coffee" },
 			{ "mockb" , "foobar -test -xyz -maus=haus --maus=laus -abc -maus=\"test test test\" end" },
@@ -0,0 +1,183 @@
+#ifndef QT_NO_DEBUG
+#include "DictionaryImage.hpp"
+
+#include "SpellerUtility.hpp"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+using QTest::addColumn;
+using QTest::addRow;
+
+static const QString baseWords = "cat/S\ndog/S\nhouse/S po:noun\nword ph:wrod\n";
+
+// offsets of fields in the image header of hashmgr.cxx
+static const int imageHeaderSize = 96;
+static const int tableOffsetField = 80;
+static const int repOffsetField = 88;
+
+
+Test::DictionaryImage::DictionaryImage()
+	: dir(nullptr){}
+
+Test::DictionaryImage::~DictionaryImage(){}
+
+void Test::DictionaryImage::initTestCase(){
+
+	#ifndef HUNSPELL_STATIC
+		QSKIP("the system Hunspell library has no dictionary images");
+	#endif
+
+	dir = new QTemporaryDir();
+	QVERIFY(dir -> isValid());
+
+	affFile = dir -> filePath("test.aff");
+	dicFile = dir -> filePath("test.dic");
+	imageFile = dir -> filePath("test.img");
+
+	QFile aff(affFile);
+	QVERIFY(aff.open(QFile::WriteOnly));
+	aff.write("SET UTF-8\nSFX S Y 1\nSFX S 0 s .\n");
+}
+
+void Test::DictionaryImage::cleanupTestCase(){
+	delete dir;
+}
+
+void Test::DictionaryImage::init(){
+
+	writeDictionary(baseWords);
+	QFile::remove(imageFile);
+}
+
+void Test::DictionaryImage::writeDictionary(const QString & words){
+
+	QFile dic(dicFile);
+	QVERIFY(dic.open(QFile::WriteOnly));
+	dic.write(QString("%1\n%2").arg(words.count('\n')).arg(words).toUtf8());
+}
+
+QByteArray Test::DictionaryImage::readImage(){
+
+	QFile image(imageFile);
+
+	if(!image.open(QFile::ReadOnly))
+		return QByteArray();
+
+	return image.readAll();
+}
+
+void Test::DictionaryImage::writeImage(const QByteArray & data){
+
+	QFile image(imageFile);
+	QVERIFY(image.open(QFile::WriteOnly));
+	image.write(data);
+}
+
+void Test::DictionaryImage::checkWords(const QStringList & correct,const QStringList & wrong){
+#ifdef HUNSPELL_STATIC
+	Hunspell hunspell(affFile.toLocal8Bit(),dicFile.toLocal8Bit(),nullptr,imageFile.toLocal8Bit());
+
+	for(const QString & word : correct)
+		QVERIFY2(hunspell.spell(word.toStdString()),qPrintable(word));
+
+	for(const QString & word : wrong)
+		QVERIFY2(!hunspell.spell(word.toStdString()),qPrintable(word));
+
+	// the REP entries from ph: fields come from the image as well
+	if(correct.contains("word")){
+		const auto suggestions = hunspell.suggest("wrod");
+		QVERIFY(std::find(suggestions.begin(),suggestions.end(),std::string("word")) != suggestions.end());
+	}
+#else
+	Q_UNUSED(correct)
+	Q_UNUSED(wrong)
+#endif
+}
+
+void Test::DictionaryImage::roundTrip(){
+
+	const QStringList correct = { "cat" , "cats" , "dogs" , "house" , "word" };
+	const QStringList wrong = { "cow" , "words" , "wrod" };
+
+	checkWords(correct,wrong);
+
+	const QByteArray image = readImage();
+	QVERIFY(image.size() > imageHeaderSize);
+
+	// an image which is used as is, is not written again
+	const QDateTime old = QDateTime::currentDateTime().addDays(-1);
+	{
+		QFile f(imageFile);
+		QVERIFY(f.open(QFile::ReadWrite));
+		QVERIFY(f.setFileTime(old,QFileDevice::FileModificationTime));
+	}
+
+	checkWords(correct,wrong);
+
+	QEQUAL(QFileInfo(imageFile).lastModified().toMSecsSinceEpoch(),old.toMSecsSinceEpoch());
+	QVERIFY(readImage() == image);
+}
+
+void Test::DictionaryImage::damagedImage_data(){
+
+	addColumn<int>("offset");
+	addColumn<int>("length");
+	addColumn<char>("fill");
+
+	// a length of -1 truncates the image at the offset
+	addRow("truncated") << imageHeaderSize + 8 << -1 << '\0';
+	addRow("table offset") << tableOffsetField << 8 << '\x7f';
+	addRow("rep offset") << repOffsetField << 8 << '\x7f';
+	addRow("table pointers") << imageHeaderSize << 64 << '\xff';
+	addRow("everything") << imageHeaderSize << (1 << 24) << '\x3f';
+}
+
+void Test::DictionaryImage::damagedImage(){
+
+	QFETCH(int,offset);
+	QFETCH(int,length);
+	QFETCH(char,fill);
+
+	checkWords({ "cats" },{});
+
+	QByteArray image = readImage();
+	QVERIFY(image.size() > imageHeaderSize);
+
+	if(length < 0){
+		image.truncate(offset);
+	}else{
+		length = qMin(length,image.size() - offset);
+		image.replace(offset,length,QByteArray(length,fill));
+	}
+
+	writeImage(image);
+
+	// the dictionary is parsed again and the image is replaced
+	checkWords({ "cat" , "cats" , "dogs" , "house" , "word" },{ "cow" , "wrod" });
+
+	const QByteArray rewritten = readImage();
+	QVERIFY(rewritten != image);
+	QVERIFY(rewritten.size() > imageHeaderSize);
+}
+
+void Test::DictionaryImage::staleImage(){
+
+	checkWords({ "dog" },{ "cow" });
+
+	const QDateTime modified = QFileInfo(dicFile).lastModified();
+
+	// same size and a modification time in the same second
+	writeDictionary(QString(baseWords).replace("dog","cow"));
+	{
+		QFile f(dicFile);
+		QVERIFY(f.open(QFile::ReadWrite));
+		QVERIFY(f.setFileTime(modified.addMSecs(modified.time().msec() < 500 ? 1 : -1),QFileDevice::FileModificationTime));
+	}
+
+	if(QFileInfo(dicFile).lastModified() == modified)
+		QSKIP("the file system has no sub-second modification times");
+
+	checkWords({ "cow" , "cows" },{ "dog" });
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef Test_DictionaryImage
+#define Test_DictionaryImage
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QTemporaryDir;
+
+testclass(DictionaryImage){
+
+	Q_OBJECT
+
+	private:
+
+		QTemporaryDir * dir;
+		QString affFile;
+		QString dicFile;
+		QString imageFile;
+
+		void writeDictionary(const QString & words);
+		void checkWords(const QStringList & correct,const QStringList & wrong);
+		QByteArray readImage();
+		void writeImage(const QByteArray & data);
+
+	private slots:
+
+		void initTestCase();
+		void cleanupTestCase();
+		void init();
+
+		testcase( roundTrip );
+		testcase( damagedImage_data );
+		testcase( damagedImage );
+		testcase( staleImage );
+
+	public:
+
+		DictionaryImage();
+		~DictionaryImage();
+
+};
+
+
+#endif
+#endif
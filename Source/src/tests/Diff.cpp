@@ -0,0 +1,172 @@
+#ifndef QT_NO_DEBUG
+#include "tests/Diff.hpp"
+
+#include "diffoperations.h"
+#include "qdocumentline.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+using QTest::addColumn;
+using QTest::addRow;
+
+
+static QString typeName(DiffOp::DiffType type){
+	switch(type){
+	case DiffOp::Insert : return "Insert";
+	case DiffOp::Delete : return "Delete";
+	case DiffOp::Replace : return "Replace";
+	default : return QString::number(type);
+	}
+}
+
+// one line per DiffOp: line: type start+length 'text' -> 'line of the other document'
+
+static QString markersOf(LatexDocument & doc){
+
+	QStringList markers;
+
+	for(int l = 0;l < doc.lines();l++){
+
+		const auto ops = doc.line(l).getCookie(QDocumentLine::DIFF_LIST_COOCKIE).value<DiffList>();
+
+		for(const auto & op : ops)
+			markers << QString("%1: %2 %3+%4 '%5' -> '%6'")
+				.arg(l)
+				.arg(typeName(op.type))
+				.arg(op.start)
+				.arg(op.length)
+				.arg(op.text)
+				.arg(op.dlh ? QDocumentLine(op.dlh).text() : "-");
+	}
+
+	return markers.join("\n");
+}
+
+// the diff of the complete texts, as diffDocs computed it before it compared lines first
+
+static QList<Diff> textDiff(const QString & text,const QString & text2){
+
+	diff_match_patch dmp;
+
+	auto diffs = dmp.diff_main(text,text2,true);
+	dmp.diff_cleanupSemantic(diffs);
+
+	return diffs;
+}
+
+static QString numberedLines(int count,const QMap<int,QString> & changed){
+
+	QStringList lines;
+
+	for(int l = 0;l < count;l++)
+		lines << changed.value(l,QString("Line %1 of the chapter with \\textbf{words}.").arg(l));
+
+	return lines.join("\n");
+}
+
+
+void Test::Diff::markers_data(){
+
+	addColumn<QString>("text");
+	addColumn<QString>("text2");
+	addColumn<QString>("markers");
+	addColumn<QString>("merged");
+
+	addRow("unchanged")
+		<< "a\nb\nc" << "a\nb\nc"
+		<< ""
+		<< "a\nb\nc";
+
+	addRow("inserted line")
+		<< "a\nb\nc" << "a\nb\nx\nc"
+		<< "2: Insert 0+1 '' -> 'x'\n"
+		   "3: Insert 0+0 '' -> 'c'"
+		<< "a\nb\nx\nc";
+
+	addRow("deleted line")
+		<< "a\nb\nc" << "a\nc"
+		<< "1: Delete 0+1 '' -> '-'\n"
+		   "2: Delete 0+0 '' -> '-'"
+		<< "a\nb\nc";
+
+	addRow("changed line")
+		<< "a\nb\nc" << "a\nd\nc"
+		<< "1: Delete 0+1 '' -> '-'\n"
+		   "1: Insert 1+1 '' -> 'd'"
+		<< "a\nbd\nc";
+}
+
+void Test::Diff::markers(){
+
+	QFETCH(QString,text);
+	QFETCH(QString,text2);
+	QFETCH(QString,markers);
+	QFETCH(QString,merged);
+
+	LatexDocument doc , doc2;
+	doc.setText(text,false);
+	doc2.setText(text2,false);
+
+	diffDocs(& doc,& doc2);
+
+	QEQUAL(markersOf(doc),markers);
+	QEQUAL(doc.text(),merged);
+}
+
+void Test::Diff::sameAsTextDiff_data(){
+
+	addColumn<QString>("text");
+	addColumn<QString>("text2");
+
+	addRow("unchanged")
+		<< "a\nb\nc" << "a\nb\nc";
+
+	addRow("empty")
+		<< "" << "a\nb";
+
+	addRow("emptied")
+		<< "a\nb" << "";
+
+	addRow("word")
+		<< "a\nhello world\nc" << "a\nhello there\nc";
+
+	addRow("first and last line")
+		<< "first\nb\nlast" << "1st\nb\nthe end";
+
+	addRow("lines inserted and deleted")
+		<< "a\nb\nc\nd\ne" << "a\nx\ny\nb\nd\ne\nz";
+
+	addRow("lines split and joined")
+		<< "a\nb c\nd\ne" << "a\nb\nc\nd e";
+
+	addRow("distant changes")
+		<< numberedLines(60,{})
+		<< numberedLines(60,{
+			{ 5 , "Line 5 of the chapter with \\emph{words}." } ,
+			{ 30 , "\\section{Results}" } ,
+			{ 55 , "Line 55 of the section with \\textbf{words}." } });
+}
+
+void Test::Diff::sameAsTextDiff(){
+
+	// comparing lines first must not change the markers
+
+	QFETCH(QString,text);
+	QFETCH(QString,text2);
+
+	LatexDocument doc , doc2;
+	doc.setText(text,false);
+	doc2.setText(text2,false);
+
+	LatexDocument reference , reference2;
+	reference.setText(text,false);
+	reference2.setText(text2,false);
+
+	diffDocs(& doc,& doc2);
+	diffAddMarkers(& reference,& reference2,textDiff(text,text2));
+
+	QEQUAL(markersOf(doc),markersOf(reference));
+	QEQUAL(doc.text(),reference.text());
+}
+
+#endif
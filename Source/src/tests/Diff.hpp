@@ -0,0 +1,24 @@
+#ifndef Test_Diff
+#define Test_Diff
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+testclass(Diff){
+
+	Q_OBJECT
+
+	private slots:
+
+		testcase( markers_data );
+		testcase( markers );
+		testcase( sameAsTextDiff_data );
+		testcase( sameAsTextDiff );
+
+};
+
+
+#endif
+#endif
@@ -0,0 +1,177 @@
+#ifndef QT_NO_DEBUG
+#include "DocumentDelayedUpdates.hpp"
+
+//----
+//force full access to qdocument things
+#define private public
+#include "qdocument_p.h"
+#undef private
+//----
+
+#include "qdocument.h"
+#include "qdocumentcursor.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+using QTest::addColumn;
+using QTest::addRow;
+
+// ranges are written as "first:count,first:count,..."
+
+static QList<QPair<int,int>> parseRanges(const QString & ranges){
+
+	QList<QPair<int,int>> result;
+
+	for(const QString & range : ranges.split(',',Qt::SkipEmptyParts)){
+		const QStringList parts = range.split(':');
+		result << qMakePair(parts[0].toInt(),parts[1].toInt());
+	}
+
+	return result;
+}
+
+static QString formatRanges(const QList<QPair<int,int>> & ranges){
+
+	QStringList result;
+
+	for(const auto & range : ranges)
+		result << QString("%1:%2").arg(range.first).arg(range.second);
+
+	return result.join(',');
+}
+
+static QString formatSignals(const QSignalSpy & spy){
+
+	QList<QPair<int,int>> ranges;
+
+	for(const QList<QVariant> & arguments : spy)
+		ranges << qMakePair(arguments[0].toInt(),arguments[1].toInt());
+
+	return formatRanges(ranges);
+}
+
+
+Test::DocumentDelayedUpdates::DocumentDelayedUpdates(){
+	doc = new QDocument(this);
+}
+
+Test::DocumentDelayedUpdates::~DocumentDelayedUpdates(){}
+
+void Test::DocumentDelayedUpdates::init(){
+
+	QStringList lines;
+
+	for(int i = 0;i < 300;i++)
+		lines << QString("line %1").arg(i);
+
+	doc -> setText(lines.join("\n"),false);
+	doc -> clearUndo();
+}
+
+void Test::DocumentDelayedUpdates::shiftDelayedUpdates_data(){
+
+	addColumn<QString>("ranges");
+	addColumn<int>("line");
+	addColumn<int>("count");
+	addColumn<QString>("expected");
+
+	addRow("insert before") << "10:2" << 5 << 3 << "13:2";
+	addRow("insert at start") << "10:2" << 10 << 1 << "11:2";
+	addRow("insert inside") << "10:4" << 12 << 2 << "10:6";
+	addRow("insert at end") << "10:2" << 12 << 5 << "10:2";
+	addRow("insert between") << "10:2,20:1" << 15 << 4 << "10:2,24:1";
+	addRow("remove before") << "10:2" << 2 << -3 << "7:2";
+	addRow("remove up to start") << "10:2" << 7 << -3 << "7:2";
+	addRow("remove overlapping start") << "10:4" << 8 << -4 << "8:2";
+	addRow("remove inside") << "10:6" << 12 << -2 << "10:4";
+	addRow("remove overlapping end") << "10:4" << 12 << -5 << "10:2";
+	addRow("remove all lines") << "10:2" << 9 << -4 << "";
+	addRow("remove after") << "10:2" << 20 << -5 << "10:2";
+	addRow("remove one of two") << "10:2,20:1" << 19 << -3 << "10:2";
+}
+
+void Test::DocumentDelayedUpdates::shiftDelayedUpdates(){
+
+	QFETCH(QString,ranges);
+	QFETCH(int,line);
+	QFETCH(int,count);
+	QFETCH(QString,expected);
+
+	QDocumentPrivate * d = doc -> impl();
+	d -> m_delayedUpdates = parseRanges(ranges);
+	d -> shiftDelayedUpdates(line,count);
+
+	QEQUAL(formatRanges(d -> m_delayedUpdates),expected);
+	d -> m_delayedUpdates.clear();
+}
+
+void Test::DocumentDelayedUpdates::mergeRanges_data(){
+
+	addColumn<QString>("ranges");
+	addColumn<QString>("expected");
+
+	addRow("single") << "10:3" << "10:3";
+	addRow("gap of 64 lines") << "10:1,75:1" << "10:66";
+	addRow("gap of 65 lines") << "10:1,76:1" << "10:1,76:1";
+	addRow("overlapping") << "5:10,8:2" << "5:10";
+	addRow("unsorted") << "200:2,20:5,10:1" << "10:15,200:2";
+	addRow("column edit") << "100:1,101:1,102:1,103:1,250:1" << "100:4,250:1";
+	addRow("beyond the document") << "290:50" << "290:10";
+}
+
+void Test::DocumentDelayedUpdates::mergeRanges(){
+
+	QFETCH(QString,ranges);
+	QFETCH(QString,expected);
+
+	QSignalSpy spy(doc,SIGNAL(contentsChange(int,int)));
+
+	QDocumentPrivate * d = doc -> impl();
+	d -> beginDelayedUpdateBlock();
+	d -> m_delayedUpdates = parseRanges(ranges);
+	d -> endDelayedUpdateBlock();
+
+	QEQUAL(formatSignals(spy),expected);
+	QVERIFY(d -> m_delayedUpdates.isEmpty());
+}
+
+void Test::DocumentDelayedUpdates::undoMirrorEdit(){
+
+	QDocumentPrivate * d = doc -> impl();
+
+	// an edit at every mirror, as QEditor::beginMirrorEdit() does it
+	d -> beginChangeBlock(true);
+	doc -> beginDelayedUpdateBlock();
+
+	for(int line : { 10 , 12 , 14 })
+		QDocumentCursor(doc,line,0).insertText("x");
+
+	doc -> endDelayedUpdateBlock();
+	doc -> endMacro();
+
+	// a plain macro is undone command by command
+	doc -> beginMacro();
+
+	for(int line : { 20 , 200 })
+		QDocumentCursor(doc,line,0).insertText("y");
+
+	doc -> endMacro();
+
+	QSignalSpy spy(doc,SIGNAL(contentsChange(int,int)));
+
+	doc -> undo();
+	QEQUAL(formatSignals(spy),QString("200:1,20:1"));
+	QEQUAL(d -> m_delayedUpdateBlocks,0);
+
+	spy.clear();
+	doc -> undo();
+	QEQUAL(formatSignals(spy),QString("10:5"));
+	QEQUAL(doc -> line(12).text(),QString("line 12"));
+
+	spy.clear();
+	doc -> redo();
+	QEQUAL(formatSignals(spy),QString("10:5"));
+	QEQUAL(doc -> line(14).text(),QString("xline 14"));
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef Test_DocumentDelayedUpdates
+#define Test_DocumentDelayedUpdates
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QDocument;
+
+testclass(DocumentDelayedUpdates){
+
+	Q_OBJECT
+
+	private:
+
+		QDocument * doc;
+
+	private slots:
+
+		void init();
+
+		testcase( shiftDelayedUpdates_data );
+		testcase( shiftDelayedUpdates );
+		testcase( mergeRanges_data );
+		testcase( mergeRanges );
+		testcase( undoMirrorEdit );
+
+	public:
+
+		DocumentDelayedUpdates();
+		~DocumentDelayedUpdates();
+
+};
+
+
+#endif
+#endif
@@ -0,0 +1,183 @@
+#ifndef QT_NO_DEBUG
+#include "DocumentJournal.hpp"
+
+#include "qdocument.h"
+#include "qdocumentcursor.h"
+#include "qdocumentjournal.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+using QTest::addColumn;
+using QTest::addRow;
+
+static const QString baseText = "\\section{a}\nfirst line\nsecond line\n\nlast line";
+
+
+Test::DocumentJournal::DocumentJournal()
+	: dir(nullptr)
+	, savedCompactionThreshold(0){}
+
+Test::DocumentJournal::~DocumentJournal(){}
+
+void Test::DocumentJournal::initTestCase(){
+
+	savedJournalDirectory = QDocumentJournal::journalDirectory();
+	savedCompactionThreshold = QDocumentJournal::compactionThreshold();
+
+	dir = new QTemporaryDir();
+	QVERIFY(dir -> isValid());
+	QDocumentJournal::setJournalDirectory(dir -> filePath("journal"));
+
+	fileName = dir -> filePath("journaled.tex");
+	QFile f(fileName);
+	QVERIFY(f.open(QFile::WriteOnly));
+	f.write(baseText.toUtf8());
+}
+
+void Test::DocumentJournal::cleanupTestCase(){
+
+	QDocumentJournal::setJournalDirectory(savedJournalDirectory);
+	QDocumentJournal::setCompactionThreshold(savedCompactionThreshold);
+	delete dir;
+}
+
+void Test::DocumentJournal::cleanup(){
+
+	QDocumentJournal::setCompactionThreshold(savedCompactionThreshold);
+	QDocumentJournal::discardRecoveryData(fileName);
+}
+
+QDocument * Test::DocumentJournal::loadPlain(){
+
+	QDocument * doc = new QDocument(this);
+	doc -> load(fileName,nullptr);
+	doc -> setFileName_DONOTCALLTHIS(fileName);
+	return doc;
+}
+
+QDocument * Test::DocumentJournal::loadJournaled(){
+
+	QDocument * doc = loadPlain();
+	doc -> startJournal();
+	return doc;
+}
+
+void Test::DocumentJournal::recordReplay_data(){
+
+	// every edit is "line,column,text" for an insertion or "line,column,endLine,endColumn" for an erasure
+
+	addColumn<QStringList>("edits");
+
+	addRow("insert") << QStringList{ "1,5,ly" };
+	addRow("insert line break") << QStringList{ "2,6,\n" };
+	addRow("insert lines") << QStringList{ "0,0,% header\n%\n" };
+	addRow("erase") << QStringList{ "1,0,1,6" };
+	addRow("erase lines") << QStringList{ "0,3,3,0" };
+	addRow("mixed") << QStringList{ "4,4,\nnew\nlines", "1,0,2,7", "5,3,x", "0,0,4,1", "0,0,y" };
+	addRow("erase all") << QStringList{ "0,0,4,9" };
+}
+
+void Test::DocumentJournal::recordReplay(){
+
+	QFETCH(QStringList,edits);
+
+	QDocument * doc = loadJournaled();
+
+	for(const QString & edit : edits){
+
+		QStringList parts = edit.split(',');
+
+		if(parts.size() == 3){
+			QDocumentCursor c(doc,parts[0].toInt(),parts[1].toInt());
+			c.insertText(parts[2]);
+		}else{
+			QDocumentCursor c(doc,parts[0].toInt(),parts[1].toInt(),parts[2].toInt(),parts[3].toInt());
+			c.removeSelectedText();
+		}
+	}
+
+	QVERIFY(QDocumentJournal::flushAll());
+	QVERIFY(QDocumentJournal::hasRecoveryData(fileName));
+
+	QDocument * restored = loadPlain();
+	QVERIFY(QDocumentJournal::replay(fileName,restored));
+	QEQUAL(restored -> text(),doc -> text());
+
+	// the replay is a single undoable step
+	restored -> undo();
+	QEQUAL(restored -> text(),baseText);
+
+	// regularly closed documents leave no journal behind
+	doc -> stopJournal();
+	QVERIFY(!QDocumentJournal::hasRecoveryData(fileName));
+
+	delete restored;
+	delete doc;
+}
+
+void Test::DocumentJournal::replayRejectsForeignRecords(){
+
+	QDocument * doc = loadJournaled();
+
+	QDocumentCursor c(doc,4,0,4,4);
+	c.removeSelectedText();
+	c.moveTo(3,0);
+	c.insertText("abc");
+
+	QVERIFY(QDocumentJournal::flushAll());
+
+	// the text does not match the file the journal was started on
+	QDocument * other = new QDocument(this);
+	other -> setText("short\ntext",false);
+	QVERIFY(!QDocumentJournal::replay(fileName,other));
+	QEQUAL(other -> text(),QString("short\ntext"));
+
+	doc -> stopJournal();
+	delete other;
+	delete doc;
+}
+
+void Test::DocumentJournal::compaction(){
+
+	QDocumentJournal::setCompactionThreshold(4096);
+
+	QDocument * doc = loadJournaled();
+
+	int recorded = 0;
+
+	for(int i = 0;i < 2000;i++){
+		QDocumentCursor(doc,1,i).insertText("xy");
+		QDocumentCursor(doc,1,i + 1,1,i + 2).removeSelectedText();
+		recorded += (1 + 4 + 4 + 4 + 2 * 2) + (1 + 4 + 4 + 4 + 4);
+	}
+
+	QVERIFY(QDocumentJournal::flushAll());
+
+	// the records were replaced by a snapshot of the text
+	QFileInfo journal(QDocumentJournal::journalFileName(fileName));
+	QVERIFY(journal.exists());
+	QVERIFY2(journal.size() < recorded / 2,qPrintable(QString("%1 bytes journaled for %2 bytes of records").arg(journal.size()).arg(recorded)));
+
+	QDocument * restored = loadPlain();
+	QVERIFY(QDocumentJournal::replay(fileName,restored));
+	QEQUAL(restored -> text(),doc -> text());
+
+	doc -> stopJournal();
+	delete restored;
+	delete doc;
+}
+
+void Test::DocumentJournal::journalLocation(){
+
+	QString journal = QDocumentJournal::journalFileName(fileName);
+
+	QEQUAL(QFileInfo(journal).absolutePath(),QFileInfo(dir -> filePath("journal")).absoluteFilePath());
+	QVERIFY(QFileInfo(journal).fileName().startsWith("journaled.tex-"));
+
+	// files of the same name in different directories do not share a journal
+	QString other = dir -> filePath("sub/journaled.tex");
+	QVERIFY(QDocumentJournal::journalFileName(other) != journal);
+	QEQUAL(QDocumentJournal::journalFileName(QFileInfo(fileName).absoluteFilePath()),journal);
+}
+
+#endif
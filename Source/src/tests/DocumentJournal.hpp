@@ -0,0 +1,48 @@
+#ifndef Test_DocumentJournal
+#define Test_DocumentJournal
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QDocument;
+class QTemporaryDir;
+
+testclass(DocumentJournal){
+
+	Q_OBJECT
+
+	private:
+
+		QTemporaryDir * dir;
+		QString fileName;
+
+		QString savedJournalDirectory;
+		int savedCompactionThreshold;
+
+		QDocument * loadJournaled();
+		QDocument * loadPlain();
+
+	private slots:
+
+		void initTestCase();
+		void cleanupTestCase();
+		void cleanup();
+
+		testcase( recordReplay_data );
+		testcase( recordReplay );
+		testcase( replayRejectsForeignRecords );
+		testcase( compaction );
+		testcase( journalLocation );
+
+	public:
+
+		DocumentJournal();
+		~DocumentJournal();
+
+};
+
+
+#endif
+#endif
@@ -0,0 +1,160 @@
+#ifndef QT_NO_DEBUG
+#include "DocumentMarks.hpp"
+
+//----
+//force full access to qdocument things
+#define private public
+#include "qdocument_p.h"
+#undef private
+//----
+
+#include "qdocument.h"
+#include "qdocumentcursor.h"
+#include "qdocumentline.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+static const int markA = 1;
+static const int markB = 2;
+
+
+Test::DocumentMarks::DocumentMarks(){
+	doc = new QDocument(this);
+}
+
+Test::DocumentMarks::~DocumentMarks(){}
+
+void Test::DocumentMarks::init(){
+
+	QStringList lines;
+
+	for(int i = 0;i < 10;i++)
+		lines << QString("line %1").arg(i);
+
+	doc -> setText(lines.join("\n"),false);
+	doc -> clearUndo();
+}
+
+QString Test::DocumentMarks::marked(int id,int first,int last){
+
+	QStringList lines;
+
+	for(int line : doc -> linesWithMark(id,first,last))
+		lines << QString::number(line);
+
+	return lines.join(",");
+}
+
+// the incrementally updated index has to match one built from scratch
+void Test::DocumentMarks::checkIndex(){
+
+	QDocumentPrivate * d = doc -> impl();
+	const QHash<int,QVector<int>> updated = d -> m_markIndex;
+
+	d -> m_markIndex.clear();
+
+	for(auto it = updated.constBegin();it != updated.constEnd();++it)
+		QVERIFY2(d -> markIndex(it.key()) == it.value(),qPrintable(QString("mark %1").arg(it.key())));
+}
+
+void Test::DocumentMarks::addRemoveKeepsIndex(){
+
+	QEQUAL(marked(markA),QString(""));
+	QEQUAL(marked(-1),QString(""));
+
+	doc -> line(5).addMark(markA);
+	doc -> line(2).addMark(markA);
+	doc -> line(7).addMark(markB);
+	doc -> line(2).addMark(markB);
+
+	// the indexes are updated, not dropped and rebuilt
+	QVERIFY(doc -> impl() -> m_markIndex.contains(markA));
+	QVERIFY(doc -> impl() -> m_markIndex.contains(-1));
+
+	QEQUAL(marked(markA),QString("2,5"));
+	QEQUAL(marked(markB),QString("2,7"));
+	QEQUAL(marked(-1),QString("2,5,7"));
+	checkIndex();
+
+	doc -> line(2).removeMark(markA);
+
+	QVERIFY(doc -> impl() -> m_markIndex.contains(markA));
+	QEQUAL(marked(markA),QString("5"));
+	QEQUAL(marked(-1),QString("2,5,7"));
+
+	doc -> line(2).toggleMark(markB);
+	doc -> line(5).removeMark(markB); // not set, nothing changes
+
+	QEQUAL(marked(markB),QString("7"));
+	QEQUAL(marked(-1),QString("5,7"));
+	QEQUAL(doc -> findNextMark(markA,6),5);
+	QEQUAL(doc -> findPreviousMark(-1,6),5);
+	checkIndex();
+}
+
+void Test::DocumentMarks::removeMarksOfType(){
+
+	doc -> line(1).addMark(markA);
+	doc -> line(3).addMark(markA);
+	doc -> line(3).addMark(markB);
+	doc -> line(8).addMark(markB);
+
+	QEQUAL(marked(-1),QString("1,3,8"));
+	QEQUAL(marked(markA),QString("1,3"));
+
+	doc -> removeMarks(markA);
+
+	QEQUAL(marked(markA),QString(""));
+	QEQUAL(marked(markB),QString("3,8"));
+	QEQUAL(marked(-1),QString("3,8"));
+	QVERIFY(!doc -> line(1).hasMark(markA));
+	checkIndex();
+}
+
+void Test::DocumentMarks::linesInsertedRemoved(){
+
+	doc -> line(2).addMark(markA);
+	doc -> line(6).addMark(markB);
+
+	QEQUAL(marked(-1),QString("2,6"));
+	QEQUAL(marked(markA),QString("2"));
+
+	QDocumentCursor c(doc,1,0);
+	c.insertText("new\nnew\n");
+
+	QEQUAL(marked(-1),QString("4,8"));
+	QEQUAL(marked(markA),QString("4"));
+	checkIndex();
+
+	// removing the marked line, undo brings it back with its mark
+	QDocumentCursor r(doc,3,0,5,0);
+	r.removeSelectedText();
+
+	QEQUAL(marked(-1),QString("6"));
+	QEQUAL(marked(markA),QString(""));
+	checkIndex();
+
+	doc -> undo();
+
+	QEQUAL(marked(-1),QString("4,8"));
+	QEQUAL(marked(markA),QString("4"));
+	checkIndex();
+}
+
+void Test::DocumentMarks::rangeQuery(){
+
+	for(int line : { 0 , 3 , 4 , 9 })
+		doc -> line(line).addMark(markA);
+
+	doc -> line(5).addMark(markB);
+
+	QEQUAL(marked(-1,3,5),QString("3,4,5"));
+	QEQUAL(marked(markA,3,5),QString("3,4"));
+	QEQUAL(marked(markA,1,2),QString(""));
+	QEQUAL(marked(markA,5,3),QString(""));
+	QEQUAL(marked(markA,-2),QString("9"));
+	QEQUAL(marked(markA,0,-2),QString("0,3,4"));
+	QEQUAL(marked(markA,4,100),QString("4,9"));
+}
+
+#endif
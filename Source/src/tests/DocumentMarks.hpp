@@ -0,0 +1,40 @@
+#ifndef Test_DocumentMarks
+#define Test_DocumentMarks
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QDocument;
+
+testclass(DocumentMarks){
+
+	Q_OBJECT
+
+	private:
+
+		QDocument * doc;
+
+		QString marked(int id,int first = 0,int last = -1);
+		void checkIndex();
+
+	private slots:
+
+		void init();
+
+		testcase( addRemoveKeepsIndex );
+		testcase( removeMarksOfType );
+		testcase( linesInsertedRemoved );
+		testcase( rangeQuery );
+
+	public:
+
+		DocumentMarks();
+		~DocumentMarks();
+
+};
+
+
+#endif
+#endif
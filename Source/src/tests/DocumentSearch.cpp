@@ -2,6 +2,7 @@
 #ifndef QT_NO_DEBUG
 #include "mostQtHeaders.h"
 #include "DocumentSearch.hpp"
+#include "qdocument.h"
 #include "qdocumentsearch.h"
 #include "qdocumentline.h"
 #include "qeditor.h"
@@ -670,6 +671,59 @@ void QDocumentSearchTest::searchAndFolding(){
 	}
 }
 
+void QDocumentSearchTest::matchCount_data(){
+	QTest::addColumn<QString>("editorText");
+	QTest::addColumn<QString>("searchText");
+	QTest::addColumn<int>("options");
+	QTest::addColumn<int>("count");
+	QTest::addColumn<int>("editLine");
+	QTest::addColumn<QString>("insertedText");
+	QTest::addColumn<int>("countAfterEdit");
+	QTest::newRow("simple")
+			<< "abc\nxyz abc\nabcabc" << "abc" << 0 << 4
+			<< 1 << "abc " << 5;
+	QTest::newRow("case insensitive")
+			<< "Abc\nabc\nABC" << "abc" << 0 << 3
+			<< 0 << "x" << 3;
+	QTest::newRow("case sensitive")
+			<< "Abc\nabc\nABC" << "abc" << int(QDocumentSearch::CaseSensitive) << 1
+			<< 2 << "abc" << 2;
+	QTest::newRow("whole words")
+			<< "abc abcd\nabc" << "abc" << int(QDocumentSearch::WholeWords) << 2
+			<< 1 << "x" << 1;
+	QTest::newRow("new line")
+			<< "abc\nabc" << "abc" << 0 << 2
+			<< 1 << "abc\nabc\n" << 4;
+	QTest::newRow("empty regexp matches")
+			<< "abc\n\nb" << "x*" << int(QDocumentSearch::RegExp) << 0
+			<< 1 << "xx" << 1;
+}
+
+void QDocumentSearchTest::matchCount(){
+	QFETCH(QString, editorText);
+	QFETCH(QString, searchText);
+	QFETCH(int, options);
+	QFETCH(int, count);
+	QFETCH(int, editLine);
+	QFETCH(QString, insertedText);
+	QFETCH(int, countAfterEdit);
+
+	ed->setText(editorText, false);
+	ds->setCursor(QDocumentCursor());
+	ds->setOptions(static_cast<QDocumentSearch::Options>(options|QDocumentSearch::HighlightAll));
+	ds->setSearchText("");
+	ds->setSearchText(searchText);
+	QTRY_COMPARE(ds->matchCount(), count);
+	QDocument* doc = ed->document();
+	QCOMPARE(ds->matchIndex(doc->cursor(doc->lines()-1, doc->line(doc->lines()-1).length())), count);
+
+	doc->cursor(editLine, 0).insertText(insertedText);
+	QTRY_COMPARE(ds->matchCount(), countAfterEdit);
+	QCOMPARE(ds->matchIndex(doc->cursor(doc->lines()-1, doc->line(doc->lines()-1).length())), countAfterEdit);
+
+	ds->setOptions(QDocumentSearch::Options());
+}
+
 void QDocumentSearchTest::cleanupTestCase(){
 	delete ds;
 }
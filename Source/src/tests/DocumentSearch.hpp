@@ -22,6 +22,8 @@ class QDocumentSearchTest: public QObject{
 		void replaceAll();
 		void searchAndFolding_data();
 		void searchAndFolding();
+		void matchCount_data();
+		void matchCount();
 		void cleanupTestCase();
 };
 
@@ -0,0 +1,162 @@
+#ifndef QT_NO_DEBUG
+#include "DocumentUndoStack.hpp"
+
+//----
+//force full access to qdocument things
+#define private public
+#include "qdocument_p.h"
+#include "qdocumentundostack.h"
+#undef private
+//----
+
+#include "qdocument.h"
+#include "qdocumentcommand.h"
+#include "qdocumentline_p.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+
+Test::DocumentUndoStack::DocumentUndoStack()
+	: savedMemoryLimit(0)
+	, savedSpillEnabled(false){
+
+	doc = new QDocument(this);
+}
+
+Test::DocumentUndoStack::~DocumentUndoStack(){}
+
+QDocumentUndoStack & Test::DocumentUndoStack::stack(){
+	return doc -> impl() -> m_commands;
+}
+
+void Test::DocumentUndoStack::initTestCase(){
+
+	savedMemoryLimit = QDocumentUndoStack::memoryLimit();
+	savedSpillEnabled = QDocumentUndoStack::spillEnabled();
+}
+
+void Test::DocumentUndoStack::cleanupTestCase(){
+
+	QDocumentUndoStack::setMemoryLimit(savedMemoryLimit);
+	QDocumentUndoStack::setSpillEnabled(savedSpillEnabled);
+	doc -> setText("",false);
+}
+
+void Test::DocumentUndoStack::init(){
+
+	QDocumentUndoStack::setMemoryLimit(0);
+	QDocumentUndoStack::setSpillEnabled(false);
+	doc -> setText("abc\ndef\nghi",false);
+	doc -> setClean();
+}
+
+void Test::DocumentUndoStack::pushMerges(){
+
+	doc -> execute(new QDocumentInsertCommand(0,3,"x",doc));
+	doc -> execute(new QDocumentInsertCommand(0,4,"y",doc));
+	doc -> execute(new QDocumentEraseCommand(1,2,1,3,doc));
+	doc -> execute(new QDocumentEraseCommand(1,1,1,2,doc));
+
+	QEQUAL(doc -> text(),QString("abcxy\nd\nghi"));
+	QEQUAL(stack().count(),2);
+
+	doc -> undo();
+	QEQUAL(doc -> text(),QString("abcxy\ndef\nghi"));
+	doc -> undo();
+	QEQUAL(doc -> text(),QString("abc\ndef\nghi"));
+	QVERIFY(doc -> isClean());
+}
+
+void Test::DocumentUndoStack::mergeStopsAtCleanState(){
+
+	doc -> execute(new QDocumentInsertCommand(0,3,"x",doc));
+	doc -> setClean();
+	doc -> execute(new QDocumentInsertCommand(0,4,"y",doc));
+
+	QEQUAL(stack().count(),2);
+
+	doc -> undo();
+	QEQUAL(doc -> text(),QString("abcx\ndef\nghi"));
+	QVERIFY(doc -> isClean());
+}
+
+void Test::DocumentUndoStack::pushDiscardsRedo(){
+
+	doc -> execute(new QDocumentInsertCommand(0,0,"x",doc));
+	doc -> execute(new QDocumentInsertCommand(2,0,"y",doc));
+	doc -> undo();
+
+	QVERIFY(doc -> canRedo());
+
+	doc -> execute(new QDocumentInsertCommand(1,0,"z",doc));
+
+	QVERIFY(!doc -> canRedo());
+	QEQUAL(stack().count(),2);
+	QEQUAL(stack().index(),2);
+	QEQUAL(doc -> text(),QString("xabc\nzdef\nghi"));
+
+	doc -> undo();
+	doc -> undo();
+	QEQUAL(doc -> text(),QString("abc\ndef\nghi"));
+}
+
+void Test::DocumentUndoStack::memoryLimitDropsOldest(){
+
+	QDocumentUndoStack::setMemoryLimit(1);
+
+	for(int i = 0;i < 3;i++)
+		doc -> execute(new QDocumentInsertCommand(i,0,"x",doc));
+
+	// the most recent command always stays undoable
+	QEQUAL(stack().count(),1);
+	QVERIFY(!doc -> isClean());
+
+	doc -> undo();
+	QEQUAL(doc -> text(),QString("xabc\nxdef\nghi"));
+	QVERIFY(!doc -> canUndo());
+	QVERIFY(!doc -> isClean());
+}
+
+void Test::DocumentUndoStack::spillKeepsSharedLines(){
+
+	QStringList lines;
+
+	for(int i = 0;i < 100;i++)
+		lines << QString("line %1").arg(i);
+
+	doc -> setText(lines.join("\n"),false);
+
+	// held elsewhere, e.g. by a cursor or the structure of a latex document
+	QDocumentLineHandle * shared = doc -> line(1).handle();
+	shared -> ref();
+
+	QDocumentLineHandle * owned = doc -> line(2).handle();
+
+	const int erased = 40;
+
+	for(int i = 0;i < erased;i++)
+		doc -> execute(new QDocumentEraseCommand(0,0,1,0,doc));
+
+	QEQUAL(stack().count(),erased);
+	QEQUAL(stack().spilledBytes(),0);
+
+	// compact the history again, now with spilling
+	QDocumentUndoStack::setSpillEnabled(true);
+	QDocumentUndoStack::setMemoryLimit(stack().memoryUsage() * 3 / 2);
+	stack().m_compacted = 0;
+	stack().compactHistory();
+
+	QVERIFY(stack().spilledBytes() > 0);
+	QEQUAL(shared -> text(),QString("line 1"));
+	QVERIFY(owned -> text().isEmpty());
+
+	for(int i = 0;i < erased;i++)
+		doc -> undo();
+
+	QEQUAL(doc -> text(),lines.join("\n"));
+	QEQUAL(owned -> text(),QString("line 2"));
+
+	shared -> deref();
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef Test_DocumentUndoStack
+#define Test_DocumentUndoStack
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QDocument;
+class QDocumentUndoStack;
+
+testclass(DocumentUndoStack){
+
+	Q_OBJECT
+
+	private:
+
+		QDocument * doc;
+
+		qint64 savedMemoryLimit;
+		bool savedSpillEnabled;
+
+		QDocumentUndoStack & stack();
+
+	private slots:
+
+		void initTestCase();
+		void cleanupTestCase();
+		void init();
+
+		testcase( pushMerges );
+		testcase( mergeStopsAtCleanState );
+		testcase( pushDiscardsRedo );
+		testcase( memoryLimitDropsOldest );
+		testcase( spillKeepsSharedLines );
+
+	public:
+
+		DocumentUndoStack();
+		~DocumentUndoStack();
+
+};
+
+
+#endif
+#endif
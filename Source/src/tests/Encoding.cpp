@@ -115,6 +115,39 @@ void Test::Encoding::test_guessEncoding(){
 }
 
 
+void Test::Encoding::test_guessEncodingBasic_data(){
+
+	using namespace Encoding;
+
+	addColumn<QByteArray>("data");
+	addColumn<int>("mib");
+	addColumn<QList<int>>("lineBreaks");
+
+	newRow("empty") << QByteArray() << 0 << QList<int>();
+	newRow("ascii") << QByteArray("\\section{long ascii line}\nfoo") << int(MIB_LATIN1) << (QList<int>() << 25);
+	newRow("line endings") << QByteArray("\na\r\nb\rc\n") << int(MIB_LATIN1) << (QList<int>() << 0 << 2 << 3 << 5 << 7);
+	newRow("utf8") << QByteArray("gr\xC3\xBC\xC3\x9F" "e aus K\xC3\xB6ln\n\xC3\xA4") << int(MIB_UTF8) << (QList<int>() << 17);
+	newRow("windows-1252") << QByteArray("\x93quoted\x94 text over eight bytes\r\n") << int(MIB_WINDOWS1252) << (QList<int>() << 30 << 31);
+}
+
+void Test::Encoding::test_guessEncodingBasic(){
+
+	using namespace Encoding;
+
+	QFETCH(QByteArray,data);
+	QFETCH(int,mib);
+	QFETCH(QList<int>,lineBreaks);
+
+	QVector<int> breaks;
+	int sure = 0;
+
+	auto guess = guessEncodingBasic(data,& sure,& breaks);
+
+	QEQUAL(guess ? guess -> mibEnum() : 0,mib);
+	QCOMPARE(breaks.toList(),lineBreaks);
+}
+
+
 void Test::Encoding::test_encodingEnum(){
 
 	using namespace Encoding;
@@ -25,6 +25,9 @@ testclass(Encoding){
 	testcase( test_guessEncoding_data );
 	testcase( test_guessEncoding );
 
+	testcase( test_guessEncodingBasic_data );
+	testcase( test_guessEncodingBasic );
+
 	testcase( test_encodingEnum );
 };
 
@@ -0,0 +1,104 @@
+#ifndef QT_NO_DEBUG
+#include "tests/FindInDirs.hpp"
+
+#include "findindirs.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+
+// the listings are only dropped by the watcher once events are processed,
+// which these tests do not do, so a stale listing stays until it is cleared
+
+Test::FindInDirs::FindInDirs()
+	: dir(nullptr){}
+
+Test::FindInDirs::~FindInDirs(){}
+
+void Test::FindInDirs::initTestCase(){
+	dir = new QTemporaryDir();
+	QVERIFY(dir -> isValid());
+}
+
+void Test::FindInDirs::cleanupTestCase(){
+	delete dir;
+}
+
+QString Test::FindInDirs::createDir(const QString & name){
+
+	const QString path = dir -> filePath(name);
+
+	QDir().mkpath(path);
+
+	return path;
+}
+
+void Test::FindInDirs::createFile(const QString & directory,const QString & name){
+	QFile file(directory + "/" + name);
+	QVERIFY(file.open(QFile::WriteOnly));
+}
+
+void Test::FindInDirs::cachedListing(){
+
+	const QString main = createDir("cached");
+	createFile(main,"a.tex");
+
+	::FindInDirs find(false,false,main,main);
+
+	QEQUAL(find.findAbsolute("a.tex"),main + "/a.tex");
+	QEQUAL(find.findAbsolute("a.pdf"),QString(""));
+
+	// a miss is answered from the listing
+	createFile(main,"a.pdf");
+	QEQUAL(find.findAbsolute("a.pdf"),QString(""));
+
+	::FindInDirs::clearCache();
+	QEQUAL(find.findAbsolute("a.pdf"),main + "/a.pdf");
+}
+
+void Test::FindInDirs::clearCachedDirs(){
+
+	const QString main = createDir("main");
+	const QString output = createDir("main/output");
+	const QString other = createDir("other");
+
+	::FindInDirs find(false,false,main,main);
+	find.loadDirs(output);
+
+	::FindInDirs findOther(false,false,other,other);
+
+	QEQUAL(find.findAbsolute("a.log"),QString(""));
+	QEQUAL(find.findAbsolute("a.pdf"),QString(""));
+	QEQUAL(findOther.findAbsolute("a.bib"),QString(""));
+
+	createFile(main,"a.log");
+	createFile(output,"a.pdf");
+	createFile(other,"a.bib");
+
+	// only the listings of the loaded directories are dropped
+	find.clearCachedDirs();
+
+	QEQUAL(find.findAbsolute("a.log"),main + "/a.log");
+	QEQUAL(find.findAbsolute("a.pdf"),output + "/a.pdf");
+	QEQUAL(findOther.findAbsolute("a.bib"),QString(""));
+
+	findOther.clearCachedDirs();
+	QEQUAL(findOther.findAbsolute("a.bib"),other + "/a.bib");
+}
+
+void Test::FindInDirs::relativeDirs(){
+
+	const QString main = createDir("relative");
+	const QString build = createDir("relative/build");
+
+	// relative directories are dropped under the same name as they are cached
+	::FindInDirs find(false,false,main,"./build");
+
+	QEQUAL(find.findAbsolute("a.aux"),QString(""));
+	createFile(build,"a.aux");
+	QEQUAL(find.findAbsolute("a.aux"),QString(""));
+
+	::FindInDirs(false,false,main,"build/../build").clearCachedDirs();
+	QEQUAL(find.findAbsolute("a.aux"),build + "/a.aux");
+}
+
+#endif
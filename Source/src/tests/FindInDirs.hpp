@@ -0,0 +1,40 @@
+#ifndef Test_FindInDirs
+#define Test_FindInDirs
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QTemporaryDir;
+
+testclass(FindInDirs){
+
+	Q_OBJECT
+
+	private:
+
+		QTemporaryDir * dir;
+
+		QString createDir(const QString & name);
+		void createFile(const QString & directory,const QString & name);
+
+	private slots:
+
+		void initTestCase();
+		void cleanupTestCase();
+
+		testcase( cachedListing );
+		testcase( clearCachedDirs );
+		testcase( relativeDirs );
+
+	public:
+
+		FindInDirs();
+		~FindInDirs();
+
+};
+
+
+#endif
+#endif
@@ -0,0 +1,255 @@
+#ifndef QT_NO_DEBUG
+#include "tests/GrammarCheckCache.hpp"
+
+#include "grammarcheck.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+using QTest::addColumn;
+using QTest::addRow;
+
+
+const QString language = "en-US";
+const QString rules = "http://localhost:8081/v2/check|WHITESPACE_RULE|";
+
+
+// one line per error: offset+length type 'message' corrections
+
+static QString describe(const QList<GrammarError> & errors){
+
+	QStringList lines;
+
+	for(const auto & error : errors)
+		lines << QString("%1+%2 %3 '%4' %5")
+			.arg(error.offset)
+			.arg(error.length)
+			.arg(int(error.error))
+			.arg(error.message)
+			.arg(error.corrections.join('|'));
+
+	return lines.join("\n");
+}
+
+static QList<GrammarError> someErrors(){
+	return QList<GrammarError>()
+		<< GrammarError(2,3,GET_BACKEND,"Possible typo",QStringList() << "the" << "then")
+		<< GrammarError(10,1,GET_BACKEND_SPECIAL1,"Missing comma");
+}
+
+
+Test::GrammarCheckCache::GrammarCheckCache()
+	: dir(nullptr){}
+
+Test::GrammarCheckCache::~GrammarCheckCache(){}
+
+void Test::GrammarCheckCache::initTestCase(){
+	dir = new QTemporaryDir();
+	QVERIFY(dir -> isValid());
+}
+
+void Test::GrammarCheckCache::cleanupTestCase(){
+	delete dir;
+}
+
+void Test::GrammarCheckCache::splitSentences_data(){
+
+	addColumn<QString>("text");
+	addColumn<QStringList>("sentences");
+
+	addRow("empty")
+		<< ""
+		<< QStringList();
+
+	addRow("one sentence")
+		<< "This is one sentence."
+		<< QStringList { "This is one sentence." };
+
+	addRow("no final punctuation")
+		<< "No end at all"
+		<< QStringList { "No end at all" };
+
+	addRow("punctuation")
+		<< "Is this a question? Yes it is! And this ends here."
+		<< QStringList { "Is this a question?" , "Yes it is!" , "And this ends here." };
+
+	addRow("lower case continuation")
+		<< "This does not end. but continues here."
+		<< QStringList { "This does not end. but continues here." };
+
+	addRow("no space")
+		<< "See version 2.Then continue."
+		<< QStringList { "See version 2.Then continue." };
+
+	addRow("abbreviations")
+		<< "We asked Dr. Miller about it, e.g. Tuesday. Then we left."
+		<< QStringList { "We asked Dr. Miller about it, e.g. Tuesday." , "Then we left." };
+
+	addRow("initials")
+		<< "It was founded in the U.S. By now it is everywhere."
+		<< QStringList { "It was founded in the U.S. By now it is everywhere." };
+
+	// the lines of a block are joined with spaces
+
+	addRow("multiple lines")
+		<< QStringList {
+			"The first sentence ends at the" ,
+			"end of a line. The second one starts on the" ,
+			"same line and continues on the next. Here it" ,
+			"ends!" }.join(' ')
+		<< QStringList {
+			"The first sentence ends at the end of a line." ,
+			"The second one starts on the same line and continues on the next." ,
+			"Here it ends!" };
+}
+
+void Test::GrammarCheckCache::splitSentences(){
+
+	QFETCH(QString,text);
+	QFETCH(QStringList,sentences);
+
+	QStringList split;
+
+	for(const auto & sentence : ::GrammarCheckCache::splitSentences(text))
+		split << text.mid(sentence.offset,sentence.length);
+
+	QEQUALLIST(split,sentences);
+
+	// only the separating spaces are left out
+	QEQUAL(split.join(' '),text);
+}
+
+void Test::GrammarCheckCache::lookup(){
+
+	::GrammarCheckCache cache;
+	QList<GrammarError> errors;
+
+	QVERIFY(!cache.lookup(language,rules,"Thsi is wrong.",errors));
+
+	cache.insert(language,rules,"Thsi is wrong.",someErrors());
+	cache.insert(language,rules,"This is right.",QList<GrammarError>());
+
+	QVERIFY(cache.lookup(language,rules,"Thsi is wrong.",errors));
+	QEQUAL(describe(errors),describe(someErrors()));
+
+	// sentences without errors are cached as well
+	errors = someErrors();
+	QVERIFY(cache.lookup(language,rules,"This is right.",errors));
+	QVERIFY(errors.isEmpty());
+}
+
+void Test::GrammarCheckCache::invalidation(){
+
+	::GrammarCheckCache cache;
+	QList<GrammarError> errors;
+
+	cache.insert(language,rules,"Thsi is wrong.",someErrors());
+
+	QVERIFY(!cache.lookup("de-DE",rules,"Thsi is wrong.",errors));
+	QVERIFY(!cache.lookup(language,rules + "COMMA_RULE","Thsi is wrong.",errors));
+	QVERIFY(!cache.lookup(language,rules,"Thsi is wrong!",errors));
+
+	cache.clear();
+	QVERIFY(!cache.lookup(language,rules,"Thsi is wrong.",errors));
+}
+
+void Test::GrammarCheckCache::leastRecentlyUsed(){
+
+	::GrammarCheckCache cache(2);
+	QList<GrammarError> errors;
+
+	cache.insert(language,rules,"First.",someErrors());
+	cache.insert(language,rules,"Second.",someErrors());
+
+	QVERIFY(cache.lookup(language,rules,"First.",errors));
+
+	cache.insert(language,rules,"Third.",someErrors());
+
+	QVERIFY(cache.lookup(language,rules,"First.",errors));
+	QVERIFY(!cache.lookup(language,rules,"Second.",errors));
+	QVERIFY(cache.lookup(language,rules,"Third.",errors));
+}
+
+void Test::GrammarCheckCache::persistence(){
+
+	const QString fileName = dir -> filePath("persistence.cache");
+
+	{
+		::GrammarCheckCache cache;
+		cache.insert(language,rules,"Thsi is wrong.",someErrors());
+		cache.insert(language,rules,"This is right.",QList<GrammarError>());
+		QVERIFY(cache.save(fileName));
+	}
+
+	::GrammarCheckCache cache;
+	QList<GrammarError> errors;
+
+	QVERIFY(cache.load(fileName));
+
+	QVERIFY(cache.lookup(language,rules,"Thsi is wrong.",errors));
+	QEQUAL(describe(errors),describe(someErrors()));
+
+	QVERIFY(cache.lookup(language,rules,"This is right.",errors));
+	QVERIFY(errors.isEmpty());
+
+	QVERIFY(!cache.lookup("de-DE",rules,"Thsi is wrong.",errors));
+
+	// a cleared cache is saved empty
+	cache.clear();
+	QVERIFY(cache.save(fileName));
+
+	::GrammarCheckCache cleared;
+	QVERIFY(cleared.load(fileName));
+	QVERIFY(!cleared.lookup(language,rules,"Thsi is wrong.",errors));
+}
+
+void Test::GrammarCheckCache::unmodified(){
+
+	const QString fileName = dir -> filePath("unmodified.cache");
+
+	// nothing changed since loading, the file is not written
+	::GrammarCheckCache cache;
+	QVERIFY(!cache.load(fileName));
+	QVERIFY(cache.save(fileName));
+	QVERIFY(!QFile::exists(fileName));
+
+	cache.insert(language,rules,"New.",QList<GrammarError>());
+	QVERIFY(cache.save(fileName));
+	QVERIFY(QFile::exists(fileName));
+}
+
+void Test::GrammarCheckCache::invalidFile(){
+
+	const QString fileName = dir -> filePath("invalid.cache");
+
+	{
+		QFile file(fileName);
+		QVERIFY(file.open(QFile::WriteOnly));
+		file.write("not a cache");
+	}
+
+	::GrammarCheckCache cache;
+	QList<GrammarError> errors;
+
+	QVERIFY(!cache.load(fileName));
+	QVERIFY(!cache.lookup(language,rules,"Thsi is wrong.",errors));
+
+	// a file which ends within an entry keeps the complete entries
+	{
+		::GrammarCheckCache complete;
+		complete.insert(language,rules,"Thsi is wrong.",someErrors());
+		complete.insert(language,rules,"This is right.",QList<GrammarError>());
+		QVERIFY(complete.save(fileName));
+	}
+
+	QFile file(fileName);
+	QVERIFY(file.resize(file.size() - 4));
+
+	::GrammarCheckCache truncated;
+	QVERIFY(!truncated.load(fileName));
+
+	const bool wrong = truncated.lookup(language,rules,"Thsi is wrong.",errors);
+	const bool right = truncated.lookup(language,rules,"This is right.",errors);
+	QVERIFY(wrong != right);
+}
+
+#endif
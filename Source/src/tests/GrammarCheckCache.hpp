@@ -0,0 +1,42 @@
+#ifndef Test_GrammarCheckCache
+#define Test_GrammarCheckCache
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QTemporaryDir;
+
+testclass(GrammarCheckCache){
+
+	Q_OBJECT
+
+	private:
+
+		QTemporaryDir * dir;
+
+	private slots:
+
+		void initTestCase();
+		void cleanupTestCase();
+
+		testcase( splitSentences_data );
+		testcase( splitSentences );
+		testcase( lookup );
+		testcase( invalidation );
+		testcase( leastRecentlyUsed );
+		testcase( persistence );
+		testcase( unmodified );
+		testcase( invalidFile );
+
+	public:
+
+		GrammarCheckCache();
+		~GrammarCheckCache();
+
+};
+
+
+#endif
+#endif
@@ -178,6 +178,97 @@ void ScriptEngineTest::scriptApp(){
     QEQUAL(edView->editor->document()->text(), newText);
 }
 
+void ScriptEngineTest::scriptPool(){
+	// globals of one run must not be visible in the next one on the same engine
+	scriptengine *eng = scriptengine::acquire();
+	eng->setEditorView(edView);
+	eng->setScript("editor.setText(\"Hallo\", false); leaked = 1; let local = 2;");
+	eng->run(true);
+	scriptengine::release(eng);
+
+	QEQUAL(edView->editor->document()->text(), "Hallo");
+
+	scriptengine *reused = scriptengine::acquire();
+	QVERIFY(reused == eng);
+	reused->setEditorView(edView);
+	reused->setScript("let local = 3; editor.setText(typeof leaked + local, false)");
+	reused->run(true);
+	scriptengine::release(reused);
+
+	QEQUAL(edView->editor->document()->text(), "undefined3");
+}
+
+void ScriptEngineTest::scriptPoolBackground_data(){
+	QTest::addColumn<QString>("script");
+	QTest::addColumn<bool>("pooled");
+
+	QTest::newRow("plain")
+		<< "editor.setText(\"x\", false)"
+		<< true;
+
+	QTest::newRow("mentions only")
+		<< "// setTimeout, registerAsBackgroundScript\nvar s = \"a.connect(b)\";"
+		<< true;
+
+	QTest::newRow("connection")
+		<< "editor.cursorPositionChanged.connect(function(){});"
+		<< false;
+
+	QTest::newRow("timer")
+		<< "setTimeout(function(){}, 0);"
+		<< false;
+
+	QTest::newRow("connection not reached")
+		<< "if (false) editor.cursorPositionChanged.connect(function(){});"
+		<< true;
+}
+
+void ScriptEngineTest::scriptPoolBackground(){
+	// only what the script does at runtime keeps its engine out of the pool
+	QFETCH(QString, script);
+	QFETCH(bool, pooled);
+
+	scriptengine *eng = scriptengine::acquire();
+	eng->setEditorView(edView);
+	eng->setScript(script);
+	eng->run(true);
+	scriptengine::release(eng);
+
+	scriptengine *next = scriptengine::acquire();
+	QEQUAL(next == eng, pooled);
+	scriptengine::release(next);
+}
+
+void ScriptEngineTest::scriptPoolTimer(){
+	// a timer may call a function which is local to the run
+	scriptengine *eng = scriptengine::acquire();
+	eng->setEditorView(edView);
+	eng->setScript("function timed(){ editor.setText(\"timed\", false) }\nsetTimeout(timed, 0);");
+	eng->run(true);
+	scriptengine::release(eng);
+
+	QTRY_COMPARE(edView->editor->document()->text(), QString("timed"));
+}
+
+void ScriptEngineTest::scriptPoolGrowth(){
+	// released engines are all kept for reuse
+	QList<scriptengine *> engines;
+	for (int i = 0; i < 6; i++)
+		engines << scriptengine::acquire();
+	for (scriptengine *eng : engines)
+		scriptengine::release(eng);
+
+	QList<scriptengine *> reused;
+	for (int i = 0; i < 6; i++)
+		reused << scriptengine::acquire();
+	for (scriptengine *eng : reused)
+		scriptengine::release(eng);
+
+	std::sort(engines.begin(), engines.end());
+	std::sort(reused.begin(), reused.end());
+	QVERIFY(engines == reused);
+}
+
 void ScriptEngineTest::getLineTokens_data(void)
 {
 	QTest::addColumn<QString>("documentText");
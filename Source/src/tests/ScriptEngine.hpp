@@ -19,6 +19,11 @@ class ScriptEngineTest: public QObject{
 		void script();
         void scriptApp_data();
         void scriptApp();
+		void scriptPool();
+		void scriptPoolBackground_data();
+		void scriptPoolBackground();
+		void scriptPoolTimer();
+		void scriptPoolGrowth();
 		void getLineTokens_data(void);
 		void getLineTokens(void);
 };
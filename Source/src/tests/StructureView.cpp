@@ -11,6 +11,7 @@
 #include <QtTest/QtTest>
 
 #include "Latex/EditorView.hpp"
+#include "Latex/StructureItems.hpp"
 
 StructureViewTest::StructureViewTest(LatexEditorView* editor,LatexDocument *doc, bool all): edView(editor),document(doc), all(all){}
 
@@ -312,5 +313,134 @@ void StructureViewTest::benchmark(){
 	}
 }
 
+static StructureEntry *addSection(LatexDocument *doc, StructureEntry *parent, const QString &title, int pos=-1){
+	StructureEntry *entry=new StructureEntry(doc,StructureEntry::SE_SECTION);
+	entry->title=title;
+	if (pos<0) parent->add(entry);
+	else parent->insert(pos,entry);
+	return entry;
+}
+
+static void buildItems(StructureEntry *entry, QTreeWidgetItem *item){
+	foreach (StructureEntry *child, entry->children) {
+		QTreeWidgetItem *childItem=new QTreeWidgetItem(item,QStringList(child->title));
+		childItem->setData(0,Qt::UserRole,QVariant::fromValue<StructureEntry *>(child));
+		buildItems(child,childItem);
+	}
+}
+
+static QString unrollItems(QTreeWidgetItem *item){
+	QStringList result;
+	for (int i=0;i<item->childCount();i++) {
+		QTreeWidgetItem *child=item->child(i);
+		QString text=child->text(0);
+		if (child->childCount()) text+="("+unrollItems(child)+")";
+		result << text;
+	}
+	return result.join(",");
+}
+
+void StructureViewTest::patchItems_data(){
+	QTest::addColumn<QString>("operation");
+	QTest::addColumn<QString>("expectedItems");
+	QTest::addColumn<QStringList>("keptItems");
+
+	QTest::newRow("insert")
+		<< "insert"
+		<< "a(a1),d,b(b1),c"
+		<< (QStringList() << "a" << "a1" << "b" << "b1" << "c");
+
+	QTest::newRow("remove")
+		<< "remove"
+		<< "a(a1),c"
+		<< (QStringList() << "a" << "a1" << "c");
+
+	QTest::newRow("move up")
+		<< "move up"
+		<< "c,a(a1),b(b1)"
+		<< (QStringList() << "a" << "a1" << "b" << "b1");
+
+	QTest::newRow("move into section")
+		<< "move into section"
+		<< "a(c,a1),b(b1)"
+		<< (QStringList() << "a" << "a1" << "b" << "b1");
+
+	QTest::newRow("rename")
+		<< "rename"
+		<< "x(a1),b(b1),c"
+		<< (QStringList() << "x" << "a1" << "b" << "b1" << "c");
+}
+
+void StructureViewTest::patchItems(){
+	// only the rows which changed are replaced, the index follows the items
+	QFETCH(QString, operation);
+	QFETCH(QString, expectedItems);
+	QFETCH(QStringList, keptItems);
+
+	StructureEntry *base=new StructureEntry(document,StructureEntry::SE_DOCUMENT_ROOT);
+	StructureEntry *a=addSection(document,base,"a");
+	addSection(document,a,"a1");
+	StructureEntry *b=addSection(document,base,"b");
+	addSection(document,b,"b1");
+	StructureEntry *c=addSection(document,base,"c");
+
+	QTreeWidgetItem live;
+	buildItems(base,&live);
+	QHash<StructureEntry *,QTreeWidgetItem *> index;
+	indexStructureItems(&live,&index);
+	const QHash<StructureEntry *,QTreeWidgetItem *> before=index;
+
+	StructureEntry *removed=nullptr;
+	if (operation=="insert") {
+		addSection(document,base,"d",1);
+	} else if (operation=="remove") {
+		base->children.removeOne(b);
+		removed=b;
+	} else if (operation=="move up") {
+		base->children.removeOne(c);
+		base->insert(0,c);
+	} else if (operation=="move into section") {
+		base->children.removeOne(c);
+		a->insert(0,c);
+	} else if (operation=="rename") {
+		a->title="x";
+	}
+
+	QTreeWidgetItem built;
+	buildItems(base,&built);
+	syncStructureItems(&live,&built,&index);
+
+	QEQUAL(unrollItems(&live), expectedItems);
+	for (QHash<StructureEntry *,QTreeWidgetItem *>::const_iterator it=before.constBegin();it!=before.constEnd();++it) {
+		if (keptItems.contains(it.key()->title))
+			QVERIFY2(index.value(it.key())==it.value(),qPrintable(it.key()->title));
+	}
+
+	QHash<StructureEntry *,QTreeWidgetItem *> shown;
+	indexStructureItems(&live,&shown);
+	QVERIFY(index==shown);
+
+	delete removed;
+	delete base;
+}
+
+void StructureViewTest::forgetRemovedEntries(){
+	// a removed entry may be deleted, it must not stay recorded with the entries below it
+	StructureEntry *base=new StructureEntry(document,StructureEntry::SE_DOCUMENT_ROOT);
+	StructureEntry *a=addSection(document,base,"a");
+	StructureEntry *a1=addSection(document,a,"a1");
+	StructureEntry *b=addSection(document,base,"b");
+
+	QSet<StructureEntry *> recorded;
+	recorded << base << a << a1 << b;
+	forgetStructureEntries(a,&recorded);
+
+	QSet<StructureEntry *> expected;
+	expected << base << b;
+	QVERIFY(recorded==expected);
+
+	delete base;
+}
+
 #endif
 
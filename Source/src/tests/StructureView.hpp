@@ -23,6 +23,9 @@ class StructureViewTest: public QObject{
 		void script();
 		void benchmark_data();
 		void benchmark();
+		void patchItems_data();
+		void patchItems();
+		void forgetRemovedEntries();
 };
 
 #endif
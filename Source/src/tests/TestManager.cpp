@@ -10,17 +10,27 @@
 #include "BuildManager.hpp"
 #include "CodeSnippet.hpp"
 #include "DocumentCursor.hpp"
+#include "DocumentDelayedUpdates.hpp"
+#include "DocumentJournal.hpp"
 #include "DocumentLine.hpp"
+#include "DocumentMarks.hpp"
 #include "DocumentSearch.hpp"
+#include "DocumentUndoStack.hpp"
+#include "DictionaryImage.hpp"
+#include "tests/Diff.hpp"
 #include "SearchReplacementPanel.hpp"
 #include "Editor.hpp"
+#include "tests/FindInDirs.hpp"
+#include "tests/GrammarCheckCache.hpp"
 #include "LatexCompleter.hpp"
 #include "LatexEditorView.hpp"
 #include "LatexEditorViewBenchmark.hpp"
 #include "LatexStyleParser.hpp"
 #include "ScriptEngine.hpp"
 #include "tests/StructureView.hpp"
+#include "tests/TextAnalysis.hpp"
 #include "TableManipulation.hpp"
+#include "tests/Thesaurus.hpp"
 #include "SyntaxChecker.hpp"
 #include "UpdateChecker.hpp"
 #include "UtilUI.hpp"
@@ -80,10 +90,18 @@ QString TestManager::execute(TestLevel level, LatexEditorView* edView, QCodeEdit
 		<< new LatexParsingTest()
 		<< new Test::Encoding()
 		<< new ExecProgramTest()
+		<< new Test::FindInDirs()
+		<< new Test::GrammarCheckCache()
 		<< new LatexOutputFilterTest()
 		<< new BuildManagerTest(buildManager)
 		<< new CodeSnippetTest(editor)
 		<< new Test::DocumentLine()
+		<< new Test::DocumentMarks()
+		<< new Test::DocumentJournal()
+		<< new Test::DocumentUndoStack()
+		<< new Test::DocumentDelayedUpdates()
+		<< new Test::DictionaryImage()
+		<< new Test::Diff()
 		<< new QDocumentCursorTest(level==TL_AUTO)
 		<< new QDocumentSearchTest(editor,level==TL_ALL)
 		<< new QSearchReplacePanelTest(codeedit,level==TL_ALL)
@@ -95,6 +113,8 @@ QString TestManager::execute(TestLevel level, LatexEditorView* edView, QCodeEdit
 		<< new LatexEditorViewBenchmark(edView,level==TL_ALL)
 		<< new StructureViewTest(edView,edView->document,level==TL_ALL)
 		<< new TableManipulationTest(editor)
+		<< new Test::TextAnalysis()
+		<< new Test::Thesaurus()
 		<< new SyntaxCheckTest(edView)
 		<< new UpdateCheckerTest(level==TL_ALL)
 		<< new UtilsUITest(level==TL_ALL)
@@ -0,0 +1,109 @@
+#ifndef QT_NO_DEBUG
+#include "tests/TextAnalysis.hpp"
+
+#include "textanalysis.h"
+#include "qdocument.h"
+#include "qdocumentline.h"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+
+// one entry per token: type word start-end, * marks the comment start
+
+static QStringList describe(const TextAnalysisLine & line){
+
+	QStringList tokens;
+
+	for(const auto & token : line.tokens)
+		tokens << QString("%1 %2 %3-%4%5")
+			.arg(token.type)
+			.arg(token.word)
+			.arg(token.start)
+			.arg(token.end)
+			.arg(token.commentStart ? " *" : "");
+
+	return tokens;
+}
+
+static TextAnalysisLine cookieOf(const QDocumentLine & line){
+	return line.getCookie(QDocumentLine::TEXT_ANALYSIS_COOKIE).value<TextAnalysisLine>();
+}
+
+
+Test::TextAnalysis::TextAnalysis()
+	: doc(nullptr){}
+
+Test::TextAnalysis::~TextAnalysis(){}
+
+void Test::TextAnalysis::init(){
+	doc = new QDocument(this);
+}
+
+void Test::TextAnalysis::cleanup(){
+	delete doc;
+	doc = nullptr;
+}
+
+void Test::TextAnalysis::tokens(){
+
+	doc -> setText("Some \\textbf{bold} text. % a Note",false);
+
+	QVERIFY(!doc -> line(0).getCookie(QDocumentLine::TEXT_ANALYSIS_COOKIE).isValid());
+
+	const auto lines = textAnalysisLines(doc);
+
+	QCOMPARE(lines.size(),1);
+	QEQUALLIST(describe(lines[0]),QStringList({
+		"0 some 0-4" ,
+		"1 \\textbf 5-12" ,
+		"0 bold 13-17" ,
+		"0 text 19-24" ,
+		"2 % 25-26 *" ,
+		"2 a 27-28" ,
+		"2 note 29-33" }));
+
+	// the words are stored in the line for the next count
+
+	const auto cached = cookieOf(doc -> line(0));
+
+	QEQUAL(cached.text,doc -> line(0).text());
+	QEQUALLIST(describe(cached),describe(lines[0]));
+}
+
+void Test::TextAnalysis::cachedTokens(){
+
+	doc -> setText("first line\nsecond line\nthird line",false);
+	textAnalysisLines(doc);
+
+	// a cookie matching the text of its line is used as it is, a stale one is replaced
+
+	TextAnalysisToken token;
+	token.word = "cached";
+	token.type = 0;
+	token.start = 0;
+	token.end = 5;
+	token.commentStart = false;
+
+	TextAnalysisLine unchanged;
+	unchanged.text = "first line";
+	unchanged.tokens << token;
+	doc -> line(0).setCookie(QDocumentLine::TEXT_ANALYSIS_COOKIE,QVariant::fromValue(unchanged));
+
+	TextAnalysisLine stale;
+	stale.text = "old line";
+	stale.tokens << token;
+	doc -> line(1).setCookie(QDocumentLine::TEXT_ANALYSIS_COOKIE,QVariant::fromValue(stale));
+
+	const auto lines = textAnalysisLines(doc);
+
+	QCOMPARE(lines.size(),3);
+	QEQUALLIST(describe(lines[0]),QStringList({ "0 cached 0-5" }));
+	QEQUALLIST(describe(lines[1]),QStringList({ "0 second 0-6" , "0 line 7-11" }));
+	QEQUALLIST(describe(lines[2]),QStringList({ "0 third 0-5" , "0 line 6-10" }));
+
+	QEQUAL(cookieOf(doc -> line(1)).text,QString("second line"));
+	QEQUALLIST(describe(cookieOf(doc -> line(1))),describe(lines[1]));
+	QEQUALLIST(describe(cookieOf(doc -> line(0))),QStringList({ "0 cached 0-5" }));
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef Test_TextAnalysis
+#define Test_TextAnalysis
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QDocument;
+
+testclass(TextAnalysis){
+
+	Q_OBJECT
+
+	private:
+
+		QDocument * doc;
+
+	private slots:
+
+		void init();
+		void cleanup();
+
+		testcase( tokens );
+		testcase( cachedTokens );
+
+	public:
+
+		TextAnalysis();
+		~TextAnalysis();
+
+};
+
+
+#endif
+#endif
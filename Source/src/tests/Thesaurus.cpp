@@ -0,0 +1,181 @@
+#ifndef QT_NO_DEBUG
+#include "tests/Thesaurus.hpp"
+
+#include "Dialogs/Thesaurus.hpp"
+#include "tests/Util.hpp"
+#include <QtTest/QtTest>
+
+using QTest::addColumn;
+using QTest::addRow;
+
+static const char * thesaurusText =
+	"UTF-8\n"
+	"house|2\n"
+	"(noun)|home|building\n"
+	"(verb)|lodge\n"
+	"household|1\n"
+	"(noun)|family\n"
+	"mouse|1\n"
+	"(noun)|rodent\n";
+
+// field offsets in the image, see ThesaurusImageHeader and ThesaurusImageKey in thesaurusdialog.cpp
+static const int keyCountField = 24;
+static const int poolLengthField = 36;
+static const int keysOffsetField = 40;
+static const int entriesOffsetField = 44;
+static const int suffixesOffsetField = 48;
+
+static quint32 readField(const QByteArray & image,int offset){
+
+	quint32 value = 0;
+
+	if(offset >= 0 && offset + int(sizeof(value)) <= image.size())
+		memcpy(& value,image.constData() + offset,sizeof(value));
+
+	return value;
+}
+
+static void writeField(QByteArray & image,int offset,quint32 value){
+	if(offset >= 0 && offset + int(sizeof(value)) <= image.size())
+		memcpy(image.data() + offset,& value,sizeof(value));
+}
+
+
+Test::Thesaurus::Thesaurus()
+	: dir(nullptr){}
+
+Test::Thesaurus::~Thesaurus(){}
+
+void Test::Thesaurus::initTestCase(){
+
+	dir = new QTemporaryDir();
+	QVERIFY(dir -> isValid());
+
+	thesaurusFile = dir -> filePath("th_test.dat");
+	imageFile = dir -> filePath("thesaurus/th_test.idx");
+
+	QFile f(thesaurusFile);
+	QVERIFY(f.open(QFile::WriteOnly));
+	f.write(thesaurusText);
+}
+
+void Test::Thesaurus::cleanupTestCase(){
+	delete dir;
+}
+
+void Test::Thesaurus::init(){
+	QFile::remove(imageFile);
+}
+
+QByteArray Test::Thesaurus::readImage(){
+
+	QFile image(imageFile);
+
+	if(!image.open(QFile::ReadOnly))
+		return QByteArray();
+
+	return image.readAll();
+}
+
+void Test::Thesaurus::writeImage(const QByteArray & data){
+
+	QFile image(imageFile);
+	QVERIFY(image.open(QFile::WriteOnly));
+	image.write(data);
+}
+
+void Test::Thesaurus::checkDatabase(){
+
+	QFile file(thesaurusFile);
+	QVERIFY(file.open(QFile::ReadOnly));
+
+	ThesaurusDatabaseType database;
+	database.load(file,imageFile);
+
+	QEQUALLIST(database.lookup("house"),QStringList({ "home|building" , "lodge" }));
+	QEQUALLIST(database.lookup("mouse"),QStringList({ "rodent" }));
+	QVERIFY(database.lookup("hous").isEmpty());
+	QEQUALLIST(database.keysStartingWith("house"),QStringList({ "house" , "household" }));
+	QEQUALLIST(database.keysContaining("ouse"),QStringList({ "house" , "household" , "mouse" }));
+	QEQUALLIST(database.keysContaining("hold"),QStringList({ "household" }));
+}
+
+void Test::Thesaurus::roundTrip(){
+
+	checkDatabase();
+
+	const QByteArray image = readImage();
+	QVERIFY(image.size() > suffixesOffsetField);
+	QEQUAL(readField(image,keyCountField),3u);
+
+	// an image which is used as is, is not written again
+	const QDateTime old = QDateTime::currentDateTime().addDays(-1);
+	{
+		QFile f(imageFile);
+		QVERIFY(f.open(QFile::ReadWrite));
+		QVERIFY(f.setFileTime(old,QFileDevice::FileModificationTime));
+	}
+
+	checkDatabase();
+
+	QEQUAL(QFileInfo(imageFile).lastModified().toMSecsSinceEpoch(),old.toMSecsSinceEpoch());
+	QVERIFY(readImage() == image);
+}
+
+void Test::Thesaurus::damagedImage_data(){
+
+	// the field is given relative to the keys ("key"), entries ("entry"), suffixes ("suffix") or the file ("")
+
+	addColumn<QString>("table");
+	addColumn<int>("offset");
+	addColumn<quint32>("value");
+
+	addRow("truncated") << "" << -1 << 0u;
+	addRow("misaligned keys") << "" << keysOffsetField << 57u;
+	addRow("pool length") << "" << poolLengthField << 0xfffffff0u;
+	addRow("key count") << "" << keyCountField << 0x10000000u;
+	addRow("key start") << "key" << 0 << 0xfffffff0u;
+	addRow("key length") << "key" << 4 << 1000u;
+	addRow("key entries") << "key" << 12 << 1000u;
+	addRow("entry start") << "entry" << 0 << 0x7fffffffu;
+	addRow("entry length") << "entry" << 4 << 1000u;
+	addRow("suffix key") << "suffix" << 0 << 3u;
+	addRow("suffix offset") << "suffix" << 4 << 100u;
+}
+
+void Test::Thesaurus::damagedImage(){
+
+	QFETCH(QString,table);
+	QFETCH(int,offset);
+	QFETCH(quint32,value);
+
+	checkDatabase();
+
+	QByteArray image = readImage();
+
+	if(offset < 0){
+		image.truncate(image.size() / 2);
+	}else{
+
+		if(table == "key")
+			offset += readField(image,keysOffsetField);
+		else if(table == "entry")
+			offset += readField(image,entriesOffsetField);
+		else if(table == "suffix")
+			offset += readField(image,suffixesOffsetField);
+
+		QVERIFY(offset + 4 <= image.size());
+		writeField(image,offset,value);
+	}
+
+	writeImage(image);
+
+	// the thesaurus is parsed again and the image is replaced
+	checkDatabase();
+
+	const QByteArray rewritten = readImage();
+	QVERIFY(rewritten != image);
+	QEQUAL(readField(rewritten,keyCountField),3u);
+}
+
+#endif
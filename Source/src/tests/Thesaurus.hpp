@@ -0,0 +1,44 @@
+#ifndef Test_Thesaurus
+#define Test_Thesaurus
+
+#ifndef QT_NO_DEBUG
+
+#include "mostQtHeaders.h"
+#include "Test.hpp"
+
+class QTemporaryDir;
+
+testclass(Thesaurus){
+
+	Q_OBJECT
+
+	private:
+
+		QTemporaryDir * dir;
+		QString thesaurusFile;
+		QString imageFile;
+
+		void checkDatabase();
+		QByteArray readImage();
+		void writeImage(const QByteArray & data);
+
+	private slots:
+
+		void initTestCase();
+		void cleanupTestCase();
+		void init();
+
+		testcase( roundTrip );
+		testcase( damagedImage_data );
+		testcase( damagedImage );
+
+	public:
+
+		Thesaurus();
+		~Thesaurus();
+
+};
+
+
+#endif
+#endif
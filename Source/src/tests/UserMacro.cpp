@@ -139,3 +139,46 @@ void UserMacro::saveRead(){
     QCOMPARE(macro2.menu,menu);
     QCOMPARE(macro2.description,description);
 }
+
+void UserMacro::triggerSuffix_data(){
+
+    addColumn<QString>("pattern");
+    addColumn<QString>("suffix");
+
+    newRow("plain") << "abc" << "abc";
+    newRow("escaped") << "\\\\sec\\." << "\\sec.";
+    newRow("look behind") << "(\\\\)lr" << "lr";
+    newRow("quantifier") << "ab+c" << "c";
+    newRow("quantifier at end") << "abc*" << "";
+    newRow("class") << "[a-z]]x" << "x";
+    newRow("class with bracket") << "[])]x" << "x";
+    newRow("group with class") << "([)])y" << "y";
+    newRow("group at end") << "x(ab)" << "";
+    newRow("alternative") << "ab|cd" << "";
+    newRow("any") << "a.b" << "b";
+    newRow("word boundary") << "ab\\b" << "";
+    newRow("hex escape") << "\\x0041" << "";
+    newRow("repetition") << "a{2}b" << "b";
+}
+
+void UserMacro::triggerSuffix(){
+
+    QFETCH(QString,pattern);
+    QFETCH(QString,suffix);
+
+    QCOMPARE(MacroTriggerIndex::literalSuffix(pattern),suffix);
+
+    // the index must not drop a macro whose trigger matches
+
+    Macro macro("m",Macro::Snippet,"x","",pattern);
+    QList<Macro> macros;
+    macros << macro;
+
+    MacroTriggerIndex index;
+    index.update(macros);
+
+    QString text = "some text " + suffix;
+
+    if(macro.triggerRegex.indexIn(text) != -1)
+        QCOMPARE(index.candidates(text),QList<int>() << 0);
+}
@@ -21,6 +21,8 @@ testclass(UserMacro){
 
     testcase( saveRead_data );
     testcase( saveRead );
+    testcase( triggerSuffix_data );
+    testcase( triggerSuffix );
 };
 
 
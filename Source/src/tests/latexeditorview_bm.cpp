@@ -8,6 +8,7 @@
 #include "qdocumentline_p.h"
 #include "qeditor.h"
 #include "tests/Util.hpp"
+#include "diffoperations.h"
 
 #include <QtTest/QtTest>
 
@@ -270,5 +271,49 @@ void LatexEditorViewBenchmark::paintEvent(){
 		edView->editor->repaint(edView->rect());
 	}
 }
+
+void LatexEditorViewBenchmark::diffDocs_data(){
+	QTest::addColumn<int>("lines");
+	QTest::addColumn<int>("changeEvery");
+
+	QTest::newRow("small") << 100 << 10;
+
+	if (!all) {
+		qDebug() << "skipped benchmark data";
+		return;
+	}
+
+	QTest::newRow("20k lines, few changes") << 20000 << 1000;
+	QTest::newRow("20k lines, many changes") << 20000 << 20;
+	QTest::newRow("20k lines, rewritten") << 20000 << 1;
+}
+void LatexEditorViewBenchmark::diffDocs(){
+	QFETCH(int, lines);
+	QFETCH(int, changeEvery);
+
+	if (!all) {
+		qDebug() << "skipped benchmark";
+		return;
+	}
+
+	QStringList text, text2;
+	for (int i = 0; i < lines; i++) {
+		QString line = QString("Line %1 of the chapter with some \\textbf{words} and $x_{%2}$.").arg(i).arg(i % 17);
+		text << line;
+		if (i % changeEvery != 0)
+			text2 << line;
+		else if (i % (3 * changeEvery) == 0)
+			text2 << line << "an inserted line";
+		else if (i % (3 * changeEvery) != changeEvery)
+			text2 << line.replace("words", "other words");
+	}
+
+	LatexDocument doc, doc2;
+	doc.setText(text.join("\n"), false);
+	doc2.setText(text2.join("\n"), false);
+	QBENCHMARK_ONCE {
+		::diffDocs(&doc, &doc2);
+	}
+}
 #endif
 
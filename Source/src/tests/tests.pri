@@ -17,15 +17,25 @@ isEmpty(NO_TESTS){
 		src/tests/LatexParsing.cpp                         \
 		src/tests/QCETestUtil.cpp                          \
 		src/tests/DocumentCursor.cpp                       \
+		src/tests/DocumentDelayedUpdates.cpp               \
+		src/tests/DocumentJournal.cpp                      \
 		src/tests/DocumentLine.cpp                         \
+		src/tests/DocumentMarks.cpp                        \
 		src/tests/DocumentSearch.cpp                       \
+		src/tests/DocumentUndoStack.cpp                    \
+		src/tests/DictionaryImage.cpp                      \
+		src/tests/Diff.cpp                                 \
 		src/tests/Editor.cpp                               \
+		src/tests/FindInDirs.cpp                           \
+		src/tests/GrammarCheckCache.cpp                    \
 		src/tests/SearchReplacementPanel.cpp               \
 		src/tests/ScriptEngine.cpp                         \
 		src/tests/Misc.cpp                                 \
 		src/tests/StructureView.cpp                        \
 		src/tests/SyntaxCheck.cpp                          \
 		src/tests/TableManipulation.cpp                    \
+		src/tests/TextAnalysis.cpp                         \
+		src/tests/Thesaurus.cpp                            \
 		src/tests/UserMacro.cpp                            \
 		src/tests/TestManager.cpp                          \
 		src/tests/Git.cpp                                  \
@@ -39,8 +49,14 @@ isEmpty(NO_TESTS){
 		src/tests/SearchReplacementPanel.hpp 			   \
 		src/tests/UpdateChecker.hpp 					   \
 		src/tests/DocumentCursor.hpp  					   \
+		src/tests/DocumentDelayedUpdates.hpp 			   \
+		src/tests/DocumentJournal.hpp 					   \
 		src/tests/DocumentLine.hpp 						   \
+		src/tests/DocumentMarks.hpp 					   \
 		src/tests/DocumentSearch.hpp 					   \
+		src/tests/DocumentUndoStack.hpp 				   \
+		src/tests/DictionaryImage.hpp 					   \
+		src/tests/Diff.hpp 								   \
 		src/tests/CodeSnippet.hpp 						   \
 		src/tests/LatexCompleter.hpp 					   \
 		src/tests/LatexEditorViewBenchmark.hpp 			   \
@@ -52,8 +68,12 @@ isEmpty(NO_TESTS){
 		src/tests/LatexStyleParser.hpp 					   \
 		src/tests/ScriptEngine.hpp 						   \
 		src/tests/Editor.hpp 							   \
+		src/tests/FindInDirs.hpp 						   \
+		src/tests/GrammarCheckCache.hpp 				   \
 		src/tests/BuildManager.hpp 						   \
 		src/tests/TableManipulation.hpp 				   \
+		src/tests/TextAnalysis.hpp 					   \
+		src/tests/Thesaurus.hpp 						   \
 		src/tests/Misc.hpp 								   \
 		src/tests/UtilUI.hpp 							   \
 		src/tests/UtilVersion.hpp 						   \
@@ -28,6 +28,46 @@ class ClsWord {
 };
 
 
+/*!
+ * Word of a line as seen by the text analysis, independent of the analysis options
+ */
+struct TextAnalysisToken {
+
+	QString word; // lower case, without trailing .
+	int type; // 0: text, 1: command, 2: comment, -1: ignored
+	int start , end;
+	bool commentStart;
+
+};
+
+
+/*!
+ * Words of one line, cached in the line cookie QDocumentLine::TEXT_ANALYSIS_COOKIE
+ * so that only changed lines have to be parsed again
+ *
+ * Memory: text shares its data with the line until the line is edited. Each token costs
+ * about 80 bytes on 64 bit (the struct and the lower-cased copy of a typical word), so a
+ * line of prose with a dozen words holds about 1 kB and a 20000 line book about 20 MB
+ * once it has been analyzed. The cookie lives as long as the line, erased lines kept
+ * by the undo stack drop it in releaseCaches().
+ */
+struct TextAnalysisLine {
+
+	QString text;
+	QVector<TextAnalysisToken> tokens;
+
+};
+
+Q_DECLARE_METATYPE(TextAnalysisLine)
+
+
+/*!
+ * Words of all lines of the document, unchanged lines are taken from their cookie,
+ * the others are parsed again (in parallel) and their cookie is updated
+ */
+QVector<TextAnalysisLine> textAnalysisLines(QDocument * document);
+
+
 class TextAnalysisModel : public QAbstractTableModel {
 
 	Q_OBJECT
@@ -67,6 +107,7 @@ class TextAnalysisDialog : public QDialog {
 	QString lastEndCharacters;
 
 	void needCount();
+	void mergeCount(const QVector<QMap<QString,int> > (& chunkMaps)[3],const QVector<int> (& chunkLineCount)[3]);
 	void insertDisplayData(const QMap<QString,int> & map);
 
 	public:
@@ -7,33 +7,61 @@
 #include <QMutex>
 #include <QFuture>
 #include <QtConcurrentRun>
+#include <QCryptographicHash>
+#include <QSaveFile>
+
+#include <algorithm>
 
 //==============================Database=============================
-class ThesaurusDatabaseType
-{
-public:
-	struct TinyStringRef {
-		int start, length;
-		TinyStringRef(int astart, int alen);
-		QString toStringWithBuffer(const QString *buffer);
-	};
-	QString fileName, userFileName;
-	QString *buffer;
-    QMultiMap<QString, TinyStringRef> thesaurus; //maps category => word1|word2|... in most memory efficent format
-	QMap<QString, QStringList> userWords; //maps category => Category/words
-	QMultiMap<QString, QString> userCategories; //maps word => Category
-	void clear();
-	void load(QFile &file);
-	void saveUser();
-	ThesaurusDatabaseType();
-	~ThesaurusDatabaseType();
+/*
+ * The OpenOffice thesaurus text file is parsed once and converted to a binary image
+ * which is memory mapped on later starts:
+ *
+ * header | keys (sorted) | entries | suffixes of all keys (sorted) | string pool (UTF-16)
+ *
+ * The suffix array makes "contains" lookups a binary search instead of a scan over all keys.
+ */
+struct ThesaurusImageHeader {
+	quint32 magic, version;
+	qint64 sourceSize, sourceModified;
+	quint32 keyCount, entryCount, suffixCount, poolLength;
+	quint32 keysOffset, entriesOffset, suffixesOffset, poolOffset;
+};
+
+struct ThesaurusImageKey {
+	quint32 start, length; // in the pool
+	quint32 firstEntry, entryCount;
+};
+
+struct ThesaurusImageEntry {
+	quint32 start, length; // "category|word1|word2|..." in the pool
 };
 
+struct ThesaurusImageSuffix {
+	quint32 key, offset;
+};
+
+namespace {
+const quint32 ThesaurusImageMagic = 0x48545854; // "TXTH"
+const quint32 ThesaurusImageVersion = 1;
+
+// the image depends on the thesaurus file, so it is invalidated when the file changes
+QString thesaurusImageFileName(const QString &userPath, const QFileInfo &source)
+{
+	QByteArray pathHash = QCryptographicHash::hash(source.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+	return QFileInfo(userPath).absolutePath() + "/thesaurus/" + source.completeBaseName() + "-" + pathHash + ".idx";
+}
+}
+
 void ThesaurusDatabaseType::clear()
 {
-	delete buffer;
-    buffer = nullptr;
-	thesaurus.clear();
+	imageFile.clear();
+	image.clear();
+	header = nullptr;
+	keys = nullptr;
+	entries = nullptr;
+	suffixes = nullptr;
+	pool = nullptr;
 	fileName.clear();
 }
 
@@ -50,41 +78,169 @@ void ThesaurusDatabaseType::saveUser()
 	//userFileName.clear(); why was it there? save only once?
 }
 
-void ThesaurusDatabaseType::load(QFile &file)
+/*!
+ * Verifies that data is a complete image of the thesaurus file source and uses it.
+ * Every offset and length in the keys, entries and suffixes is checked against the
+ * pool, so a damaged image is rejected (and rebuilt by load()) instead of being read
+ * out of bounds.
+ */
+bool ThesaurusDatabaseType::setImage(const QByteArray &data, const QFileInfo &source)
 {
-	REQUIRE(!buffer); //only call it once
+	if (data.size() < int(sizeof(ThesaurusImageHeader))) return false;
+	const ThesaurusImageHeader *h = reinterpret_cast<const ThesaurusImageHeader *>(data.constData());
+	if (h->magic != ThesaurusImageMagic || h->version != ThesaurusImageVersion) return false;
+	if (h->sourceSize != source.size() || h->sourceModified != source.lastModified().toMSecsSinceEpoch()) return false;
+	const qint64 size = data.size();
+	if (h->keysOffset + qint64(h->keyCount) * sizeof(ThesaurusImageKey) > size) return false;
+	if (h->entriesOffset + qint64(h->entryCount) * sizeof(ThesaurusImageEntry) > size) return false;
+	if (h->suffixesOffset + qint64(h->suffixCount) * sizeof(ThesaurusImageSuffix) > size) return false;
+	if (h->poolOffset + qint64(h->poolLength) * sizeof(QChar) > size) return false;
+	const quint32 tableAlignment = alignof(quint32);
+	if (h->keysOffset < sizeof(ThesaurusImageHeader) || h->keysOffset % tableAlignment || h->entriesOffset % tableAlignment
+	        || h->suffixesOffset % tableAlignment || h->poolOffset % alignof(QChar)) return false;
+
+	const ThesaurusImageKey *k = reinterpret_cast<const ThesaurusImageKey *>(data.constData() + h->keysOffset);
+	const ThesaurusImageEntry *e = reinterpret_cast<const ThesaurusImageEntry *>(data.constData() + h->entriesOffset);
+	const ThesaurusImageSuffix *s = reinterpret_cast<const ThesaurusImageSuffix *>(data.constData() + h->suffixesOffset);
+	for (quint32 i = 0; i < h->keyCount; i++) {
+		if (qint64(k[i].start) + k[i].length > h->poolLength) return false;
+		if (qint64(k[i].firstEntry) + k[i].entryCount > h->entryCount) return false;
+	}
+	for (quint32 i = 0; i < h->entryCount; i++)
+		if (qint64(e[i].start) + e[i].length > h->poolLength) return false;
+	for (quint32 i = 0; i < h->suffixCount; i++)
+		if (s[i].key >= h->keyCount || s[i].offset >= k[s[i].key].length) return false;
+
+	image = data;
+	header = h;
+	keys = reinterpret_cast<const ThesaurusImageKey *>(data.constData() + h->keysOffset);
+	entries = reinterpret_cast<const ThesaurusImageEntry *>(data.constData() + h->entriesOffset);
+	suffixes = reinterpret_cast<const ThesaurusImageSuffix *>(data.constData() + h->suffixesOffset);
+	pool = reinterpret_cast<const QChar *>(data.constData() + h->poolOffset);
+	return true;
+}
+
+bool ThesaurusDatabaseType::mapImage(const QString &imageFileName, const QFileInfo &source)
+{
+	QSharedPointer<QFile> f(new QFile(imageFileName));
+	if (!f->open(QIODevice::ReadOnly)) return false;
+	uchar *data = f->map(0, f->size());
+	if (!data) return false;
+	if (!setImage(QByteArray::fromRawData(reinterpret_cast<const char *>(data), f->size()), source)) return false;
+	imageFile = f;
+	return true;
+}
+
+QByteArray ThesaurusDatabaseType::buildImage(QFile &file, const QFileInfo &source)
+{
+	struct KeyData {
+		quint32 start, length;
+		QVector<ThesaurusImageEntry> entries;
+	};
+	QString pool;
+	pool.reserve(file.size());
+	QMap<QString, KeyData> thesaurus; //maps category => word1|word2|...
 
 	QTextStream stream(&file);
 	QString line;
-    QString key;
+	KeyData *key = nullptr;
 	line = stream.readLine();
 
-	buffer = new QString();
-	buffer->reserve(file.size());
 	do {
-		int currentBufferLength = buffer->length();
+		int currentPoolLength = pool.length();
 		line = stream.readLine();
 		int firstSplitter = line.indexOf('|');
 		if (firstSplitter >= 0) {
 			if (line.startsWith("-|") || line.startsWith("(") || line.startsWith("|")) {
-				buffer->append(line.mid(firstSplitter + 1));
-				thesaurus.insert(key, ThesaurusDatabaseType::TinyStringRef(currentBufferLength, buffer->length() - currentBufferLength));
-				//using TinyStringRef instead of QString reduces the memory usage (with German thesaurus) by 4mb without any noticable performance decrease (it could even be faster, because the buffer fits better in the cache).
-
+				if (!key) continue;
+				pool.append(line.mid(firstSplitter + 1));
+				ThesaurusImageEntry entry = { quint32(currentPoolLength), quint32(pool.length() - currentPoolLength) };
+				key->entries.append(entry);
 				//TODO: do something something that word type is included in key and still correct search is possible
 			} else {
-				buffer->append(line.left(firstSplitter));
-                key = buffer->mid(currentBufferLength, firstSplitter);
+				QString keyText = line.left(firstSplitter);
+				QMap<QString, KeyData>::iterator it = thesaurus.find(keyText);
+				if (it == thesaurus.end()) {
+					pool.append(keyText);
+					KeyData data;
+					data.start = currentPoolLength;
+					data.length = firstSplitter;
+					it = thesaurus.insert(keyText, data);
+				}
+				key = &it.value();
 			}
 		}
 	} while (!line.isNull());
-	buffer->squeeze();
+
+	QVector<ThesaurusImageKey> keys;
+	QVector<ThesaurusImageEntry> entries;
+	QVector<ThesaurusImageSuffix> suffixes;
+	keys.reserve(thesaurus.size());
+	for (QMap<QString, KeyData>::const_iterator it = thesaurus.constBegin(); it != thesaurus.constEnd(); ++it) {
+		ThesaurusImageKey k = { it->start, it->length, quint32(entries.size()), quint32(it->entries.size()) };
+		for (quint32 o = 0; o < k.length; o++) {
+			ThesaurusImageSuffix suffix = { quint32(keys.size()), o };
+			suffixes.append(suffix);
+		}
+		keys.append(k);
+		entries << it->entries;
+	}
+	const QChar *p = pool.constData();
+	std::sort(suffixes.begin(), suffixes.end(), [&keys, p](const ThesaurusImageSuffix &a, const ThesaurusImageSuffix &b) {
+		const ThesaurusImageKey &ka = keys[a.key], &kb = keys[b.key];
+		return QStringView(p + ka.start + a.offset, ka.length - a.offset) < QStringView(p + kb.start + b.offset, kb.length - b.offset);
+	});
+
+	ThesaurusImageHeader h;
+	memset(&h, 0, sizeof(h));
+	h.magic = ThesaurusImageMagic;
+	h.version = ThesaurusImageVersion;
+	h.sourceSize = source.size();
+	h.sourceModified = source.lastModified().toMSecsSinceEpoch();
+	h.keyCount = keys.size();
+	h.entryCount = entries.size();
+	h.suffixCount = suffixes.size();
+	h.poolLength = pool.length();
+	h.keysOffset = sizeof(h);
+	h.entriesOffset = h.keysOffset + h.keyCount * sizeof(ThesaurusImageKey);
+	h.suffixesOffset = h.entriesOffset + h.entryCount * sizeof(ThesaurusImageEntry);
+	h.poolOffset = h.suffixesOffset + h.suffixCount * sizeof(ThesaurusImageSuffix);
+
+	QByteArray data;
+	data.reserve(h.poolOffset + h.poolLength * sizeof(QChar));
+	data.append(reinterpret_cast<const char *>(&h), sizeof(h));
+	data.append(reinterpret_cast<const char *>(keys.constData()), h.keyCount * sizeof(ThesaurusImageKey));
+	data.append(reinterpret_cast<const char *>(entries.constData()), h.entryCount * sizeof(ThesaurusImageEntry));
+	data.append(reinterpret_cast<const char *>(suffixes.constData()), h.suffixCount * sizeof(ThesaurusImageSuffix));
+	data.append(reinterpret_cast<const char *>(pool.constData()), h.poolLength * sizeof(QChar));
+	return data;
+}
+
+void ThesaurusDatabaseType::load(QFile &file, const QString &imageFileName)
+{
+	REQUIRE(!header); //only call it once
+
+	QFileInfo source(file);
+	if (imageFileName.isEmpty() || !mapImage(imageFileName, source)) {
+		QByteArray data = buildImage(file, source);
+		if (!imageFileName.isEmpty()) {
+			QDir().mkpath(QFileInfo(imageFileName).absolutePath());
+			QSaveFile f(imageFileName);
+			if (f.open(QIODevice::WriteOnly)) {
+				f.write(data);
+				f.commit();
+			}
+		}
+		if (!mapImage(imageFileName, source))
+			setImage(data, source);
+	}
 
 	if (!userFileName.isEmpty()) {
 		//simpler format: category|word|word|...
 		QFile f(userFileName);
 		if (f.open(QIODevice::ReadOnly)) {
 			QTextStream s(&f);
+			QString line;
 
 			do {
 				line = s.readLine();
@@ -100,22 +256,83 @@ void ThesaurusDatabaseType::load(QFile &file)
 	}
 }
 
-ThesaurusDatabaseType::ThesaurusDatabaseType(): buffer(nullptr)
+QStringView ThesaurusDatabaseType::keyAt(int i) const
 {
+	return QStringView(pool + keys[i].start, keys[i].length);
 }
 
-ThesaurusDatabaseType::TinyStringRef::TinyStringRef(int astart, int alen): start(astart), length(alen)
+QStringView ThesaurusDatabaseType::suffixAt(int i) const
 {
+	const ThesaurusImageKey &k = keys[suffixes[i].key];
+	return QStringView(pool + k.start + suffixes[i].offset, k.length - suffixes[i].offset);
 }
 
-ThesaurusDatabaseType::~ThesaurusDatabaseType()
+int ThesaurusDatabaseType::lowerBoundKey(const QString &key) const
 {
-	saveUser();
+	int lo = 0, hi = header->keyCount;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (keyAt(mid) < QStringView(key)) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+/*!
+ * \return the entries "category|word1|word2|..." of key
+ */
+QStringList ThesaurusDatabaseType::lookup(const QString &key) const
+{
+	QStringList result;
+	if (!header) return result;
+	int i = lowerBoundKey(key);
+	if (i >= int(header->keyCount) || keyAt(i) != QStringView(key)) return result;
+	for (quint32 e = keys[i].firstEntry; e < keys[i].firstEntry + keys[i].entryCount; e++)
+		result << QString(pool + entries[e].start, entries[e].length);
+	return result;
+}
+
+QStringList ThesaurusDatabaseType::keysStartingWith(const QString &prefix) const
+{
+	QStringList result;
+	if (!header) return result;
+	for (int i = lowerBoundKey(prefix); i < int(header->keyCount) && keyAt(i).startsWith(prefix); i++)
+		result << keyAt(i).toString();
+	return result;
 }
 
-QString ThesaurusDatabaseType::TinyStringRef::toStringWithBuffer(const QString *buffer)
+/*!
+ * \return all keys containing part, sorted
+ */
+QStringList ThesaurusDatabaseType::keysContaining(const QString &part) const
 {
-	return buffer->mid(start, length);
+	QStringList result;
+	if (!header) return result;
+	if (part.isEmpty()) return keysStartingWith(part);
+
+	int lo = 0, hi = header->suffixCount;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (suffixAt(mid) < QStringView(part)) lo = mid + 1;
+		else hi = mid;
+	}
+	QVector<quint32> found;
+	for (int i = lo; i < int(header->suffixCount) && suffixAt(i).startsWith(part); i++)
+		found << suffixes[i].key;
+	std::sort(found.begin(), found.end());
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+	foreach (quint32 k, found)
+		result << keyAt(k).toString();
+	return result;
+}
+
+ThesaurusDatabaseType::ThesaurusDatabaseType(): header(nullptr), keys(nullptr), entries(nullptr), suffixes(nullptr), pool(nullptr)
+{
+}
+
+ThesaurusDatabaseType::~ThesaurusDatabaseType()
+{
+	saveUser();
 }
 
 static ThesaurusDatabaseType globalThesaurus;
@@ -230,13 +447,12 @@ void ThesaurusDialog::setSearchWord(const QString &word)
 	replacelistWidget->clear();
 	// do all the other calculations
 	QString lowerWord = word.trimmed().toLower();
-    QList<ThesaurusDatabaseType::TinyStringRef> result = thesaurus->thesaurus.values(lowerWord);
+	QStringList result = thesaurus->lookup(lowerWord);
 	// set word classes
 	QString first;
 	if (result.count() > 0) classlistWidget->addItem(tr("<all>"));
 	QStringList realCats;
-	foreach (ThesaurusDatabaseType::TinyStringRef elem, result) {
-		QString selem = elem.toStringWithBuffer(thesaurus->buffer);
+	foreach (const QString &selem, result) {
 		first = selem.left(selem.indexOf('|'));
 		classlistWidget->addItem(first);
 		realCats << first.toLower();
@@ -260,17 +476,17 @@ void ThesaurusDialog::classChanged(int row)
 {
 	if (!thesaurus || row < 0) return;
 	QString lowerWord = searchWrdLe->text().trimmed().toLower();
-    QList<ThesaurusDatabaseType::TinyStringRef> result = thesaurus->thesaurus.values(lowerWord);
+	QStringList result = thesaurus->lookup(lowerWord);
 	QStringList userCats = thesaurus->userCategories.values(lowerWord);
 	if (row - 1 >= userCats.size() + result.size()) return;
 	replacelistWidget->clear();
 	if (row == 0) {
-		foreach (ThesaurusDatabaseType::TinyStringRef elem, result)
-			addItems(elem.toStringWithBuffer(thesaurus->buffer));
+		foreach (const QString &elem, result)
+			addItems(elem);
 		foreach (const QString &elem, userCats)
 			addItems(QStringList(thesaurus->userWords.value(elem.toLower(), QStringList() << "").mid(1)).join("|"));
 	} else if (row - 1 < result.size())
-		addItems(result[row - 1].toStringWithBuffer(thesaurus->buffer));
+		addItems(result[row - 1]);
 	else if (row - 1 - result.size() < userCats.size())
 		addItems(QStringList(thesaurus->userWords.value(userCats[row - 1 - result.size()].toLower(), QStringList() << "").mid(1)).join("|"));
 }
@@ -309,13 +525,7 @@ void ThesaurusDialog::containsClicked()
     word.replace(QRegularExpression(" \\(.*"), "");
 	classlistWidget->clear();
 	replacelistWidget->clear();
-    QMultiMap<QString, ThesaurusDatabaseType::TinyStringRef>::const_iterator i = thesaurus->thesaurus.constBegin();
-    QMultiMap<QString, ThesaurusDatabaseType::TinyStringRef>::const_iterator end = thesaurus->thesaurus.constEnd();
-	while (i != end) {
-        QString skey = i.key();
-		if (!replacelistWidget->findItems(skey, Qt::MatchExactly).count() && skey.contains(word)) replacelistWidget->addItem(skey);
-		++i;
-	}
+	replacelistWidget->addItems(thesaurus->keysContaining(word));
 }
 
 void ThesaurusDialog::startsWithClicked()
@@ -325,14 +535,7 @@ void ThesaurusDialog::startsWithClicked()
     word.replace(QRegularExpression(" \\(.*"), "");
 	classlistWidget->clear();
 	replacelistWidget->clear();
-    QMultiMap<QString, ThesaurusDatabaseType::TinyStringRef>::const_iterator i = thesaurus->thesaurus.lowerBound(word);
-    QMultiMap<QString, ThesaurusDatabaseType::TinyStringRef>::const_iterator end = thesaurus->thesaurus.constEnd();
-	while (i != end) {
-        QString skey = i.key();
-		if (!skey.startsWith(word)) break;
-		if (!replacelistWidget->findItems(skey, Qt::MatchExactly).count()) replacelistWidget->addItem(skey);
-		++i;
-	}
+	replacelistWidget->addItems(thesaurus->keysStartingWith(word));
 }
 
 void ThesaurusDialog::addUserWordClicked()
@@ -412,7 +615,7 @@ void ThesaurusDialog::loadDatabase(const QString &fileName )
 		result.userFileName.clear();
 
 
-	result.load(file);
+	result.load(file, thesaurusImageFileName(userPath, fi));
 
 
 	thesaurusLock.lock();
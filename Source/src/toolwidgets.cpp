@@ -292,7 +292,7 @@ bool OutputViewWidget::isPreviewPanelVisible()
 void OutputViewWidget::setMessage(const QString &message)
 {
 	setCurrentPage(MESSAGES_PAGE);
-	OutputMessages->setText(message);
+	OutputMessages->setPlainText(message);
 }
 
 void OutputViewWidget::insertMessageLine(const QString &message)
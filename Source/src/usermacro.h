@@ -103,6 +103,31 @@ class Macro {
 Q_DECLARE_METATYPE(Macro);
 
 
+/*!
+ * Index over the regex triggers of a macro list.
+ *
+ * All triggers are anchored at the end of the text, so a trigger can only
+ * match if the text ends with the literal characters its pattern ends with.
+ * candidates() uses that to skip most triggers without running their regex.
+ */
+class MacroTriggerIndex {
+
+	public:
+
+		void update(const QList<Macro> & macros);
+		QList<int> candidates(const QString & text) const;
+
+		static QString literalSuffix(const QString & pattern);
+
+	private:
+
+		QList<Macro> indexedMacros; // shares the data of the indexed list as long as it is unchanged
+		QHash<QChar,QList<int> > byLastChar;
+		QList<int> withoutSuffix;
+		QVector<QString> suffixes;
+};
+
+
 class MacroExecContext {
 
 	public: